@@ -0,0 +1,967 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Headless benchmark of b2World::Step on a set of standard scenes. Each scene
+// runs a fixed number of steps and reports the average b2Profile timings,
+// the allocations the world made from its allocator with their peak size, and
+// the peak heap memory behind the world, which includes its arena.
+// --memory adds the b2World::GetMemoryStats breakdown at the end of each
+// scene to the text output. --trace writes the events of a BOX2D_PROFILE
+// build to a Chrome trace file. --reuse enables b2World::SetManifoldReuse.
+//
+// usage: box2d_bench [--csv | --json | --memory] [--steps count] [--trace file] [--reuse] [scene ...]
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+static const int32 k_velocityIterations = 8;
+static const int32 k_positionIterations = 3;
+
+struct Scene
+{
+	const char* name;
+	int32 stepCount;
+	void (*create)(b2World* world);
+	void (*step)(b2World* world, int32 stepIndex);
+};
+
+static b2Body* CreateGround(b2World* world, float32 halfWidth)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2EdgeShape shape;
+	shape.Set(b2Vec2(-halfWidth, 0.0f), b2Vec2(halfWidth, 0.0f));
+	ground->CreateFixture(&shape, 0.0f);
+	return ground;
+}
+
+// Tall columns of boxes: stresses warm starting and the position solver.
+static void CreateVerticalStack(b2World* world)
+{
+	CreateGround(world, 40.0f);
+
+	const int32 columnCount = 10;
+	const int32 rowCount = 30;
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.5f, 0.5f);
+
+	b2FixtureDef fd;
+	fd.shape = &shape;
+	fd.density = 1.0f;
+	fd.friction = 0.3f;
+
+	for (int32 j = 0; j < columnCount; ++j)
+	{
+		for (int32 i = 0; i < rowCount; ++i)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position.Set(-18.0f + 4.0f * j, 0.5f + 1.0f * i);
+			world->CreateBody(&bd)->CreateFixture(&fd);
+		}
+	}
+}
+
+// The classic Box2D pyramid.
+static void CreatePyramid(b2World* world)
+{
+	CreateGround(world, 40.0f);
+
+	const int32 baseCount = 40;
+	const float32 a = 0.5f;
+
+	b2PolygonShape shape;
+	shape.SetAsBox(a, a);
+
+	b2Vec2 x(-(baseCount - 1) * a, 0.75f);
+	b2Vec2 deltaX(0.5625f, 1.25f);
+	b2Vec2 deltaY(1.125f, 0.0f);
+
+	for (int32 i = 0; i < baseCount; ++i)
+	{
+		b2Vec2 y = x;
+
+		for (int32 j = i; j < baseCount; ++j)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position = y;
+			world->CreateBody(&bd)->CreateFixture(&shape, 5.0f);
+
+			y += deltaY;
+		}
+
+		x += deltaX;
+	}
+}
+
+// Convex polygons of 3 to 8 vertices poured into a bin: the polygon
+// narrow phase dominates once the pile settles.
+static void CreatePolygonPile(b2World* world)
+{
+	b2Body* ground = CreateGround(world, 40.0f);
+
+	b2PolygonShape wall;
+	wall.SetAsBox(0.5f, 20.0f, b2Vec2(-15.5f, 20.0f), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+	wall.SetAsBox(0.5f, 20.0f, b2Vec2(15.5f, 20.0f), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+
+	for (int32 i = 0; i < 1200; ++i)
+	{
+		int32 count = 3 + i % 6;
+		float32 radius = 0.4f + 0.02f * (i % 5);
+
+		b2Vec2 vertices[b2_maxPolygonVertices];
+		for (int32 j = 0; j < count; ++j)
+		{
+			float32 angle = 2.0f * b2_pi * j / count;
+			vertices[j].Set(radius * b2Cos(angle), radius * b2Sin(angle));
+		}
+
+		b2PolygonShape shape;
+		shape.Set(vertices, count);
+
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-14.0f + 1.0f * (i % 29) + 0.1f * (i % 3), 1.0f + 1.0f * (i / 29));
+		bd.angle = 0.3f * i;
+		world->CreateBody(&bd)->CreateFixture(&shape, 1.0f);
+	}
+}
+
+// A rotating box that is filled with small bodies, one per step.
+static void CreateTumbler(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.allowSleep = false;
+	bd.position.Set(0.0f, 10.0f);
+	b2Body* body = world->CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.5f, 10.0f, b2Vec2( 10.0f, 0.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(0.5f, 10.0f, b2Vec2(-10.0f, 0.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(10.0f, 0.5f, b2Vec2(0.0f, 10.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+	shape.SetAsBox(10.0f, 0.5f, b2Vec2(0.0f, -10.0f), 0.0);
+	body->CreateFixture(&shape, 5.0f);
+
+	b2RevoluteJointDef jd;
+	jd.bodyA = ground;
+	jd.bodyB = body;
+	jd.localAnchorA.Set(0.0f, 10.0f);
+	jd.localAnchorB.Set(0.0f, 0.0f);
+	jd.referenceAngle = 0.0f;
+	jd.motorSpeed = 0.05f * b2_pi;
+	jd.maxMotorTorque = 1e8f;
+	jd.enableMotor = true;
+	world->CreateJoint(&jd);
+}
+
+static void StepTumbler(b2World* world, int32 stepIndex)
+{
+	if (stepIndex >= 800)
+	{
+		return;
+	}
+
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, 10.0f);
+	b2Body* body = world->CreateBody(&bd);
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.125f, 0.125f);
+	body->CreateFixture(&shape, 1.0f);
+}
+
+// Ragdolls made of capsule-like boxes and limited revolute joints.
+static void CreateRagdoll(b2World* world, const b2Vec2& position)
+{
+	b2PolygonShape shape;
+
+	b2FixtureDef fd;
+	fd.shape = &shape;
+	fd.density = 1.0f;
+	fd.friction = 0.4f;
+	// Bodies of the same ragdoll do not collide.
+	fd.filter.groupIndex = -1;
+
+	struct Part
+	{
+		float32 x, y, hx, hy;
+		int32 parent;
+		float32 jointX, jointY;
+		float32 lower, upper;
+	};
+
+	const Part parts[] =
+	{
+		{ 0.0f, 1.5f, 0.25f, 0.5f, -1, 0.0f, 0.0f, 0.0f, 0.0f },		// torso
+		{ 0.0f, 2.35f, 0.2f, 0.2f, 0, 0.0f, 2.05f, -0.5f, 0.5f },		// head
+		{ -0.45f, 1.8f, 0.2f, 0.08f, 0, -0.25f, 1.8f, -1.5f, 1.5f },	// upper arms
+		{ 0.45f, 1.8f, 0.2f, 0.08f, 0, 0.25f, 1.8f, -1.5f, 1.5f },
+		{ -0.85f, 1.8f, 0.2f, 0.07f, 2, -0.65f, 1.8f, -2.0f, 0.0f },	// lower arms
+		{ 0.85f, 1.8f, 0.2f, 0.07f, 3, 0.65f, 1.8f, 0.0f, 2.0f },
+		{ -0.12f, 0.75f, 0.1f, 0.25f, 0, -0.12f, 1.0f, -0.5f, 1.0f },	// upper legs
+		{ 0.12f, 0.75f, 0.1f, 0.25f, 0, 0.12f, 1.0f, -0.5f, 1.0f },
+		{ -0.12f, 0.25f, 0.09f, 0.25f, 6, -0.12f, 0.5f, -1.5f, 0.0f },	// lower legs
+		{ 0.12f, 0.25f, 0.09f, 0.25f, 7, 0.12f, 0.5f, -1.5f, 0.0f },
+	};
+	const int32 partCount = sizeof(parts) / sizeof(parts[0]);
+
+	b2Body* bodies[partCount];
+	for (int32 i = 0; i < partCount; ++i)
+	{
+		const Part& p = parts[i];
+
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position = position + b2Vec2(p.x, p.y);
+		bodies[i] = world->CreateBody(&bd);
+
+		shape.SetAsBox(p.hx, p.hy);
+		bodies[i]->CreateFixture(&fd);
+
+		if (p.parent >= 0)
+		{
+			b2RevoluteJointDef jd;
+			jd.Initialize(bodies[p.parent], bodies[i], position + b2Vec2(p.jointX, p.jointY));
+			jd.enableLimit = true;
+			jd.lowerAngle = p.lower;
+			jd.upperAngle = p.upper;
+			world->CreateJoint(&jd);
+		}
+	}
+}
+
+static void CreateRagdolls(b2World* world)
+{
+	CreateGround(world, 60.0f);
+
+	const int32 columnCount = 20;
+	const int32 rowCount = 10;
+
+	for (int32 j = 0; j < rowCount; ++j)
+	{
+		for (int32 i = 0; i < columnCount; ++i)
+		{
+			CreateRagdoll(world, b2Vec2(-38.0f + 4.0f * i, 1.0f + 3.0f * j));
+		}
+	}
+}
+
+// Fast bullets against thin static walls: exercises continuous collision.
+static void CreateBullets(b2World* world)
+{
+	b2Body* ground = CreateGround(world, 40.0f);
+
+	b2EdgeShape wall;
+	for (int32 i = 0; i < 8; ++i)
+	{
+		float32 x = -14.0f + 4.0f * i;
+		wall.Set(b2Vec2(x, 0.0f), b2Vec2(x, 20.0f));
+		ground->CreateFixture(&wall, 0.0f);
+	}
+
+	b2PolygonShape thin;
+	thin.SetAsBox(15.0f, 0.05f, b2Vec2(0.0f, 20.0f), 0.0f);
+	ground->CreateFixture(&thin, 0.0f);
+}
+
+static void StepBullets(b2World* world, int32 stepIndex)
+{
+	if (stepIndex % 4 != 0 || world->GetBodyCount() > 400)
+	{
+		return;
+	}
+
+	// Deterministic pseudo random spread.
+	float32 t = 0.61803398875f * stepIndex;
+	t -= (int32)t;
+
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.bullet = true;
+	bd.position.Set(-30.0f, 1.0f + 18.0f * t);
+	bd.linearVelocity.Set(400.0f, 40.0f * (t - 0.5f));
+	b2Body* body = world->CreateBody(&bd);
+
+	if (stepIndex % 8 == 0)
+	{
+		b2CircleShape circle;
+		circle.m_radius = 0.1f;
+		body->CreateFixture(&circle, 1.0f);
+	}
+	else
+	{
+		b2PolygonShape box;
+		box.SetAsBox(0.1f, 0.05f);
+		body->CreateFixture(&box, 1.0f);
+	}
+}
+
+// Volleys of bullets fired through a pile of debris at thin walls. Each
+// volley replaces the previous one and makes hundreds of TOI events.
+static void CreateBulletVolleys(b2World* world)
+{
+	CreateBullets(world);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.2f, 0.2f);
+	for (int32 i = 0; i < 400; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-24.0f + 0.45f * (i % 20), 0.3f + 0.45f * (i / 20));
+		world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+	}
+}
+
+static void FireBulletVolley(b2World* world, int32 stepIndex, bool speculative)
+{
+	if (stepIndex % 30 != 0)
+	{
+		return;
+	}
+
+	b2Body* body = world->GetBodyList();
+	while (body)
+	{
+		b2Body* next = body->GetNext();
+		if (body->IsBullet() || body->IsSpeculative())
+		{
+			world->DestroyBody(body);
+		}
+		body = next;
+	}
+
+	b2CircleShape circle;
+	circle.m_radius = 0.1f;
+
+	for (int32 i = 0; i < 50; ++i)
+	{
+		float32 t = 0.61803398875f * (stepIndex + i);
+		t -= (int32)t;
+
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.bullet = !speculative;
+		bd.speculative = speculative;
+		bd.position.Set(-30.0f, 0.5f + 0.18f * i);
+		bd.linearVelocity.Set(300.0f + 100.0f * t, 40.0f * (t - 0.5f));
+		world->CreateBody(&bd)->CreateFixture(&circle, 1.0f);
+	}
+}
+
+static void StepBulletVolleys(b2World* world, int32 stepIndex)
+{
+	FireBulletVolley(world, stepIndex, false);
+}
+
+// The same volleys using speculative contacts instead of TOI sub-stepping.
+static void StepSpeculativeVolleys(b2World* world, int32 stepIndex)
+{
+	FireBulletVolley(world, stepIndex, true);
+}
+
+// Mixed bodies rolling and resting on hilly chain-shape terrain.
+static void CreateChainTerrain(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	const int32 vertexCount = 1001;
+	b2Vec2* vertices = (b2Vec2*)b2Alloc(vertexCount * sizeof(b2Vec2));
+	for (int32 i = 0; i < vertexCount; ++i)
+	{
+		float32 x = -100.0f + 0.2f * i;
+		vertices[i].Set(x, 2.0f * b2Sin(0.15f * x) + 0.5f * b2Sin(0.9f * x));
+	}
+
+	b2ChainShape chain;
+	chain.CreateChain(vertices, vertexCount);
+	ground->CreateFixture(&chain, 0.0f);
+	b2Free(vertices);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.3f;
+
+	b2PolygonShape box;
+	box.SetAsBox(0.3f, 0.3f);
+
+	b2PolygonShape triangle;
+	b2Vec2 points[3] = { b2Vec2(-0.35f, 0.0f), b2Vec2(0.35f, 0.0f), b2Vec2(0.0f, 0.5f) };
+	triangle.Set(points, 3);
+
+	const b2Shape* shapes[3] = { &circle, &box, &triangle };
+
+	for (int32 i = 0; i < 600; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-95.0f + 0.95f * (i % 200), 5.0f + 1.0f * (i / 200));
+		b2Body* body = world->CreateBody(&bd);
+
+		b2FixtureDef fd;
+		fd.shape = shapes[i % 3];
+		fd.density = 1.0f;
+		fd.friction = 0.6f;
+		body->CreateFixture(&fd);
+	}
+}
+
+// A large field of bodies floating without gravity that are asleep from the
+// start. They are spaced apart because creating a contact wakes both bodies.
+// Now and then a projectile hits the field and wakes a few bodies, which come
+// to rest again because of damping. Measures the per-step overhead that
+// sleeping bodies still cost.
+static void CreateSleepingField(b2World* world)
+{
+	world->SetGravity(b2Vec2_zero);
+
+	const int32 columnCount = 200;
+	const int32 rowCount = 100;
+	const float32 spacing = 1.5f;
+
+	b2PolygonShape shape;
+	shape.SetAsBox(0.45f, 0.45f);
+
+	for (int32 j = 0; j < rowCount; ++j)
+	{
+		for (int32 i = 0; i < columnCount; ++i)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.awake = false;
+			bd.linearDamping = 2.0f;
+			bd.angularDamping = 2.0f;
+			bd.position.Set(spacing * (i - 0.5f * columnCount), spacing * j);
+			world->CreateBody(&bd)->CreateFixture(&shape, 1.0f);
+		}
+	}
+}
+
+static void StepSleepingField(b2World* world, int32 stepIndex)
+{
+	if (stepIndex % 30 != 0)
+	{
+		return;
+	}
+
+	float32 t = 0.61803398875f * stepIndex;
+	t -= (int32)t;
+
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.position.Set(-140.0f + 280.0f * t, 160.0f);
+	bd.linearVelocity.Set(0.0f, -20.0f);
+	bd.linearDamping = 0.5f;
+	b2Body* body = world->CreateBody(&bd);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+	body->CreateFixture(&circle, 1.0f);
+}
+
+// A level of 100 screens, each a region with tiled ground and resting boxes.
+// Only the three screens around the camera are simulated; the camera scrolls
+// one screen every 10 steps, parking the screen behind it and unparking the
+// one ahead. Measures the cost of streaming a level through the world.
+static const int32 k_levelScreenCount = 100;
+static const int32 k_levelVisibleCount = 3;
+static const float32 k_levelScreenWidth = 20.0f;
+
+static void CreateStreamingLevel(b2World* world)
+{
+	b2PolygonShape tile;
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+
+	for (int32 screen = 0; screen < k_levelScreenCount; ++screen)
+	{
+		float32 x0 = k_levelScreenWidth * screen;
+
+		b2BodyDef groundDef;
+		groundDef.region = screen;
+		b2Body* ground = world->CreateBody(&groundDef);
+		for (int32 i = 0; i < 40; ++i)
+		{
+			float32 y = (i % 8 == 0) ? 0.5f : 0.0f;
+			tile.SetAsBox(0.25f, 0.25f, b2Vec2(x0 + 0.5f * i, y), 0.0f);
+			ground->CreateFixture(&tile, 0.0f);
+		}
+
+		for (int32 i = 0; i < 20; ++i)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.region = screen;
+			bd.position.Set(x0 + 1.0f + 0.9f * (i % 10), 1.0f + 0.9f * (i / 10));
+			world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+		}
+
+		if (screen >= k_levelVisibleCount)
+		{
+			world->ParkRegion(screen);
+		}
+	}
+}
+
+static void StepStreamingLevel(b2World* world, int32 stepIndex)
+{
+	int32 screen = stepIndex / 10;
+	if (stepIndex % 10 != 0 || screen == 0 || screen + k_levelVisibleCount > k_levelScreenCount)
+	{
+		return;
+	}
+
+	world->ParkRegion(screen - 1);
+	world->UnparkRegion(screen + k_levelVisibleCount - 1);
+}
+
+// The streaming level placed a thousand kilometers out, where float32 has a
+// resolution of 6 cm. The world origin follows the camera, so the simulated
+// screens stay close to it. Parked screens are shifted when unparked.
+static void CreateEndlessRunner(b2World* world)
+{
+	world->ShiftOrigin(b2Vec2(1.0e6f, 0.0f));
+	CreateStreamingLevel(world);
+}
+
+static void StepEndlessRunner(b2World* world, int32 stepIndex)
+{
+	int32 screen = stepIndex / 10;
+	if (stepIndex % 10 != 0 || screen == 0 || screen + k_levelVisibleCount > k_levelScreenCount)
+	{
+		return;
+	}
+
+	StepStreamingLevel(world, stepIndex);
+	world->ShiftOrigin(b2Vec2(k_levelScreenWidth, 0.0f));
+}
+
+// A platformer level: rows of kinematic platforms that move back and forth and
+// reverse every second, and spinning kinematic hazards. Every fourth platform
+// carries two boxes that don't touch each other.
+static void CreateMovingPlatforms(b2World* world)
+{
+	CreateGround(world, 200.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+
+	b2PolygonShape platform;
+	platform.SetAsBox(2.0f, 0.25f);
+
+	b2PolygonShape blade;
+	blade.SetAsBox(1.5f, 0.1f);
+
+	for (int32 j = 0; j < 20; ++j)
+	{
+		for (int32 i = 0; i < 20; ++i)
+		{
+			b2BodyDef pd;
+			pd.type = b2_kinematicBody;
+			pd.position.Set(-190.0f + 19.0f * i, 4.0f + 5.0f * j);
+			pd.linearVelocity.Set((i + j) % 2 == 0 ? 1.5f : -1.5f, 0.0f);
+			world->CreateBody(&pd)->CreateFixture(&platform, 0.0f);
+
+			if ((i + j) % 4 == 0)
+			{
+				for (int32 k = 0; k < 2; ++k)
+				{
+					b2BodyDef bd;
+					bd.type = b2_dynamicBody;
+					bd.position.Set(pd.position.x - 1.0f + 2.0f * k, pd.position.y + 0.65f);
+					world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+				}
+			}
+
+			b2BodyDef hd;
+			hd.type = b2_kinematicBody;
+			hd.position.Set(pd.position.x + 9.5f, pd.position.y + 2.0f);
+			hd.angularVelocity = 2.0f;
+			world->CreateBody(&hd)->CreateFixture(&blade, 0.0f);
+		}
+	}
+}
+
+static void StepMovingPlatforms(b2World* world, int32 stepIndex)
+{
+	if (stepIndex % 60 != 0)
+	{
+		return;
+	}
+
+	for (b2Body* b = world->GetBodyList(); b; b = b->GetNext())
+	{
+		if (b->GetType() == b2_kinematicBody && b->GetAngularVelocity() == 0.0f)
+		{
+			b->SetLinearVelocity(-b->GetLinearVelocity());
+		}
+	}
+}
+
+static const Scene k_scenes[] =
+{
+	{ "vertical_stack", 600, CreateVerticalStack, NULL },
+	{ "pyramid", 600, CreatePyramid, NULL },
+	{ "polygon_pile", 600, CreatePolygonPile, NULL },
+	{ "tumbler", 1000, CreateTumbler, StepTumbler },
+	{ "ragdolls", 600, CreateRagdolls, NULL },
+	{ "bullets", 600, CreateBullets, StepBullets },
+	{ "bullet_volleys", 600, CreateBulletVolleys, StepBulletVolleys },
+	{ "speculative_volleys", 600, CreateBulletVolleys, StepSpeculativeVolleys },
+	{ "chain_terrain", 600, CreateChainTerrain, NULL },
+	{ "sleeping_field", 600, CreateSleepingField, StepSleepingField },
+	{ "streaming_level", 1000, CreateStreamingLevel, StepStreamingLevel },
+	{ "endless_runner", 1000, CreateEndlessRunner, StepEndlessRunner },
+	{ "moving_platforms", 600, CreateMovingPlatforms, StepMovingPlatforms },
+};
+static const int32 k_sceneCount = sizeof(k_scenes) / sizeof(k_scenes[0]);
+
+struct Result
+{
+	const char* name;
+	int32 stepCount;
+	int32 bodyCount;
+	int32 contactCount;
+	int32 jointCount;
+	float64 totalTime;
+	float64 maxStep;
+	b2Profile average;
+	int32 toiEvents;
+	int32 maxTOIEvents;
+	int32 manifoldsReused;
+	int32 allocCount;
+	int32 freeCount;
+	int32 peakBytes;
+	int32 heapPeakBytes;
+	b2MemoryStats memory;
+};
+
+static void RunScene(const Scene& scene, int32 stepCount, bool reuse, Result* result)
+{
+	// The world arena is given explicitly so the heap behind it can be counted.
+	b2StatsAllocator heap;
+	b2ArenaAllocator arena(b2_arenaSize, &heap);
+
+	b2WorldDef def;
+	def.allocator = &arena;
+	def.manifoldReuse = reuse;
+	b2World* world = new b2World(&def);
+	scene.create(world);
+
+	b2Profile sum;
+	memset(&sum, 0, sizeof(sum));
+	float64 maxStep = 0.0;
+	int32 maxTOIEvents = 0;
+
+	b2Timer timer;
+	for (int32 i = 0; i < stepCount; ++i)
+	{
+		if (scene.step)
+		{
+			scene.step(world, i);
+		}
+
+		world->Step(k_timeStep, k_velocityIterations, k_positionIterations);
+
+		const b2Profile& p = world->GetProfile();
+		sum.step += p.step;
+		sum.collide += p.collide;
+		sum.solve += p.solve;
+		sum.solveInit += p.solveInit;
+		sum.solveVelocity += p.solveVelocity;
+		sum.solvePosition += p.solvePosition;
+		sum.broadphase += p.broadphase;
+		sum.solveTOI += p.solveTOI;
+		sum.buildIslands += p.buildIslands;
+		sum.toiEvents += p.toiEvents;
+		sum.manifoldsReused += p.manifoldsReused;
+		maxStep = b2Max(maxStep, float64(p.step));
+		maxTOIEvents = b2Max(maxTOIEvents, p.toiEvents);
+	}
+	float64 totalTime = timer.GetMilliseconds();
+
+	const b2AllocStats& stats = world->GetAllocStats();
+
+	float32 scale = stepCount > 0 ? 1.0f / stepCount : 0.0f;
+	result->name = scene.name;
+	result->stepCount = stepCount;
+	result->bodyCount = world->GetBodyCount();
+	result->contactCount = world->GetContactCount();
+	result->jointCount = world->GetJointCount();
+	result->totalTime = totalTime;
+	result->maxStep = maxStep;
+	result->average.step = scale * sum.step;
+	result->average.collide = scale * sum.collide;
+	result->average.solve = scale * sum.solve;
+	result->average.solveInit = scale * sum.solveInit;
+	result->average.solveVelocity = scale * sum.solveVelocity;
+	result->average.solvePosition = scale * sum.solvePosition;
+	result->average.broadphase = scale * sum.broadphase;
+	result->average.solveTOI = scale * sum.solveTOI;
+	result->average.buildIslands = scale * sum.buildIslands;
+	result->toiEvents = sum.toiEvents;
+	result->maxTOIEvents = maxTOIEvents;
+	result->manifoldsReused = sum.manifoldsReused;
+	result->allocCount = stats.allocCount;
+	result->freeCount = stats.freeCount;
+	result->peakBytes = stats.peakBytes;
+	result->heapPeakBytes = heap.GetStats().peakBytes;
+	world->GetMemoryStats(&result->memory);
+
+	delete world;
+}
+
+enum Format
+{
+	e_text,
+	e_csv,
+	e_json
+};
+
+static void PrintHeader(Format format)
+{
+	if (format == e_csv)
+	{
+		printf("scene,steps,bodies,contacts,joints,total_ms,max_step_ms,step_ms,collide_ms,solve_ms,"
+			"solve_init_ms,solve_velocity_ms,solve_position_ms,broadphase_ms,solve_toi_ms,build_islands_ms,"
+			"toi_events,max_toi_events,manifolds_reused,alloc_count,free_count,peak_bytes,heap_peak_bytes\n");
+	}
+	else if (format == e_json)
+	{
+		printf("[\n");
+	}
+	else
+	{
+		printf("%-20s %6s %7s %9s %9s %9s %9s %9s %9s %9s %9s %12s\n",
+			"scene", "steps", "bodies", "step", "max", "collide", "solve", "velocity", "position", "toi",
+			"allocs", "peak bytes");
+	}
+}
+
+static void PrintResult(Format format, const Result& r, bool last)
+{
+	const b2Profile& p = r.average;
+	if (format == e_csv)
+	{
+		printf("%s,%d,%d,%d,%d,%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%d\n",
+			r.name, r.stepCount, r.bodyCount, r.contactCount, r.jointCount, r.totalTime, r.maxStep,
+			p.step, p.collide, p.solve, p.solveInit, p.solveVelocity, p.solvePosition, p.broadphase,
+			p.solveTOI, p.buildIslands, r.toiEvents, r.maxTOIEvents, r.manifoldsReused, r.allocCount, r.freeCount,
+			r.peakBytes, r.heapPeakBytes);
+	}
+	else if (format == e_json)
+	{
+		printf("  {\"scene\": \"%s\", \"steps\": %d, \"bodies\": %d, \"contacts\": %d, \"joints\": %d,\n",
+			r.name, r.stepCount, r.bodyCount, r.contactCount, r.jointCount);
+		printf("   \"total_ms\": %.3f, \"max_step_ms\": %.4f,\n", r.totalTime, r.maxStep);
+		printf("   \"profile_ms\": {\"step\": %.4f, \"collide\": %.4f, \"solve\": %.4f, \"solve_init\": %.4f, "
+			"\"solve_velocity\": %.4f, \"solve_position\": %.4f, \"broadphase\": %.4f, \"solve_toi\": %.4f, "
+			"\"build_islands\": %.4f},\n",
+			p.step, p.collide, p.solve, p.solveInit, p.solveVelocity, p.solvePosition, p.broadphase,
+			p.solveTOI, p.buildIslands);
+		printf("   \"toi_events\": %d, \"max_toi_events\": %d, \"manifolds_reused\": %d,\n",
+			r.toiEvents, r.maxTOIEvents, r.manifoldsReused);
+		printf("   \"alloc_count\": %d, \"free_count\": %d, \"peak_bytes\": %d, \"heap_peak_bytes\": %d}%s\n",
+			r.allocCount, r.freeCount, r.peakBytes, r.heapPeakBytes, last ? "" : ",");
+	}
+	else
+	{
+		printf("%-20s %6d %7d %9.4f %9.4f %9.4f %9.4f %9.4f %9.4f %9.4f %9d %12d\n",
+			r.name, r.stepCount, r.bodyCount, p.step, r.maxStep, p.collide, p.solve, p.solveVelocity,
+			p.solvePosition, p.solveTOI, r.allocCount, r.peakBytes);
+	}
+}
+
+static void PrintObjectMemory(const char* name, const b2ObjectMemory& memory)
+{
+	printf("  %-10s %8d %12d\n", name, memory.count, memory.bytes);
+}
+
+static void PrintMemory(const b2MemoryStats& m)
+{
+	printf("  %-10s %8s %12s\n", "object", "count", "bytes");
+	PrintObjectMemory("bodies", m.bodies);
+	PrintObjectMemory("fixtures", m.fixtures);
+	PrintObjectMemory("shapes", m.shapes);
+	PrintObjectMemory("contacts", m.contacts);
+	PrintObjectMemory("manifolds", m.manifolds);
+	PrintObjectMemory("joints", m.joints);
+	PrintObjectMemory("islands", m.islands);
+	PrintObjectMemory("regions", m.regions);
+	PrintObjectMemory("proxies", m.proxies);
+	printf("  %-10s %8s %12d\n", "stack", "", m.stackBytes);
+
+	printf("  %-10s %8s %8s %8s\n", "block", "chunks", "used", "free");
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		const b2BlockClassStats& c = m.blockClasses[i];
+		if (c.chunkCount > 0)
+		{
+			printf("  %-10d %8d %8d %8d\n", c.blockSize, c.chunkCount, c.usedCount, c.freeCount);
+		}
+	}
+}
+
+static void PrintFooter(Format format)
+{
+	if (format == e_json)
+	{
+		printf("]\n");
+	}
+}
+
+static void PrintUsage()
+{
+	printf("usage: box2d_bench [--csv | --json | --memory] [--steps count] [--trace file] [--reuse] [scene ...]\n");
+	printf("scenes:");
+	for (int32 i = 0; i < k_sceneCount; ++i)
+	{
+		printf(" %s", k_scenes[i].name);
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	Format format = e_text;
+	bool printMemory = false;
+	int32 stepCount = 0;
+	const char* tracePath = NULL;
+	bool reuse = false;
+	bool selected[k_sceneCount];
+	bool anySelected = false;
+	memset(selected, 0, sizeof(selected));
+
+	for (int32 i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--csv") == 0)
+		{
+			format = e_csv;
+		}
+		else if (strcmp(argv[i], "--json") == 0)
+		{
+			format = e_json;
+		}
+		else if (strcmp(argv[i], "--memory") == 0)
+		{
+			printMemory = true;
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+		{
+			stepCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			tracePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--reuse") == 0)
+		{
+			reuse = true;
+		}
+		else
+		{
+			int32 index = -1;
+			for (int32 j = 0; j < k_sceneCount; ++j)
+			{
+				if (strcmp(argv[i], k_scenes[j].name) == 0)
+				{
+					index = j;
+				}
+			}
+
+			if (index < 0)
+			{
+				PrintUsage();
+				return 1;
+			}
+
+			selected[index] = true;
+			anySelected = true;
+		}
+	}
+
+	int32 lastIndex = -1;
+	for (int32 i = 0; i < k_sceneCount; ++i)
+	{
+		if (anySelected == false || selected[i])
+		{
+			lastIndex = i;
+		}
+	}
+
+	if (tracePath)
+	{
+		b2StartTrace();
+	}
+
+	PrintHeader(format);
+	for (int32 i = 0; i < k_sceneCount; ++i)
+	{
+		if (anySelected && selected[i] == false)
+		{
+			continue;
+		}
+
+		const Scene& scene = k_scenes[i];
+		Result result;
+		{
+			b2TraceScope(scene.name);
+			RunScene(scene, stepCount > 0 ? stepCount : scene.stepCount, reuse, &result);
+		}
+		PrintResult(format, result, i == lastIndex);
+		if (printMemory && format == e_text)
+		{
+			PrintMemory(result.memory);
+		}
+		fflush(stdout);
+	}
+	PrintFooter(format);
+
+	if (tracePath)
+	{
+		b2StopTrace();
+		if (b2GetTraceEventCount() == 0)
+		{
+			fprintf(stderr, "no trace events, build with BOX2D_PROFILE\n");
+		}
+
+		if (b2SaveChromeTrace(tracePath) == false)
+		{
+			fprintf(stderr, "cannot write %s\n", tracePath);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,212 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <Box2D/Common/b2ConcurrentBlockAllocator.h>
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+// Creates and destroys one million contact and manifold blocks from eight threads.
+// Each round every thread allocates a batch and then frees the batch of its
+// neighbor, so half of the traffic crosses threads. A b2BlockAllocator behind
+// a global lock is the baseline.
+
+const int32 e_threadCount = 8;
+const int32 e_totalContacts = 1000000;
+const int32 e_roundSize = 5000;
+
+static const int32 k_contactSizes[] =
+{
+	sizeof(b2Contact),
+	sizeof(b2Manifold),
+};
+static const int32 k_contactSizeCount = sizeof(k_contactSizes) / sizeof(k_contactSizes[0]);
+
+class Barrier
+{
+public:
+	Barrier(int32 count) : m_count(count), m_waiting(0), m_generation(0) {}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		int32 generation = m_generation;
+		if (++m_waiting == m_count)
+		{
+			m_waiting = 0;
+			++m_generation;
+			m_condition.notify_all();
+			return;
+		}
+
+		while (generation == m_generation)
+		{
+			m_condition.wait(lock);
+		}
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	int32 m_count;
+	int32 m_waiting;
+	int32 m_generation;
+};
+
+class LockedBlockAllocator
+{
+public:
+	void* Allocate(int32 size)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		return m_allocator.Allocate(size);
+	}
+
+	void Free(void* p, int32 size)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_allocator.Free(p, size);
+	}
+
+	void Rebalance()
+	{
+	}
+
+private:
+	std::mutex m_mutex;
+	b2BlockAllocator m_allocator;
+};
+
+struct Slot
+{
+	void* p;
+	int32 size;
+};
+
+template <typename Allocator>
+static void Worker(Allocator* allocator, Barrier* barrier, std::vector<Slot>* slots, int32 threadIndex,
+				   int32 roundCount, bool* valid)
+{
+	std::vector<Slot>& mine = slots[threadIndex];
+	std::vector<Slot>& neighbor = slots[(threadIndex + 1) % e_threadCount];
+
+	for (int32 round = 0; round < roundCount; ++round)
+	{
+		for (int32 i = 0; i < e_roundSize; ++i)
+		{
+			int32 size = k_contactSizes[(i + round + threadIndex) % k_contactSizeCount];
+			void* p = allocator->Allocate(size);
+			// Tag the block so overlapping blocks are detected.
+			memset(p, threadIndex + 1, size);
+			mine[i].p = p;
+			mine[i].size = size;
+		}
+
+		barrier->Wait();
+
+		for (int32 i = 0; i < e_roundSize; ++i)
+		{
+			const Slot& slot = neighbor[i];
+			uint8 tag = (uint8)((threadIndex + 1) % e_threadCount + 1);
+			const uint8* bytes = (const uint8*)slot.p;
+			if (bytes[0] != tag || bytes[slot.size - 1] != tag)
+			{
+				*valid = false;
+			}
+			allocator->Free(slot.p, slot.size);
+		}
+
+		barrier->Wait();
+
+		// The main thread would do this between parallel phases.
+		if (threadIndex == 0 && round % 8 == 7)
+		{
+			allocator->Rebalance();
+		}
+
+		barrier->Wait();
+	}
+}
+
+template <typename Allocator>
+static float64 Run(Allocator* allocator, bool* valid)
+{
+	int32 roundCount = e_totalContacts / (e_threadCount * e_roundSize);
+
+	std::vector<Slot> slots[e_threadCount];
+	for (int32 i = 0; i < e_threadCount; ++i)
+	{
+		slots[i].resize(e_roundSize);
+	}
+
+	bool threadValid[e_threadCount];
+	Barrier barrier(e_threadCount);
+
+	b2Timer timer;
+	std::vector<std::thread> threads;
+	for (int32 i = 0; i < e_threadCount; ++i)
+	{
+		threadValid[i] = true;
+		threads.push_back(std::thread(Worker<Allocator>, allocator, &barrier, slots, i, roundCount, threadValid + i));
+	}
+
+	for (int32 i = 0; i < e_threadCount; ++i)
+	{
+		threads[i].join();
+	}
+	float64 time = timer.GetMilliseconds();
+
+	*valid = true;
+	for (int32 i = 0; i < e_threadCount; ++i)
+	{
+		*valid = *valid && threadValid[i];
+	}
+
+	return time;
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	int32 roundCount = e_totalContacts / (e_threadCount * e_roundSize);
+	int32 contactCount = roundCount * e_threadCount * e_roundSize;
+	printf("threads: %d\n", e_threadCount);
+	printf("contacts created and destroyed: %d\n", contactCount);
+
+	bool lockedValid;
+	LockedBlockAllocator locked;
+	float64 lockedTime = Run(&locked, &lockedValid);
+	printf("locked b2BlockAllocator: %.2f ms (%.1f M contacts/s)%s\n",
+		lockedTime, 1e-3 * contactCount / lockedTime, lockedValid ? "" : " CORRUPTED");
+
+	bool concurrentValid;
+	b2ConcurrentBlockAllocator concurrent;
+	float64 concurrentTime = Run(&concurrent, &concurrentValid);
+	printf("b2ConcurrentBlockAllocator: %.2f ms (%.1f M contacts/s), %d chunks%s\n",
+		concurrentTime, 1e-3 * contactCount / concurrentTime, concurrent.GetChunkCount(),
+		concurrentValid ? "" : " CORRUPTED");
+
+	return lockedValid && concurrentValid ? 0 : 1;
+}
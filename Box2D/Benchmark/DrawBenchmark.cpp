@@ -0,0 +1,212 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <stdio.h>
+#include <vector>
+
+// Draws a world of 10000 bodies each frame, once through a b2Draw that
+// tessellates and buffers every primitive the way the testbed renderer does,
+// and once into a b2DrawBuffer, and compares both to the step time.
+
+const int32 e_bodyCount = 10000;
+const int32 e_columnCount = 100;
+const int32 e_frameCount = 120;
+const int32 e_circleSegments = 16;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+
+// Buffers the vertices like the testbed's GL renderer.
+class RecordingDraw : public b2Draw
+{
+public:
+	void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+	{
+		b2Vec2 p1 = vertices[vertexCount - 1];
+		for (int32 i = 0; i < vertexCount; ++i)
+		{
+			Line(p1, color);
+			Line(vertices[i], color);
+			p1 = vertices[i];
+		}
+	}
+
+	void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+	{
+		b2Color fill(0.5f * color.r, 0.5f * color.g, 0.5f * color.b, 0.5f);
+		for (int32 i = 1; i < vertexCount - 1; ++i)
+		{
+			Triangle(vertices[0], fill);
+			Triangle(vertices[i], fill);
+			Triangle(vertices[i + 1], fill);
+		}
+		DrawPolygon(vertices, vertexCount, color);
+	}
+
+	void DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color)
+	{
+		const float32 increment = 2.0f * b2_pi / e_circleSegments;
+		float32 theta = 0.0f;
+		b2Vec2 p1 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+		for (int32 i = 0; i < e_circleSegments; ++i)
+		{
+			theta += increment;
+			b2Vec2 p2 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+			Line(p1, color);
+			Line(p2, color);
+			p1 = p2;
+		}
+	}
+
+	void DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color)
+	{
+		const float32 increment = 2.0f * b2_pi / e_circleSegments;
+		b2Color fill(0.5f * color.r, 0.5f * color.g, 0.5f * color.b, 0.5f);
+		b2Vec2 p0 = center + radius * b2Vec2(1.0f, 0.0f);
+		float32 theta = increment;
+		b2Vec2 p1 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+		for (int32 i = 2; i < e_circleSegments; ++i)
+		{
+			theta += increment;
+			b2Vec2 p2 = center + radius * b2Vec2(cosf(theta), sinf(theta));
+			Triangle(p0, fill);
+			Triangle(p1, fill);
+			Triangle(p2, fill);
+			p1 = p2;
+		}
+		DrawCircle(center, radius, color);
+		DrawSegment(center, center + radius * axis, color);
+	}
+
+	void DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
+	{
+		Line(p1, color);
+		Line(p2, color);
+	}
+
+	void DrawTransform(const b2Transform& xf)
+	{
+		DrawSegment(xf.p, xf.p + 0.4f * xf.q.GetXAxis(), b2Color(1.0f, 0.0f, 0.0f));
+		DrawSegment(xf.p, xf.p + 0.4f * xf.q.GetYAxis(), b2Color(0.0f, 1.0f, 0.0f));
+	}
+
+	void Clear()
+	{
+		lines.clear();
+		triangles.clear();
+	}
+
+	std::vector<b2DrawVertex> lines;
+	std::vector<b2DrawVertex> triangles;
+
+private:
+	void Line(const b2Vec2& p, const b2Color& color)
+	{
+		b2DrawVertex v = { p, b2PackColor(color) };
+		lines.push_back(v);
+	}
+
+	void Triangle(const b2Vec2& p, const b2Color& color)
+	{
+		b2DrawVertex v = { p, b2PackColor(color) };
+		triangles.push_back(v);
+	}
+};
+
+static void CreateWorld(b2World* world)
+{
+	b2BodyDef gd;
+	b2Body* ground = world->CreateBody(&gd);
+	b2EdgeShape edge;
+	edge.Set(b2Vec2(-60.0f, 0.0f), b2Vec2(60.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+
+	b2Body* previous = NULL;
+	for (int32 i = 0; i < e_bodyCount; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-50.0f + 1.0f * (i % e_columnCount), 1.0f + 1.0f * (i / e_columnCount));
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(i % 3 == 0 ? (b2Shape*)&circle : (b2Shape*)&box, 1.0f);
+
+		// Pairs of bodies in the same row are jointed.
+		if (i % 2 == 1)
+		{
+			b2DistanceJointDef jd;
+			jd.Initialize(previous, body, previous->GetPosition(), body->GetPosition());
+			world->CreateJoint(&jd);
+		}
+		previous = body;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateWorld(&world);
+
+	uint32 flags = b2Draw::e_shapeBit | b2Draw::e_jointBit | b2Draw::e_aabbBit | b2Draw::e_centerOfMassBit;
+	RecordingDraw recording;
+	recording.SetFlags(flags);
+	world.SetDebugDraw(&recording);
+
+	b2DrawBuffer buffer(e_circleSegments);
+	buffer.SetFlags(flags);
+
+	float32 stepTime = 0.0f;
+	float32 drawTime = 0.0f;
+	float32 bufferTime = 0.0f;
+	bool same = true;
+	for (int32 i = 0; i < e_frameCount; ++i)
+	{
+		b2Timer timer;
+		world.Step(k_timeStep, 8, 3);
+		stepTime += timer.GetMilliseconds();
+
+		timer.Reset();
+		recording.Clear();
+		world.DrawDebugData();
+		drawTime += timer.GetMilliseconds();
+
+		timer.Reset();
+		buffer.Clear();
+		world.DrawDebugData(&buffer);
+		bufferTime += timer.GetMilliseconds();
+
+		same = same && (int32)recording.lines.size() == buffer.GetLineVertexCount() &&
+			(int32)recording.triangles.size() == buffer.GetTriangleVertexCount();
+	}
+
+	printf("bodies: %d, line vertices: %d, triangle vertices: %d\n", e_bodyCount,
+		buffer.GetLineVertexCount(), buffer.GetTriangleVertexCount());
+	printf("step:        %.3f ms\n", stepTime / e_frameCount);
+	printf("b2Draw:      %.3f ms\n", drawTime / e_frameCount);
+	printf("b2DrawBuffer: %.3f ms\n", bufferTime / e_frameCount);
+	printf("vertex counts: %s\n", same ? "match" : "DIFFER");
+
+	return same ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <stdio.h>
+
+// Drops 500 ragdolls held together by limited revolute joints with friction
+// motors, once with the joints solved through their virtual functions and once
+// with b2World::SetJointBatching, and compares the solver times. The ragdoll
+// islands only have revolute joints, so both runs must end in the same state.
+
+const int32 e_columnCount = 25;
+const int32 e_rowCount = 20;
+const int32 e_stepCount = 300;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+
+static void CreateRagdoll(b2World* world, const b2Vec2& position)
+{
+	b2PolygonShape shape;
+
+	b2FixtureDef fd;
+	fd.shape = &shape;
+	fd.density = 1.0f;
+	fd.friction = 0.4f;
+	// Bodies of the same ragdoll do not collide.
+	fd.filter.groupIndex = -1;
+
+	struct Part
+	{
+		float32 x, y, hx, hy;
+		int32 parent;
+		float32 jointX, jointY;
+		float32 lower, upper;
+	};
+
+	const Part parts[] =
+	{
+		{ 0.0f, 1.5f, 0.25f, 0.5f, -1, 0.0f, 0.0f, 0.0f, 0.0f },		// torso
+		{ 0.0f, 2.35f, 0.2f, 0.2f, 0, 0.0f, 2.05f, -0.5f, 0.5f },		// head
+		{ -0.45f, 1.8f, 0.2f, 0.08f, 0, -0.25f, 1.8f, -1.5f, 1.5f },	// upper arms
+		{ 0.45f, 1.8f, 0.2f, 0.08f, 0, 0.25f, 1.8f, -1.5f, 1.5f },
+		{ -0.85f, 1.8f, 0.2f, 0.07f, 2, -0.65f, 1.8f, -2.0f, 0.0f },	// lower arms
+		{ 0.85f, 1.8f, 0.2f, 0.07f, 3, 0.65f, 1.8f, 0.0f, 2.0f },
+		{ -0.12f, 0.75f, 0.1f, 0.25f, 0, -0.12f, 1.0f, -0.5f, 1.0f },	// upper legs
+		{ 0.12f, 0.75f, 0.1f, 0.25f, 0, 0.12f, 1.0f, -0.5f, 1.0f },
+		{ -0.12f, 0.25f, 0.09f, 0.25f, 6, -0.12f, 0.5f, -1.5f, 0.0f },	// lower legs
+		{ 0.12f, 0.25f, 0.09f, 0.25f, 7, 0.12f, 0.5f, -1.5f, 0.0f },
+	};
+	const int32 partCount = sizeof(parts) / sizeof(parts[0]);
+
+	b2Body* bodies[partCount];
+	for (int32 i = 0; i < partCount; ++i)
+	{
+		const Part& p = parts[i];
+
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position = position + b2Vec2(p.x, p.y);
+		bodies[i] = world->CreateBody(&bd);
+
+		shape.SetAsBox(p.hx, p.hy);
+		bodies[i]->CreateFixture(&fd);
+
+		if (p.parent >= 0)
+		{
+			b2RevoluteJointDef jd;
+			jd.Initialize(bodies[p.parent], bodies[i], position + b2Vec2(p.jointX, p.jointY));
+			jd.enableLimit = true;
+			jd.lowerAngle = p.lower;
+			jd.upperAngle = p.upper;
+			jd.enableMotor = true;
+			jd.maxMotorTorque = 1.0f;
+			world->CreateJoint(&jd);
+		}
+	}
+}
+
+struct Result
+{
+	float32 step;
+	float32 solve;
+	uint32 hash;
+	int32 jointCount;
+};
+
+static void Run(bool batching, Result* result)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.SetAllowSleeping(false);
+	world.SetJointBatching(batching);
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2EdgeShape edge;
+	edge.Set(b2Vec2(-60.0f, 0.0f), b2Vec2(60.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	for (int32 j = 0; j < e_rowCount; ++j)
+	{
+		for (int32 i = 0; i < e_columnCount; ++i)
+		{
+			CreateRagdoll(&world, b2Vec2(-48.0f + 4.0f * i, 1.0f + 3.0f * j));
+		}
+	}
+
+	result->step = 0.0f;
+	result->solve = 0.0f;
+	for (int32 i = 0; i < e_stepCount; ++i)
+	{
+		world.Step(k_timeStep, 8, 3);
+
+		const b2Profile& profile = world.GetProfile();
+		result->step += profile.step;
+		result->solve += profile.solveInit + profile.solveVelocity + profile.solvePosition;
+	}
+
+	result->hash = world.GetStateHash();
+	result->jointCount = world.GetJointCount();
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	Result virtualResult, batchedResult;
+	Run(false, &virtualResult);
+	Run(true, &batchedResult);
+
+	printf("ragdolls: %d, joints: %d, steps: %d\n", e_columnCount * e_rowCount, batchedResult.jointCount, e_stepCount);
+	printf("           step ms   solve ms\n");
+	printf("virtual   %8.3f   %8.3f\n", virtualResult.step / e_stepCount, virtualResult.solve / e_stepCount);
+	printf("batched   %8.3f   %8.3f\n", batchedResult.step / e_stepCount, batchedResult.solve / e_stepCount);
+
+	bool same = virtualResult.hash == batchedResult.hash;
+	printf("state hash: %08x %08x %s\n", virtualResult.hash, batchedResult.hash, same ? "match" : "DIFFER");
+
+	return same ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include <Box2D/Box2D.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+// Steps a tank of 50k water particles with floating boxes on one thread and
+// on a pool of threads, and checks both give the same state. Then compares a
+// small pool of particles with the same number of circle bodies.
+
+const int32 e_particleCount = 50000;
+const int32 e_boxCount = 20;
+const int32 e_steps = 120;
+const int32 e_threadCount = 4;
+const int32 e_smallCount = 4000;
+const int32 e_smallSteps = 120;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+static const float32 k_radius = 0.05f;
+
+// A minimal pool: the calling thread and the workers take chunks of the
+// range until it runs out.
+class ThreadPoolExecutor : public b2TaskExecutor
+{
+public:
+	ThreadPoolExecutor(int32 threadCount) : m_task(NULL), m_generation(0), m_busy(0), m_quit(false)
+	{
+		for (int32 i = 1; i < threadCount; ++i)
+		{
+			m_threads.push_back(std::thread(&ThreadPoolExecutor::Worker, this));
+		}
+	}
+
+	~ThreadPoolExecutor()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+		for (size_t i = 0; i < m_threads.size(); ++i)
+		{
+			m_threads[i].join();
+		}
+	}
+
+	void ParallelFor(b2ParallelTask* task, int32 count, int32 minRange)
+	{
+		int32 threadCount = int32(m_threads.size()) + 1;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_task = task;
+			m_count = count;
+			m_chunk = b2Max(minRange, count / (4 * threadCount));
+			m_next = 0;
+			m_busy = int32(m_threads.size());
+			++m_generation;
+		}
+		m_wake.notify_all();
+
+		Run(task);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_busy > 0)
+		{
+			m_done.wait(lock);
+		}
+		m_task = NULL;
+	}
+
+private:
+	void Run(b2ParallelTask* task)
+	{
+		for (;;)
+		{
+			int32 begin = m_next.fetch_add(m_chunk);
+			if (begin >= m_count)
+			{
+				break;
+			}
+			task->Execute(begin, b2Min(begin + m_chunk, m_count));
+		}
+	}
+
+	void Worker()
+	{
+		int32 generation = 0;
+		for (;;)
+		{
+			b2ParallelTask* task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (m_quit == false && m_generation == generation)
+				{
+					m_wake.wait(lock);
+				}
+				if (m_quit)
+				{
+					return;
+				}
+				generation = m_generation;
+				task = m_task;
+			}
+
+			Run(task);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_busy == 0)
+			{
+				m_done.notify_one();
+			}
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	b2ParallelTask* m_task;
+	int32 m_count;
+	int32 m_chunk;
+	std::atomic<int32> m_next;
+	int32 m_generation;
+	int32 m_busy;
+	bool m_quit;
+};
+
+static void CreateTank(b2World* world, float32 width)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2Vec2 vs[4];
+	vs[0].Set(-0.5f * width, 40.0f);
+	vs[1].Set(-0.5f * width, 0.0f);
+	vs[2].Set(0.5f * width, 0.0f);
+	vs[3].Set(0.5f * width, 40.0f);
+	b2ChainShape chain;
+	chain.CreateChain(vs, 4);
+	ground->CreateFixture(&chain, 0.0f);
+}
+
+// Particles in a block at rest spacing, filling the tank from the left.
+static b2ParticleSystem* CreateWater(b2World* world, int32 count, int32 columns)
+{
+	b2ParticleSystemDef def;
+	def.radius = k_radius;
+	b2ParticleSystem* system = world->CreateParticleSystem(&def);
+
+	float32 spacing = b2_particleStride * 2.0f * k_radius;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2ParticleDef pd;
+		pd.flags = b2_viscousParticle;
+		pd.position.Set(-9.9f + spacing * (i % columns), 0.05f + spacing * (i / columns));
+		system->CreateParticle(pd);
+	}
+
+	return system;
+}
+
+static float64 RunLarge(b2TaskExecutor* executor, uint32* hash, b2Profile* profile)
+{
+	b2WorldDef def;
+	def.taskExecutor = executor;
+	b2World world(&def);
+	CreateTank(&world, 20.0f);
+	CreateWater(&world, e_particleCount, 250);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.25f);
+	for (int32 i = 0; i < e_boxCount; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-9.0f + 0.9f * i, 18.0f + 0.5f * (i % 3));
+		world.CreateBody(&bd)->CreateFixture(&box, 0.5f);
+	}
+
+	memset(profile, 0, sizeof(b2Profile));
+	b2Timer timer;
+	for (int32 i = 0; i < e_steps; ++i)
+	{
+		world.Step(k_timeStep, 8, 3);
+		profile->solveParticles += world.GetProfile().solveParticles;
+	}
+	float64 time = timer.GetMilliseconds();
+
+	*hash = world.GetStateHash();
+	return time / e_steps;
+}
+
+static float64 RunSmall(bool particles)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateTank(&world, 8.0f);
+
+	if (particles)
+	{
+		CreateWater(&world, e_smallCount, 50);
+	}
+	else
+	{
+		b2CircleShape circle;
+		circle.m_radius = k_radius;
+		float32 spacing = 2.0f * k_radius;
+		for (int32 i = 0; i < e_smallCount; ++i)
+		{
+			b2BodyDef bd;
+			bd.type = b2_dynamicBody;
+			bd.position.Set(-3.9f + spacing * (i % 50), 0.05f + spacing * (i / 50));
+			world.CreateBody(&bd)->CreateFixture(&circle, 1.0f);
+		}
+	}
+
+	b2Timer timer;
+	for (int32 i = 0; i < e_smallSteps; ++i)
+	{
+		world.Step(k_timeStep, 8, 3);
+	}
+	return timer.GetMilliseconds() / e_smallSteps;
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	b2Profile profile;
+	uint32 serialHash, threadedHash;
+	float64 serialTime = RunLarge(NULL, &serialHash, &profile);
+	printf("%d particles, 1 thread: %.3f ms/step (particles %.3f)\n", e_particleCount, serialTime, profile.solveParticles / e_steps);
+
+	ThreadPoolExecutor executor(e_threadCount);
+	float64 threadedTime = RunLarge(&executor, &threadedHash, &profile);
+	printf("%d particles, %d threads: %.3f ms/step (particles %.3f)\n", e_particleCount, e_threadCount, threadedTime, profile.solveParticles / e_steps);
+	printf("state: %s (%08x)\n", serialHash == threadedHash ? "identical" : "DIFFERENT", serialHash);
+
+	printf("%d circle bodies: %.3f ms/step\n", e_smallCount, RunSmall(false));
+	printf("%d particles: %.3f ms/step\n", e_smallCount, RunSmall(true));
+
+	return serialHash == threadedHash ? 0 : 1;
+}
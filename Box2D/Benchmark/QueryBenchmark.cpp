@@ -0,0 +1,181 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <stdio.h>
+#include <vector>
+
+// Drops 4000 boxes onto a wide floor that is covered by a grid of 200 trigger
+// regions, and asks every region for its fixtures each frame, once with
+// b2World::QueryAABB and once with b2PersistentQuery. The boxes keep settling
+// in a pile for the whole run, so the step time of the persistent run includes
+// updating the regions from every box that moves.
+
+const int32 e_bodyCount = 4000;
+const int32 e_columnCount = 100;
+const int32 e_queryColumnCount = 40;
+const int32 e_queryRowCount = 5;
+const int32 e_frameCount = 600;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+
+class CollectCallback : public b2QueryCallback
+{
+public:
+	bool ReportFixture(b2Fixture* fixture)
+	{
+		fixtures.push_back(fixture);
+		return true;
+	}
+
+	std::vector<b2Fixture*> fixtures;
+};
+
+static b2AABB GetRegion(int32 index)
+{
+	int32 i = index % e_queryColumnCount;
+	int32 j = index / e_queryColumnCount;
+	b2AABB aabb;
+	aabb.lowerBound.Set(-100.0f + 5.0f * i, 4.0f * j);
+	aabb.upperBound = aabb.lowerBound + b2Vec2(4.0f, 3.0f);
+	return aabb;
+}
+
+static void CreateWorld(b2World* world)
+{
+	b2BodyDef gd;
+	b2Body* ground = world->CreateBody(&gd);
+	b2EdgeShape edge;
+	edge.Set(b2Vec2(-110.0f, 0.0f), b2Vec2(110.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+	for (int32 i = 0; i < e_bodyCount; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-99.0f + 2.0f * (i % e_columnCount) + 0.1f * (i / e_columnCount % 3), 1.0f + 1.0f * (i / e_columnCount));
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&box, 1.0f);
+	}
+}
+
+struct Result
+{
+	float32 step;
+	float32 query;
+	std::vector<int32> counts;	///< hits per region in the last frame
+};
+
+// Each region is asked every frame.
+static void RunQueryAABB(Result* result)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateWorld(&world);
+
+	CollectCallback callback;
+	result->step = 0.0f;
+	result->query = 0.0f;
+	for (int32 i = 0; i < e_frameCount; ++i)
+	{
+		b2Timer timer;
+		world.Step(k_timeStep, 8, 3);
+		result->step += timer.GetMilliseconds();
+
+		timer.Reset();
+		result->counts.clear();
+		for (int32 j = 0; j < e_queryColumnCount * e_queryRowCount; ++j)
+		{
+			callback.fixtures.clear();
+			world.QueryAABB(&callback, GetRegion(j));
+			result->counts.push_back((int32)callback.fixtures.size());
+		}
+		result->query += timer.GetMilliseconds();
+	}
+}
+
+// The regions are created once and read every frame.
+static void RunPersistent(Result* result)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateWorld(&world);
+
+	std::vector<b2PersistentQuery*> queries;
+	for (int32 j = 0; j < e_queryColumnCount * e_queryRowCount; ++j)
+	{
+		b2PersistentQueryDef qd;
+		qd.aabb = GetRegion(j);
+		queries.push_back(world.CreatePersistentQuery(&qd));
+	}
+
+	std::vector<b2Fixture*> fixtures;
+	result->step = 0.0f;
+	result->query = 0.0f;
+	for (int32 i = 0; i < e_frameCount; ++i)
+	{
+		b2Timer timer;
+		world.Step(k_timeStep, 8, 3);
+		result->step += timer.GetMilliseconds();
+
+		timer.Reset();
+		result->counts.clear();
+		for (size_t j = 0; j < queries.size(); ++j)
+		{
+			// Gather the fixtures like the callback does.
+			fixtures.clear();
+			const b2QueryHit* hits = queries[j]->GetResults();
+			for (int32 k = 0; k < queries[j]->GetResultCount(); ++k)
+			{
+				fixtures.push_back(hits[k].fixture);
+			}
+			result->counts.push_back((int32)fixtures.size());
+		}
+		result->query += timer.GetMilliseconds();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	Result queryResult, persistentResult;
+	RunQueryAABB(&queryResult);
+	RunPersistent(&persistentResult);
+
+	printf("bodies: %d, regions: %d, frames: %d\n", e_bodyCount, e_queryColumnCount * e_queryRowCount, e_frameCount);
+	printf("              step ms   query ms   total ms\n");
+	printf("QueryAABB   %8.3f   %8.3f   %8.3f\n", queryResult.step / e_frameCount, queryResult.query / e_frameCount,
+		(queryResult.step + queryResult.query) / e_frameCount);
+	printf("persistent  %8.3f   %8.3f   %8.3f\n", persistentResult.step / e_frameCount, persistentResult.query / e_frameCount,
+		(persistentResult.step + persistentResult.query) / e_frameCount);
+
+	// Both worlds are stepped the same way, so each region must find the
+	// same number of fixtures.
+	int32 queryHits = 0, persistentHits = 0;
+	for (size_t j = 0; j < queryResult.counts.size(); ++j)
+	{
+		queryHits += queryResult.counts[j];
+		persistentHits += persistentResult.counts[j];
+	}
+	bool same = queryResult.counts == persistentResult.counts;
+	printf("hits in the last frame: %d %d %s\n", queryHits, persistentHits, same ? "match" : "DIFFER");
+
+	return same ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include <Box2D/Box2D.h>
+#include <Box2D/Rope/b2RopeSystem.h>
+#include <stdio.h>
+#include <string.h>
+
+// Steps a field of hanging ropes with one b2Rope each and with a b2RopeSystem,
+// and checks that both give the same vertices.
+
+const int32 e_ropeCount = 1000;
+const int32 e_maxRopeVertices = 32;
+const int32 e_steps = 300;
+const int32 e_iterations = 8;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+
+// Ropes of 8 to 32 vertices pinned at one end, starting out bent sideways.
+static void MakeRope(int32 index, b2RopeDef* def, b2Vec2* vertices, float32* masses)
+{
+	int32 count = 8 + 4 * (index % 7);
+	b2Vec2 anchor(1.0f * (index % 100), 20.0f * (index / 100));
+	for (int32 i = 0; i < count; ++i)
+	{
+		float32 t = float32(i) / (count - 1);
+		vertices[i].Set(anchor.x + 4.0f * t, anchor.y - 0.5f * t * t);
+		masses[i] = i == 0 ? 0.0f : 1.0f;
+	}
+
+	def->vertices = vertices;
+	def->count = count;
+	def->masses = masses;
+	def->gravity.Set(0.0f, -10.0f);
+	def->damping = 0.1f;
+	def->k2 = 1.0f;
+	def->k3 = 0.5f * (index % 3) / 2.0f;
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	b2Rope* ropes = new b2Rope[e_ropeCount];
+	b2RopeSystem system;
+
+	b2Vec2 vertices[e_maxRopeVertices];
+	float32 masses[e_maxRopeVertices];
+	for (int32 i = 0; i < e_ropeCount; ++i)
+	{
+		b2RopeDef def;
+		MakeRope(i, &def, vertices, masses);
+		ropes[i].Initialize(&def);
+		system.CreateRope(&def);
+	}
+
+	float32 ropeTime = 0.0f;
+	float32 systemTime = 0.0f;
+	for (int32 step = 0; step < e_steps; ++step)
+	{
+		b2Timer timer;
+		for (int32 i = 0; i < e_ropeCount; ++i)
+		{
+			ropes[i].Step(k_timeStep, e_iterations);
+		}
+		ropeTime += timer.GetMilliseconds();
+
+		timer.Reset();
+		system.Step(k_timeStep, e_iterations);
+		systemTime += timer.GetMilliseconds();
+	}
+
+	bool identical = true;
+	for (int32 i = 0; i < e_ropeCount; ++i)
+	{
+		int32 count = system.GetRopeVertexCount(i);
+		const b2Vec2* v = system.GetVertices() + system.GetRopeVertexStart(i);
+		identical = identical && count == ropes[i].GetVertexCount() &&
+			memcmp(v, ropes[i].GetVertices(), count * sizeof(b2Vec2)) == 0;
+	}
+
+	printf("ropes: %d\n", system.GetRopeCount());
+	printf("vertices: %d\n", system.GetVertexCount());
+	printf("batches: %d\n", system.GetBatchCount());
+	printf("b2Rope: %.3f ms/step\n", ropeTime / e_steps);
+	printf("b2RopeSystem: %.3f ms/step\n", systemTime / e_steps);
+	printf("vertices: %s\n", identical ? "identical" : "DIFFERENT");
+
+	delete [] ropes;
+	return identical ? 0 : 1;
+}
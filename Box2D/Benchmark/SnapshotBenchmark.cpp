@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <stdio.h>
+#include <string.h>
+
+// Measures snapshot size and save/restore time for a world of 2000 bodies
+// and checks that a restored world steps to bit-identical results.
+
+const int32 e_bodyCount = 2000;
+const int32 e_warmupSteps = 120;
+const int32 e_replaySteps = 60;
+const int32 e_iterations = 100;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+
+static void CreateScene(b2World* world)
+{
+	b2BodyDef groundDef;
+	b2Body* ground = world->CreateBody(&groundDef);
+
+	b2EdgeShape edge;
+	edge.Set(b2Vec2(-60.0f, 0.0f), b2Vec2(60.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+	edge.Set(b2Vec2(-60.0f, 0.0f), b2Vec2(-60.0f, 100.0f));
+	ground->CreateFixture(&edge, 0.0f);
+	edge.Set(b2Vec2(60.0f, 0.0f), b2Vec2(60.0f, 100.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+
+	// Short chains of revolute joints keep joint state in the snapshot.
+	b2Body* prev = NULL;
+	for (int32 i = 0; i < e_bodyCount - 1; ++i)
+	{
+		b2BodyDef bd;
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-55.0f + 1.0f * (i % 100) + 0.05f * (i / 100), 1.0f + 1.0f * (i / 100));
+		b2Body* body = world->CreateBody(&bd);
+		if (i % 3 == 0)
+		{
+			body->CreateFixture(&circle, 1.0f);
+		}
+		else
+		{
+			body->CreateFixture(&box, 1.0f);
+		}
+
+		if (prev != NULL && i % 10 != 0 && i % 100 != 0)
+		{
+			b2RevoluteJointDef jd;
+			jd.Initialize(prev, body, 0.5f * (prev->GetPosition() + body->GetPosition()));
+			world->CreateJoint(&jd);
+		}
+		prev = body;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateScene(&world);
+
+	for (int32 i = 0; i < e_warmupSteps; ++i)
+	{
+		world.Step(k_timeStep, 8, 3);
+	}
+
+	int32 size = world.SaveSnapshot(NULL, 0);
+	void* snapshot = b2Alloc(size);
+
+	float32 saveTime = 0.0f;
+	for (int32 i = 0; i < e_iterations; ++i)
+	{
+		b2Timer timer;
+		world.SaveSnapshot(snapshot, size);
+		saveTime += timer.GetMilliseconds();
+	}
+
+	for (int32 i = 0; i < e_replaySteps; ++i)
+	{
+		world.Step(k_timeStep, 8, 3);
+	}
+	uint32 expected = world.GetStateHash();
+
+	// Restore after the world has diverged so contacts are created and destroyed.
+	float32 restoreTime = 0.0f;
+	bool identical = true;
+	for (int32 i = 0; i < e_iterations; ++i)
+	{
+		b2Timer timer;
+		bool restored = world.RestoreSnapshot(snapshot, size);
+		restoreTime += timer.GetMilliseconds();
+
+		if (restored == false)
+		{
+			printf("restore failed\n");
+			b2Free(snapshot);
+			return 1;
+		}
+
+		// Replaying every iteration is slow, a few are enough to check determinism.
+		if (i < 3)
+		{
+			for (int32 j = 0; j < e_replaySteps; ++j)
+			{
+				world.Step(k_timeStep, 8, 3);
+			}
+			identical = identical && world.GetStateHash() == expected;
+		}
+	}
+
+	printf("bodies: %d\n", world.GetBodyCount());
+	printf("contacts: %d\n", world.GetContactCount());
+	printf("joints: %d\n", world.GetJointCount());
+	printf("snapshot size: %d bytes\n", size);
+	printf("save: %.3f ms\n", saveTime / e_iterations);
+	printf("restore: %.3f ms\n", restoreTime / e_iterations);
+	printf("replay: %s\n", identical ? "identical" : "DIVERGED");
+
+	b2Free(snapshot);
+	return identical ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Box2D.h>
+#include <stdio.h>
+#include <string.h>
+
+// Spawns a level of 5000 bodies one at a time with CreateBody and
+// CreateFixture, then in one batch with CreateBodies and CreateFixtures, and
+// reports the spawn time, the time of the first step and the tree quality.
+
+const int32 e_bodyCount = 5000;
+const int32 e_columnCount = 100;
+const int32 e_iterations = 20;
+
+static const float32 k_timeStep = 1.0f / 60.0f;
+
+struct Level
+{
+	b2BodyDef bodyDefs[e_bodyCount];
+	b2FixtureDef fixtureDefs[e_bodyCount];
+	b2Body* bodies[e_bodyCount];
+	b2PolygonShape box;
+	b2CircleShape circle;
+};
+
+static void InitializeLevel(Level* level)
+{
+	level->box.SetAsBox(0.4f, 0.4f);
+	level->circle.m_radius = 0.4f;
+
+	for (int32 i = 0; i < e_bodyCount; ++i)
+	{
+		b2BodyDef* bd = level->bodyDefs + i;
+		bd->type = b2_dynamicBody;
+		bd->position.Set(-50.0f + 1.0f * (i % e_columnCount), 1.0f + 1.0f * (i / e_columnCount));
+
+		b2FixtureDef* fd = level->fixtureDefs + i;
+		fd->shape = i % 3 == 0 ? (b2Shape*)&level->circle : (b2Shape*)&level->box;
+		fd->density = 1.0f;
+	}
+}
+
+static void CreateGround(b2World* world)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2Vec2 vertices[4];
+	vertices[0].Set(-55.0f, 100.0f);
+	vertices[1].Set(-55.0f, 0.0f);
+	vertices[2].Set(55.0f, 0.0f);
+	vertices[3].Set(55.0f, 100.0f);
+
+	b2ChainShape chain;
+	chain.CreateChain(vertices, 4);
+	ground->CreateFixture(&chain, 0.0f);
+}
+
+struct Result
+{
+	float32 spawnTime;
+	float32 stepTime;
+	float32 treeQuality;
+};
+
+static void Spawn(Level* level, bool batch, Result* result)
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+	CreateGround(&world);
+
+	b2Timer timer;
+	if (batch)
+	{
+		world.CreateBodies(level->bodyDefs, e_bodyCount, level->bodies);
+		world.CreateFixtures(level->bodies, level->fixtureDefs, e_bodyCount, NULL);
+	}
+	else
+	{
+		for (int32 i = 0; i < e_bodyCount; ++i)
+		{
+			level->bodies[i] = world.CreateBody(level->bodyDefs + i);
+			level->bodies[i]->CreateFixture(level->fixtureDefs + i);
+		}
+	}
+	result->spawnTime += timer.GetMilliseconds();
+	result->treeQuality = world.GetTreeQuality();
+
+	timer.Reset();
+	world.Step(k_timeStep, 8, 3);
+	result->stepTime += timer.GetMilliseconds();
+}
+
+int main(int argc, char** argv)
+{
+	B2_NOT_USED(argc);
+	B2_NOT_USED(argv);
+
+	static Level level;
+	InitializeLevel(&level);
+
+	Result results[2];
+	memset(results, 0, sizeof(results));
+	for (int32 i = 0; i < e_iterations; ++i)
+	{
+		Spawn(&level, false, results + 0);
+		Spawn(&level, true, results + 1);
+	}
+
+	// Handles of destroyed bodies no longer resolve.
+	b2World world(b2Vec2(0.0f, -10.0f));
+	world.CreateBodies(level.bodyDefs, e_bodyCount, level.bodies);
+	b2BodyHandle handle = level.bodies[0]->GetHandle();
+	bool valid = world.GetBody(handle) == level.bodies[0];
+	world.DestroyBody(level.bodies[0]);
+	valid = valid && world.GetBody(handle) == NULL;
+	valid = valid && world.CreateBody(level.bodyDefs) != NULL && world.GetBody(handle) == NULL;
+
+	const char* names[2] = { "one by one", "batch" };
+	printf("bodies: %d\n", e_bodyCount);
+	for (int32 i = 0; i < 2; ++i)
+	{
+		printf("%-10s spawn: %.3f ms, first step: %.3f ms, tree quality: %.1f\n", names[i],
+			results[i].spawnTime / e_iterations, results[i].stepTime / e_iterations, results[i].treeQuality);
+	}
+	printf("handles: %s\n", valid ? "ok" : "FAILED");
+
+	return valid ? 0 : 1;
+}
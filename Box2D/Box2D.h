@@ -32,8 +32,11 @@ For discussion please visit http://box2d.org/forum
 // These include files constitute the main Box2D API
 
 #include <Box2D/Common/b2Settings.h>
+#include <Box2D/Common/b2Allocator.h>
 #include <Box2D/Common/b2Draw.h>
+#include <Box2D/Common/b2DrawBuffer.h>
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Trace.h>
 
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
 #include <Box2D/Collision/Shapes/b2EdgeShape.h>
@@ -50,6 +53,7 @@ For discussion please visit http://box2d.org/forum
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
 #include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Dynamics/b2PersistentQuery.h>
 
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 
@@ -65,4 +69,6 @@ For discussion please visit http://box2d.org/forum
 #include <Box2D/Dynamics/Joints/b2WeldJoint.h>
 #include <Box2D/Dynamics/Joints/b2WheelJoint.h>
 
+#include <Box2D/Particle/b2ParticleSystem.h>
+
 #endif
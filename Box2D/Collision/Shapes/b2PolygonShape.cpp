@@ -39,6 +39,7 @@ void b2PolygonShape::SetAsBox(float32 hx, float32 hy)
 	m_normals[2].Set(0.0f, 1.0f);
 	m_normals[3].Set(-1.0f, 0.0f);
 	m_centroid.SetZero();
+	UpdateLanes();
 }
 
 void b2PolygonShape::SetAsBox(float32 hx, float32 hy, const b2Vec2& center, float32 angle)
@@ -64,6 +65,20 @@ void b2PolygonShape::SetAsBox(float32 hx, float32 hy, const b2Vec2& center, floa
 		m_vertices[i] = b2Mul(xf, m_vertices[i]);
 		m_normals[i] = b2Mul(xf.q, m_normals[i]);
 	}
+
+	UpdateLanes();
+}
+
+void b2PolygonShape::UpdateLanes()
+{
+	for (int32 i = 0; i < b2_maxPolygonLanes; ++i)
+	{
+		int32 index = i < m_count ? i : 0;
+		m_vertexX[i] = m_vertices[index].x;
+		m_vertexY[i] = m_vertices[index].y;
+		m_normalX[i] = m_normals[index].x;
+		m_normalY[i] = m_normals[index].y;
+	}
 }
 
 int32 b2PolygonShape::GetChildCount() const
@@ -246,6 +261,8 @@ void b2PolygonShape::Set(const b2Vec2* vertices, int32 count)
 
 	// Compute the polygon centroid.
 	m_centroid = ComputeCentroid(m_vertices, m);
+
+	UpdateLanes();
 }
 
 bool b2PolygonShape::TestPoint(const b2Transform& xf, const b2Vec2& p) const
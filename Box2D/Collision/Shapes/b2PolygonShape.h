@@ -20,6 +20,7 @@
 #define B2_POLYGON_SHAPE_H
 
 #include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Common/b2Simd.h>
 
 /// A convex polygon. It is assumed that the interior of the polygon is to
 /// the left of each edge.
@@ -78,10 +79,21 @@ public:
 	/// @returns true if valid
 	bool Validate() const;
 
+	/// Copy the vertices and normals into the lanes used by the SIMD kernels.
+	/// Set and SetAsBox do this, call it after writing m_vertices directly.
+	void UpdateLanes();
+
 	b2Vec2 m_centroid;
 	b2Vec2 m_vertices[b2_maxPolygonVertices];
 	b2Vec2 m_normals[b2_maxPolygonVertices];
 	int32 m_count;
+
+	/// The vertices and normals as separate x and y arrays. The lanes past
+	/// m_count repeat the first vertex and normal.
+	float32 m_vertexX[b2_maxPolygonLanes];
+	float32 m_vertexY[b2_maxPolygonLanes];
+	float32 m_normalX[b2_maxPolygonLanes];
+	float32 m_normalY[b2_maxPolygonLanes];
 };
 
 inline b2PolygonShape::b2PolygonShape()
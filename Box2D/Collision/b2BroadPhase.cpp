@@ -17,24 +17,26 @@
 */
 
 #include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Common/b2Snapshot.h>
 
-b2BroadPhase::b2BroadPhase()
+b2BroadPhase::b2BroadPhase(b2Allocator* allocator)
+	: m_allocator(allocator ? allocator : b2GetHeapAllocator()), m_tree(m_allocator)
 {
 	m_proxyCount = 0;
 
 	m_pairCapacity = 16;
 	m_pairCount = 0;
-	m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	m_pairBuffer = (b2Pair*)m_allocator->Allocate(m_pairCapacity * sizeof(b2Pair));
 
 	m_moveCapacity = 16;
 	m_moveCount = 0;
-	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+	m_moveBuffer = (int32*)m_allocator->Allocate(m_moveCapacity * sizeof(int32));
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
-	b2Free(m_moveBuffer);
-	b2Free(m_pairBuffer);
+	m_allocator->Free(m_moveBuffer, m_moveCapacity * sizeof(int32));
+	m_allocator->Free(m_pairBuffer, m_pairCapacity * sizeof(b2Pair));
 }
 
 int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
@@ -45,6 +47,16 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+void b2BroadPhase::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds)
+{
+	m_tree.CreateProxies(aabbs, userData, count, proxyIds);
+	m_proxyCount += count;
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
@@ -52,6 +64,28 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 	m_tree.DestroyProxy(proxyId);
 }
 
+void b2BroadPhase::ParkProxy(int32 proxyId)
+{
+	UnBufferMove(proxyId);
+	--m_proxyCount;
+	m_tree.ParkProxy(proxyId);
+}
+
+void b2BroadPhase::UnparkProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count)
+{
+	m_tree.UnparkProxies(proxyIds, aabbs, count);
+	m_proxyCount += count;
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
+void b2BroadPhase::DestroyParkedProxy(int32 proxyId)
+{
+	m_tree.DestroyParkedProxy(proxyId);
+}
+
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
 	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
@@ -71,10 +105,11 @@ void b2BroadPhase::BufferMove(int32 proxyId)
 	if (m_moveCount == m_moveCapacity)
 	{
 		int32* oldBuffer = m_moveBuffer;
+		int32 oldCapacity = m_moveCapacity;
 		m_moveCapacity *= 2;
-		m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+		m_moveBuffer = (int32*)m_allocator->Allocate(m_moveCapacity * sizeof(int32));
 		memcpy(m_moveBuffer, oldBuffer, m_moveCount * sizeof(int32));
-		b2Free(oldBuffer);
+		m_allocator->Free(oldBuffer, oldCapacity * sizeof(int32));
 	}
 
 	m_moveBuffer[m_moveCount] = proxyId;
@@ -92,6 +127,39 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
+int32 b2BroadPhase::GetMemorySize() const
+{
+	return m_tree.GetMemorySize() + m_moveCapacity * sizeof(int32) + m_pairCapacity * sizeof(b2Pair);
+}
+
+void b2BroadPhase::WriteSnapshot(b2SnapshotWriter* writer) const
+{
+	m_tree.WriteSnapshot(writer);
+	writer->Write(m_proxyCount);
+	writer->Write(m_moveCount);
+	writer->Write(m_moveBuffer, m_moveCount * sizeof(int32));
+}
+
+void b2BroadPhase::ReadSnapshot(b2SnapshotReader* reader)
+{
+	m_tree.ReadSnapshot(reader);
+	m_proxyCount = reader->Read<int32>();
+	int32 moveCount = reader->Read<int32>();
+
+	if (moveCount > m_moveCapacity)
+	{
+		m_allocator->Free(m_moveBuffer, m_moveCapacity * sizeof(int32));
+		while (m_moveCapacity < moveCount)
+		{
+			m_moveCapacity *= 2;
+		}
+		m_moveBuffer = (int32*)m_allocator->Allocate(m_moveCapacity * sizeof(int32));
+	}
+
+	m_moveCount = moveCount;
+	reader->Read(m_moveBuffer, m_moveCount * sizeof(int32));
+}
+
 // This is called from b2DynamicTree::Query when we are gathering pairs.
 bool b2BroadPhase::QueryCallback(int32 proxyId)
 {
@@ -105,10 +173,11 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 	if (m_pairCount == m_pairCapacity)
 	{
 		b2Pair* oldBuffer = m_pairBuffer;
+		int32 oldCapacity = m_pairCapacity;
 		m_pairCapacity *= 2;
-		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+		m_pairBuffer = (b2Pair*)m_allocator->Allocate(m_pairCapacity * sizeof(b2Pair));
 		memcpy(m_pairBuffer, oldBuffer, m_pairCount * sizeof(b2Pair));
-		b2Free(oldBuffer);
+		m_allocator->Free(oldBuffer, oldCapacity * sizeof(b2Pair));
 	}
 
 	m_pairBuffer[m_pairCount].proxyIdA = b2Min(proxyId, m_queryProxyId);
@@ -22,6 +22,7 @@
 #include <Box2D/Common/b2Settings.h>
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2Trace.h>
 #include <algorithm>
 
 struct b2Pair
@@ -42,16 +43,33 @@ public:
 		e_nullProxy = -1
 	};
 
-	b2BroadPhase();
+	/// @param allocator provides the tree and buffers, NULL for the heap.
+	b2BroadPhase(b2Allocator* allocator = NULL);
 	~b2BroadPhase();
 
 	/// Create a proxy with an initial AABB. Pairs are not reported until
 	/// UpdatePairs is called.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create proxies for many AABBs at once. They are built into the tree
+	/// in one batch. Pairs are not reported until UpdatePairs is called.
+	/// @param proxyIds receives the ids in the order of the AABBs.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds);
+
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
 
+	/// Take a proxy out of the tree, keeping its id. Parked proxies are not
+	/// counted, queried or paired until they are unparked.
+	void ParkProxy(int32 proxyId);
+
+	/// Put parked proxies back with new tight fitting AABBs, building them
+	/// into the tree in one batch. Pairs are reported by the next UpdatePairs.
+	void UnparkProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count);
+
+	/// Destroy a parked proxy.
+	void DestroyParkedProxy(int32 proxyId);
+
 	/// Call MoveProxy as many times as you like, then when you are done
 	/// call UpdatePairs to finalized the proxy pairs (for your time step).
 	void MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
@@ -71,6 +89,11 @@ public:
 	/// Get the number of proxies.
 	int32 GetProxyCount() const;
 
+	/// Get the proxies moved, created or touched since the last UpdatePairs.
+	/// A proxy may appear more than once and destroyed proxies are e_nullProxy.
+	const int32* GetMoveBuffer() const;
+	int32 GetMoveCount() const;
+
 	/// Update the pairs. This results in pair callbacks. This can only add pairs.
 	template <typename T>
 	void UpdatePairs(T* callback);
@@ -104,6 +127,15 @@ public:
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Get the bytes used by the proxy tree and the move and pair buffers.
+	int32 GetMemorySize() const;
+
+	/// Write the proxy tree and pending moves to a world snapshot.
+	void WriteSnapshot(b2SnapshotWriter* writer) const;
+
+	/// Restore the proxy tree and pending moves from a world snapshot.
+	void ReadSnapshot(b2SnapshotReader* reader);
+
 private:
 
 	friend class b2DynamicTree;
@@ -113,6 +145,8 @@ private:
 
 	bool QueryCallback(int32 proxyId);
 
+	b2Allocator* m_allocator;
+
 	b2DynamicTree m_tree;
 
 	int32 m_proxyCount;
@@ -166,6 +200,16 @@ inline int32 b2BroadPhase::GetProxyCount() const
 	return m_proxyCount;
 }
 
+inline const int32* b2BroadPhase::GetMoveBuffer() const
+{
+	return m_moveBuffer;
+}
+
+inline int32 b2BroadPhase::GetMoveCount() const
+{
+	return m_moveCount;
+}
+
 inline int32 b2BroadPhase::GetTreeHeight() const
 {
 	return m_tree.GetHeight();
@@ -184,6 +228,8 @@ inline float32 b2BroadPhase::GetTreeQuality() const
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
+	b2TraceScope("b2BroadPhase::UpdatePairs");
+
 	// Reset pair buffer
 	m_pairCount = 0;
 
@@ -208,7 +254,12 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	m_moveCount = 0;
 
 	// Sort the pair buffer to expose duplicates.
+#ifdef B2_DETERMINISTIC
+	// Keep the order of equal pairs independent of the library's sort algorithm.
+	std::stable_sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
+#else
 	std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
+#endif
 
 	// Send the pairs back to the client.
 	int32 i = 0;
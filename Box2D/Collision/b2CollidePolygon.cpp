@@ -20,6 +20,59 @@
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
+#ifdef B2_SIMD
+// Four normals of poly1 at a time against each vertex of poly2. The padding
+// lanes repeat edge 0 so they tie with it and never win.
+static float32 b2FindMaxSeparation(int32* edgeIndex,
+								 const b2PolygonShape* poly1, const b2Transform& xf1,
+								 const b2PolygonShape* poly2, const b2Transform& xf2)
+{
+	int32 count1 = poly1->m_count;
+	int32 count2 = poly2->m_count;
+	const b2Vec2* v2s = poly2->m_vertices;
+	b2Transform xf = b2MulT(xf2, xf1);
+
+	b2Lanes c = b2SplatLanes(xf.q.c);
+	b2Lanes s = b2SplatLanes(xf.q.s);
+	b2Lanes px = b2SplatLanes(xf.p.x);
+	b2Lanes py = b2SplatLanes(xf.p.y);
+
+	int32 bestIndex = 0;
+	float32 maxSeparation = -b2_maxFloat;
+	for (int32 i = 0; i < count1; i += b2_simdWidth)
+	{
+		// Get poly1 normals and vertices in frame2.
+		b2Lanes n1x = b2LoadLanes(poly1->m_normalX + i);
+		b2Lanes n1y = b2LoadLanes(poly1->m_normalY + i);
+		b2Lanes v1x = b2LoadLanes(poly1->m_vertexX + i);
+		b2Lanes v1y = b2LoadLanes(poly1->m_vertexY + i);
+		b2Lanes nx = b2SubLanes(b2MulLanes(c, n1x), b2MulLanes(s, n1y));
+		b2Lanes ny = b2AddLanes(b2MulLanes(s, n1x), b2MulLanes(c, n1y));
+		b2Lanes vx = b2AddLanes(b2SubLanes(b2MulLanes(c, v1x), b2MulLanes(s, v1y)), px);
+		b2Lanes vy = b2AddLanes(b2AddLanes(b2MulLanes(s, v1x), b2MulLanes(c, v1y)), py);
+
+		// Find deepest point for each normal.
+		b2Lanes si = b2SplatLanes(b2_maxFloat);
+		for (int32 j = 0; j < count2; ++j)
+		{
+			b2Lanes dx = b2SubLanes(b2SplatLanes(v2s[j].x), vx);
+			b2Lanes dy = b2SubLanes(b2SplatLanes(v2s[j].y), vy);
+			si = b2MinLanes(si, b2AddLanes(b2MulLanes(nx, dx), b2MulLanes(ny, dy)));
+		}
+
+		// The first normal reaching the maximum, like the scalar loop.
+		float32 separation = b2ReduceMax(si);
+		if (separation > maxSeparation)
+		{
+			maxSeparation = separation;
+			bestIndex = i + b2FirstLane(b2EqualMask(si, separation));
+		}
+	}
+
+	*edgeIndex = bestIndex;
+	return maxSeparation;
+}
+#else
 static float32 b2FindMaxSeparation(int32* edgeIndex,
 								 const b2PolygonShape* poly1, const b2Transform& xf1,
 								 const b2PolygonShape* poly2, const b2Transform& xf2)
@@ -60,6 +113,7 @@ static float32 b2FindMaxSeparation(int32* edgeIndex,
 	*edgeIndex = bestIndex;
 	return maxSeparation;
 }
+#endif
 
 static void b2FindIncidentEdge(b2ClipVertex c[2],
 							 const b2PolygonShape* poly1, const b2Transform& xf1, int32 edge1,
@@ -115,19 +169,21 @@ static void b2FindIncidentEdge(b2ClipVertex c[2],
 // The normal points from 1 to 2
 void b2CollidePolygons(b2Manifold* manifold,
 					  const b2PolygonShape* polyA, const b2Transform& xfA,
-					  const b2PolygonShape* polyB, const b2Transform& xfB)
+					  const b2PolygonShape* polyB, const b2Transform& xfB,
+					  float32 speculativeDistance)
 {
 	manifold->pointCount = 0;
 	float32 totalRadius = polyA->m_radius + polyB->m_radius;
+	float32 maxSeparation = totalRadius + speculativeDistance;
 
 	int32 edgeA = 0;
 	float32 separationA = b2FindMaxSeparation(&edgeA, polyA, xfA, polyB, xfB);
-	if (separationA > totalRadius)
+	if (separationA > maxSeparation)
 		return;
 
 	int32 edgeB = 0;
 	float32 separationB = b2FindMaxSeparation(&edgeB, polyB, xfB, polyA, xfA);
-	if (separationB > totalRadius)
+	if (separationB > maxSeparation)
 		return;
 
 	const b2PolygonShape* poly1;	// reference polygon
@@ -217,7 +273,7 @@ void b2CollidePolygons(b2Manifold* manifold,
 	{
 		float32 separation = b2Dot(normal, clipPoints2[i].v) - frontOffset;
 
-		if (separation <= totalRadius)
+		if (separation <= maxSeparation)
 		{
 			b2ManifoldPoint* cp = manifold->points + pointCount;
 			cp->localPoint = b2MulT(xf2, clipPoints2[i].v);
@@ -17,15 +17,19 @@
 */
 
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2Snapshot.h>
+#include <algorithm>
 #include <string.h>
 
-b2DynamicTree::b2DynamicTree()
+b2DynamicTree::b2DynamicTree(b2Allocator* allocator)
 {
+	m_allocator = allocator ? allocator : b2GetHeapAllocator();
+
 	m_root = b2_nullNode;
 
 	m_nodeCapacity = 16;
 	m_nodeCount = 0;
-	m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	m_nodes = (b2TreeNode*)m_allocator->Allocate(m_nodeCapacity * sizeof(b2TreeNode));
 	memset(m_nodes, 0, m_nodeCapacity * sizeof(b2TreeNode));
 
 	// Build a linked list for the free list.
@@ -46,7 +50,37 @@ b2DynamicTree::b2DynamicTree()
 b2DynamicTree::~b2DynamicTree()
 {
 	// This frees the entire tree in one shot.
-	b2Free(m_nodes);
+	m_allocator->Free(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+}
+
+// Grow the node pool so it holds at least nodeCount nodes.
+void b2DynamicTree::ReserveNodes(int32 nodeCount)
+{
+	if (nodeCount <= m_nodeCapacity)
+	{
+		return;
+	}
+
+	b2TreeNode* oldNodes = m_nodes;
+	int32 oldCapacity = m_nodeCapacity;
+	while (m_nodeCapacity < nodeCount)
+	{
+		m_nodeCapacity *= 2;
+	}
+	m_nodes = (b2TreeNode*)m_allocator->Allocate(m_nodeCapacity * sizeof(b2TreeNode));
+	memcpy(m_nodes, oldNodes, oldCapacity * sizeof(b2TreeNode));
+	m_allocator->Free(oldNodes, oldCapacity * sizeof(b2TreeNode));
+
+	// Put the new nodes at the front of the free list. The parent
+	// pointer becomes the "next" pointer.
+	for (int32 i = oldCapacity; i < m_nodeCapacity - 1; ++i)
+	{
+		m_nodes[i].next = i + 1;
+		m_nodes[i].height = -1;
+	}
+	m_nodes[m_nodeCapacity-1].next = m_freeList;
+	m_nodes[m_nodeCapacity-1].height = -1;
+	m_freeList = oldCapacity;
 }
 
 // Allocate a node from the pool. Grow the pool if necessary.
@@ -56,24 +90,7 @@ int32 b2DynamicTree::AllocateNode()
 	if (m_freeList == b2_nullNode)
 	{
 		b2Assert(m_nodeCount == m_nodeCapacity);
-
-		// The free list is empty. Rebuild a bigger pool.
-		b2TreeNode* oldNodes = m_nodes;
-		m_nodeCapacity *= 2;
-		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
-		memcpy(m_nodes, oldNodes, m_nodeCount * sizeof(b2TreeNode));
-		b2Free(oldNodes);
-
-		// Build a linked list for the free list. The parent
-		// pointer becomes the "next" pointer.
-		for (int32 i = m_nodeCount; i < m_nodeCapacity - 1; ++i)
-		{
-			m_nodes[i].next = i + 1;
-			m_nodes[i].height = -1;
-		}
-		m_nodes[m_nodeCapacity-1].next = b2_nullNode;
-		m_nodes[m_nodeCapacity-1].height = -1;
-		m_freeList = m_nodeCount;
+		ReserveNodes(2 * m_nodeCapacity);
 	}
 
 	// Peel a node off the free list.
@@ -118,6 +135,22 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	return proxyId;
 }
 
+void b2DynamicTree::CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds)
+{
+	// Make room for the leaves and the nodes above them.
+	ReserveNodes(m_nodeCount + 2 * count);
+
+	// New leaves start out parked, outside the tree.
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = AllocateNode();
+		m_nodes[proxyId].userData = userData[i];
+		proxyIds[i] = proxyId;
+	}
+
+	UnparkProxies(proxyIds, aabbs, count);
+}
+
 void b2DynamicTree::DestroyProxy(int32 proxyId)
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
@@ -127,6 +160,164 @@ void b2DynamicTree::DestroyProxy(int32 proxyId)
 	FreeNode(proxyId);
 }
 
+void b2DynamicTree::ParkProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+	b2Assert(IsParked(proxyId) == false);
+
+	RemoveLeaf(proxyId);
+	m_nodes[proxyId].parent = b2_nullNode;
+}
+
+// Sort key of a parked proxy: the Morton code of its AABB center.
+struct b2MortonLeaf
+{
+	uint32 code;
+	int32 node;
+};
+
+static bool b2MortonLessThan(const b2MortonLeaf& leaf1, const b2MortonLeaf& leaf2)
+{
+	if (leaf1.code != leaf2.code)
+	{
+		return leaf1.code < leaf2.code;
+	}
+
+	return leaf1.node < leaf2.node;
+}
+
+// Spread the lower 16 bits of x to the even bits.
+static uint32 b2SpreadBits(uint32 x)
+{
+	x &= 0x0000ffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+void b2DynamicTree::UnparkProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Fatten the AABBs and find the bounds of the centers.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	b2Vec2 lower(b2_maxFloat, b2_maxFloat);
+	b2Vec2 upper(-b2_maxFloat, -b2_maxFloat);
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = proxyIds[i];
+		b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+		b2Assert(IsParked(proxyId));
+
+		m_nodes[proxyId].aabb.lowerBound = aabbs[i].lowerBound - r;
+		m_nodes[proxyId].aabb.upperBound = aabbs[i].upperBound + r;
+
+		b2Vec2 center = aabbs[i].GetCenter();
+		lower = b2Min(lower, center);
+		upper = b2Max(upper, center);
+	}
+
+	ReserveNodes(m_nodeCount + count);
+
+	// Sort the leaves along a Morton curve so neighbors in the array are
+	// neighbors in space.
+	b2MortonLeaf* leaves = (b2MortonLeaf*)m_allocator->Allocate(count * sizeof(b2MortonLeaf));
+	// The same scale on both axes keeps the grid cells square.
+	b2Vec2 extent = upper - lower;
+	float32 maxExtent = b2Max(extent.x, extent.y);
+	float32 scale = maxExtent > 0.0f ? 65535.0f / maxExtent : 0.0f;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 center = aabbs[i].GetCenter();
+		uint32 x = uint32(scale * (center.x - lower.x));
+		uint32 y = uint32(scale * (center.y - lower.y));
+		leaves[i].code = b2SpreadBits(x) | (b2SpreadBits(y) << 1);
+		leaves[i].node = proxyIds[i];
+	}
+	std::sort(leaves, leaves + count, b2MortonLessThan);
+
+	int32 root = BuildSubtree(leaves, count);
+
+	m_allocator->Free(leaves, count * sizeof(b2MortonLeaf));
+
+	InsertLeaf(root);
+}
+
+// Split the leaves where the highest differing bit of their codes flips, so
+// each subtree covers a cell of the Morton grid.
+int32 b2DynamicTree::BuildSubtree(const b2MortonLeaf* leaves, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0].node;
+	}
+
+	uint32 firstCode = leaves[0].code;
+	uint32 lastCode = leaves[count - 1].code;
+
+	int32 split = count / 2;
+	if (firstCode != lastCode)
+	{
+		uint32 bit = firstCode ^ lastCode;
+		bit |= bit >> 1;
+		bit |= bit >> 2;
+		bit |= bit >> 4;
+		bit |= bit >> 8;
+		bit |= bit >> 16;
+		bit ^= bit >> 1;
+
+		// The first leaf with the bit set.
+		int32 low = 1;
+		int32 high = count - 1;
+		while (low < high)
+		{
+			int32 mid = (low + high) / 2;
+			if (leaves[mid].code & bit)
+			{
+				high = mid;
+			}
+			else
+			{
+				low = mid + 1;
+			}
+		}
+		split = low;
+	}
+
+	int32 child1 = BuildSubtree(leaves, split);
+	int32 child2 = BuildSubtree(leaves + split, count - split);
+
+	int32 parent = AllocateNode();
+	b2TreeNode* node = m_nodes + parent;
+	node->child1 = child1;
+	node->child2 = child2;
+	node->height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+	node->aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	node->parent = b2_nullNode;
+	m_nodes[child1].parent = parent;
+	m_nodes[child2].parent = parent;
+	return parent;
+}
+
+void b2DynamicTree::DestroyParkedProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(IsParked(proxyId));
+
+	FreeNode(proxyId);
+}
+
+bool b2DynamicTree::IsParked(int32 node) const
+{
+	return m_nodes[node].IsLeaf() && m_nodes[node].parent == b2_nullNode && node != m_root;
+}
+
 bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
@@ -263,7 +454,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 	m_nodes[newParent].parent = oldParent;
 	m_nodes[newParent].userData = NULL;
 	m_nodes[newParent].aabb.Combine(leafAABB, m_nodes[sibling].aabb);
-	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].height = b2Max(m_nodes[sibling].height, m_nodes[leaf].height) + 1;
 
 	if (oldParent != b2_nullNode)
 	{
@@ -542,9 +733,9 @@ float32 b2DynamicTree::GetAreaRatio() const
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
 		const b2TreeNode* node = m_nodes + i;
-		if (node->height < 0)
+		if (node->height < 0 || IsParked(i))
 		{
-			// Free node in pool
+			// Free node in pool or not in the tree
 			continue;
 		}
 
@@ -693,7 +884,8 @@ int32 b2DynamicTree::GetMaxBalance() const
 
 void b2DynamicTree::RebuildBottomUp()
 {
-	int32* nodes = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 nodeCount = m_nodeCount;
+	int32* nodes = (int32*)m_allocator->Allocate(nodeCount * sizeof(int32));
 	int32 count = 0;
 
 	// Build array of leaves. Free the rest.
@@ -707,6 +899,11 @@ void b2DynamicTree::RebuildBottomUp()
 
 		if (m_nodes[i].IsLeaf())
 		{
+			if (IsParked(i))
+			{
+				continue;
+			}
+
 			m_nodes[i].parent = b2_nullNode;
 			nodes[count] = i;
 			++count;
@@ -762,17 +959,69 @@ void b2DynamicTree::RebuildBottomUp()
 	}
 
 	m_root = nodes[0];
-	b2Free(nodes);
+	m_allocator->Free(nodes, nodeCount * sizeof(int32));
 
 	Validate();
 }
 
+int32 b2DynamicTree::GetMemorySize() const
+{
+	return m_nodeCapacity * sizeof(b2TreeNode);
+}
+
+void b2DynamicTree::WriteSnapshot(b2SnapshotWriter* writer) const
+{
+	writer->Write(m_root);
+	writer->Write(m_nodeCount);
+	writer->Write(m_nodeCapacity);
+	writer->Write(m_freeList);
+	writer->Write(m_path);
+	writer->Write(m_insertionCount);
+	writer->Write(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+}
+
+void b2DynamicTree::ReadSnapshot(b2SnapshotReader* reader)
+{
+	m_root = reader->Read<int32>();
+	m_nodeCount = reader->Read<int32>();
+	int32 nodeCapacity = reader->Read<int32>();
+	m_freeList = reader->Read<int32>();
+	m_path = reader->Read<uint32>();
+	m_insertionCount = reader->Read<int32>();
+
+	if (nodeCapacity != m_nodeCapacity)
+	{
+		m_allocator->Free(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+		m_nodeCapacity = nodeCapacity;
+		m_nodes = (b2TreeNode*)m_allocator->Allocate(m_nodeCapacity * sizeof(b2TreeNode));
+	}
+
+	reader->Read(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
-	// Build array of leaves. Free the rest.
-	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	// Walk the tree instead of the node array, so free and parked nodes are
+	// skipped. Parked proxies get new AABBs when they are unparked.
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
 	{
-		m_nodes[i].aabb.lowerBound -= newOrigin;
-		m_nodes[i].aabb.upperBound -= newOrigin;
+		int32 nodeId = stack.Pop();
+		if (nodeId == b2_nullNode)
+		{
+			continue;
+		}
+
+		b2TreeNode* node = m_nodes + nodeId;
+		node->aabb.lowerBound -= newOrigin;
+		node->aabb.upperBound -= newOrigin;
+
+		if (node->IsLeaf() == false)
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+		}
 	}
 }
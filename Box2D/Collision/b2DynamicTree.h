@@ -21,6 +21,11 @@
 
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Common/b2GrowableStack.h>
+#include <Box2D/Common/b2Allocator.h>
+
+class b2SnapshotWriter;
+class b2SnapshotReader;
+struct b2MortonLeaf;
 
 #define b2_nullNode (-1)
 
@@ -62,7 +67,8 @@ class b2DynamicTree
 {
 public:
 	/// Constructing the tree initializes the node pool.
-	b2DynamicTree();
+	/// @param allocator provides the node pool, NULL for the heap.
+	b2DynamicTree(b2Allocator* allocator = NULL);
 
 	/// Destroy the tree, freeing the node pool.
 	~b2DynamicTree();
@@ -70,9 +76,25 @@ public:
 	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
 	int32 CreateProxy(const b2AABB& aabb, void* userData);
 
+	/// Create proxies for many tight fitting AABBs. They are built into a
+	/// subtree along a Morton curve, which is inserted at once.
+	/// @param proxyIds receives the ids in the order of the AABBs.
+	void CreateProxies(const b2AABB* aabbs, void* const* userData, int32 count, int32* proxyIds);
+
 	/// Destroy a proxy. This asserts if the id is invalid.
 	void DestroyProxy(int32 proxyId);
 
+	/// Take a proxy out of the tree but keep its node and user data. A parked
+	/// proxy is not found by queries. It can only be unparked or destroyed.
+	void ParkProxy(int32 proxyId);
+
+	/// Put parked proxies back into the tree with new tight fitting AABBs. The
+	/// proxies are built into a subtree along a Morton curve, which is inserted at once.
+	void UnparkProxies(const int32* proxyIds, const b2AABB* aabbs, int32 count);
+
+	/// Destroy a parked proxy.
+	void DestroyParkedProxy(int32 proxyId);
+
 	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its fattened AABB,
 	/// then the proxy is removed from the tree and re-inserted. Otherwise
 	/// the function returns immediately.
@@ -120,17 +142,34 @@ public:
 
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
+	/// Parked proxies are not shifted.
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Get the bytes used by the node pool.
+	int32 GetMemorySize() const;
+
+	/// Write the node pool to a world snapshot.
+	void WriteSnapshot(b2SnapshotWriter* writer) const;
+
+	/// Restore the node pool from a world snapshot. The pool is only reallocated
+	/// if its capacity changed. Leaf user data is restored as it was written.
+	void ReadSnapshot(b2SnapshotReader* reader);
+
 private:
 
+	void ReserveNodes(int32 nodeCount);
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
 	void InsertLeaf(int32 node);
 	void RemoveLeaf(int32 node);
 
+	bool IsParked(int32 node) const;
+
+	// Build a subtree over leaves sorted by Morton code and return its root.
+	int32 BuildSubtree(const b2MortonLeaf* leaves, int32 count);
+
 	int32 Balance(int32 index);
 
 	int32 ComputeHeight() const;
@@ -141,6 +180,8 @@ private:
 
 	int32 m_root;
 
+	b2Allocator* m_allocator;
+
 	b2TreeNode* m_nodes;
 	int32 m_nodeCount;
 	int32 m_nodeCapacity;
@@ -0,0 +1,228 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2Allocator.h>
+
+// Arena allocations are rounded to keep the alignment of b2Alloc.
+const int32 b2_arenaAlignment = 16;
+
+// A range of the arena freed out of order. It is stored in the range itself,
+// which the alignment makes large enough.
+struct b2ArenaFreeRange
+{
+	b2ArenaFreeRange* next;
+	int32 size;
+};
+
+class b2HeapAllocator : public b2Allocator
+{
+public:
+	void* Allocate(int32 size)
+	{
+		return b2Alloc(size);
+	}
+
+	void Free(void* mem, int32 size)
+	{
+		B2_NOT_USED(size);
+		b2Free(mem);
+	}
+};
+
+b2Allocator* b2GetHeapAllocator()
+{
+	static b2HeapAllocator s_heapAllocator;
+	return &s_heapAllocator;
+}
+
+b2ArenaAllocator::b2ArenaAllocator(int32 capacity, b2Allocator* parent)
+{
+	b2Assert(capacity >= 0);
+
+	m_parent = parent ? parent : b2GetHeapAllocator();
+	m_capacity = capacity & ~(b2_arenaAlignment - 1);
+	m_data = m_capacity > 0 ? (uint8*)m_parent->Allocate(m_capacity) : NULL;
+	m_used = 0;
+	m_overflowCount = 0;
+	m_freeList = NULL;
+	m_freeBytes = 0;
+}
+
+b2ArenaAllocator::~b2ArenaAllocator()
+{
+	if (m_data)
+	{
+		m_parent->Free(m_data, m_capacity);
+	}
+}
+
+void* b2ArenaAllocator::Allocate(int32 size)
+{
+	b2Assert(size >= 0);
+	int32 alignedSize = (size + b2_arenaAlignment - 1) & ~(b2_arenaAlignment - 1);
+
+	// Empty requests only need a pointer the arena recognizes.
+	if (alignedSize == 0 && m_data)
+	{
+		return m_data;
+	}
+
+	// Reuse a freed range first.
+	if (alignedSize > 0)
+	{
+		for (b2ArenaFreeRange** link = &m_freeList; *link; link = &(*link)->next)
+		{
+			b2ArenaFreeRange* range = *link;
+			if (range->size < alignedSize)
+			{
+				continue;
+			}
+
+			if (range->size == alignedSize)
+			{
+				*link = range->next;
+			}
+			else
+			{
+				b2ArenaFreeRange* rest = (b2ArenaFreeRange*)((uint8*)range + alignedSize);
+				rest->next = range->next;
+				rest->size = range->size - alignedSize;
+				*link = rest;
+			}
+
+			m_freeBytes -= alignedSize;
+			return range;
+		}
+	}
+
+	if (m_used + alignedSize > m_capacity)
+	{
+		++m_overflowCount;
+		return m_parent->Allocate(size);
+	}
+
+	void* mem = m_data + m_used;
+	m_used += alignedSize;
+	return mem;
+}
+
+void b2ArenaAllocator::Free(void* mem, int32 size)
+{
+	if (mem == NULL)
+	{
+		return;
+	}
+
+	uint8* p = (uint8*)mem;
+	if (p < m_data || m_data + m_capacity <= p)
+	{
+		m_parent->Free(mem, size);
+		return;
+	}
+
+	int32 alignedSize = (size + b2_arenaAlignment - 1) & ~(b2_arenaAlignment - 1);
+	b2Assert(p + alignedSize <= m_data + m_used);
+	if (alignedSize == 0)
+	{
+		return;
+	}
+
+	// Insert in address order and merge with the neighbors. link points to
+	// the new range and prevLink to the one before it.
+	b2ArenaFreeRange** prevLink = NULL;
+	b2ArenaFreeRange** link = &m_freeList;
+	while (*link && (uint8*)*link < p)
+	{
+		prevLink = link;
+		link = &(*link)->next;
+	}
+
+	b2ArenaFreeRange* range = (b2ArenaFreeRange*)p;
+	range->size = alignedSize;
+	range->next = *link;
+	*link = range;
+	m_freeBytes += alignedSize;
+
+	b2ArenaFreeRange* next = range->next;
+	if (next && p + range->size == (uint8*)next)
+	{
+		range->size += next->size;
+		range->next = next->next;
+	}
+
+	if (prevLink)
+	{
+		b2ArenaFreeRange* prev = *prevLink;
+		if ((uint8*)prev + prev->size == p)
+		{
+			prev->size += range->size;
+			prev->next = range->next;
+			range = prev;
+			link = prevLink;
+		}
+	}
+
+	// A range that reaches the top goes back to the bump pointer.
+	if ((uint8*)range + range->size == m_data + m_used)
+	{
+		b2Assert(range->next == NULL);
+		*link = NULL;
+		m_used -= range->size;
+		m_freeBytes -= range->size;
+	}
+}
+
+void b2ArenaAllocator::Reset()
+{
+	m_used = 0;
+	m_freeList = NULL;
+	m_freeBytes = 0;
+}
+
+b2StatsAllocator::b2StatsAllocator(b2Allocator* target)
+{
+	m_target = target ? target : b2GetHeapAllocator();
+	m_stats.allocCount = 0;
+	m_stats.freeCount = 0;
+	m_stats.bytes = 0;
+	m_stats.peakBytes = 0;
+}
+
+void* b2StatsAllocator::Allocate(int32 size)
+{
+	++m_stats.allocCount;
+	m_stats.bytes += size;
+	if (m_stats.bytes > m_stats.peakBytes)
+	{
+		m_stats.peakBytes = m_stats.bytes;
+	}
+
+	return m_target->Allocate(size);
+}
+
+void b2StatsAllocator::Free(void* mem, int32 size)
+{
+	if (mem == NULL)
+	{
+		return;
+	}
+
+	++m_stats.freeCount;
+	m_stats.bytes -= size;
+	m_target->Free(mem, size);
+}
@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ALLOCATOR_H
+#define B2_ALLOCATOR_H
+
+#include <Box2D/Common/b2Settings.h>
+
+/// The default size of the arena a world reserves up front.
+const int32 b2_arenaSize = 1024 * 1024;	// 1M
+
+/// Source of the large memory blocks used by a world: block allocator
+/// chunks, the stack allocator buffer and the broad-phase arrays. Implement
+/// this to give each world its own heap. The allocator must outlive the world.
+class b2Allocator
+{
+public:
+	virtual ~b2Allocator() {}
+
+	/// Allocate size bytes. The memory must be aligned for any Box2D type.
+	virtual void* Allocate(int32 size) = 0;
+
+	/// Free memory returned by Allocate. size is the size that was requested.
+	virtual void Free(void* mem, int32 size) = 0;
+};
+
+/// Get an allocator that forwards to b2Alloc and b2Free.
+b2Allocator* b2GetHeapAllocator();
+
+struct b2ArenaFreeRange;
+
+/// An allocator that reserves one region up front and hands out memory by
+/// bumping a pointer. Freeing the most recent allocation gives the memory
+/// back to the bump pointer. Other frees are kept in a free list and reused
+/// first fit, merged with their neighbors. This fits a world well, because
+/// most of its memory is held in chunks and buffers that only grow.
+/// Requests that don't fit in the region go to the parent allocator.
+class b2ArenaAllocator : public b2Allocator
+{
+public:
+	/// @param capacity the size of the region. Zero forwards everything to parent.
+	/// @param parent where the region and overflow come from, NULL for the heap.
+	b2ArenaAllocator(int32 capacity, b2Allocator* parent = NULL);
+	~b2ArenaAllocator();
+
+	void* Allocate(int32 size);
+	void Free(void* mem, int32 size);
+
+	/// Release all memory allocated from the region. Overflow allocations are
+	/// not affected.
+	void Reset();
+
+	/// The size of the region.
+	int32 GetCapacity() const { return m_capacity; }
+
+	/// Bytes of the region in use.
+	int32 GetUsed() const { return m_used - m_freeBytes; }
+
+	/// Number of allocations that did not fit in the region.
+	int32 GetOverflowCount() const { return m_overflowCount; }
+
+private:
+
+	b2Allocator* m_parent;
+	uint8* m_data;
+	int32 m_capacity;
+	int32 m_used;
+	int32 m_overflowCount;
+
+	// Ranges below m_used that were freed out of order, sorted by address.
+	b2ArenaFreeRange* m_freeList;
+	int32 m_freeBytes;
+};
+
+/// Forwards to another allocator and records b2AllocStats.
+class b2StatsAllocator : public b2Allocator
+{
+public:
+	b2StatsAllocator(b2Allocator* target = NULL);
+
+	void* Allocate(int32 size);
+	void Free(void* mem, int32 size);
+
+	const b2AllocStats& GetStats() const { return m_stats; }
+
+private:
+
+	b2Allocator* m_target;
+	b2AllocStats m_stats;
+};
+
+#endif
@@ -52,46 +52,55 @@ struct b2Block
 	b2Block* next;
 };
 
-b2BlockAllocator::b2BlockAllocator()
+b2BlockAllocator::b2BlockAllocator(b2Allocator* allocator)
 {
 	b2Assert(b2_blockSizes < UCHAR_MAX);
 
+	m_allocator = allocator ? allocator : b2GetHeapAllocator();
+
 	m_chunkSpace = b2_chunkArrayIncrement;
 	m_chunkCount = 0;
-	m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+	m_chunks = (b2Chunk*)m_allocator->Allocate(m_chunkSpace * sizeof(b2Chunk));
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 
-	if (s_blockSizeLookupInitialized == false)
+	InitializeBlockSizeLookup();
+}
+
+void b2BlockAllocator::InitializeBlockSizeLookup()
+{
+	if (s_blockSizeLookupInitialized)
+	{
+		return;
+	}
+
+	int32 j = 0;
+	for (int32 i = 1; i <= b2_maxBlockSize; ++i)
 	{
-		int32 j = 0;
-		for (int32 i = 1; i <= b2_maxBlockSize; ++i)
+		b2Assert(j < b2_blockSizes);
+		if (i <= s_blockSizes[j])
 		{
-			b2Assert(j < b2_blockSizes);
-			if (i <= s_blockSizes[j])
-			{
-				s_blockSizeLookup[i] = (uint8)j;
-			}
-			else
-			{
-				++j;
-				s_blockSizeLookup[i] = (uint8)j;
-			}
+			s_blockSizeLookup[i] = (uint8)j;
+		}
+		else
+		{
+			++j;
+			s_blockSizeLookup[i] = (uint8)j;
 		}
-
-		s_blockSizeLookupInitialized = true;
 	}
+
+	s_blockSizeLookupInitialized = true;
 }
 
 b2BlockAllocator::~b2BlockAllocator()
 {
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
-		b2Free(m_chunks[i].blocks);
+		m_allocator->Free(m_chunks[i].blocks, b2_chunkSize);
 	}
 
-	b2Free(m_chunks);
+	m_allocator->Free(m_chunks, m_chunkSpace * sizeof(b2Chunk));
 }
 
 void* b2BlockAllocator::Allocate(int32 size)
@@ -103,7 +112,7 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
-		return b2Alloc(size);
+		return m_allocator->Allocate(size);
 	}
 
 	int32 index = s_blockSizeLookup[size];
@@ -120,15 +129,16 @@ void* b2BlockAllocator::Allocate(int32 size)
 		if (m_chunkCount == m_chunkSpace)
 		{
 			b2Chunk* oldChunks = m_chunks;
+			int32 oldSpace = m_chunkSpace;
 			m_chunkSpace += b2_chunkArrayIncrement;
-			m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+			m_chunks = (b2Chunk*)m_allocator->Allocate(m_chunkSpace * sizeof(b2Chunk));
 			memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
 			memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
-			b2Free(oldChunks);
+			m_allocator->Free(oldChunks, oldSpace * sizeof(b2Chunk));
 		}
 
 		b2Chunk* chunk = m_chunks + m_chunkCount;
-		chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
+		chunk->blocks = (b2Block*)m_allocator->Allocate(b2_chunkSize);
 #if defined(_DEBUG)
 		memset(chunk->blocks, 0xcd, b2_chunkSize);
 #endif
@@ -163,7 +173,7 @@ void b2BlockAllocator::Free(void* p, int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
-		b2Free(p);
+		m_allocator->Free(p, size);
 		return;
 	}
 
@@ -205,7 +215,7 @@ void b2BlockAllocator::Clear()
 {
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
-		b2Free(m_chunks[i].blocks);
+		m_allocator->Free(m_chunks[i].blocks, b2_chunkSize);
 	}
 
 	m_chunkCount = 0;
@@ -213,3 +223,42 @@ void b2BlockAllocator::Clear()
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 }
+
+void b2BlockAllocator::GetStats(b2BlockClassStats stats[b2_blockSizes]) const
+{
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		stats[i].blockSize = s_blockSizes[i];
+		stats[i].chunkCount = 0;
+		stats[i].usedCount = 0;
+		stats[i].freeCount = 0;
+
+		for (const b2Block* block = m_freeLists[i]; block; block = block->next)
+		{
+			++stats[i].freeCount;
+		}
+	}
+
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		int32 index = s_blockSizeLookup[m_chunks[i].blockSize];
+		stats[index].chunkCount += 1;
+		stats[index].usedCount += b2_chunkSize / m_chunks[i].blockSize;
+	}
+
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		stats[i].usedCount -= stats[i].freeCount;
+	}
+}
+
+int32 b2BlockAllocator::GetBlockSize(int32 size)
+{
+	if (size <= 0 || size > b2_maxBlockSize)
+	{
+		return size;
+	}
+
+	InitializeBlockSizeLookup();
+	return s_blockSizes[s_blockSizeLookup[size]];
+}
@@ -20,6 +20,7 @@
 #define B2_BLOCK_ALLOCATOR_H
 
 #include <Box2D/Common/b2Settings.h>
+#include <Box2D/Common/b2Allocator.h>
 
 const int32 b2_chunkSize = 16 * 1024;
 const int32 b2_maxBlockSize = 640;
@@ -29,25 +30,49 @@ const int32 b2_chunkArrayIncrement = 128;
 struct b2Block;
 struct b2Chunk;
 
+/// Usage of one block size class of a b2BlockAllocator.
+struct b2BlockClassStats
+{
+	int32 blockSize;	///< the size of the blocks in this class
+	int32 chunkCount;	///< number of chunks carved into blocks of this size
+	int32 usedCount;	///< blocks handed out
+	int32 freeCount;	///< blocks on the free list
+};
+
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
 class b2BlockAllocator
 {
 public:
-	b2BlockAllocator();
+	/// @param allocator provides the chunks, NULL for the heap.
+	b2BlockAllocator(b2Allocator* allocator = NULL);
 	~b2BlockAllocator();
 
-	/// Allocate memory. This will use b2Alloc if the size is larger than b2_maxBlockSize.
+	/// Allocate memory. This will use the chunk allocator directly if the size
+	/// is larger than b2_maxBlockSize.
 	void* Allocate(int32 size);
 
-	/// Free memory. This will use b2Free if the size is larger than b2_maxBlockSize.
+	/// Free memory. This will use the chunk allocator directly if the size is
+	/// larger than b2_maxBlockSize.
 	void Free(void* p, int32 size);
 
 	void Clear();
 
+	/// Get the usage of each block size class. This walks the free lists.
+	void GetStats(b2BlockClassStats stats[b2_blockSizes]) const;
+
+	/// Get the number of bytes an allocation of this size really uses.
+	static int32 GetBlockSize(int32 size);
+
 private:
 
+	friend class b2ConcurrentBlockAllocator;
+
+	static void InitializeBlockSizeLookup();
+
+	b2Allocator* m_allocator;
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
@@ -0,0 +1,331 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2ConcurrentBlockAllocator.h>
+#include <Box2D/Common/b2Math.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <string.h>
+
+struct b2Block
+{
+	b2Block* next;
+};
+
+// The first block of a batch links the batches in the depot. The smallest
+// block size leaves room for two pointers.
+struct b2BlockBatch
+{
+	b2Block* next;
+	b2BlockBatch* nextBatch;
+};
+
+class b2SpinLock
+{
+public:
+	b2SpinLock()
+	{
+		m_flag.clear();
+	}
+
+	void Lock()
+	{
+		while (m_flag.test_and_set(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Unlock()
+	{
+		m_flag.clear(std::memory_order_release);
+	}
+
+private:
+	std::atomic_flag m_flag;
+};
+
+struct b2BlockShard
+{
+	b2SpinLock lock;
+	b2Block* freeLists[b2_blockSizes];
+	int32 freeCounts[b2_blockSizes];
+
+	// Keep shards used by different threads off the same cache line.
+	uint8 padding[64];
+};
+
+struct b2BlockDepot
+{
+	std::mutex lock;
+	b2BlockBatch* batches[b2_blockSizes];
+
+	void** chunks;
+	int32 chunkCount;
+	int32 chunkCapacity;
+};
+
+// Threads are assigned shards round robin on first use.
+static std::atomic<int32> s_shardCounter(0);
+static thread_local int32 s_shardIndex = -1;
+
+b2ConcurrentBlockAllocator::b2ConcurrentBlockAllocator(b2Allocator* allocator)
+{
+	b2BlockAllocator::InitializeBlockSizeLookup();
+	b2Assert(sizeof(b2BlockBatch) <= (size_t)b2BlockAllocator::s_blockSizes[0]);
+
+	m_allocator = allocator ? allocator : b2GetHeapAllocator();
+
+	m_shards = (b2BlockShard*)b2Alloc(b2_blockAllocatorShards * sizeof(b2BlockShard));
+	for (int32 i = 0; i < b2_blockAllocatorShards; ++i)
+	{
+		b2BlockShard* shard = new (m_shards + i) b2BlockShard;
+		memset(shard->freeLists, 0, sizeof(shard->freeLists));
+		memset(shard->freeCounts, 0, sizeof(shard->freeCounts));
+	}
+
+	m_depot = new (b2Alloc(sizeof(b2BlockDepot))) b2BlockDepot;
+	memset(m_depot->batches, 0, sizeof(m_depot->batches));
+	m_depot->chunkCapacity = b2_chunkArrayIncrement;
+	m_depot->chunkCount = 0;
+	m_depot->chunks = (void**)m_allocator->Allocate(m_depot->chunkCapacity * sizeof(void*));
+}
+
+b2ConcurrentBlockAllocator::~b2ConcurrentBlockAllocator()
+{
+	for (int32 i = 0; i < m_depot->chunkCount; ++i)
+	{
+		m_allocator->Free(m_depot->chunks[i], b2_chunkSize);
+	}
+	m_allocator->Free(m_depot->chunks, m_depot->chunkCapacity * sizeof(void*));
+
+	m_depot->~b2BlockDepot();
+	b2Free(m_depot);
+
+	for (int32 i = 0; i < b2_blockAllocatorShards; ++i)
+	{
+		m_shards[i].~b2BlockShard();
+	}
+	b2Free(m_shards);
+}
+
+b2BlockShard* b2ConcurrentBlockAllocator::GetShard()
+{
+	if (s_shardIndex < 0)
+	{
+		s_shardIndex = s_shardCounter.fetch_add(1) % b2_blockAllocatorShards;
+	}
+
+	return m_shards + s_shardIndex;
+}
+
+void* b2ConcurrentBlockAllocator::Allocate(int32 size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	b2Assert(0 < size);
+
+	if (size > b2_maxBlockSize)
+	{
+		std::lock_guard<std::mutex> guard(m_depot->lock);
+		return m_allocator->Allocate(size);
+	}
+
+	int32 index = b2BlockAllocator::s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
+
+	b2BlockShard* shard = GetShard();
+	shard->lock.Lock();
+
+	void* p;
+	b2Block* block = shard->freeLists[index];
+	if (block)
+	{
+		shard->freeLists[index] = block->next;
+		--shard->freeCounts[index];
+		p = block;
+	}
+	else
+	{
+		p = Refill(shard, index);
+	}
+
+	shard->lock.Unlock();
+	return p;
+}
+
+// Take a batch from the depot, or carve a new chunk, and return one block.
+// The shard must be locked.
+void* b2ConcurrentBlockAllocator::Refill(b2BlockShard* shard, int32 index)
+{
+	b2Assert(shard->freeLists[index] == NULL);
+
+	std::lock_guard<std::mutex> guard(m_depot->lock);
+
+	b2BlockBatch* batch = m_depot->batches[index];
+	if (batch)
+	{
+		m_depot->batches[index] = batch->nextBatch;
+		shard->freeLists[index] = batch->next;
+		shard->freeCounts[index] = b2_blockBatchSize - 1;
+		return batch;
+	}
+
+	if (m_depot->chunkCount == m_depot->chunkCapacity)
+	{
+		void** oldChunks = m_depot->chunks;
+		int32 oldCapacity = m_depot->chunkCapacity;
+		m_depot->chunkCapacity += b2_chunkArrayIncrement;
+		m_depot->chunks = (void**)m_allocator->Allocate(m_depot->chunkCapacity * sizeof(void*));
+		memcpy(m_depot->chunks, oldChunks, m_depot->chunkCount * sizeof(void*));
+		m_allocator->Free(oldChunks, oldCapacity * sizeof(void*));
+	}
+
+	int8* chunk = (int8*)m_allocator->Allocate(b2_chunkSize);
+#if defined(_DEBUG)
+	memset(chunk, 0xcd, b2_chunkSize);
+#endif
+	m_depot->chunks[m_depot->chunkCount++] = chunk;
+
+	int32 blockSize = b2BlockAllocator::s_blockSizes[index];
+	int32 blockCount = b2_chunkSize / blockSize;
+
+	// The shard keeps the first batch and the remainder that doesn't make a
+	// full batch. The other batches go to the depot.
+	int32 depotBatchCount = b2Max(blockCount / b2_blockBatchSize - 1, 0);
+	int32 keepCount = blockCount - depotBatchCount * b2_blockBatchSize;
+
+	for (int32 i = 0; i < keepCount - 1; ++i)
+	{
+		b2Block* block = (b2Block*)(chunk + blockSize * i);
+		block->next = (b2Block*)(chunk + blockSize * (i + 1));
+	}
+	((b2Block*)(chunk + blockSize * (keepCount - 1)))->next = NULL;
+
+	for (int32 i = keepCount; i < blockCount; i += b2_blockBatchSize)
+	{
+		for (int32 j = i; j < i + b2_blockBatchSize - 1; ++j)
+		{
+			b2Block* block = (b2Block*)(chunk + blockSize * j);
+			block->next = (b2Block*)(chunk + blockSize * (j + 1));
+		}
+		((b2Block*)(chunk + blockSize * (i + b2_blockBatchSize - 1)))->next = NULL;
+
+		b2BlockBatch* newBatch = (b2BlockBatch*)(chunk + blockSize * i);
+		newBatch->nextBatch = m_depot->batches[index];
+		m_depot->batches[index] = newBatch;
+	}
+
+	b2Block* first = (b2Block*)chunk;
+	shard->freeLists[index] = first->next;
+	shard->freeCounts[index] = keepCount - 1;
+	return first;
+}
+
+void b2ConcurrentBlockAllocator::Free(void* p, int32 size)
+{
+	if (size == 0)
+	{
+		return;
+	}
+
+	b2Assert(0 < size);
+
+	if (size > b2_maxBlockSize)
+	{
+		std::lock_guard<std::mutex> guard(m_depot->lock);
+		m_allocator->Free(p, size);
+		return;
+	}
+
+	int32 index = b2BlockAllocator::s_blockSizeLookup[size];
+	b2Assert(0 <= index && index < b2_blockSizes);
+
+#ifdef _DEBUG
+	memset(p, 0xfd, b2BlockAllocator::s_blockSizes[index]);
+#endif
+
+	b2BlockShard* shard = GetShard();
+	shard->lock.Lock();
+
+	b2Block* block = (b2Block*)p;
+	block->next = shard->freeLists[index];
+	shard->freeLists[index] = block;
+	++shard->freeCounts[index];
+
+	// Give memory back before one thread hoards what the others allocate.
+	if (shard->freeCounts[index] >= 2 * b2_blockBatchSize)
+	{
+		Trim(shard, index);
+	}
+
+	shard->lock.Unlock();
+}
+
+// Move one batch from the shard to the depot. The shard must be locked.
+void b2ConcurrentBlockAllocator::Trim(b2BlockShard* shard, int32 index)
+{
+	b2Assert(shard->freeCounts[index] >= b2_blockBatchSize);
+
+	b2Block* head = shard->freeLists[index];
+	b2Block* tail = head;
+	for (int32 i = 1; i < b2_blockBatchSize; ++i)
+	{
+		tail = tail->next;
+	}
+
+	shard->freeLists[index] = tail->next;
+	shard->freeCounts[index] -= b2_blockBatchSize;
+	tail->next = NULL;
+
+	b2BlockBatch* batch = (b2BlockBatch*)head;
+
+	std::lock_guard<std::mutex> guard(m_depot->lock);
+	batch->nextBatch = m_depot->batches[index];
+	m_depot->batches[index] = batch;
+}
+
+void b2ConcurrentBlockAllocator::Rebalance()
+{
+	for (int32 i = 0; i < b2_blockAllocatorShards; ++i)
+	{
+		b2BlockShard* shard = m_shards + i;
+		shard->lock.Lock();
+
+		for (int32 index = 0; index < b2_blockSizes; ++index)
+		{
+			while (shard->freeCounts[index] >= b2_blockBatchSize)
+			{
+				Trim(shard, index);
+			}
+		}
+
+		shard->lock.Unlock();
+	}
+}
+
+int32 b2ConcurrentBlockAllocator::GetChunkCount() const
+{
+	std::lock_guard<std::mutex> guard(m_depot->lock);
+	return m_depot->chunkCount;
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_CONCURRENT_BLOCK_ALLOCATOR_H
+#define B2_CONCURRENT_BLOCK_ALLOCATOR_H
+
+#include <Box2D/Common/b2BlockAllocator.h>
+
+/// Number of shards. Threads are spread over the shards, so with up to this
+/// many threads each thread has its own shard.
+const int32 b2_blockAllocatorShards = 16;
+
+/// Number of blocks moved at once between a shard and the shared depot.
+const int32 b2_blockBatchSize = 32;
+
+struct b2BlockShard;
+struct b2BlockDepot;
+
+/// A thread-safe version of b2BlockAllocator with the same block size classes.
+/// Each thread allocates from and frees to its own shard, which caches free
+/// lists and only takes an uncontended lock. Shards exchange blocks with a
+/// shared depot in batches: a shard that runs dry takes a batch and a shard
+/// that caches too many blocks gives a batch back. This keeps memory flowing
+/// when blocks are allocated on one thread and freed on another.
+class b2ConcurrentBlockAllocator
+{
+public:
+	/// @param allocator provides the chunks, NULL for the heap. It is only
+	/// called with the depot locked, so it doesn't need to be thread-safe as
+	/// long as nothing else uses it concurrently.
+	b2ConcurrentBlockAllocator(b2Allocator* allocator = NULL);
+	~b2ConcurrentBlockAllocator();
+
+	/// Allocate memory. This can be called from any thread.
+	void* Allocate(int32 size);
+
+	/// Free memory. This can be called from any thread, not only the one
+	/// that allocated the block.
+	void Free(void* p, int32 size);
+
+	/// Move the blocks cached by the shards back to the depot, except for
+	/// a partial batch. Call this periodically, e.g. after a parallel phase,
+	/// so memory freed by one thread can be reused by the others.
+	void Rebalance();
+
+	/// Number of chunks allocated so far.
+	int32 GetChunkCount() const;
+
+private:
+
+	b2BlockShard* GetShard();
+	void* Refill(b2BlockShard* shard, int32 index);
+	void Trim(b2BlockShard* shard, int32 index);
+
+	b2Allocator* m_allocator;
+	b2BlockShard* m_shards;
+	b2BlockDepot* m_depot;
+};
+
+#endif
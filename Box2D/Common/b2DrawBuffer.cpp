@@ -0,0 +1,181 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2DrawBuffer.h>
+#include <string.h>
+
+// Same scale as the testbed.
+static const float32 b2_drawAxisScale = 0.4f;
+
+b2DrawBuffer::b2DrawBuffer(int32 circleSegments, b2Allocator* allocator)
+{
+	b2Assert(circleSegments >= 3);
+
+	m_allocator = allocator ? allocator : b2GetHeapAllocator();
+	m_drawFlags = 0;
+
+	m_lines = NULL;
+	m_lineCount = 0;
+	m_lineCapacity = 0;
+
+	m_triangles = NULL;
+	m_triangleCount = 0;
+	m_triangleCapacity = 0;
+
+	m_circleSegments = circleSegments;
+	m_circle = (b2Vec2*)m_allocator->Allocate(m_circleSegments * sizeof(b2Vec2));
+	for (int32 i = 0; i < m_circleSegments; ++i)
+	{
+		float32 angle = 2.0f * b2_pi * i / m_circleSegments;
+		m_circle[i].Set(cosf(angle), sinf(angle));
+	}
+}
+
+b2DrawBuffer::~b2DrawBuffer()
+{
+	if (m_lines)
+	{
+		m_allocator->Free(m_lines, m_lineCapacity * sizeof(b2DrawVertex));
+	}
+
+	if (m_triangles)
+	{
+		m_allocator->Free(m_triangles, m_triangleCapacity * sizeof(b2DrawVertex));
+	}
+
+	m_allocator->Free(m_circle, m_circleSegments * sizeof(b2Vec2));
+}
+
+void b2DrawBuffer::Grow(b2DrawVertex** vertices, int32* capacity, int32 size)
+{
+	int32 oldCapacity = *capacity;
+	int32 newCapacity = b2Max(2 * oldCapacity, 1024);
+	while (newCapacity < size)
+	{
+		newCapacity *= 2;
+	}
+
+	b2DrawVertex* newVertices = (b2DrawVertex*)m_allocator->Allocate(newCapacity * sizeof(b2DrawVertex));
+	if (*vertices)
+	{
+		// Only the vertices of this frame need to move.
+		int32 count = *vertices == m_lines ? m_lineCount : m_triangleCount;
+		memcpy(newVertices, *vertices, count * sizeof(b2DrawVertex));
+		m_allocator->Free(*vertices, oldCapacity * sizeof(b2DrawVertex));
+	}
+
+	*vertices = newVertices;
+	*capacity = newCapacity;
+}
+
+void b2DrawBuffer::Reserve(int32 lineVertexCount, int32 triangleVertexCount)
+{
+	if (m_lineCount + lineVertexCount > m_lineCapacity)
+	{
+		Grow(&m_lines, &m_lineCapacity, m_lineCount + lineVertexCount);
+	}
+
+	if (m_triangleCount + triangleVertexCount > m_triangleCapacity)
+	{
+		Grow(&m_triangles, &m_triangleCapacity, m_triangleCount + triangleVertexCount);
+	}
+}
+
+void b2DrawBuffer::DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	uint32 c = b2PackColor(color);
+	b2DrawVertex* v = AddLines(2 * vertexCount);
+
+	b2Vec2 p1 = vertices[vertexCount - 1];
+	for (int32 i = 0; i < vertexCount; ++i)
+	{
+		b2Vec2 p2 = vertices[i];
+		v[0].position = p1;
+		v[0].color = c;
+		v[1].position = p2;
+		v[1].color = c;
+		v += 2;
+		p1 = p2;
+	}
+}
+
+void b2DrawBuffer::DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color)
+{
+	uint32 fill = b2PackColor(b2Color(0.5f * color.r, 0.5f * color.g, 0.5f * color.b, 0.5f));
+	b2DrawVertex* v = AddTriangles(3 * (vertexCount - 2));
+	for (int32 i = 1; i < vertexCount - 1; ++i)
+	{
+		v[0].position = vertices[0];
+		v[0].color = fill;
+		v[1].position = vertices[i];
+		v[1].color = fill;
+		v[2].position = vertices[i + 1];
+		v[2].color = fill;
+		v += 3;
+	}
+
+	DrawPolygon(vertices, vertexCount, color);
+}
+
+void b2DrawBuffer::DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color)
+{
+	uint32 c = b2PackColor(color);
+	b2DrawVertex* v = AddLines(2 * m_circleSegments);
+
+	b2Vec2 p1 = center + radius * m_circle[m_circleSegments - 1];
+	for (int32 i = 0; i < m_circleSegments; ++i)
+	{
+		b2Vec2 p2 = center + radius * m_circle[i];
+		v[0].position = p1;
+		v[0].color = c;
+		v[1].position = p2;
+		v[1].color = c;
+		v += 2;
+		p1 = p2;
+	}
+}
+
+void b2DrawBuffer::DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color)
+{
+	uint32 fill = b2PackColor(b2Color(0.5f * color.r, 0.5f * color.g, 0.5f * color.b, 0.5f));
+	b2DrawVertex* v = AddTriangles(3 * (m_circleSegments - 2));
+
+	b2Vec2 p0 = center + radius * m_circle[0];
+	b2Vec2 p1 = center + radius * m_circle[1];
+	for (int32 i = 2; i < m_circleSegments; ++i)
+	{
+		b2Vec2 p2 = center + radius * m_circle[i];
+		v[0].position = p0;
+		v[0].color = fill;
+		v[1].position = p1;
+		v[1].color = fill;
+		v[2].position = p2;
+		v[2].color = fill;
+		v += 3;
+		p1 = p2;
+	}
+
+	DrawCircle(center, radius, color);
+	DrawSegment(center, center + radius * axis, color);
+}
+
+void b2DrawBuffer::DrawTransform(const b2Transform& xf)
+{
+	DrawSegment(xf.p, xf.p + b2_drawAxisScale * xf.q.GetXAxis(), b2Color(1.0f, 0.0f, 0.0f));
+	DrawSegment(xf.p, xf.p + b2_drawAxisScale * xf.q.GetYAxis(), b2Color(0.0f, 1.0f, 0.0f));
+}
@@ -0,0 +1,198 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_DRAW_BUFFER_H
+#define B2_DRAW_BUFFER_H
+
+#include <Box2D/Common/b2Draw.h>
+#include <Box2D/Common/b2Allocator.h>
+
+/// A vertex of the debug draw buffers. The color is 8-bit RGBA with red in
+/// the lowest byte, so in memory the bytes are r, g, b, a.
+struct b2DrawVertex
+{
+	b2Vec2 position;
+	uint32 color;
+};
+
+/// Pack a color for b2DrawVertex.
+inline uint32 b2PackColor(const b2Color& color)
+{
+	uint32 r = uint32(b2Clamp(color.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+	uint32 g = uint32(b2Clamp(color.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+	uint32 b = uint32(b2Clamp(color.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+	uint32 a = uint32(b2Clamp(color.a, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+/// Debug draw data as two vertex arrays: a line list with two vertices per
+/// segment and a triangle list with three vertices per triangle. Fill it with
+/// b2World::DrawDebugData(b2DrawBuffer*), which walks the world once and
+/// makes no virtual calls, then hand each array to the renderer in one draw.
+/// The functions match b2Draw, except that they are not virtual. Solid shapes
+/// are filled at half intensity and outlined, like the testbed draws them.
+/// Circles use a unit circle tessellated once. The arrays keep their capacity
+/// when cleared, so after the first frame drawing does not allocate.
+class b2DrawBuffer
+{
+public:
+	/// @param circleSegments the number of segments of circles, at least 3.
+	/// @param allocator provides the arrays, NULL for the heap.
+	b2DrawBuffer(int32 circleSegments = 16, b2Allocator* allocator = NULL);
+	~b2DrawBuffer();
+
+	/// Remove all vertices. Call this at the start of each frame.
+	void Clear();
+
+	/// Make room for this many more line and triangle vertices.
+	void Reserve(int32 lineVertexCount, int32 triangleVertexCount);
+
+	/// Set the drawing flags, see b2Draw.
+	void SetFlags(uint32 flags);
+
+	/// Get the drawing flags.
+	uint32 GetFlags() const;
+
+	/// Draw a closed polygon provided in CCW order.
+	void DrawPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color);
+
+	/// Draw a solid closed polygon provided in CCW order.
+	void DrawSolidPolygon(const b2Vec2* vertices, int32 vertexCount, const b2Color& color);
+
+	/// Draw a circle.
+	void DrawCircle(const b2Vec2& center, float32 radius, const b2Color& color);
+
+	/// Draw a solid circle.
+	void DrawSolidCircle(const b2Vec2& center, float32 radius, const b2Vec2& axis, const b2Color& color);
+
+	/// Draw a line segment.
+	void DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color);
+
+	/// Draw a transform as a red x axis and a green y axis.
+	void DrawTransform(const b2Transform& xf);
+
+	/// Get the line list.
+	const b2DrawVertex* GetLineVertices() const;
+	int32 GetLineVertexCount() const;
+
+	/// Get the triangle list.
+	const b2DrawVertex* GetTriangleVertices() const;
+	int32 GetTriangleVertexCount() const;
+
+	/// Get the number of segments of circles.
+	int32 GetCircleSegmentCount() const;
+
+private:
+
+	// Room for count more vertices, returned for writing.
+	b2DrawVertex* AddLines(int32 count);
+	b2DrawVertex* AddTriangles(int32 count);
+	void Grow(b2DrawVertex** vertices, int32* capacity, int32 size);
+
+	b2Allocator* m_allocator;
+	uint32 m_drawFlags;
+
+	b2DrawVertex* m_lines;
+	int32 m_lineCount;
+	int32 m_lineCapacity;
+
+	b2DrawVertex* m_triangles;
+	int32 m_triangleCount;
+	int32 m_triangleCapacity;
+
+	// Points of the unit circle, starting on the x axis.
+	b2Vec2* m_circle;
+	int32 m_circleSegments;
+};
+
+inline void b2DrawBuffer::Clear()
+{
+	m_lineCount = 0;
+	m_triangleCount = 0;
+}
+
+inline void b2DrawBuffer::SetFlags(uint32 flags)
+{
+	m_drawFlags = flags;
+}
+
+inline uint32 b2DrawBuffer::GetFlags() const
+{
+	return m_drawFlags;
+}
+
+inline b2DrawVertex* b2DrawBuffer::AddLines(int32 count)
+{
+	if (m_lineCount + count > m_lineCapacity)
+	{
+		Grow(&m_lines, &m_lineCapacity, m_lineCount + count);
+	}
+
+	b2DrawVertex* vertices = m_lines + m_lineCount;
+	m_lineCount += count;
+	return vertices;
+}
+
+inline b2DrawVertex* b2DrawBuffer::AddTriangles(int32 count)
+{
+	if (m_triangleCount + count > m_triangleCapacity)
+	{
+		Grow(&m_triangles, &m_triangleCapacity, m_triangleCount + count);
+	}
+
+	b2DrawVertex* vertices = m_triangles + m_triangleCount;
+	m_triangleCount += count;
+	return vertices;
+}
+
+inline void b2DrawBuffer::DrawSegment(const b2Vec2& p1, const b2Vec2& p2, const b2Color& color)
+{
+	uint32 c = b2PackColor(color);
+	b2DrawVertex* v = AddLines(2);
+	v[0].position = p1;
+	v[0].color = c;
+	v[1].position = p2;
+	v[1].color = c;
+}
+
+inline const b2DrawVertex* b2DrawBuffer::GetLineVertices() const
+{
+	return m_lines;
+}
+
+inline int32 b2DrawBuffer::GetLineVertexCount() const
+{
+	return m_lineCount;
+}
+
+inline const b2DrawVertex* b2DrawBuffer::GetTriangleVertices() const
+{
+	return m_triangles;
+}
+
+inline int32 b2DrawBuffer::GetTriangleVertexCount() const
+{
+	return m_triangleCount;
+}
+
+inline int32 b2DrawBuffer::GetCircleSegmentCount() const
+{
+	return m_circleSegments;
+}
+
+#endif
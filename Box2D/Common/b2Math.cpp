@@ -92,3 +92,256 @@ void b2Mat33::GetSymInverse33(b2Mat33* M) const
 	M->ez.y = M->ey.z;
 	M->ez.z = det * (a11 * a22 - a12 * a12);
 }
+
+#ifdef B2_DETERMINISTIC
+
+// The routines below evaluate Taylor series in double precision after an
+// exact or extra-precise range reduction. The series are truncated below
+// double precision so rounding the result to float is correct except for
+// values extremely close to a float rounding boundary. Only IEEE basic
+// operations, sqrt, floor, fmod and ldexp are used, which are exact or
+// correctly rounded everywhere.
+
+static const float64 b2_pio2 = 1.57079632679489661923;
+static const float64 b2_pio4 = 0.78539816339744830962;
+static const float64 b2_pi64 = 3.14159265358979323846;
+
+// Sine and cosine of r for |r| <= pi/4.
+static float64 b2SinSeries(float64 r)
+{
+	float64 r2 = r * r;
+	float64 p = 1.0 / 355687428096000.0;
+	p = -1.0 / 1307674368000.0 + r2 * p;
+	p = 1.0 / 6227020800.0 + r2 * p;
+	p = -1.0 / 39916800.0 + r2 * p;
+	p = 1.0 / 362880.0 + r2 * p;
+	p = -1.0 / 5040.0 + r2 * p;
+	p = 1.0 / 120.0 + r2 * p;
+	p = -1.0 / 6.0 + r2 * p;
+	return r + r * r2 * p;
+}
+
+static float64 b2CosSeries(float64 r)
+{
+	float64 r2 = r * r;
+	float64 p = -1.0 / 6402373705728000.0;
+	p = 1.0 / 20922789888000.0 + r2 * p;
+	p = -1.0 / 87178291200.0 + r2 * p;
+	p = 1.0 / 479001600.0 + r2 * p;
+	p = -1.0 / 3628800.0 + r2 * p;
+	p = 1.0 / 40320.0 + r2 * p;
+	p = -1.0 / 720.0 + r2 * p;
+	p = 1.0 / 24.0 + r2 * p;
+	p = -0.5 + r2 * p;
+	return 1.0 + r2 * p;
+}
+
+// Reduce x to r in [-pi/4, pi/4] with x = r + quadrant * pi/2.
+static float64 b2ReduceAngle(float64 x, int32* quadrant)
+{
+	// Keep the quadrant index small. fmod is exact.
+	if (x > 1.0e6 || x < -1.0e6)
+	{
+		x = fmod(x, 2.0 * b2_pi64);
+	}
+
+	// pi/2 split in three parts (Cody-Waite). The first two parts have
+	// trailing zero bits so the products with k are exact.
+	const float64 pio2_1 = 1.57079632673412561417e+00;
+	const float64 pio2_2 = 6.07710050630396597660e-11;
+	const float64 pio2_3 = 2.02226624879595063154e-21;
+
+	float64 k = floor(x * (1.0 / b2_pio2) + 0.5);
+	*quadrant = int32(k) & 3;
+	return ((x - k * pio2_1) - k * pio2_2) - k * pio2_3;
+}
+
+float32 b2DeterministicSqrt(float32 x)
+{
+	// IEEE sqrt is correctly rounded and double has enough precision
+	// to avoid double rounding.
+	return float32(sqrt(float64(x)));
+}
+
+float32 b2DeterministicSin(float32 x)
+{
+	if (b2IsValid(x) == false)
+	{
+		return x - x;
+	}
+
+	int32 quadrant;
+	float64 r = b2ReduceAngle(x, &quadrant);
+	switch (quadrant)
+	{
+	case 0:
+		return float32(b2SinSeries(r));
+	case 1:
+		return float32(b2CosSeries(r));
+	case 2:
+		return float32(-b2SinSeries(r));
+	default:
+		return float32(-b2CosSeries(r));
+	}
+}
+
+float32 b2DeterministicCos(float32 x)
+{
+	if (b2IsValid(x) == false)
+	{
+		return x - x;
+	}
+
+	int32 quadrant;
+	float64 r = b2ReduceAngle(x, &quadrant);
+	switch (quadrant)
+	{
+	case 0:
+		return float32(b2CosSeries(r));
+	case 1:
+		return float32(-b2SinSeries(r));
+	case 2:
+		return float32(-b2CosSeries(r));
+	default:
+		return float32(b2SinSeries(r));
+	}
+}
+
+// Arc tangent for t >= 0.
+static float64 b2AtanPositive(float64 t)
+{
+	// atan(t) = pi/2 - atan(1/t)
+	bool invert = t > 1.0;
+	if (invert)
+	{
+		t = 1.0 / t;
+	}
+
+	// atan(t) = pi/4 + atan((t - 1) / (t + 1)) gives |t| <= tan(pi/8).
+	float64 offset = 0.0;
+	if (t > 0.41421356237309504880)
+	{
+		t = (t - 1.0) / (t + 1.0);
+		offset = b2_pio4;
+	}
+
+	// Halve the angle once more: |u| <= tan(pi/16).
+	float64 u = t / (1.0 + sqrt(1.0 + t * t));
+	float64 u2 = u * u;
+
+	float64 p = 1.0 / 25.0;
+	p = -1.0 / 23.0 + u2 * p;
+	p = 1.0 / 21.0 + u2 * p;
+	p = -1.0 / 19.0 + u2 * p;
+	p = 1.0 / 17.0 + u2 * p;
+	p = -1.0 / 15.0 + u2 * p;
+	p = 1.0 / 13.0 + u2 * p;
+	p = -1.0 / 11.0 + u2 * p;
+	p = 1.0 / 9.0 + u2 * p;
+	p = -1.0 / 7.0 + u2 * p;
+	p = 1.0 / 5.0 + u2 * p;
+	p = -1.0 / 3.0 + u2 * p;
+	p = 1.0 + u2 * p;
+
+	float64 a = offset + 2.0 * u * p;
+	return invert ? b2_pio2 - a : a;
+}
+
+float32 b2DeterministicAtan2(float32 y, float32 x)
+{
+	if (x != x || y != y)
+	{
+		return x + y;
+	}
+
+	bool negativeX = signbit(x) != 0;
+	bool negativeY = signbit(y) != 0;
+
+	float64 angle;
+	if (y == 0.0f)
+	{
+		// atan2(+-0, +x) = +-0 and atan2(+-0, -x) = +-pi
+		if (negativeX == false)
+		{
+			return y;
+		}
+		angle = b2_pi64;
+	}
+	else if (x == 0.0f)
+	{
+		angle = b2_pio2;
+	}
+	else if (b2IsValid(x) == false || b2IsValid(y) == false)
+	{
+		// At least one infinity.
+		if (b2IsValid(x))
+		{
+			angle = b2_pio2;
+		}
+		else if (b2IsValid(y))
+		{
+			angle = negativeX ? b2_pi64 : 0.0;
+		}
+		else
+		{
+			angle = negativeX ? 3.0 * b2_pio4 : b2_pio4;
+		}
+	}
+	else
+	{
+		float64 ax = negativeX ? -float64(x) : float64(x);
+		float64 ay = negativeY ? -float64(y) : float64(y);
+		angle = b2AtanPositive(ay / ax);
+		if (negativeX)
+		{
+			angle = b2_pi64 - angle;
+		}
+	}
+
+	return float32(negativeY ? -angle : angle);
+}
+
+float32 b2DeterministicExp(float32 x)
+{
+	if (x != x)
+	{
+		return x;
+	}
+
+	if (x > 88.7228394f)
+	{
+		return float32(HUGE_VAL);
+	}
+
+	if (x < -103.972084f)
+	{
+		return 0.0f;
+	}
+
+	// x = k * ln2 + r with |r| <= ln2 / 2. ln2 is split so k * ln2_1 is exact.
+	const float64 ln2_1 = 6.93147180369123816490e-01;
+	const float64 ln2_2 = 1.90821492927058770002e-10;
+
+	float64 k = floor(x * 1.44269504088896340736 + 0.5);
+	float64 r = (float64(x) - k * ln2_1) - k * ln2_2;
+
+	float64 p = 1.0 / 87178291200.0;
+	p = 1.0 / 6227020800.0 + r * p;
+	p = 1.0 / 479001600.0 + r * p;
+	p = 1.0 / 39916800.0 + r * p;
+	p = 1.0 / 3628800.0 + r * p;
+	p = 1.0 / 362880.0 + r * p;
+	p = 1.0 / 40320.0 + r * p;
+	p = 1.0 / 5040.0 + r * p;
+	p = 1.0 / 720.0 + r * p;
+	p = 1.0 / 120.0 + r * p;
+	p = 1.0 / 24.0 + r * p;
+	p = 1.0 / 6.0 + r * p;
+	p = 0.5 + r * p;
+	p = 1.0 + r * p;
+	p = 1.0 + r * p;
+
+	return float32(ldexp(p, int32(k)));
+}
+
+#endif
@@ -46,8 +46,33 @@ inline float32 b2InvSqrt(float32 x)
 	return x;
 }
 
+#ifdef B2_DETERMINISTIC
+
+/// Portable math routines. These only use IEEE basic operations in double
+/// precision and round the result once, so they give the same results on
+/// all compilers and platforms. Build with floating point contraction
+/// disabled and SSE2 math on x86 (see BOX2D_DETERMINISTIC in CMake).
+float32 b2DeterministicSqrt(float32 x);
+float32 b2DeterministicSin(float32 x);
+float32 b2DeterministicCos(float32 x);
+float32 b2DeterministicAtan2(float32 y, float32 x);
+float32 b2DeterministicExp(float32 x);
+
+#define	b2Sqrt(x)	b2DeterministicSqrt(x)
+#define	b2Sin(x)	b2DeterministicSin(x)
+#define	b2Cos(x)	b2DeterministicCos(x)
+#define	b2Atan2(y, x)	b2DeterministicAtan2(y, x)
+#define	b2Exp(x)	b2DeterministicExp(x)
+
+#else
+
 #define	b2Sqrt(x)	sqrtf(x)
+#define	b2Sin(x)	sinf(x)
+#define	b2Cos(x)	cosf(x)
 #define	b2Atan2(y, x)	atan2f(y, x)
+#define	b2Exp(x)	expf(x)
+
+#endif
 
 /// A 2D column vector.
 struct b2Vec2
@@ -140,6 +165,32 @@ struct b2Vec2
 	float32 x, y;
 };
 
+/// A 2D column vector with double precision. This is only used to track
+/// absolute positions in large worlds, see b2World::ShiftOrigin. The solver
+/// works with b2Vec2 relative to the world origin.
+struct b2Vec2d
+{
+	/// Default constructor does nothing (for performance).
+	b2Vec2d() {}
+
+	/// Construct using coordinates.
+	b2Vec2d(float64 x, float64 y) : x(x), y(y) {}
+
+	/// Set this vector to all zeros.
+	void SetZero() { x = 0.0; y = 0.0; }
+
+	/// Set this vector to some specified coordinates.
+	void Set(float64 x_, float64 y_) { x = x_; y = y_; }
+
+	/// Add a vector to this vector.
+	void operator += (const b2Vec2& v)
+	{
+		x += v.x; y += v.y;
+	}
+
+	float64 x, y;
+};
+
 /// A 2D column vector with 3 elements.
 struct b2Vec3
 {
@@ -304,16 +355,16 @@ struct b2Rot
 	explicit b2Rot(float32 angle)
 	{
 		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		s = b2Sin(angle);
+		c = b2Cos(angle);
 	}
 
 	/// Set using an angle in radians.
 	void Set(float32 angle)
 	{
 		/// TODO_ERIN optimize
-		s = sinf(angle);
-		c = cosf(angle);
+		s = b2Sin(angle);
+		c = b2Cos(angle);
 	}
 
 	/// Set to the identity rotation
@@ -454,6 +505,18 @@ inline b2Vec2 operator - (const b2Vec2& a, const b2Vec2& b)
 	return b2Vec2(a.x - b.x, a.y - b.y);
 }
 
+/// Add a relative position to a double precision origin.
+inline b2Vec2d operator + (const b2Vec2d& a, const b2Vec2& b)
+{
+	return b2Vec2d(a.x + b.x, a.y + b.y);
+}
+
+/// Get the offset from b to a, rounded once to single precision.
+inline b2Vec2 b2Offset(const b2Vec2d& a, const b2Vec2d& b)
+{
+	return b2Vec2(float32(a.x - b.x), float32(a.y - b.y));
+}
+
 inline b2Vec2 operator * (float32 s, const b2Vec2& a)
 {
 	return b2Vec2(s * a.x, s * a.y);
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2Pool.h>
+#include <string.h>
+
+b2Pool::b2Pool(b2Allocator* allocator, int32 objectSize)
+{
+	b2Assert(objectSize >= int32(sizeof(int32)));
+
+	m_allocator = allocator ? allocator : b2GetHeapAllocator();
+	m_objectSize = (objectSize + 7) & ~7;
+	m_pageBytes = b2_poolPageSize * (m_objectSize + int32(sizeof(uint32)));
+
+	m_pages = NULL;
+	m_pageCount = 0;
+	m_pageCapacity = 0;
+
+	m_freeList = b2_nullSlot;
+	m_count = 0;
+}
+
+b2Pool::~b2Pool()
+{
+	for (int32 i = 0; i < m_pageCount; ++i)
+	{
+		m_allocator->Free(m_pages[i], m_pageBytes);
+	}
+
+	if (m_pages)
+	{
+		m_allocator->Free(m_pages, m_pageCapacity * sizeof(char*));
+	}
+}
+
+void* b2Pool::Allocate(int32* index)
+{
+	if (m_freeList == b2_nullSlot)
+	{
+		if (m_pageCount == m_pageCapacity)
+		{
+			char** oldPages = m_pages;
+			int32 oldCapacity = m_pageCapacity;
+			m_pageCapacity = oldCapacity > 0 ? 2 * oldCapacity : 16;
+			m_pages = (char**)m_allocator->Allocate(m_pageCapacity * sizeof(char*));
+			if (oldPages)
+			{
+				memcpy(m_pages, oldPages, m_pageCount * sizeof(char*));
+				m_allocator->Free(oldPages, oldCapacity * sizeof(char*));
+			}
+		}
+
+		int32 page = m_pageCount++;
+		m_pages[page] = (char*)m_allocator->Allocate(m_pageBytes);
+		memset(GetRevisions(page), 0, b2_poolPageSize * sizeof(uint32));
+
+		// Link the new slots so the lowest index is used first.
+		int32 first = page << b2_poolPageShift;
+		for (int32 i = 0; i < b2_poolPageSize - 1; ++i)
+		{
+			*(int32*)GetSlot(first + i) = first + i + 1;
+		}
+		*(int32*)GetSlot(first + b2_poolPageSize - 1) = b2_nullSlot;
+		m_freeList = first;
+	}
+
+	int32 slot = m_freeList;
+	char* memory = GetSlot(slot);
+	m_freeList = *(int32*)memory;
+
+	uint32* revision = GetRevisions(slot >> b2_poolPageShift) + (slot & (b2_poolPageSize - 1));
+	b2Assert((*revision & 1) == 0);
+	*revision += 1;
+
+	++m_count;
+	*index = slot;
+	return memory;
+}
+
+void b2Pool::Free(int32 index)
+{
+	b2Assert(0 <= index && index < GetCapacity());
+	b2Assert(m_count > 0);
+
+	uint32* revision = GetRevisions(index >> b2_poolPageShift) + (index & (b2_poolPageSize - 1));
+	b2Assert(*revision & 1);
+	*revision += 1;
+
+	*(int32*)GetSlot(index) = m_freeList;
+	m_freeList = index;
+	--m_count;
+}
+
+int32 b2Pool::GetMemorySize() const
+{
+	return m_pageCount * m_pageBytes + m_pageCapacity * int32(sizeof(char*));
+}
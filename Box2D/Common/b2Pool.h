@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_POOL_H
+#define B2_POOL_H
+
+#include <Box2D/Common/b2Settings.h>
+#include <Box2D/Common/b2Allocator.h>
+
+const int32 b2_poolPageShift = 6;
+const int32 b2_poolPageSize = 1 << b2_poolPageShift;	// 64 objects
+const int32 b2_nullSlot = -1;
+
+/// A pool of objects of one size, stored back to back in pages. Each object
+/// keeps its slot index until it is freed and never moves, so pointers stay
+/// valid as well. Freed slots are reused before the pool grows, which keeps
+/// the live objects packed in the first pages.
+/// Every slot has a revision that changes when the slot is allocated and
+/// freed, so an index and revision pair is a handle that can be checked
+/// after the object is gone. Live slots have odd revisions.
+class b2Pool
+{
+public:
+	/// @param allocator provides the pages, NULL for the heap.
+	/// @param objectSize the size of the objects, rounded up to 8 bytes.
+	b2Pool(b2Allocator* allocator, int32 objectSize);
+	~b2Pool();
+
+	/// Get the memory of a new object and its slot index.
+	void* Allocate(int32* index);
+
+	/// Free the object in a slot. The object must be destructed already.
+	void Free(int32 index);
+
+	/// Get the object in a live slot.
+	void* Get(int32 index) const;
+
+	/// Get the object in a slot, or NULL if the slot is free.
+	void* Find(int32 index) const;
+
+	/// Get the object a handle refers to, or NULL if it was freed.
+	void* Find(int32 index, uint32 revision) const;
+
+	/// Get the current revision of a slot.
+	uint32 GetRevision(int32 index) const;
+
+	/// Get the number of live objects.
+	int32 GetCount() const;
+
+	/// Get the number of slots. Live objects have indices below this.
+	int32 GetCapacity() const;
+
+	/// Get the bytes used by the pages and the page table.
+	int32 GetMemorySize() const;
+
+private:
+
+	// A page holds the objects followed by their revisions.
+	char* GetSlot(int32 index) const;
+	uint32* GetRevisions(int32 page) const;
+
+	b2Allocator* m_allocator;
+
+	int32 m_objectSize;
+	int32 m_pageBytes;
+
+	char** m_pages;
+	int32 m_pageCount;
+	int32 m_pageCapacity;
+
+	// Free slots are linked through their first bytes.
+	int32 m_freeList;
+	int32 m_count;
+};
+
+inline char* b2Pool::GetSlot(int32 index) const
+{
+	return m_pages[index >> b2_poolPageShift] + (index & (b2_poolPageSize - 1)) * m_objectSize;
+}
+
+inline uint32* b2Pool::GetRevisions(int32 page) const
+{
+	return (uint32*)(m_pages[page] + b2_poolPageSize * m_objectSize);
+}
+
+inline uint32 b2Pool::GetRevision(int32 index) const
+{
+	b2Assert(0 <= index && index < GetCapacity());
+	return GetRevisions(index >> b2_poolPageShift)[index & (b2_poolPageSize - 1)];
+}
+
+inline void* b2Pool::Get(int32 index) const
+{
+	b2Assert(GetRevision(index) & 1);
+	return GetSlot(index);
+}
+
+inline void* b2Pool::Find(int32 index) const
+{
+	if (GetRevision(index) & 1)
+	{
+		return GetSlot(index);
+	}
+
+	return NULL;
+}
+
+inline void* b2Pool::Find(int32 index, uint32 revision) const
+{
+	if (index < 0 || index >= GetCapacity() || (revision & 1) == 0 || GetRevision(index) != revision)
+	{
+		return NULL;
+	}
+
+	return GetSlot(index);
+}
+
+inline int32 b2Pool::GetCount() const
+{
+	return m_count;
+}
+
+inline int32 b2Pool::GetCapacity() const
+{
+	return m_pageCount * b2_poolPageSize;
+}
+
+#endif
@@ -32,6 +32,7 @@ typedef signed int int32;
 typedef unsigned char uint8;
 typedef unsigned short uint16;
 typedef unsigned int uint32;
+typedef unsigned long long uint64;
 typedef float float32;
 typedef double float64;
 
@@ -79,6 +80,15 @@ typedef double float64;
 /// Maximum number of sub-steps per contact in continuous physics simulation.
 #define b2_maxSubSteps			8
 
+/// The gap at which speculative contacts are created, on top of the distance the
+/// bodies may travel in one step. This only applies to speculative bodies.
+#define b2_speculativeDistance	(4.0f * b2_linearSlop)
+
+/// A touching contact keeps its manifold while its bodies move less than this
+/// relative to each other, when manifold reuse is enabled. See b2World::SetManifoldReuse.
+#define b2_manifoldReuseLinearTolerance		(0.05f * b2_linearSlop)
+#define b2_manifoldReuseAngularTolerance	(0.05f * b2_angularSlop)
+
 
 // Dynamics
 
@@ -114,6 +124,26 @@ typedef double float64;
 #define b2_toiBaugarte				0.75f
 
 
+// Particles
+
+/// The maximum number of neighbors a particle interacts with. Extra neighbors
+/// are ignored, which only happens when particles are squeezed together.
+#define b2_maxParticleNeighbors		16
+
+/// The maximum number of fixtures a particle touches at once.
+#define b2_maxParticleBodyContacts	4
+
+/// Particles placed this fraction of their diameter apart are at rest.
+#define b2_particleStride			0.75f
+
+/// Particles have no pressure below this weight, the sum of 1 - d / diameter
+/// over the neighbors closer than a diameter.
+#define b2_minParticleWeight		1.0f
+
+/// The pressure stops growing above this weight.
+#define b2_maxParticleWeight		5.0f
+
+
 // Sleep
 
 /// The time that a body must be still before it will go to sleep.
@@ -133,6 +163,15 @@ void* b2Alloc(int32 size);
 /// If you implement b2Alloc, you should also implement this function.
 void b2Free(void* mem);
 
+/// Allocation statistics, see b2StatsAllocator.
+struct b2AllocStats
+{
+	int32 allocCount;	///< number of allocations
+	int32 freeCount;	///< number of frees
+	int32 bytes;		///< bytes currently allocated
+	int32 peakBytes;	///< largest value of bytes
+};
+
 /// Logging function.
 void b2Log(const char* string, ...);
 
@@ -0,0 +1,254 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SIMD_H
+#define B2_SIMD_H
+
+#include <Box2D/Common/b2Math.h>
+
+/// Four float lanes for the narrow-phase, rope and joint kernels, using SSE2 or NEON
+/// when the compiler targets them. Define B2_NO_SIMD to always use the scalar code.
+/// Every lane does the same multiplies and adds as the scalar code, in the same
+/// order, so both paths give bit-identical results. B2_SIMD is only defined when
+/// the lanes map to hardware; otherwise b2Lanes is a plain array.
+/// Masks come from the compare functions and are only meant for b2OrLanes,
+/// b2AndLanes and b2SelectLanes.
+#define b2_simdWidth		4
+
+/// Polygon vertex lanes are padded to a multiple of the SIMD width.
+#define b2_maxPolygonLanes	((b2_maxPolygonVertices + b2_simdWidth - 1) & ~(b2_simdWidth - 1))
+
+#if !defined(B2_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+
+#include <emmintrin.h>
+
+#define B2_SIMD
+
+typedef __m128 b2Lanes;
+
+inline b2Lanes b2LoadLanes(const float32* p) { return _mm_loadu_ps(p); }
+inline void b2StoreLanes(float32* p, b2Lanes a) { _mm_storeu_ps(p, a); }
+inline b2Lanes b2SplatLanes(float32 x) { return _mm_set1_ps(x); }
+inline b2Lanes b2AddLanes(b2Lanes a, b2Lanes b) { return _mm_add_ps(a, b); }
+inline b2Lanes b2SubLanes(b2Lanes a, b2Lanes b) { return _mm_sub_ps(a, b); }
+inline b2Lanes b2MulLanes(b2Lanes a, b2Lanes b) { return _mm_mul_ps(a, b); }
+inline b2Lanes b2DivLanes(b2Lanes a, b2Lanes b) { return _mm_div_ps(a, b); }
+inline b2Lanes b2SqrtLanes(b2Lanes a) { return _mm_sqrt_ps(a); }
+inline b2Lanes b2MinLanes(b2Lanes a, b2Lanes b) { return _mm_min_ps(a, b); }
+inline b2Lanes b2MaxLanes(b2Lanes a, b2Lanes b) { return _mm_max_ps(a, b); }
+inline b2Lanes b2LessLanes(b2Lanes a, b2Lanes b) { return _mm_cmplt_ps(a, b); }
+inline b2Lanes b2EqualLanes(b2Lanes a, b2Lanes b) { return _mm_cmpeq_ps(a, b); }
+inline b2Lanes b2OrLanes(b2Lanes a, b2Lanes b) { return _mm_or_ps(a, b); }
+inline b2Lanes b2AndLanes(b2Lanes a, b2Lanes b) { return _mm_and_ps(a, b); }
+
+/// Lanes of a where the mask is set, lanes of b elsewhere.
+inline b2Lanes b2SelectLanes(b2Lanes mask, b2Lanes a, b2Lanes b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// Smallest of the four lanes.
+inline float32 b2ReduceMin(b2Lanes a)
+{
+	a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+	a = _mm_min_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(a);
+}
+
+/// Largest of the four lanes.
+inline float32 b2ReduceMax(b2Lanes a)
+{
+	a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)));
+	a = _mm_max_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(a);
+}
+
+/// One bit per lane equal to x, lane 0 in the lowest bit.
+inline int32 b2EqualMask(b2Lanes a, float32 x)
+{
+	return _mm_movemask_ps(_mm_cmpeq_ps(a, _mm_set1_ps(x)));
+}
+
+#elif !defined(B2_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+
+#include <arm_neon.h>
+
+#define B2_SIMD
+
+typedef float32x4_t b2Lanes;
+
+inline b2Lanes b2LoadLanes(const float32* p) { return vld1q_f32(p); }
+inline void b2StoreLanes(float32* p, b2Lanes a) { vst1q_f32(p, a); }
+inline b2Lanes b2SplatLanes(float32 x) { return vdupq_n_f32(x); }
+inline b2Lanes b2AddLanes(b2Lanes a, b2Lanes b) { return vaddq_f32(a, b); }
+inline b2Lanes b2SubLanes(b2Lanes a, b2Lanes b) { return vsubq_f32(a, b); }
+inline b2Lanes b2MulLanes(b2Lanes a, b2Lanes b) { return vmulq_f32(a, b); }
+inline b2Lanes b2MinLanes(b2Lanes a, b2Lanes b) { return vminq_f32(a, b); }
+inline b2Lanes b2MaxLanes(b2Lanes a, b2Lanes b) { return vmaxq_f32(a, b); }
+inline b2Lanes b2LessLanes(b2Lanes a, b2Lanes b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+inline b2Lanes b2EqualLanes(b2Lanes a, b2Lanes b) { return vreinterpretq_f32_u32(vceqq_f32(a, b)); }
+
+inline b2Lanes b2OrLanes(b2Lanes a, b2Lanes b)
+{
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+inline b2Lanes b2AndLanes(b2Lanes a, b2Lanes b)
+{
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+inline b2Lanes b2SelectLanes(b2Lanes mask, b2Lanes a, b2Lanes b)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+inline b2Lanes b2DivLanes(b2Lanes a, b2Lanes b) { return vdivq_f32(a, b); }
+inline b2Lanes b2SqrtLanes(b2Lanes a) { return vsqrtq_f32(a); }
+
+#else
+
+// 32-bit NEON has no divide or square root, only estimates, so these go
+// through the scalar operations to stay correctly rounded.
+inline b2Lanes b2DivLanes(b2Lanes a, b2Lanes b)
+{
+	float32 x[b2_simdWidth], y[b2_simdWidth];
+	vst1q_f32(x, a);
+	vst1q_f32(y, b);
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		x[i] = x[i] / y[i];
+	}
+	return vld1q_f32(x);
+}
+
+inline b2Lanes b2SqrtLanes(b2Lanes a)
+{
+	float32 x[b2_simdWidth];
+	vst1q_f32(x, a);
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		x[i] = sqrtf(x[i]);
+	}
+	return vld1q_f32(x);
+}
+
+#endif
+
+inline float32 b2ReduceMin(b2Lanes a)
+{
+	float32x2_t m = vpmin_f32(vget_low_f32(a), vget_high_f32(a));
+	return vget_lane_f32(vpmin_f32(m, m), 0);
+}
+
+inline float32 b2ReduceMax(b2Lanes a)
+{
+	float32x2_t m = vpmax_f32(vget_low_f32(a), vget_high_f32(a));
+	return vget_lane_f32(vpmax_f32(m, m), 0);
+}
+
+inline int32 b2EqualMask(b2Lanes a, float32 x)
+{
+	uint32x4_t eq = vceqq_f32(a, vdupq_n_f32(x));
+	return (vgetq_lane_u32(eq, 0) & 1) | (vgetq_lane_u32(eq, 1) & 2) |
+		(vgetq_lane_u32(eq, 2) & 4) | (vgetq_lane_u32(eq, 3) & 8);
+}
+
+#else
+
+struct b2Lanes
+{
+	float32 x[b2_simdWidth];
+};
+
+inline b2Lanes b2LoadLanes(const float32* p)
+{
+	b2Lanes r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) { r.x[i] = p[i]; }
+	return r;
+}
+
+inline void b2StoreLanes(float32* p, b2Lanes a)
+{
+	for (int32 i = 0; i < b2_simdWidth; ++i) { p[i] = a.x[i]; }
+}
+
+inline b2Lanes b2SplatLanes(float32 x)
+{
+	b2Lanes r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) { r.x[i] = x; }
+	return r;
+}
+
+#define B2_LANES_BINARY(name, expr) \
+	inline b2Lanes name(b2Lanes a, b2Lanes b) \
+	{ \
+		b2Lanes r; \
+		for (int32 i = 0; i < b2_simdWidth; ++i) { r.x[i] = (expr); } \
+		return r; \
+	}
+
+// Masks are 1 or 0 per lane.
+B2_LANES_BINARY(b2AddLanes, a.x[i] + b.x[i])
+B2_LANES_BINARY(b2SubLanes, a.x[i] - b.x[i])
+B2_LANES_BINARY(b2MulLanes, a.x[i] * b.x[i])
+B2_LANES_BINARY(b2DivLanes, a.x[i] / b.x[i])
+B2_LANES_BINARY(b2MinLanes, b2Min(a.x[i], b.x[i]))
+B2_LANES_BINARY(b2MaxLanes, b2Max(a.x[i], b.x[i]))
+B2_LANES_BINARY(b2LessLanes, a.x[i] < b.x[i] ? 1.0f : 0.0f)
+B2_LANES_BINARY(b2EqualLanes, a.x[i] == b.x[i] ? 1.0f : 0.0f)
+B2_LANES_BINARY(b2OrLanes, a.x[i] != 0.0f || b.x[i] != 0.0f ? 1.0f : 0.0f)
+B2_LANES_BINARY(b2AndLanes, a.x[i] != 0.0f && b.x[i] != 0.0f ? 1.0f : 0.0f)
+
+#undef B2_LANES_BINARY
+
+inline b2Lanes b2SqrtLanes(b2Lanes a)
+{
+	b2Lanes r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) { r.x[i] = sqrtf(a.x[i]); }
+	return r;
+}
+
+inline b2Lanes b2SelectLanes(b2Lanes mask, b2Lanes a, b2Lanes b)
+{
+	b2Lanes r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) { r.x[i] = mask.x[i] != 0.0f ? a.x[i] : b.x[i]; }
+	return r;
+}
+
+#endif
+
+#ifdef B2_SIMD
+
+/// Index of the first lane set in a non-zero b2EqualMask.
+inline int32 b2FirstLane(int32 mask)
+{
+	int32 index = 0;
+	while ((mask & 1) == 0)
+	{
+		mask >>= 1;
+		++index;
+	}
+	return index;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include <Box2D/Common/b2Settings.h>
+#include <string.h>
+
+/// Writes raw values into a caller-provided buffer. When the buffer is NULL
+/// or too small, only the size is accumulated so the required capacity can
+/// be queried with the same code path.
+/// This is an internal class.
+class b2SnapshotWriter
+{
+public:
+	b2SnapshotWriter(void* buffer, int32 capacity)
+	{
+		m_data = (uint8*)buffer;
+		m_capacity = buffer ? capacity : 0;
+		m_size = 0;
+	}
+
+	void Write(const void* data, int32 size)
+	{
+		if (m_size + size <= m_capacity)
+		{
+			memcpy(m_data + m_size, data, size);
+		}
+		m_size += size;
+	}
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		Write(&value, sizeof(T));
+	}
+
+	/// Overwrite a value written earlier, e.g. a size that was not known yet.
+	template <typename T>
+	void WriteAt(int32 offset, const T& value)
+	{
+		b2Assert(offset + (int32)sizeof(T) <= m_size);
+		if (offset + (int32)sizeof(T) <= m_capacity)
+		{
+			memcpy(m_data + offset, &value, sizeof(T));
+		}
+	}
+
+	/// Did everything written so far fit in the buffer?
+	bool IsValid() const
+	{
+		return m_size <= m_capacity;
+	}
+
+	int32 GetSize() const
+	{
+		return m_size;
+	}
+
+private:
+	uint8* m_data;
+	int32 m_capacity;
+	int32 m_size;
+};
+
+/// Reads raw values written by b2SnapshotWriter. Reading past the end of
+/// the buffer returns zeroed values and invalidates the reader.
+/// This is an internal class.
+class b2SnapshotReader
+{
+public:
+	b2SnapshotReader(const void* buffer, int32 size)
+	{
+		m_data = (const uint8*)buffer;
+		m_size = size;
+		m_offset = 0;
+		m_valid = true;
+	}
+
+	void Read(void* data, int32 size)
+	{
+		if (m_valid == false || m_offset + size > m_size)
+		{
+			m_valid = false;
+			memset(data, 0, size);
+			return;
+		}
+
+		memcpy(data, m_data + m_offset, size);
+		m_offset += size;
+	}
+
+	template <typename T>
+	T Read()
+	{
+		T value;
+		Read(&value, sizeof(T));
+		return value;
+	}
+
+	/// Skip bytes that were validated or are not needed.
+	void Skip(int32 size)
+	{
+		if (m_valid == false || m_offset + size > m_size)
+		{
+			m_valid = false;
+			return;
+		}
+
+		m_offset += size;
+	}
+
+	int32 GetOffset() const
+	{
+		return m_offset;
+	}
+
+	void SetOffset(int32 offset)
+	{
+		b2Assert(0 <= offset && offset <= m_size);
+		m_offset = offset;
+	}
+
+	bool IsValid() const
+	{
+		return m_valid;
+	}
+
+private:
+	const uint8* m_data;
+	int32 m_size;
+	int32 m_offset;
+	bool m_valid;
+};
+
+#endif
@@ -19,9 +19,30 @@
 #include <Box2D/Common/b2StackAllocator.h>
 #include <Box2D/Common/b2Math.h>
 
-b2StackAllocator::b2StackAllocator()
+struct b2StackBlock
 {
-	m_index = 0;
+	b2StackBlock* prev;
+	b2StackBlock* next;
+	int32 capacity;
+	int32 index;
+};
+
+// The data of a block follows its header, aligned like the entries.
+const int32 b2_stackBlockHeaderSize = (sizeof(b2StackBlock) + b2_stackAlignment - 1) & ~(b2_stackAlignment - 1);
+
+inline char* b2GetBlockData(b2StackBlock* block)
+{
+	return (char*)block + b2_stackBlockHeaderSize;
+}
+
+b2StackAllocator::b2StackAllocator(b2Allocator* allocator, int32 capacity)
+{
+	b2Assert(capacity >= 0);
+	m_allocator = allocator ? allocator : b2GetHeapAllocator();
+	m_capacity = 0;
+	m_blocks = capacity > 0 ? CreateBlock(capacity) : NULL;
+	m_block = m_blocks;
+	m_overflowCount = 0;
 	m_allocation = 0;
 	m_maxAllocation = 0;
 	m_entryCount = 0;
@@ -29,28 +50,70 @@ b2StackAllocator::b2StackAllocator()
 
 b2StackAllocator::~b2StackAllocator()
 {
-	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+
+	DestroyBlocks(m_blocks);
 }
 
-void* b2StackAllocator::Allocate(int32 size)
+b2StackBlock* b2StackAllocator::CreateBlock(int32 capacity)
 {
-	b2Assert(m_entryCount < b2_maxStackEntries);
+	b2StackBlock* block = (b2StackBlock*)m_allocator->Allocate(b2_stackBlockHeaderSize + capacity);
+	block->prev = NULL;
+	block->next = NULL;
+	block->capacity = capacity;
+	block->index = 0;
+	m_capacity += capacity;
+	return block;
+}
 
-	b2StackEntry* entry = m_entries + m_entryCount;
-	entry->size = size;
-	if (m_index + size > b2_stackSize)
+void b2StackAllocator::DestroyBlocks(b2StackBlock* block)
+{
+	while (block)
 	{
-		entry->data = (char*)b2Alloc(size);
-		entry->usedMalloc = true;
+		b2StackBlock* next = block->next;
+		m_capacity -= block->capacity;
+		m_allocator->Free(block, b2_stackBlockHeaderSize + block->capacity);
+		block = next;
 	}
-	else
+}
+
+void* b2StackAllocator::Allocate(int32 size)
+{
+	b2Assert(m_entryCount < b2_maxStackEntries);
+
+	// Keep every entry aligned for pointers and doubles, arrays of 12 byte
+	// structs would leave the next one misaligned.
+	size = (size + b2_stackAlignment - 1) & ~(b2_stackAlignment - 1);
+
+	if (m_block == NULL || m_block->index + size > m_block->capacity)
 	{
-		entry->data = m_data + m_index;
-		entry->usedMalloc = false;
-		m_index += size;
+		// Move to the next block, chaining a new one when the kept blocks are
+		// too small. Each new block at least doubles the stack.
+		b2StackBlock* next = m_block ? m_block->next : m_blocks;
+		if (next == NULL || size > next->capacity)
+		{
+			DestroyBlocks(next);
+			next = CreateBlock(b2Max(size, m_capacity));
+			next->prev = m_block;
+			if (m_block)
+			{
+				m_block->next = next;
+			}
+			else
+			{
+				m_blocks = next;
+			}
+			++m_overflowCount;
+		}
+		m_block = next;
 	}
 
+	b2StackEntry* entry = m_entries + m_entryCount;
+	entry->data = b2GetBlockData(m_block) + m_block->index;
+	entry->size = size;
+	entry->block = m_block;
+	m_block->index += size;
+
 	m_allocation += size;
 	m_maxAllocation = b2Max(m_maxAllocation, m_allocation);
 	++m_entryCount;
@@ -63,21 +126,38 @@ void b2StackAllocator::Free(void* p)
 	b2Assert(m_entryCount > 0);
 	b2StackEntry* entry = m_entries + m_entryCount - 1;
 	b2Assert(p == entry->data);
-	if (entry->usedMalloc)
-	{
-		b2Free(p);
-	}
-	else
-	{
-		m_index -= entry->size;
-	}
+	b2Assert(entry->block == m_block);
+	B2_NOT_USED(p);
+	m_block->index -= entry->size;
 	m_allocation -= entry->size;
 	--m_entryCount;
 
-	p = NULL;
+	// Step back to the block of the previous entry. The blocks after it are
+	// empty and kept.
+	m_block = m_entryCount > 0 ? m_entries[m_entryCount - 1].block : m_blocks;
+
+	// Nothing is allocated, so this is the time to merge the blocks.
+	if (m_entryCount == 0 && m_blocks->next)
+	{
+		// Leave some room so slowly growing scenes don't reallocate every step.
+		int32 capacity = b2Max(m_capacity, m_maxAllocation + m_maxAllocation / 4);
+		DestroyBlocks(m_blocks);
+		m_blocks = CreateBlock(capacity);
+		m_block = m_blocks;
+	}
 }
 
 int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+int32 b2StackAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+int32 b2StackAllocator::GetOverflowCount() const
+{
+	return m_overflowCount;
+}
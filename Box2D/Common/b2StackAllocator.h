@@ -20,24 +20,34 @@
 #define B2_STACK_ALLOCATOR_H
 
 #include <Box2D/Common/b2Settings.h>
+#include <Box2D/Common/b2Allocator.h>
 
 const int32 b2_stackSize = 100 * 1024;	// 100k
 const int32 b2_maxStackEntries = 32;
+const int32 b2_stackAlignment = 8;
+
+struct b2StackBlock;
 
 struct b2StackEntry
 {
 	char* data;
 	int32 size;
-	bool usedMalloc;
+	b2StackBlock* block;
 };
 
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
+// An allocation that doesn't fit chains a new block from the backing allocator.
+// The block stays with the stack, so memory is never returned in the middle
+// of a step. When the stack is empty again the blocks are merged into one
+// buffer sized for the peak usage, so later steps use a single block.
 class b2StackAllocator
 {
 public:
-	b2StackAllocator();
+	/// @param allocator provides the stack blocks, NULL for the heap.
+	/// @param capacity the initial size of the stack buffer.
+	b2StackAllocator(b2Allocator* allocator = NULL, int32 capacity = b2_stackSize);
 	~b2StackAllocator();
 
 	void* Allocate(int32 size);
@@ -45,10 +55,25 @@ public:
 
 	int32 GetMaxAllocation() const;
 
+	/// The size of all the stack blocks.
+	int32 GetCapacity() const;
+
+	/// Number of allocations that did not fit and chained a new block.
+	int32 GetOverflowCount() const;
+
 private:
 
-	char m_data[b2_stackSize];
-	int32 m_index;
+	b2StackBlock* CreateBlock(int32 capacity);
+	void DestroyBlocks(b2StackBlock* block);
+
+	b2Allocator* m_allocator;
+
+	// The first block and the one allocations come from. The blocks after
+	// m_block are empty and kept for reuse.
+	b2StackBlock* m_blocks;
+	b2StackBlock* m_block;
+	int32 m_capacity;
+	int32 m_overflowCount;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
@@ -36,15 +36,16 @@ public:
 	/// Get the time since construction or the last reset.
 	float32 GetMilliseconds() const;
 
+	/// Get the time since construction or the last reset in nanoseconds.
+	uint64 GetNanoseconds() const;
+
 private:
 
-#if defined(_WIN32)
-	float64 m_start;
-	static float64 s_invFrequency;
-#elif defined(__linux__) || defined (__APPLE__)
-	unsigned long m_start_sec;
-	unsigned long m_start_usec;
-#endif
+	uint64 m_start;
 };
 
+/// Get the time of a monotonic clock in nanoseconds. Only differences
+/// between two readings are meaningful.
+uint64 b2GetTicks();
+
 #endif
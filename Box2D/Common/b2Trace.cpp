@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2Trace.h>
+#include <Box2D/Common/b2Timer.h>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+// Marks an event that has not ended yet.
+static const uint64 b2_openTraceEvent = ~0ull;
+
+struct b2TraceEvent
+{
+	const char* name;
+	uint64 start;
+	uint64 duration;
+};
+
+// The events of one thread. Only the owning thread writes to a stream.
+struct b2TraceStream
+{
+	b2TraceEvent* events;
+	int32 eventCount;
+	int32 eventCapacity;
+
+	// Indices of the open events, -1 for events that were not recorded.
+	int32 open[b2_maxTraceDepth];
+	int32 depth;
+
+	int32 threadIndex;
+	b2TraceStream* next;
+};
+
+// Streams live until the program exits, so a thread that ended still
+// shows up in the trace.
+struct b2TraceRegistry
+{
+	b2TraceRegistry() : streams(NULL), streamCount(0), start(0) {}
+
+	~b2TraceRegistry()
+	{
+		while (streams)
+		{
+			b2TraceStream* stream = streams;
+			streams = stream->next;
+			b2Free(stream->events);
+			b2Free(stream);
+		}
+	}
+
+	std::mutex lock;
+	b2TraceStream* streams;
+	int32 streamCount;
+	uint64 start;
+};
+
+static b2TraceRegistry s_registry;
+static std::atomic<bool> s_tracing(false);
+static thread_local b2TraceStream* s_stream = NULL;
+
+static b2TraceStream* b2GetTraceStream()
+{
+	if (s_stream == NULL)
+	{
+		b2TraceStream* stream = (b2TraceStream*)b2Alloc(sizeof(b2TraceStream));
+		memset(stream, 0, sizeof(b2TraceStream));
+
+		std::lock_guard<std::mutex> guard(s_registry.lock);
+		stream->threadIndex = s_registry.streamCount++;
+		stream->next = s_registry.streams;
+		s_registry.streams = stream;
+		s_stream = stream;
+	}
+
+	return s_stream;
+}
+
+void b2StartTrace()
+{
+	std::lock_guard<std::mutex> guard(s_registry.lock);
+	for (b2TraceStream* stream = s_registry.streams; stream; stream = stream->next)
+	{
+		stream->eventCount = 0;
+	}
+
+	s_registry.start = b2GetTicks();
+	s_tracing.store(true);
+}
+
+void b2StopTrace()
+{
+	s_tracing.store(false);
+}
+
+bool b2IsTracing()
+{
+	return s_tracing.load(std::memory_order_relaxed);
+}
+
+int32 b2GetTraceEventCount()
+{
+	std::lock_guard<std::mutex> guard(s_registry.lock);
+	int32 count = 0;
+	for (b2TraceStream* stream = s_registry.streams; stream; stream = stream->next)
+	{
+		count += stream->eventCount;
+	}
+
+	return count;
+}
+
+void b2BeginTraceEvent(const char* name)
+{
+	b2TraceStream* stream = b2GetTraceStream();
+	if (stream->depth >= b2_maxTraceDepth)
+	{
+		++stream->depth;
+		return;
+	}
+
+	int32 index = -1;
+	if (s_tracing.load(std::memory_order_relaxed))
+	{
+		if (stream->eventCount == stream->eventCapacity && stream->eventCapacity < b2_maxTraceEvents)
+		{
+			b2TraceEvent* oldEvents = stream->events;
+			stream->eventCapacity = stream->eventCapacity > 0 ? 2 * stream->eventCapacity : 1024;
+			stream->events = (b2TraceEvent*)b2Alloc(stream->eventCapacity * sizeof(b2TraceEvent));
+			if (oldEvents)
+			{
+				memcpy(stream->events, oldEvents, stream->eventCount * sizeof(b2TraceEvent));
+				b2Free(oldEvents);
+			}
+		}
+
+		// Events beyond the maximum are dropped.
+		if (stream->eventCount < stream->eventCapacity)
+		{
+			index = stream->eventCount++;
+			b2TraceEvent* event = stream->events + index;
+			event->name = name;
+			event->duration = b2_openTraceEvent;
+			event->start = b2GetTicks();
+		}
+	}
+
+	stream->open[stream->depth++] = index;
+}
+
+void b2EndTraceEvent()
+{
+	uint64 end = b2GetTicks();
+
+	b2TraceStream* stream = s_stream;
+	b2Assert(stream != NULL && stream->depth > 0);
+	if (stream == NULL || stream->depth == 0)
+	{
+		return;
+	}
+
+	--stream->depth;
+	if (stream->depth >= b2_maxTraceDepth)
+	{
+		return;
+	}
+
+	// The trace may have been restarted since the event began.
+	int32 index = stream->open[stream->depth];
+	if (0 <= index && index < stream->eventCount)
+	{
+		b2TraceEvent* event = stream->events + index;
+		event->duration = end - event->start;
+	}
+}
+
+bool b2SaveChromeTrace(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(s_registry.lock);
+
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	const char* separator = "";
+	for (b2TraceStream* stream = s_registry.streams; stream; stream = stream->next)
+	{
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+			separator, stream->threadIndex, stream->threadIndex);
+		separator = ",\n";
+
+		for (int32 i = 0; i < stream->eventCount; ++i)
+		{
+			const b2TraceEvent* event = stream->events + i;
+			if (event->duration == b2_openTraceEvent || event->start < s_registry.start)
+			{
+				continue;
+			}
+
+			// Timestamps are in microseconds.
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+				separator, event->name, stream->threadIndex,
+				1.0e-3 * float64(event->start - s_registry.start), 1.0e-3 * float64(event->duration));
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	bool ok = ferror(file) == 0;
+	ok = fclose(file) == 0 && ok;
+	return ok;
+}
@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TRACE_H
+#define B2_TRACE_H
+
+#include <Box2D/Common/b2Settings.h>
+
+/// The maximum number of events recorded per thread until the trace is cleared.
+const int32 b2_maxTraceEvents = 1024 * 1024;
+
+/// The maximum nesting of trace scopes on one thread.
+const int32 b2_maxTraceDepth = 32;
+
+/// Start recording trace events. This clears events recorded earlier.
+/// Scopes are only recorded when Box2D is built with B2_PROFILE defined,
+/// otherwise the trace macros compile to nothing.
+void b2StartTrace();
+
+/// Stop recording trace events. The recorded events are kept.
+void b2StopTrace();
+
+/// Is recording enabled?
+bool b2IsTracing();
+
+/// Get the number of events recorded on all threads.
+int32 b2GetTraceEventCount();
+
+/// Write the recorded events in the Chrome trace event format. Open the file
+/// with chrome://tracing or https://ui.perfetto.dev.
+/// @warning no thread may record events while this runs.
+/// @return false if the file could not be written.
+bool b2SaveChromeTrace(const char* path);
+
+/// Begin a timed event on this thread. The name must be a string literal.
+/// Use b2TraceScope or b2TraceBegin instead of calling this directly.
+void b2BeginTraceEvent(const char* name);
+
+/// End the most recent event begun on this thread.
+void b2EndTraceEvent();
+
+/// Records the lifetime of a scope as a trace event.
+class b2TraceZone
+{
+public:
+	b2TraceZone(const char* name)
+	{
+		b2BeginTraceEvent(name);
+	}
+
+	~b2TraceZone()
+	{
+		b2EndTraceEvent();
+	}
+};
+
+#ifdef B2_PROFILE
+#define B2_TRACE_CONCAT2(a, b) a##b
+#define B2_TRACE_CONCAT(a, b) B2_TRACE_CONCAT2(a, b)
+#define b2TraceScope(name) b2TraceZone B2_TRACE_CONCAT(b2_traceZone, __LINE__)(name)
+#define b2TraceBegin(name) b2BeginTraceEvent(name)
+#define b2TraceEnd() b2EndTraceEvent()
+#else
+#define b2TraceScope(name)
+#define b2TraceBegin(name)
+#define b2TraceEnd()
+#endif
+
+#endif
@@ -17,123 +17,104 @@
 */
 
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
-#include <Box2D/Dynamics/Contacts/b2CircleContact.h>
-#include <Box2D/Dynamics/Contacts/b2PolygonAndCircleContact.h>
-#include <Box2D/Dynamics/Contacts/b2PolygonContact.h>
-#include <Box2D/Dynamics/Contacts/b2EdgeAndCircleContact.h>
-#include <Box2D/Dynamics/Contacts/b2EdgeAndPolygonContact.h>
-#include <Box2D/Dynamics/Contacts/b2ChainAndCircleContact.h>
-#include <Box2D/Dynamics/Contacts/b2ChainAndPolygonContact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2TimeOfImpact.h>
 #include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2EdgeShape.h>
+#include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Common/b2BlockAllocator.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
 
-b2ContactRegister b2Contact::s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
-bool b2Contact::s_initialized = false;
+#include <new>
 
-void b2Contact::InitializeRegisters()
+// Rows are shape A, columns shape B: circle, edge, polygon, chain.
+const uint8 b2Contact::s_types[b2Shape::e_typeCount][b2Shape::e_typeCount] =
 {
-	AddType(b2CircleContact::Create, b2CircleContact::Destroy, b2Shape::e_circle, b2Shape::e_circle);
-	AddType(b2PolygonAndCircleContact::Create, b2PolygonAndCircleContact::Destroy, b2Shape::e_polygon, b2Shape::e_circle);
-	AddType(b2PolygonContact::Create, b2PolygonContact::Destroy, b2Shape::e_polygon, b2Shape::e_polygon);
-	AddType(b2EdgeAndCircleContact::Create, b2EdgeAndCircleContact::Destroy, b2Shape::e_edge, b2Shape::e_circle);
-	AddType(b2EdgeAndPolygonContact::Create, b2EdgeAndPolygonContact::Destroy, b2Shape::e_edge, b2Shape::e_polygon);
-	AddType(b2ChainAndCircleContact::Create, b2ChainAndCircleContact::Destroy, b2Shape::e_chain, b2Shape::e_circle);
-	AddType(b2ChainAndPolygonContact::Create, b2ChainAndPolygonContact::Destroy, b2Shape::e_chain, b2Shape::e_polygon);
-}
+	{ e_circleContact, e_edgeAndCircleContact, e_polygonAndCircleContact, e_chainAndCircleContact },
+	{ e_edgeAndCircleContact, e_noContact, e_edgeAndPolygonContact, e_noContact },
+	{ e_polygonAndCircleContact, e_edgeAndPolygonContact, e_polygonContact, e_chainAndPolygonContact },
+	{ e_chainAndCircleContact, e_noContact, e_chainAndPolygonContact, e_noContact }
+};
 
-void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
-						b2Shape::Type type1, b2Shape::Type type2)
+const bool b2Contact::s_primary[b2Shape::e_typeCount][b2Shape::e_typeCount] =
 {
-	b2Assert(0 <= type1 && type1 < b2Shape::e_typeCount);
-	b2Assert(0 <= type2 && type2 < b2Shape::e_typeCount);
-	
-	s_registers[type1][type2].createFcn = createFcn;
-	s_registers[type1][type2].destroyFcn = destoryFcn;
-	s_registers[type1][type2].primary = true;
+	{ true, false, false, false },
+	{ true, true, true, true },
+	{ true, false, true, false },
+	{ true, true, true, true }
+};
 
-	if (type1 != type2)
-	{
-		s_registers[type2][type1].createFcn = createFcn;
-		s_registers[type2][type1].destroyFcn = destoryFcn;
-		s_registers[type2][type1].primary = false;
-	}
-}
+const b2Manifold b2_emptyManifold = b2Manifold();
 
 b2Contact* b2Contact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator)
 {
-	if (s_initialized == false)
-	{
-		InitializeRegisters();
-		s_initialized = true;
-	}
-
 	b2Shape::Type type1 = fixtureA->GetType();
 	b2Shape::Type type2 = fixtureB->GetType();
 
 	b2Assert(0 <= type1 && type1 < b2Shape::e_typeCount);
 	b2Assert(0 <= type2 && type2 < b2Shape::e_typeCount);
-	
-	b2ContactCreateFcn* createFcn = s_registers[type1][type2].createFcn;
-	if (createFcn)
+
+	Type type = (Type)s_types[type1][type2];
+	if (type == e_noContact)
 	{
-		if (s_registers[type1][type2].primary)
-		{
-			return createFcn(fixtureA, indexA, fixtureB, indexB, allocator);
-		}
-		else
-		{
-			return createFcn(fixtureB, indexB, fixtureA, indexA, allocator);
-		}
+		return NULL;
+	}
+
+	void* mem = allocator->Allocate(sizeof(b2Contact));
+	if (s_primary[type1][type2])
+	{
+		return new (mem) b2Contact(type, fixtureA, indexA, fixtureB, indexB);
 	}
 	else
 	{
-		return NULL;
+		return new (mem) b2Contact(type, fixtureB, indexB, fixtureA, indexA);
 	}
 }
 
 void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 {
-	b2Assert(s_initialized == true);
-
 	b2Fixture* fixtureA = contact->m_fixtureA;
 	b2Fixture* fixtureB = contact->m_fixtureB;
 
-	if (contact->m_manifold.pointCount > 0 &&
-		fixtureA->IsSensor() == false &&
-		fixtureB->IsSensor() == false)
+	if (contact->m_manifold)
 	{
-		fixtureA->GetBody()->SetAwake(true);
-		fixtureB->GetBody()->SetAwake(true);
-	}
-
-	b2Shape::Type typeA = fixtureA->GetType();
-	b2Shape::Type typeB = fixtureB->GetType();
+		if (contact->m_manifold->pointCount > 0 &&
+			fixtureA->IsSensor() == false &&
+			fixtureB->IsSensor() == false)
+		{
+			fixtureA->GetBody()->SetAwake(true);
+			fixtureB->GetBody()->SetAwake(true);
+		}
 
-	b2Assert(0 <= typeA && typeB < b2Shape::e_typeCount);
-	b2Assert(0 <= typeA && typeB < b2Shape::e_typeCount);
+		allocator->Free(contact->m_manifold, sizeof(b2Manifold));
+		contact->m_manifold = NULL;
+	}
 
-	b2ContactDestroyFcn* destroyFcn = s_registers[typeA][typeB].destroyFcn;
-	destroyFcn(contact, allocator);
+	contact->~b2Contact();
+	allocator->Free(contact, sizeof(b2Contact));
 }
 
-b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
+b2Contact::b2Contact(Type type, b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 {
-	m_flags = e_enabledFlag;
+	b2Assert(0 <= type && type < e_noContact);
+	b2Assert(s_types[fA->GetType()][fB->GetType()] == type && s_primary[fA->GetType()][fB->GetType()]);
 
+	m_flags = e_enabledFlag;
+	m_type = type;
+	m_speculativeDistance = 0.0f;
 	m_fixtureA = fA;
 	m_fixtureB = fB;
 
 	m_indexA = indexA;
 	m_indexB = indexB;
 
-	m_manifold.pointCount = 0;
+	m_manifold = NULL;
 
 	m_prev = NULL;
 	m_next = NULL;
@@ -154,13 +135,74 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
 
 	m_tangentSpeed = 0.0f;
+
+	m_cachePosition.SetZero();
+	m_cacheAngle = 0.0f;
+}
+
+void b2Contact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
+{
+	const b2Shape* shapeA = m_fixtureA->GetShape();
+	const b2Shape* shapeB = m_fixtureB->GetShape();
+
+	switch (m_type)
+	{
+	case e_circleContact:
+		b2CollideCircles(manifold, (const b2CircleShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB, m_speculativeDistance);
+		break;
+
+	case e_polygonAndCircleContact:
+		b2CollidePolygonAndCircle(manifold, (const b2PolygonShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB, m_speculativeDistance);
+		break;
+
+	case e_polygonContact:
+		b2CollidePolygons(manifold, (const b2PolygonShape*)shapeA, xfA, (const b2PolygonShape*)shapeB, xfB, m_speculativeDistance);
+		break;
+
+	case e_edgeAndCircleContact:
+		b2CollideEdgeAndCircle(manifold, (const b2EdgeShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB, m_speculativeDistance);
+		break;
+
+	case e_edgeAndPolygonContact:
+		b2CollideEdgeAndPolygon(manifold, (const b2EdgeShape*)shapeA, xfA, (const b2PolygonShape*)shapeB, xfB, m_speculativeDistance);
+		break;
+
+	case e_chainAndCircleContact:
+		{
+			b2EdgeShape edge;
+			((const b2ChainShape*)shapeA)->GetChildEdge(&edge, m_indexA);
+			b2CollideEdgeAndCircle(manifold, &edge, xfA, (const b2CircleShape*)shapeB, xfB, m_speculativeDistance);
+		}
+		break;
+
+	case e_chainAndPolygonContact:
+		{
+			b2EdgeShape edge;
+			((const b2ChainShape*)shapeA)->GetChildEdge(&edge, m_indexA);
+			b2CollideEdgeAndPolygon(manifold, &edge, xfA, (const b2PolygonShape*)shapeB, xfB, m_speculativeDistance);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		manifold->pointCount = 0;
+		break;
+	}
 }
 
 // Update the contact manifold and touching status.
 // Note: do not assume the fixture AABBs are overlapping or are valid.
 void b2Contact::Update(b2ContactListener* listener)
 {
-	b2Manifold oldManifold = m_manifold;
+	b2Manifold oldManifold;
+	if (m_manifold)
+	{
+		oldManifold = *m_manifold;
+	}
+	else
+	{
+		oldManifold.pointCount = 0;
+	}
 
 	// Re-enable this contact.
 	m_flags |= e_enabledFlag;
@@ -168,6 +210,10 @@ void b2Contact::Update(b2ContactListener* listener)
 	bool touching = false;
 	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
 
+	// A manifold that is no longer needed is released after EndContact, so the
+	// listener still sees the empty manifold.
+	bool releaseManifold = false;
+
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
 	bool sensor = sensorA || sensorB;
@@ -185,39 +231,111 @@ void b2Contact::Update(b2ContactListener* listener)
 		touching = b2TestOverlap(shapeA, m_indexA, shapeB, m_indexB, xfA, xfB);
 
 		// Sensors don't generate manifolds.
-		m_manifold.pointCount = 0;
+		m_flags &= ~e_cacheFlag;
+		if (m_manifold)
+		{
+			m_manifold->pointCount = 0;
+			releaseManifold = true;
+		}
 	}
 	else
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		// Speculative bodies keep points within reach of this step's motion.
+		m_speculativeDistance = 0.0f;
+		if (bodyA->IsSpeculative() || bodyB->IsSpeculative())
+		{
+			float32 dt = bodyA->m_world->m_dt;
+			float32 travelA = b2Min(dt * bodyA->m_linearVelocity.Length(), b2_maxTranslation);
+			float32 travelB = b2Min(dt * bodyB->m_linearVelocity.Length(), b2_maxTranslation);
+			m_speculativeDistance = b2_speculativeDistance + travelA + travelB;
+		}
 
-		// Match old contact ids to new contact ids and copy the
-		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+		// The manifold is in local coordinates, so it stays valid while the
+		// bodies barely move relative to each other.
+		b2World* world = bodyA->m_world;
+		b2Vec2 position = b2MulT(xfA.q, xfB.p - xfA.p);
+		float32 angle = bodyB->m_sweep.a - bodyA->m_sweep.a;
+		bool reuse = false;
+		if (world->m_manifoldReuse && (m_flags & e_cacheFlag) && m_speculativeDistance == 0.0f)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
-			mp2->normalImpulse = 0.0f;
-			mp2->tangentImpulse = 0.0f;
-			b2ContactID id2 = mp2->id;
+			b2Vec2 d = position - m_cachePosition;
+			reuse = b2Dot(d, d) < b2_manifoldReuseLinearTolerance * b2_manifoldReuseLinearTolerance &&
+				b2Abs(angle - m_cacheAngle) < b2_manifoldReuseAngularTolerance;
+		}
+
+		if (reuse)
+		{
+			// The stored impulses stay in place for warm starting.
+			b2Assert(m_manifold != NULL);
+			touching = true;
+			++world->m_profile.manifoldsReused;
+		}
+		else
+		{
+			m_flags &= ~e_cacheFlag;
+
+			// Evaluate in place when touching before, otherwise on the stack
+			// and only allocate the manifold if the shapes touch now.
+			b2Manifold newManifold;
+			b2Manifold* manifold = m_manifold ? m_manifold : &newManifold;
+			Evaluate(manifold, xfA, xfB);
+			touching = manifold->pointCount > 0;
+
+			if (touching && world->m_manifoldReuse)
+			{
+				m_cachePosition = position;
+				m_cacheAngle = angle;
+				m_flags |= e_cacheFlag;
+			}
+
+			if (touching && m_manifold == NULL)
+			{
+				m_manifold = (b2Manifold*)world->m_blockAllocator.Allocate(sizeof(b2Manifold));
+				*m_manifold = newManifold;
+			}
+			else if (touching == false && m_manifold)
+			{
+				releaseManifold = true;
+			}
 
-			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			// Match old contact ids to new contact ids and copy the
+			// stored impulses to warm start the solver.
+			int32 pointCount = m_manifold ? m_manifold->pointCount : 0;
+			for (int32 i = 0; i < pointCount; ++i)
 			{
-				b2ManifoldPoint* mp1 = oldManifold.points + j;
+				b2ManifoldPoint* mp2 = m_manifold->points + i;
+				mp2->normalImpulse = 0.0f;
+				mp2->tangentImpulse = 0.0f;
+				b2ContactID id2 = mp2->id;
 
-				if (mp1->id.key == id2.key)
+				for (int32 j = 0; j < oldManifold.pointCount; ++j)
 				{
-					mp2->normalImpulse = mp1->normalImpulse;
-					mp2->tangentImpulse = mp1->tangentImpulse;
-					break;
+					b2ManifoldPoint* mp1 = oldManifold.points + j;
+
+					if (mp1->id.key == id2.key)
+					{
+						mp2->normalImpulse = mp1->normalImpulse;
+						mp2->tangentImpulse = mp1->tangentImpulse;
+						break;
+					}
 				}
 			}
-		}
 
-		if (touching != wasTouching)
-		{
-			bodyA->SetAwake(true);
-			bodyB->SetAwake(true);
+			if (touching != wasTouching)
+			{
+				bodyA->SetAwake(true);
+				bodyB->SetAwake(true);
+
+				// Keep the persistent islands up to date.
+				if (touching)
+				{
+					world->LinkIslands(bodyA, bodyB);
+				}
+				else
+				{
+					world->UnlinkIslands(bodyA, bodyB);
+				}
+			}
 		}
 	}
 
@@ -244,4 +362,24 @@ void b2Contact::Update(b2ContactListener* listener)
 	{
 		listener->PreSolve(this, &oldManifold);
 	}
+
+	if (releaseManifold)
+	{
+		bodyA->m_world->m_blockAllocator.Free(m_manifold, sizeof(b2Manifold));
+		m_manifold = NULL;
+	}
+}
+
+b2Manifold* b2Contact::GetManifold()
+{
+	if (m_manifold == NULL)
+	{
+		// A contact that is not touching gets its own empty manifold, so writes
+		// through it stay with this contact. The next update releases it.
+		b2World* world = m_fixtureA->GetBody()->m_world;
+		m_manifold = (b2Manifold*)world->m_blockAllocator.Allocate(sizeof(b2Manifold));
+		*m_manifold = b2_emptyManifold;
+	}
+
+	return m_manifold;
 }
@@ -46,18 +46,6 @@ inline float32 b2MixRestitution(float32 restitution1, float32 restitution2)
 	return restitution1 > restitution2 ? restitution1 : restitution2;
 }
 
-typedef b2Contact* b2ContactCreateFcn(	b2Fixture* fixtureA, int32 indexA,
-										b2Fixture* fixtureB, int32 indexB,
-										b2BlockAllocator* allocator);
-typedef void b2ContactDestroyFcn(b2Contact* contact, b2BlockAllocator* allocator);
-
-struct b2ContactRegister
-{
-	b2ContactCreateFcn* createFcn;
-	b2ContactDestroyFcn* destroyFcn;
-	bool primary;
-};
-
 /// A contact edge is used to connect bodies and contacts together
 /// in a contact graph where each body is a node and each contact
 /// is an edge. A contact edge belongs to a doubly linked list
@@ -73,14 +61,21 @@ struct b2ContactEdge
 
 /// The class manages contact between two shapes. A contact exists for each overlapping
 /// AABB in the broad-phase (except if filtered). Therefore a contact object may exist
-/// that has no contact points.
+/// that has no contact points. Most contacts never touch, so the manifold is
+/// only allocated while the shapes are touching.
+/// All shape pairs share this one class. The pair is stored in the contact and
+/// Evaluate switches on it, so updating contacts makes no indirect calls.
 class b2Contact
 {
 public:
 
 	/// Get the contact manifold. Do not modify the manifold unless you understand the
-	/// internals of Box2D.
+	/// internals of Box2D. Touching contacts own a manifold. Other contacts get
+	/// an empty one of their own, which lasts until the next update.
 	b2Manifold* GetManifold();
+
+	/// Get the contact manifold. If the contact is not touching, this is a
+	/// shared empty manifold.
 	const b2Manifold* GetManifold() const;
 
 	/// Get the world manifold.
@@ -142,7 +137,7 @@ public:
 	float32 GetTangentSpeed() const;
 
 	/// Evaluate this contact with your own manifold and transforms.
-	virtual void Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB) = 0;
+	void Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB);
 
 protected:
 	friend class b2ContactManager;
@@ -170,29 +165,49 @@ protected:
 		e_bulletHitFlag		= 0x0010,
 
 		// This contact has a valid TOI in m_toi
-		e_toiFlag			= 0x0020
+		e_toiFlag			= 0x0020,
+
+		// The manifold was computed at the cached relative position
+		e_cacheFlag			= 0x0040
+	};
+
+	// Shape pairs, shape A first. The contact swaps the fixtures of the
+	// reversed pairs, so edges and chains are always fixture A and circles
+	// are always fixture B.
+	enum Type
+	{
+		e_circleContact,
+		e_polygonAndCircleContact,
+		e_polygonContact,
+		e_edgeAndCircleContact,
+		e_edgeAndPolygonContact,
+		e_chainAndCircleContact,
+		e_chainAndPolygonContact,
+		e_noContact
 	};
 
 	/// Flag this contact for filtering. Filtering will occur the next time step.
 	void FlagForFiltering();
 
-	static void AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destroyFcn,
-						b2Shape::Type typeA, b2Shape::Type typeB);
-	static void InitializeRegisters();
 	static b2Contact* Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator);
-	static void Destroy(b2Contact* contact, b2Shape::Type typeA, b2Shape::Type typeB, b2BlockAllocator* allocator);
 	static void Destroy(b2Contact* contact, b2BlockAllocator* allocator);
 
 	b2Contact() : m_fixtureA(NULL), m_fixtureB(NULL) {}
-	b2Contact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
-	virtual ~b2Contact() {}
+	b2Contact(Type type, b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
+	~b2Contact() {}
 
 	void Update(b2ContactListener* listener);
 
-	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
-	static bool s_initialized;
+	// The contact type of each pair of shape types, and whether the pair is
+	// stored in that order.
+	static const uint8 s_types[b2Shape::e_typeCount][b2Shape::e_typeCount];
+	static const bool s_primary[b2Shape::e_typeCount][b2Shape::e_typeCount];
 
 	uint32 m_flags;
+	int32 m_type;
+
+	// Extra gap reported by Evaluate when a body is speculative, zero otherwise.
+	float32 m_speculativeDistance;
 
 	// World pool and list pointers.
 	b2Contact* m_prev;
@@ -208,7 +223,8 @@ protected:
 	int32 m_indexA;
 	int32 m_indexB;
 
-	b2Manifold m_manifold;
+	// Only allocated while touching.
+	b2Manifold* m_manifold;
 
 	int32 m_toiCount;
 	float32 m_toi;
@@ -217,16 +233,18 @@ protected:
 	float32 m_restitution;
 
 	float32 m_tangentSpeed;
+
+	// The position and angle of body B relative to body A when the manifold
+	// was last computed. Only valid with e_cacheFlag.
+	b2Vec2 m_cachePosition;
+	float32 m_cacheAngle;
 };
 
-inline b2Manifold* b2Contact::GetManifold()
-{
-	return &m_manifold;
-}
+extern const b2Manifold b2_emptyManifold;
 
 inline const b2Manifold* b2Contact::GetManifold() const
 {
-	return &m_manifold;
+	return m_manifold ? m_manifold : &b2_emptyManifold;
 }
 
 inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
@@ -236,7 +254,7 @@ inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
 	const b2Shape* shapeA = m_fixtureA->GetShape();
 	const b2Shape* shapeB = m_fixtureB->GetShape();
 
-	worldManifold->Initialize(&m_manifold, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
+	worldManifold->Initialize(GetManifold(), bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
 }
 
 inline void b2Contact::SetEnabled(bool flag)
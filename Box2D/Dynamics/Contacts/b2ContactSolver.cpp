@@ -43,6 +43,14 @@ struct b2ContactPositionConstraint
 	int32 pointCount;
 };
 
+struct b2ContactConstraintRun
+{
+	int32 begin;
+	int32 end;
+	int32 pointCount;
+	b2Manifold::Type type;
+};
+
 b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 {
 	m_step = def->step;
@@ -50,6 +58,10 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_count = def->count;
 	m_positionConstraints = (b2ContactPositionConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactPositionConstraint));
 	m_velocityConstraints = (b2ContactVelocityConstraint*)m_allocator->Allocate(m_count * sizeof(b2ContactVelocityConstraint));
+	m_positionRuns = (b2ContactConstraintRun*)m_allocator->Allocate(m_count * sizeof(b2ContactConstraintRun));
+	m_velocityRuns = (b2ContactConstraintRun*)m_allocator->Allocate(m_count * sizeof(b2ContactConstraintRun));
+	m_positionRunCount = 0;
+	m_velocityRunCount = 0;
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
@@ -127,11 +139,25 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 			pc->localPoints[j] = cp->localPoint;
 		}
+
+		// The point count and manifold type of position constraints are fixed
+		// for the step, so the position runs can be built here.
+		b2ContactConstraintRun* run = m_positionRunCount > 0 ? &m_positionRuns[m_positionRunCount - 1] : NULL;
+		if (run == NULL || run->pointCount != pointCount || run->type != pc->type)
+		{
+			run = m_positionRuns + m_positionRunCount++;
+			run->begin = i;
+			run->pointCount = pointCount;
+			run->type = pc->type;
+		}
+		run->end = i + 1;
 	}
 }
 
 b2ContactSolver::~b2ContactSolver()
 {
+	m_allocator->Free(m_velocityRuns);
+	m_allocator->Free(m_positionRuns);
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -146,7 +172,9 @@ void b2ContactSolver::InitializeVelocityConstraints()
 
 		float32 radiusA = pc->radiusA;
 		float32 radiusB = pc->radiusB;
-		b2Manifold* manifold = m_contacts[vc->contactIndex]->GetManifold();
+		b2Contact* contact = m_contacts[vc->contactIndex];
+		b2Manifold* manifold = contact->GetManifold();
+		bool speculative = contact->m_speculativeDistance > 0.0f;
 
 		int32 indexA = vc->indexA;
 		int32 indexB = vc->indexB;
@@ -208,7 +236,12 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			// Setup a velocity bias for restitution.
 			vcp->velocityBias = 0.0f;
 			float32 vRel = b2Dot(vc->normal, vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA));
-			if (vRel < -b2_velocityThreshold)
+			if (speculative && worldManifold.separations[j] > 0.0f)
+			{
+				// Speculative point: the bodies may close the gap this step but no more.
+				vcp->velocityBias = -worldManifold.separations[j] * m_step.inv_dt;
+			}
+			else if (vRel < -b2_velocityThreshold)
 			{
 				vcp->velocityBias = -vc->restitution * vRel;
 			}
@@ -246,14 +279,31 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	// Group consecutive constraints by point count. The order is preserved
+	// so the iterations give the same results as a single loop.
+	m_velocityRunCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		int32 pointCount = m_velocityConstraints[i].pointCount;
+		b2ContactConstraintRun* run = m_velocityRunCount > 0 ? &m_velocityRuns[m_velocityRunCount - 1] : NULL;
+		if (run == NULL || run->pointCount != pointCount)
+		{
+			run = m_velocityRuns + m_velocityRunCount++;
+			run->begin = i;
+			run->pointCount = pointCount;
+			run->type = b2Manifold::e_circles;
+		}
+		run->end = i + 1;
+	}
 }
 
-void b2ContactSolver::WarmStart()
+template <int32 pointCount>
+static void b2WarmStartRun(b2ContactVelocityConstraint* vcs, int32 begin, int32 end, b2Velocity* velocities)
 {
-	// Warm start.
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = begin; i < end; ++i)
 	{
-		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		b2ContactVelocityConstraint* vc = vcs + i;
 
 		int32 indexA = vc->indexA;
 		int32 indexB = vc->indexB;
@@ -261,12 +311,11 @@ void b2ContactSolver::WarmStart()
 		float32 iA = vc->invIA;
 		float32 mB = vc->invMassB;
 		float32 iB = vc->invIB;
-		int32 pointCount = vc->pointCount;
 
-		b2Vec2 vA = m_velocities[indexA].v;
-		float32 wA = m_velocities[indexA].w;
-		b2Vec2 vB = m_velocities[indexB].v;
-		float32 wB = m_velocities[indexB].w;
+		b2Vec2 vA = velocities[indexA].v;
+		float32 wA = velocities[indexA].w;
+		b2Vec2 vB = velocities[indexB].v;
+		float32 wB = velocities[indexB].w;
 
 		b2Vec2 normal = vc->normal;
 		b2Vec2 tangent = b2Cross(normal, 1.0f);
@@ -281,18 +330,36 @@ void b2ContactSolver::WarmStart()
 			vB += mB * P;
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		velocities[indexA].v = vA;
+		velocities[indexA].w = wA;
+		velocities[indexB].v = vB;
+		velocities[indexB].w = wB;
 	}
 }
 
-void b2ContactSolver::SolveVelocityConstraints()
+void b2ContactSolver::WarmStart()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	// Warm start.
+	for (int32 i = 0; i < m_velocityRunCount; ++i)
 	{
-		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		const b2ContactConstraintRun* run = m_velocityRuns + i;
+		if (run->pointCount == 1)
+		{
+			b2WarmStartRun<1>(m_velocityConstraints, run->begin, run->end, m_velocities);
+		}
+		else
+		{
+			b2WarmStartRun<2>(m_velocityConstraints, run->begin, run->end, m_velocities);
+		}
+	}
+}
+
+template <int32 pointCount, bool blockSolve>
+static void b2SolveVelocityRun(b2ContactVelocityConstraint* vcs, int32 begin, int32 end, b2Velocity* velocities)
+{
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2ContactVelocityConstraint* vc = vcs + i;
 
 		int32 indexA = vc->indexA;
 		int32 indexB = vc->indexB;
@@ -300,18 +367,17 @@ void b2ContactSolver::SolveVelocityConstraints()
 		float32 iA = vc->invIA;
 		float32 mB = vc->invMassB;
 		float32 iB = vc->invIB;
-		int32 pointCount = vc->pointCount;
 
-		b2Vec2 vA = m_velocities[indexA].v;
-		float32 wA = m_velocities[indexA].w;
-		b2Vec2 vB = m_velocities[indexB].v;
-		float32 wB = m_velocities[indexB].w;
+		b2Vec2 vA = velocities[indexA].v;
+		float32 wA = velocities[indexA].w;
+		b2Vec2 vB = velocities[indexB].v;
+		float32 wB = velocities[indexB].w;
 
 		b2Vec2 normal = vc->normal;
 		b2Vec2 tangent = b2Cross(normal, 1.0f);
 		float32 friction = vc->friction;
 
-		b2Assert(pointCount == 1 || pointCount == 2);
+		b2Assert(vc->pointCount == pointCount);
 
 		// Solve tangent constraints first because non-penetration is more important
 		// than friction.
@@ -343,7 +409,7 @@ void b2ContactSolver::SolveVelocityConstraints()
 		}
 
 		// Solve normal constraints
-		if (pointCount == 1 || g_blockSolve == false)
+		if (pointCount == 1 || blockSolve == false)
 		{
 			for (int32 i = 0; i < pointCount; ++i)
 			{
@@ -594,10 +660,31 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		velocities[indexA].v = vA;
+		velocities[indexA].w = wA;
+		velocities[indexB].v = vB;
+		velocities[indexB].w = wB;
+	}
+}
+
+void b2ContactSolver::SolveVelocityConstraints()
+{
+	bool blockSolve = g_blockSolve;
+	for (int32 i = 0; i < m_velocityRunCount; ++i)
+	{
+		const b2ContactConstraintRun* run = m_velocityRuns + i;
+		if (run->pointCount == 1)
+		{
+			b2SolveVelocityRun<1, true>(m_velocityConstraints, run->begin, run->end, m_velocities);
+		}
+		else if (blockSolve)
+		{
+			b2SolveVelocityRun<2, true>(m_velocityConstraints, run->begin, run->end, m_velocities);
+		}
+		else
+		{
+			b2SolveVelocityRun<2, false>(m_velocityConstraints, run->begin, run->end, m_velocities);
+		}
 	}
 }
 
@@ -618,11 +705,13 @@ void b2ContactSolver::StoreImpulses()
 
 struct b2PositionSolverManifold
 {
-	void Initialize(b2ContactPositionConstraint* pc, const b2Transform& xfA, const b2Transform& xfB, int32 index)
+	template <b2Manifold::Type type>
+	void Initialize(const b2ContactPositionConstraint* pc, const b2Transform& xfA, const b2Transform& xfB, int32 index)
 	{
 		b2Assert(pc->pointCount > 0);
+		b2Assert(pc->type == type);
 
-		switch (pc->type)
+		switch (type)
 		{
 		case b2Manifold::e_circles:
 			{
@@ -667,14 +756,12 @@ struct b2PositionSolverManifold
 	float32 separation;
 };
 
-// Sequential solver.
-bool b2ContactSolver::SolvePositionConstraints()
+template <b2Manifold::Type type, int32 pointCount>
+static float32 b2SolvePositionRun(const b2ContactPositionConstraint* pcs, int32 begin, int32 end, b2Position* positions, float32 minSeparation)
 {
-	float32 minSeparation = 0.0f;
-
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = begin; i < end; ++i)
 	{
-		b2ContactPositionConstraint* pc = m_positionConstraints + i;
+		const b2ContactPositionConstraint* pc = pcs + i;
 
 		int32 indexA = pc->indexA;
 		int32 indexB = pc->indexB;
@@ -684,13 +771,13 @@ bool b2ContactSolver::SolvePositionConstraints()
 		b2Vec2 localCenterB = pc->localCenterB;
 		float32 mB = pc->invMassB;
 		float32 iB = pc->invIB;
-		int32 pointCount = pc->pointCount;
+		b2Assert(pc->pointCount == pointCount);
 
-		b2Vec2 cA = m_positions[indexA].c;
-		float32 aA = m_positions[indexA].a;
+		b2Vec2 cA = positions[indexA].c;
+		float32 aA = positions[indexA].a;
 
-		b2Vec2 cB = m_positions[indexB].c;
-		float32 aB = m_positions[indexB].a;
+		b2Vec2 cB = positions[indexB].c;
+		float32 aB = positions[indexB].a;
 
 		// Solve normal constraints
 		for (int32 j = 0; j < pointCount; ++j)
@@ -702,7 +789,7 @@ bool b2ContactSolver::SolvePositionConstraints()
 			xfB.p = cB - b2Mul(xfB.q, localCenterB);
 
 			b2PositionSolverManifold psm;
-			psm.Initialize(pc, xfA, xfB, j);
+			psm.Initialize<type>(pc, xfA, xfB, j);
 			b2Vec2 normal = psm.normal;
 
 			b2Vec2 point = psm.point;
@@ -734,11 +821,55 @@ bool b2ContactSolver::SolvePositionConstraints()
 			aB += iB * b2Cross(rB, P);
 		}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+		positions[indexA].c = cA;
+		positions[indexA].a = aA;
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+		positions[indexB].c = cB;
+		positions[indexB].a = aB;
+	}
+
+	return minSeparation;
+}
+
+
+// Sequential solver.
+bool b2ContactSolver::SolvePositionConstraints()
+{
+	float32 minSeparation = 0.0f;
+
+	for (int32 i = 0; i < m_positionRunCount; ++i)
+	{
+		const b2ContactConstraintRun* run = m_positionRuns + i;
+		const b2ContactPositionConstraint* pcs = m_positionConstraints;
+
+		switch (run->type)
+		{
+		case b2Manifold::e_circles:
+			minSeparation = b2SolvePositionRun<b2Manifold::e_circles, 1>(pcs, run->begin, run->end, m_positions, minSeparation);
+			break;
+
+		case b2Manifold::e_faceA:
+			if (run->pointCount == 1)
+			{
+				minSeparation = b2SolvePositionRun<b2Manifold::e_faceA, 1>(pcs, run->begin, run->end, m_positions, minSeparation);
+			}
+			else
+			{
+				minSeparation = b2SolvePositionRun<b2Manifold::e_faceA, 2>(pcs, run->begin, run->end, m_positions, minSeparation);
+			}
+			break;
+
+		case b2Manifold::e_faceB:
+			if (run->pointCount == 1)
+			{
+				minSeparation = b2SolvePositionRun<b2Manifold::e_faceB, 1>(pcs, run->begin, run->end, m_positions, minSeparation);
+			}
+			else
+			{
+				minSeparation = b2SolvePositionRun<b2Manifold::e_faceB, 2>(pcs, run->begin, run->end, m_positions, minSeparation);
+			}
+			break;
+		}
 	}
 
 	// We can't expect minSpeparation >= -b2_linearSlop because we don't
@@ -746,20 +877,19 @@ bool b2ContactSolver::SolvePositionConstraints()
 	return minSeparation >= -3.0f * b2_linearSlop;
 }
 
-// Sequential position solver for position constraints.
-bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB)
+template <b2Manifold::Type type, int32 pointCount>
+static float32 b2SolveTOIPositionRun(const b2ContactPositionConstraint* pcs, int32 begin, int32 end, b2Position* positions,
+									 int32 toiIndexA, int32 toiIndexB, float32 minSeparation)
 {
-	float32 minSeparation = 0.0f;
-
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = begin; i < end; ++i)
 	{
-		b2ContactPositionConstraint* pc = m_positionConstraints + i;
+		const b2ContactPositionConstraint* pc = pcs + i;
 
 		int32 indexA = pc->indexA;
 		int32 indexB = pc->indexB;
 		b2Vec2 localCenterA = pc->localCenterA;
 		b2Vec2 localCenterB = pc->localCenterB;
-		int32 pointCount = pc->pointCount;
+		b2Assert(pc->pointCount == pointCount);
 
 		float32 mA = 0.0f;
 		float32 iA = 0.0f;
@@ -777,11 +907,11 @@ bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiInde
 			iB = pc->invIB;
 		}
 
-		b2Vec2 cA = m_positions[indexA].c;
-		float32 aA = m_positions[indexA].a;
+		b2Vec2 cA = positions[indexA].c;
+		float32 aA = positions[indexA].a;
 
-		b2Vec2 cB = m_positions[indexB].c;
-		float32 aB = m_positions[indexB].a;
+		b2Vec2 cB = positions[indexB].c;
+		float32 aB = positions[indexB].a;
 
 		// Solve normal constraints
 		for (int32 j = 0; j < pointCount; ++j)
@@ -793,7 +923,7 @@ bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiInde
 			xfB.p = cB - b2Mul(xfB.q, localCenterB);
 
 			b2PositionSolverManifold psm;
-			psm.Initialize(pc, xfA, xfB, j);
+			psm.Initialize<type>(pc, xfA, xfB, j);
 			b2Vec2 normal = psm.normal;
 
 			b2Vec2 point = psm.point;
@@ -825,11 +955,54 @@ bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiInde
 			aB += iB * b2Cross(rB, P);
 		}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+		positions[indexA].c = cA;
+		positions[indexA].a = aA;
+
+		positions[indexB].c = cB;
+		positions[indexB].a = aB;
+	}
+
+	return minSeparation;
+}
+
+// Sequential position solver for position constraints.
+bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB)
+{
+	float32 minSeparation = 0.0f;
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+	for (int32 i = 0; i < m_positionRunCount; ++i)
+	{
+		const b2ContactConstraintRun* run = m_positionRuns + i;
+		const b2ContactPositionConstraint* pcs = m_positionConstraints;
+
+		switch (run->type)
+		{
+		case b2Manifold::e_circles:
+			minSeparation = b2SolveTOIPositionRun<b2Manifold::e_circles, 1>(pcs, run->begin, run->end, m_positions, toiIndexA, toiIndexB, minSeparation);
+			break;
+
+		case b2Manifold::e_faceA:
+			if (run->pointCount == 1)
+			{
+				minSeparation = b2SolveTOIPositionRun<b2Manifold::e_faceA, 1>(pcs, run->begin, run->end, m_positions, toiIndexA, toiIndexB, minSeparation);
+			}
+			else
+			{
+				minSeparation = b2SolveTOIPositionRun<b2Manifold::e_faceA, 2>(pcs, run->begin, run->end, m_positions, toiIndexA, toiIndexB, minSeparation);
+			}
+			break;
+
+		case b2Manifold::e_faceB:
+			if (run->pointCount == 1)
+			{
+				minSeparation = b2SolveTOIPositionRun<b2Manifold::e_faceB, 1>(pcs, run->begin, run->end, m_positions, toiIndexA, toiIndexB, minSeparation);
+			}
+			else
+			{
+				minSeparation = b2SolveTOIPositionRun<b2Manifold::e_faceB, 2>(pcs, run->begin, run->end, m_positions, toiIndexA, toiIndexB, minSeparation);
+			}
+			break;
+		}
 	}
 
 	// We can't expect minSpeparation >= -b2_linearSlop because we don't
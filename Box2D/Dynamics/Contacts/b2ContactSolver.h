@@ -27,6 +27,7 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2ContactConstraintRun;
 
 struct b2VelocityConstraintPoint
 {
@@ -89,6 +90,13 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// Consecutive constraints sharing a point count (and manifold type for
+	// position constraints) are solved by specialized kernels.
+	b2ContactConstraintRun* m_velocityRuns;
+	b2ContactConstraintRun* m_positionRuns;
+	int32 m_velocityRunCount;
+	int32 m_positionRunCount;
 };
 
 #endif
@@ -180,6 +180,49 @@ void b2Joint::Destroy(b2Joint* joint, b2BlockAllocator* allocator)
 	}
 }
 
+int32 b2Joint::GetSize(b2JointType type)
+{
+	switch (type)
+	{
+	case e_distanceJoint:
+		return sizeof(b2DistanceJoint);
+
+	case e_mouseJoint:
+		return sizeof(b2MouseJoint);
+
+	case e_prismaticJoint:
+		return sizeof(b2PrismaticJoint);
+
+	case e_revoluteJoint:
+		return sizeof(b2RevoluteJoint);
+
+	case e_pulleyJoint:
+		return sizeof(b2PulleyJoint);
+
+	case e_gearJoint:
+		return sizeof(b2GearJoint);
+
+	case e_wheelJoint:
+		return sizeof(b2WheelJoint);
+
+	case e_weldJoint:
+		return sizeof(b2WeldJoint);
+
+	case e_frictionJoint:
+		return sizeof(b2FrictionJoint);
+
+	case e_ropeJoint:
+		return sizeof(b2RopeJoint);
+
+	case e_motorJoint:
+		return sizeof(b2MotorJoint);
+
+	default:
+		b2Assert(false);
+		return 0;
+	}
+}
+
 b2Joint::b2Joint(const b2JointDef* def)
 {
 	b2Assert(def->bodyA != def->bodyB);
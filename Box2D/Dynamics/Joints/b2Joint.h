@@ -154,10 +154,14 @@ protected:
 	friend class b2Body;
 	friend class b2Island;
 	friend class b2GearJoint;
+	friend class b2JointSolver;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
 	static void Destroy(b2Joint* joint, b2BlockAllocator* allocator);
 
+	// The allocation size of the concrete joint type.
+	static int32 GetSize(b2JointType type);
+
 	b2Joint(const b2JointDef* def);
 	virtual ~b2Joint() {}
 
@@ -0,0 +1,1651 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/Joints/b2JointSolver.h>
+#include <Box2D/Dynamics/Joints/b2RevoluteJoint.h>
+#include <Box2D/Dynamics/Joints/b2DistanceJoint.h>
+#include <Box2D/Dynamics/Joints/b2PrismaticJoint.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Common/b2StackAllocator.h>
+#include <string.h>
+
+// The kernels below repeat the math of b2RevoluteJoint, b2DistanceJoint and
+// b2PrismaticJoint operation for operation. Keep them in sync.
+
+b2JointSolver::b2JointSolver(b2JointSolverDef* def)
+{
+	m_step = def->step;
+	m_positions = def->positions;
+	m_velocities = def->velocities;
+	m_allocator = def->allocator;
+
+	m_revoluteCount = 0;
+	m_distanceCount = 0;
+	m_prismaticCount = 0;
+	m_otherCount = 0;
+
+	for (int32 i = 0; i < def->count; ++i)
+	{
+		switch (def->joints[i]->m_type)
+		{
+		case e_revoluteJoint:
+			++m_revoluteCount;
+			break;
+
+		case e_distanceJoint:
+			++m_distanceCount;
+			break;
+
+		case e_prismaticJoint:
+			++m_prismaticCount;
+			break;
+
+		default:
+			++m_otherCount;
+			break;
+		}
+	}
+
+	m_joints = (b2Joint**)m_allocator->Allocate(def->count * sizeof(b2Joint*));
+	m_revolutes = (b2RevoluteConstraint*)m_allocator->Allocate(m_revoluteCount * sizeof(b2RevoluteConstraint));
+	m_distances = (b2DistanceConstraint*)m_allocator->Allocate(m_distanceCount * sizeof(b2DistanceConstraint));
+	m_prismatics = (b2PrismaticConstraint*)m_allocator->Allocate(m_prismaticCount * sizeof(b2PrismaticConstraint));
+	m_revoluteColorStarts = (int32*)m_allocator->Allocate((m_revoluteCount + 1) * sizeof(int32));
+	m_revoluteBatches = (b2RevoluteBatch*)m_allocator->Allocate((m_revoluteCount / b2_simdWidth) * sizeof(b2RevoluteBatch));
+	m_distanceColorStarts = (int32*)m_allocator->Allocate((m_distanceCount + 1) * sizeof(int32));
+	m_distanceBatches = (b2DistanceBatch*)m_allocator->Allocate((m_distanceCount / b2_simdWidth) * sizeof(b2DistanceBatch));
+	m_revoluteBatchCount = 0;
+	m_distanceBatchCount = 0;
+
+	// Group the joints by type. Each group keeps the island order.
+	int32 revoluteIndex = 0;
+	int32 distanceIndex = m_revoluteCount;
+	int32 prismaticIndex = distanceIndex + m_distanceCount;
+	int32 otherIndex = prismaticIndex + m_prismaticCount;
+	for (int32 i = 0; i < def->count; ++i)
+	{
+		b2Joint* joint = def->joints[i];
+		switch (joint->m_type)
+		{
+		case e_revoluteJoint:
+			m_joints[revoluteIndex++] = joint;
+			break;
+
+		case e_distanceJoint:
+			m_joints[distanceIndex++] = joint;
+			break;
+
+		case e_prismaticJoint:
+			m_joints[prismaticIndex++] = joint;
+			break;
+
+		default:
+			m_joints[otherIndex++] = joint;
+			break;
+		}
+	}
+
+	m_revoluteColorCount = ColorJoints(m_joints, m_revoluteCount, def->bodyCount, m_revoluteColorStarts);
+	m_distanceColorCount = ColorJoints(m_joints + m_revoluteCount, m_distanceCount, def->bodyCount, m_distanceColorStarts);
+
+	// Copy the position independent data and the warm starting state.
+	b2Joint** joints = m_joints;
+	for (int32 i = 0; i < m_revoluteCount; ++i)
+	{
+		b2RevoluteJoint* joint = (b2RevoluteJoint*)joints[i];
+		b2Body* bodyA = joint->m_bodyA;
+		b2Body* bodyB = joint->m_bodyB;
+		b2RevoluteConstraint* rc = m_revolutes + i;
+
+		rc->indexA = bodyA->m_islandIndex;
+		rc->indexB = bodyB->m_islandIndex;
+		rc->localOffsetA = joint->m_localAnchorA - bodyA->m_sweep.localCenter;
+		rc->localOffsetB = joint->m_localAnchorB - bodyB->m_sweep.localCenter;
+		rc->invMassA = bodyA->m_invMass;
+		rc->invMassB = bodyB->m_invMass;
+		rc->invIA = bodyA->m_invI;
+		rc->invIB = bodyB->m_invI;
+		rc->impulse = joint->m_impulse;
+		rc->motorImpulse = joint->m_motorImpulse;
+		rc->motorSpeed = joint->m_motorSpeed;
+		rc->maxMotorTorque = joint->m_maxMotorTorque;
+		rc->referenceAngle = joint->m_referenceAngle;
+		rc->lowerAngle = joint->m_lowerAngle;
+		rc->upperAngle = joint->m_upperAngle;
+		rc->limitState = joint->m_limitState;
+		rc->enableMotor = joint->m_enableMotor;
+		rc->enableLimit = joint->m_enableLimit;
+	}
+
+	joints += m_revoluteCount;
+	for (int32 i = 0; i < m_distanceCount; ++i)
+	{
+		b2DistanceJoint* joint = (b2DistanceJoint*)joints[i];
+		b2Body* bodyA = joint->m_bodyA;
+		b2Body* bodyB = joint->m_bodyB;
+		b2DistanceConstraint* dc = m_distances + i;
+
+		dc->indexA = bodyA->m_islandIndex;
+		dc->indexB = bodyB->m_islandIndex;
+		dc->localOffsetA = joint->m_localAnchorA - bodyA->m_sweep.localCenter;
+		dc->localOffsetB = joint->m_localAnchorB - bodyB->m_sweep.localCenter;
+		dc->invMassA = bodyA->m_invMass;
+		dc->invMassB = bodyB->m_invMass;
+		dc->invIA = bodyA->m_invI;
+		dc->invIB = bodyB->m_invI;
+		dc->impulse = joint->m_impulse;
+		dc->length = joint->m_length;
+		dc->frequencyHz = joint->m_frequencyHz;
+		dc->dampingRatio = joint->m_dampingRatio;
+	}
+
+	joints += m_distanceCount;
+	for (int32 i = 0; i < m_prismaticCount; ++i)
+	{
+		b2PrismaticJoint* joint = (b2PrismaticJoint*)joints[i];
+		b2Body* bodyA = joint->m_bodyA;
+		b2Body* bodyB = joint->m_bodyB;
+		b2PrismaticConstraint* pc = m_prismatics + i;
+
+		pc->indexA = bodyA->m_islandIndex;
+		pc->indexB = bodyB->m_islandIndex;
+		pc->localOffsetA = joint->m_localAnchorA - bodyA->m_sweep.localCenter;
+		pc->localOffsetB = joint->m_localAnchorB - bodyB->m_sweep.localCenter;
+		pc->localXAxisA = joint->m_localXAxisA;
+		pc->localYAxisA = joint->m_localYAxisA;
+		pc->invMassA = bodyA->m_invMass;
+		pc->invMassB = bodyB->m_invMass;
+		pc->invIA = bodyA->m_invI;
+		pc->invIB = bodyB->m_invI;
+		pc->impulse = joint->m_impulse;
+		pc->motorImpulse = joint->m_motorImpulse;
+		pc->motorSpeed = joint->m_motorSpeed;
+		pc->maxMotorForce = joint->m_maxMotorForce;
+		pc->referenceAngle = joint->m_referenceAngle;
+		pc->lowerTranslation = joint->m_lowerTranslation;
+		pc->upperTranslation = joint->m_upperTranslation;
+		pc->limitState = joint->m_limitState;
+		pc->enableMotor = joint->m_enableMotor;
+		pc->enableLimit = joint->m_enableLimit;
+	}
+}
+
+b2JointSolver::~b2JointSolver()
+{
+	m_allocator->Free(m_distanceBatches);
+	m_allocator->Free(m_distanceColorStarts);
+	m_allocator->Free(m_revoluteBatches);
+	m_allocator->Free(m_revoluteColorStarts);
+	m_allocator->Free(m_prismatics);
+	m_allocator->Free(m_distances);
+	m_allocator->Free(m_revolutes);
+	m_allocator->Free(m_joints);
+}
+
+int32 b2JointSolver::ColorJoints(b2Joint** joints, int32 count, int32 bodyCount, int32* colorStarts)
+{
+	colorStarts[0] = 0;
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	// The first color free on each body. Static and kinematic bodies are not
+	// changed by the joints, so they do not constrain the colors.
+	int32* levels = (int32*)m_allocator->Allocate(bodyCount * sizeof(int32));
+	int32* colors = (int32*)m_allocator->Allocate(count * sizeof(int32));
+	b2Joint** sorted = (b2Joint**)m_allocator->Allocate(count * sizeof(b2Joint*));
+	memset(levels, 0, bodyCount * sizeof(int32));
+
+	int32 colorCount = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Body* bodyA = joints[i]->m_bodyA;
+		b2Body* bodyB = joints[i]->m_bodyB;
+		bool dynamicA = bodyA->m_type == b2_dynamicBody;
+		bool dynamicB = bodyB->m_type == b2_dynamicBody;
+
+		int32 color = 0;
+		if (dynamicA)
+		{
+			color = levels[bodyA->m_islandIndex];
+		}
+		if (dynamicB)
+		{
+			color = b2Max(color, levels[bodyB->m_islandIndex]);
+		}
+
+		if (dynamicA)
+		{
+			levels[bodyA->m_islandIndex] = color + 1;
+		}
+		if (dynamicB)
+		{
+			levels[bodyB->m_islandIndex] = color + 1;
+		}
+
+		colors[i] = color;
+		colorCount = b2Max(colorCount, color + 1);
+	}
+
+	// Stable counting sort by color.
+	memset(colorStarts, 0, (colorCount + 1) * sizeof(int32));
+	for (int32 i = 0; i < count; ++i)
+	{
+		++colorStarts[colors[i] + 1];
+	}
+
+	for (int32 i = 0; i < colorCount; ++i)
+	{
+		colorStarts[i + 1] += colorStarts[i];
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		sorted[colorStarts[colors[i]]++] = joints[i];
+	}
+
+	// The starts were advanced to the ends.
+	for (int32 i = colorCount; i > 0; --i)
+	{
+		colorStarts[i] = colorStarts[i - 1];
+	}
+	colorStarts[0] = 0;
+
+	memcpy(joints, sorted, count * sizeof(b2Joint*));
+
+	m_allocator->Free(sorted);
+	m_allocator->Free(colors);
+	m_allocator->Free(levels);
+
+	return colorCount;
+}
+
+void b2JointSolver::InitializeVelocityConstraints()
+{
+	InitializeRevolute();
+	InitializeDistance();
+	InitializePrismatic();
+
+	b2SolverData data;
+	data.step = m_step;
+	data.positions = m_positions;
+	data.velocities = m_velocities;
+
+	b2Joint** others = m_joints + m_revoluteCount + m_distanceCount + m_prismaticCount;
+	for (int32 i = 0; i < m_otherCount; ++i)
+	{
+		others[i]->InitVelocityConstraints(data);
+	}
+}
+
+void b2JointSolver::SolveVelocityConstraints()
+{
+	SolveRevoluteVelocity();
+	SolveDistanceVelocity();
+	SolvePrismaticVelocity();
+
+	b2SolverData data;
+	data.step = m_step;
+	data.positions = m_positions;
+	data.velocities = m_velocities;
+
+	b2Joint** others = m_joints + m_revoluteCount + m_distanceCount + m_prismaticCount;
+	for (int32 i = 0; i < m_otherCount; ++i)
+	{
+		others[i]->SolveVelocityConstraints(data);
+	}
+}
+
+bool b2JointSolver::SolvePositionConstraints()
+{
+	bool revolutesOkay = SolveRevolutePosition();
+	bool distancesOkay = SolveDistancePosition();
+	bool prismaticsOkay = SolvePrismaticPosition();
+
+	b2SolverData data;
+	data.step = m_step;
+	data.positions = m_positions;
+	data.velocities = m_velocities;
+
+	bool othersOkay = true;
+	b2Joint** others = m_joints + m_revoluteCount + m_distanceCount + m_prismaticCount;
+	for (int32 i = 0; i < m_otherCount; ++i)
+	{
+		bool jointOkay = others[i]->SolvePositionConstraints(data);
+		othersOkay = othersOkay && jointOkay;
+	}
+
+	return revolutesOkay && distancesOkay && prismaticsOkay && othersOkay;
+}
+
+void b2JointSolver::StoreImpulses()
+{
+	// Take the impulses of the batched lanes back.
+	b2RevoluteBatch* revoluteBatch = m_revoluteBatches;
+	for (int32 i = 0; i < m_revoluteColorCount; ++i)
+	{
+		int32 end = m_revoluteColorStarts[i + 1];
+		for (int32 j = m_revoluteColorStarts[i]; j + b2_simdWidth <= end; j += b2_simdWidth)
+		{
+			for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+			{
+				b2RevoluteConstraint* rc = m_revolutes + j + lane;
+				rc->impulse.Set(revoluteBatch->impulseX[lane], revoluteBatch->impulseY[lane], revoluteBatch->impulseZ[lane]);
+				rc->motorImpulse = revoluteBatch->motorImpulse[lane];
+			}
+			++revoluteBatch;
+		}
+	}
+
+	b2DistanceBatch* distanceBatch = m_distanceBatches;
+	for (int32 i = 0; i < m_distanceColorCount; ++i)
+	{
+		int32 end = m_distanceColorStarts[i + 1];
+		for (int32 j = m_distanceColorStarts[i]; j + b2_simdWidth <= end; j += b2_simdWidth)
+		{
+			for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+			{
+				m_distances[j + lane].impulse = distanceBatch->impulse[lane];
+			}
+			++distanceBatch;
+		}
+	}
+
+	b2Joint** joints = m_joints;
+	for (int32 i = 0; i < m_revoluteCount; ++i)
+	{
+		b2RevoluteJoint* joint = (b2RevoluteJoint*)joints[i];
+		const b2RevoluteConstraint* rc = m_revolutes + i;
+		joint->m_impulse = rc->impulse;
+		joint->m_motorImpulse = rc->motorImpulse;
+		joint->m_limitState = rc->limitState;
+	}
+
+	joints += m_revoluteCount;
+	for (int32 i = 0; i < m_distanceCount; ++i)
+	{
+		b2DistanceJoint* joint = (b2DistanceJoint*)joints[i];
+		const b2DistanceConstraint* dc = m_distances + i;
+		joint->m_impulse = dc->impulse;
+
+		// For GetReactionForce.
+		joint->m_u = dc->u;
+	}
+
+	joints += m_distanceCount;
+	for (int32 i = 0; i < m_prismaticCount; ++i)
+	{
+		b2PrismaticJoint* joint = (b2PrismaticJoint*)joints[i];
+		const b2PrismaticConstraint* pc = m_prismatics + i;
+		joint->m_impulse = pc->impulse;
+		joint->m_motorImpulse = pc->motorImpulse;
+		joint->m_limitState = pc->limitState;
+
+		// For GetReactionForce.
+		joint->m_axis = pc->axis;
+		joint->m_perp = pc->perp;
+	}
+}
+
+void b2JointSolver::InitializeRevolute()
+{
+	for (int32 i = 0; i < m_revoluteCount; ++i)
+	{
+		b2RevoluteConstraint* rc = m_revolutes + i;
+
+		int32 indexA = rc->indexA;
+		int32 indexB = rc->indexB;
+
+		float32 aA = m_positions[indexA].a;
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+
+		float32 aB = m_positions[indexB].a;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		b2Rot qA(aA), qB(aB);
+
+		b2Vec2 rA = b2Mul(qA, rc->localOffsetA);
+		b2Vec2 rB = b2Mul(qB, rc->localOffsetB);
+		rc->rA = rA;
+		rc->rB = rB;
+
+		float32 mA = rc->invMassA, mB = rc->invMassB;
+		float32 iA = rc->invIA, iB = rc->invIB;
+
+		bool fixedRotation = (iA + iB == 0.0f);
+
+		b2Mat33& K = rc->mass;
+		K.ex.x = mA + mB + rA.y * rA.y * iA + rB.y * rB.y * iB;
+		K.ey.x = -rA.y * rA.x * iA - rB.y * rB.x * iB;
+		K.ez.x = -rA.y * iA - rB.y * iB;
+		K.ex.y = K.ey.x;
+		K.ey.y = mA + mB + rA.x * rA.x * iA + rB.x * rB.x * iB;
+		K.ez.y = rA.x * iA + rB.x * iB;
+		K.ex.z = K.ez.x;
+		K.ey.z = K.ez.y;
+		K.ez.z = iA + iB;
+
+		rc->motorMass = iA + iB;
+		if (rc->motorMass > 0.0f)
+		{
+			rc->motorMass = 1.0f / rc->motorMass;
+		}
+
+		if (rc->enableMotor == false || fixedRotation)
+		{
+			rc->motorImpulse = 0.0f;
+		}
+
+		if (rc->enableLimit && fixedRotation == false)
+		{
+			float32 jointAngle = aB - aA - rc->referenceAngle;
+			if (b2Abs(rc->upperAngle - rc->lowerAngle) < 2.0f * b2_angularSlop)
+			{
+				rc->limitState = e_equalLimits;
+			}
+			else if (jointAngle <= rc->lowerAngle)
+			{
+				if (rc->limitState != e_atLowerLimit)
+				{
+					rc->impulse.z = 0.0f;
+				}
+				rc->limitState = e_atLowerLimit;
+			}
+			else if (jointAngle >= rc->upperAngle)
+			{
+				if (rc->limitState != e_atUpperLimit)
+				{
+					rc->impulse.z = 0.0f;
+				}
+				rc->limitState = e_atUpperLimit;
+			}
+			else
+			{
+				rc->limitState = e_inactiveLimit;
+				rc->impulse.z = 0.0f;
+			}
+		}
+		else
+		{
+			rc->limitState = e_inactiveLimit;
+		}
+
+		if (m_step.warmStarting)
+		{
+			// Scale impulses to support a variable time step.
+			rc->impulse *= m_step.dtRatio;
+			rc->motorImpulse *= m_step.dtRatio;
+
+			b2Vec2 P(rc->impulse.x, rc->impulse.y);
+
+			vA -= mA * P;
+			wA -= iA * (b2Cross(rA, P) + rc->motorImpulse + rc->impulse.z);
+
+			vB += mB * P;
+			wB += iB * (b2Cross(rB, P) + rc->motorImpulse + rc->impulse.z);
+		}
+		else
+		{
+			rc->impulse.SetZero();
+			rc->motorImpulse = 0.0f;
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+
+	// Copy the full lanes of each color to the batches.
+	float32 dt = m_step.dt;
+	m_revoluteBatchCount = 0;
+	for (int32 i = 0; i < m_revoluteColorCount; ++i)
+	{
+		int32 end = m_revoluteColorStarts[i + 1];
+		for (int32 j = m_revoluteColorStarts[i]; j + b2_simdWidth <= end; j += b2_simdWidth)
+		{
+			b2RevoluteBatch* b = m_revoluteBatches + m_revoluteBatchCount++;
+			for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+			{
+				const b2RevoluteConstraint* rc = m_revolutes + j + lane;
+				const b2Mat33& K = rc->mass;
+
+				b->indexA[lane] = rc->indexA;
+				b->indexB[lane] = rc->indexB;
+				b->rAx[lane] = rc->rA.x;
+				b->rAy[lane] = rc->rA.y;
+				b->rBx[lane] = rc->rB.x;
+				b->rBy[lane] = rc->rB.y;
+				b->invMassA[lane] = rc->invMassA;
+				b->invMassB[lane] = rc->invMassB;
+				b->invIA[lane] = rc->invIA;
+				b->invIB[lane] = rc->invIB;
+
+				b->k11[lane] = K.ex.x;
+				b->k12[lane] = K.ey.x;
+				b->k13[lane] = K.ez.x;
+				b->k22[lane] = K.ey.y;
+				b->k23[lane] = K.ez.y;
+				b->k33[lane] = K.ez.z;
+
+				// As in b2Mat33::Solve33 and b2Mat33::Solve22.
+				b2Vec3 c = b2Cross(K.ey, K.ez);
+				float32 det33 = b2Dot(K.ex, c);
+				if (det33 != 0.0f)
+				{
+					det33 = 1.0f / det33;
+				}
+				float32 det22 = K.ex.x * K.ey.y - K.ey.x * K.ex.y;
+				if (det22 != 0.0f)
+				{
+					det22 = 1.0f / det22;
+				}
+				b->cx[lane] = c.x;
+				b->cy[lane] = c.y;
+				b->cz[lane] = c.z;
+				b->det33[lane] = det33;
+				b->det22[lane] = det22;
+
+				b->impulseX[lane] = rc->impulse.x;
+				b->impulseY[lane] = rc->impulse.y;
+				b->impulseZ[lane] = rc->impulse.z;
+				b->motorImpulse[lane] = rc->motorImpulse;
+				b->motorMass[lane] = rc->motorMass;
+				b->motorSpeed[lane] = rc->motorSpeed;
+				b->maxMotorImpulse[lane] = dt * rc->maxMotorTorque;
+
+				bool fixedRotation = (rc->invIA + rc->invIB == 0.0f);
+				bool motor = rc->enableMotor && rc->limitState != e_equalLimits && fixedRotation == false;
+				bool limit = rc->enableLimit && rc->limitState != e_inactiveLimit && fixedRotation == false;
+				b->motor[lane] = motor ? 1.0f : 0.0f;
+				b->limit[lane] = limit ? 1.0f : 0.0f;
+				b->lower[lane] = rc->limitState == e_atLowerLimit ? 1.0f : 0.0f;
+				b->upper[lane] = rc->limitState == e_atUpperLimit ? 1.0f : 0.0f;
+			}
+		}
+	}
+}
+
+void b2JointSolver::InitializeDistance()
+{
+	for (int32 i = 0; i < m_distanceCount; ++i)
+	{
+		b2DistanceConstraint* dc = m_distances + i;
+
+		int32 indexA = dc->indexA;
+		int32 indexB = dc->indexB;
+
+		b2Vec2 cA = m_positions[indexA].c;
+		float32 aA = m_positions[indexA].a;
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+
+		b2Vec2 cB = m_positions[indexB].c;
+		float32 aB = m_positions[indexB].a;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		b2Rot qA(aA), qB(aB);
+
+		b2Vec2 rA = b2Mul(qA, dc->localOffsetA);
+		b2Vec2 rB = b2Mul(qB, dc->localOffsetB);
+		b2Vec2 u = cB + rB - cA - rA;
+		dc->rA = rA;
+		dc->rB = rB;
+
+		// Handle singularity.
+		float32 length = u.Length();
+		if (length > b2_linearSlop)
+		{
+			u *= 1.0f / length;
+		}
+		else
+		{
+			u.Set(0.0f, 0.0f);
+		}
+		dc->u = u;
+
+		float32 crAu = b2Cross(rA, u);
+		float32 crBu = b2Cross(rB, u);
+		float32 invMass = dc->invMassA + dc->invIA * crAu * crAu + dc->invMassB + dc->invIB * crBu * crBu;
+
+		// Compute the effective mass matrix.
+		dc->mass = invMass != 0.0f ? 1.0f / invMass : 0.0f;
+
+		if (dc->frequencyHz > 0.0f)
+		{
+			float32 C = length - dc->length;
+
+			// Frequency
+			float32 omega = 2.0f * b2_pi * dc->frequencyHz;
+
+			// Damping coefficient
+			float32 d = 2.0f * dc->mass * dc->dampingRatio * omega;
+
+			// Spring stiffness
+			float32 k = dc->mass * omega * omega;
+
+			// magic formulas
+			float32 h = m_step.dt;
+			dc->gamma = h * (d + h * k);
+			dc->gamma = dc->gamma != 0.0f ? 1.0f / dc->gamma : 0.0f;
+			dc->bias = C * h * k * dc->gamma;
+
+			invMass += dc->gamma;
+			dc->mass = invMass != 0.0f ? 1.0f / invMass : 0.0f;
+		}
+		else
+		{
+			dc->gamma = 0.0f;
+			dc->bias = 0.0f;
+		}
+
+		if (m_step.warmStarting)
+		{
+			// Scale the impulse to support a variable time step.
+			dc->impulse *= m_step.dtRatio;
+
+			b2Vec2 P = dc->impulse * u;
+			vA -= dc->invMassA * P;
+			wA -= dc->invIA * b2Cross(rA, P);
+			vB += dc->invMassB * P;
+			wB += dc->invIB * b2Cross(rB, P);
+		}
+		else
+		{
+			dc->impulse = 0.0f;
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+
+	// Copy the full lanes of each color to the batches.
+	m_distanceBatchCount = 0;
+	for (int32 i = 0; i < m_distanceColorCount; ++i)
+	{
+		int32 end = m_distanceColorStarts[i + 1];
+		for (int32 j = m_distanceColorStarts[i]; j + b2_simdWidth <= end; j += b2_simdWidth)
+		{
+			b2DistanceBatch* b = m_distanceBatches + m_distanceBatchCount++;
+			for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+			{
+				const b2DistanceConstraint* dc = m_distances + j + lane;
+				b->indexA[lane] = dc->indexA;
+				b->indexB[lane] = dc->indexB;
+				b->rAx[lane] = dc->rA.x;
+				b->rAy[lane] = dc->rA.y;
+				b->rBx[lane] = dc->rB.x;
+				b->rBy[lane] = dc->rB.y;
+				b->ux[lane] = dc->u.x;
+				b->uy[lane] = dc->u.y;
+				b->invMassA[lane] = dc->invMassA;
+				b->invMassB[lane] = dc->invMassB;
+				b->invIA[lane] = dc->invIA;
+				b->invIB[lane] = dc->invIB;
+				b->mass[lane] = dc->mass;
+				b->bias[lane] = dc->bias;
+				b->gamma[lane] = dc->gamma;
+				b->impulse[lane] = dc->impulse;
+			}
+		}
+	}
+}
+
+void b2JointSolver::InitializePrismatic()
+{
+	for (int32 i = 0; i < m_prismaticCount; ++i)
+	{
+		b2PrismaticConstraint* pc = m_prismatics + i;
+
+		int32 indexA = pc->indexA;
+		int32 indexB = pc->indexB;
+
+		b2Vec2 cA = m_positions[indexA].c;
+		float32 aA = m_positions[indexA].a;
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+
+		b2Vec2 cB = m_positions[indexB].c;
+		float32 aB = m_positions[indexB].a;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		b2Rot qA(aA), qB(aB);
+
+		// Compute the effective masses.
+		b2Vec2 rA = b2Mul(qA, pc->localOffsetA);
+		b2Vec2 rB = b2Mul(qB, pc->localOffsetB);
+		b2Vec2 d = (cB - cA) + rB - rA;
+
+		float32 mA = pc->invMassA, mB = pc->invMassB;
+		float32 iA = pc->invIA, iB = pc->invIB;
+
+		// Compute motor Jacobian and effective mass.
+		b2Vec2 axis = b2Mul(qA, pc->localXAxisA);
+		float32 a1 = b2Cross(d + rA, axis);
+		float32 a2 = b2Cross(rB, axis);
+
+		pc->motorMass = mA + mB + iA * a1 * a1 + iB * a2 * a2;
+		if (pc->motorMass > 0.0f)
+		{
+			pc->motorMass = 1.0f / pc->motorMass;
+		}
+
+		// Prismatic constraint.
+		b2Vec2 perp = b2Mul(qA, pc->localYAxisA);
+		float32 s1 = b2Cross(d + rA, perp);
+		float32 s2 = b2Cross(rB, perp);
+
+		float32 k11 = mA + mB + iA * s1 * s1 + iB * s2 * s2;
+		float32 k12 = iA * s1 + iB * s2;
+		float32 k13 = iA * s1 * a1 + iB * s2 * a2;
+		float32 k22 = iA + iB;
+		if (k22 == 0.0f)
+		{
+			// For bodies with fixed rotation.
+			k22 = 1.0f;
+		}
+		float32 k23 = iA * a1 + iB * a2;
+		float32 k33 = mA + mB + iA * a1 * a1 + iB * a2 * a2;
+
+		pc->K.ex.Set(k11, k12, k13);
+		pc->K.ey.Set(k12, k22, k23);
+		pc->K.ez.Set(k13, k23, k33);
+
+		pc->axis = axis;
+		pc->perp = perp;
+		pc->s1 = s1;
+		pc->s2 = s2;
+		pc->a1 = a1;
+		pc->a2 = a2;
+
+		// Compute motor and limit terms.
+		if (pc->enableLimit)
+		{
+			float32 jointTranslation = b2Dot(axis, d);
+			if (b2Abs(pc->upperTranslation - pc->lowerTranslation) < 2.0f * b2_linearSlop)
+			{
+				pc->limitState = e_equalLimits;
+			}
+			else if (jointTranslation <= pc->lowerTranslation)
+			{
+				if (pc->limitState != e_atLowerLimit)
+				{
+					pc->limitState = e_atLowerLimit;
+					pc->impulse.z = 0.0f;
+				}
+			}
+			else if (jointTranslation >= pc->upperTranslation)
+			{
+				if (pc->limitState != e_atUpperLimit)
+				{
+					pc->limitState = e_atUpperLimit;
+					pc->impulse.z = 0.0f;
+				}
+			}
+			else
+			{
+				pc->limitState = e_inactiveLimit;
+				pc->impulse.z = 0.0f;
+			}
+		}
+		else
+		{
+			pc->limitState = e_inactiveLimit;
+			pc->impulse.z = 0.0f;
+		}
+
+		if (pc->enableMotor == false)
+		{
+			pc->motorImpulse = 0.0f;
+		}
+
+		if (m_step.warmStarting)
+		{
+			// Account for variable time step.
+			pc->impulse *= m_step.dtRatio;
+			pc->motorImpulse *= m_step.dtRatio;
+
+			b2Vec3 impulse = pc->impulse;
+			float32 axial = pc->motorImpulse + impulse.z;
+			b2Vec2 P = impulse.x * perp + axial * axis;
+			float32 LA = impulse.x * s1 + impulse.y + axial * a1;
+			float32 LB = impulse.x * s2 + impulse.y + axial * a2;
+
+			vA -= mA * P;
+			wA -= iA * LA;
+
+			vB += mB * P;
+			wB += iB * LB;
+		}
+		else
+		{
+			pc->impulse.SetZero();
+			pc->motorImpulse = 0.0f;
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+}
+
+// Solve one revolute joint, see b2RevoluteJoint::SolveVelocityConstraints.
+static void b2SolveRevolute(b2RevoluteConstraint* rc, b2Velocity* velocities, float32 dt)
+{
+	int32 indexA = rc->indexA;
+	int32 indexB = rc->indexB;
+
+	b2Vec2 vA = velocities[indexA].v;
+	float32 wA = velocities[indexA].w;
+	b2Vec2 vB = velocities[indexB].v;
+	float32 wB = velocities[indexB].w;
+
+	float32 mA = rc->invMassA, mB = rc->invMassB;
+	float32 iA = rc->invIA, iB = rc->invIB;
+	b2Vec2 rA = rc->rA, rB = rc->rB;
+
+	bool fixedRotation = (iA + iB == 0.0f);
+
+	// Solve motor constraint.
+	if (rc->enableMotor && rc->limitState != e_equalLimits && fixedRotation == false)
+	{
+		float32 Cdot = wB - wA - rc->motorSpeed;
+		float32 impulse = -rc->motorMass * Cdot;
+		float32 oldImpulse = rc->motorImpulse;
+		float32 maxImpulse = dt * rc->maxMotorTorque;
+		rc->motorImpulse = b2Clamp(rc->motorImpulse + impulse, -maxImpulse, maxImpulse);
+		impulse = rc->motorImpulse - oldImpulse;
+
+		wA -= iA * impulse;
+		wB += iB * impulse;
+	}
+
+	// Solve limit constraint.
+	if (rc->enableLimit && rc->limitState != e_inactiveLimit && fixedRotation == false)
+	{
+		b2Vec2 Cdot1 = vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA);
+		float32 Cdot2 = wB - wA;
+		b2Vec3 Cdot(Cdot1.x, Cdot1.y, Cdot2);
+
+		b2Vec3 impulse = -rc->mass.Solve33(Cdot);
+
+		if (rc->limitState == e_equalLimits)
+		{
+			rc->impulse += impulse;
+		}
+		else if (rc->limitState == e_atLowerLimit)
+		{
+			float32 newImpulse = rc->impulse.z + impulse.z;
+			if (newImpulse < 0.0f)
+			{
+				b2Vec2 rhs = -Cdot1 + rc->impulse.z * b2Vec2(rc->mass.ez.x, rc->mass.ez.y);
+				b2Vec2 reduced = rc->mass.Solve22(rhs);
+				impulse.x = reduced.x;
+				impulse.y = reduced.y;
+				impulse.z = -rc->impulse.z;
+				rc->impulse.x += reduced.x;
+				rc->impulse.y += reduced.y;
+				rc->impulse.z = 0.0f;
+			}
+			else
+			{
+				rc->impulse += impulse;
+			}
+		}
+		else if (rc->limitState == e_atUpperLimit)
+		{
+			float32 newImpulse = rc->impulse.z + impulse.z;
+			if (newImpulse > 0.0f)
+			{
+				b2Vec2 rhs = -Cdot1 + rc->impulse.z * b2Vec2(rc->mass.ez.x, rc->mass.ez.y);
+				b2Vec2 reduced = rc->mass.Solve22(rhs);
+				impulse.x = reduced.x;
+				impulse.y = reduced.y;
+				impulse.z = -rc->impulse.z;
+				rc->impulse.x += reduced.x;
+				rc->impulse.y += reduced.y;
+				rc->impulse.z = 0.0f;
+			}
+			else
+			{
+				rc->impulse += impulse;
+			}
+		}
+
+		b2Vec2 P(impulse.x, impulse.y);
+
+		vA -= mA * P;
+		wA -= iA * (b2Cross(rA, P) + impulse.z);
+
+		vB += mB * P;
+		wB += iB * (b2Cross(rB, P) + impulse.z);
+	}
+	else
+	{
+		// Solve point-to-point constraint
+		b2Vec2 Cdot = vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA);
+		b2Vec2 impulse = rc->mass.Solve22(-Cdot);
+
+		rc->impulse.x += impulse.x;
+		rc->impulse.y += impulse.y;
+
+		vA -= mA * impulse;
+		wA -= iA * b2Cross(rA, impulse);
+
+		vB += mB * impulse;
+		wB += iB * b2Cross(rB, impulse);
+	}
+
+	velocities[indexA].v = vA;
+	velocities[indexA].w = wA;
+	velocities[indexB].v = vB;
+	velocities[indexB].w = wB;
+}
+
+// Solve one distance joint, see b2DistanceJoint::SolveVelocityConstraints.
+static void b2SolveDistance(b2DistanceConstraint* dc, b2Velocity* velocities)
+{
+	int32 indexA = dc->indexA;
+	int32 indexB = dc->indexB;
+
+	b2Vec2 vA = velocities[indexA].v;
+	float32 wA = velocities[indexA].w;
+	b2Vec2 vB = velocities[indexB].v;
+	float32 wB = velocities[indexB].w;
+
+	b2Vec2 rA = dc->rA, rB = dc->rB;
+	b2Vec2 u = dc->u;
+
+	// Cdot = dot(u, v + cross(w, r))
+	b2Vec2 vpA = vA + b2Cross(wA, rA);
+	b2Vec2 vpB = vB + b2Cross(wB, rB);
+	float32 Cdot = b2Dot(u, vpB - vpA);
+
+	float32 impulse = -dc->mass * (Cdot + dc->bias + dc->gamma * dc->impulse);
+	dc->impulse += impulse;
+
+	b2Vec2 P = impulse * u;
+	vA -= dc->invMassA * P;
+	wA -= dc->invIA * b2Cross(rA, P);
+	vB += dc->invMassB * P;
+	wB += dc->invIB * b2Cross(rB, P);
+
+	velocities[indexA].v = vA;
+	velocities[indexA].w = wA;
+	velocities[indexB].v = vB;
+	velocities[indexB].w = wB;
+}
+
+// Solve the b2_simdWidth revolute joints of a batch, one per lane, with the
+// operations of b2SolveRevolute in the same order. Both sides of each branch
+// are computed and the lanes pick theirs.
+static void b2SolveRevoluteBatch(b2RevoluteBatch* b, b2Velocity* velocities)
+{
+	float32 vAx[b2_simdWidth], vAy[b2_simdWidth], wAs[b2_simdWidth];
+	float32 vBx[b2_simdWidth], vBy[b2_simdWidth], wBs[b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		const b2Velocity& velocityA = velocities[b->indexA[i]];
+		const b2Velocity& velocityB = velocities[b->indexB[i]];
+		vAx[i] = velocityA.v.x;
+		vAy[i] = velocityA.v.y;
+		wAs[i] = velocityA.w;
+		vBx[i] = velocityB.v.x;
+		vBy[i] = velocityB.v.y;
+		wBs[i] = velocityB.w;
+	}
+
+	b2Lanes zero = b2SplatLanes(0.0f);
+	b2Lanes minusOne = b2SplatLanes(-1.0f);
+
+	b2Lanes vAX = b2LoadLanes(vAx), vAY = b2LoadLanes(vAy), wA = b2LoadLanes(wAs);
+	b2Lanes vBX = b2LoadLanes(vBx), vBY = b2LoadLanes(vBy), wB = b2LoadLanes(wBs);
+
+	b2Lanes mA = b2LoadLanes(b->invMassA), mB = b2LoadLanes(b->invMassB);
+	b2Lanes iA = b2LoadLanes(b->invIA), iB = b2LoadLanes(b->invIB);
+	b2Lanes rAx = b2LoadLanes(b->rAx), rAy = b2LoadLanes(b->rAy);
+	b2Lanes rBx = b2LoadLanes(b->rBx), rBy = b2LoadLanes(b->rBy);
+
+	// Solve motor constraint.
+	{
+		b2Lanes active = b2LessLanes(zero, b2LoadLanes(b->motor));
+		b2Lanes Cdot = b2SubLanes(b2SubLanes(wB, wA), b2LoadLanes(b->motorSpeed));
+		b2Lanes impulse = b2MulLanes(b2MulLanes(minusOne, b2LoadLanes(b->motorMass)), Cdot);
+		b2Lanes oldImpulse = b2LoadLanes(b->motorImpulse);
+		b2Lanes maxImpulse = b2LoadLanes(b->maxMotorImpulse);
+		b2Lanes motorImpulse = b2MaxLanes(b2MulLanes(minusOne, maxImpulse), b2MinLanes(b2AddLanes(oldImpulse, impulse), maxImpulse));
+		impulse = b2SubLanes(motorImpulse, oldImpulse);
+
+		wA = b2SelectLanes(active, b2SubLanes(wA, b2MulLanes(iA, impulse)), wA);
+		wB = b2SelectLanes(active, b2AddLanes(wB, b2MulLanes(iB, impulse)), wB);
+		b2StoreLanes(b->motorImpulse, b2SelectLanes(active, motorImpulse, oldImpulse));
+	}
+
+	b2Lanes k11 = b2LoadLanes(b->k11), k12 = b2LoadLanes(b->k12), k13 = b2LoadLanes(b->k13);
+	b2Lanes k22 = b2LoadLanes(b->k22), k23 = b2LoadLanes(b->k23), k33 = b2LoadLanes(b->k33);
+	b2Lanes det22 = b2LoadLanes(b->det22);
+
+	b2Lanes impulseX = b2LoadLanes(b->impulseX);
+	b2Lanes impulseY = b2LoadLanes(b->impulseY);
+	b2Lanes impulseZ = b2LoadLanes(b->impulseZ);
+
+	// Cdot1 = vB + cross(wB, rB) - vA - cross(wA, rA)
+	b2Lanes Cdot1x = b2AddLanes(b2SubLanes(b2SubLanes(vBX, b2MulLanes(wB, rBy)), vAX), b2MulLanes(wA, rAy));
+	b2Lanes Cdot1y = b2SubLanes(b2SubLanes(b2AddLanes(vBY, b2MulLanes(wB, rBx)), vAY), b2MulLanes(wA, rAx));
+	b2Lanes Cdot2 = b2SubLanes(wB, wA);
+
+	// Solve limit constraint.
+	b2Lanes limitImpulseX, limitImpulseY, limitImpulseZ;
+	b2Lanes limitVAX, limitVAY, limitWA, limitVBX, limitVBY, limitWB;
+	{
+		// impulse = -K.Solve33(Cdot)
+		b2Lanes det33 = b2LoadLanes(b->det33);
+		b2Lanes dx = b2AddLanes(b2AddLanes(b2MulLanes(Cdot1x, b2LoadLanes(b->cx)), b2MulLanes(Cdot1y, b2LoadLanes(b->cy))), b2MulLanes(Cdot2, b2LoadLanes(b->cz)));
+		b2Lanes ux = b2SubLanes(b2MulLanes(Cdot1y, k33), b2MulLanes(Cdot2, k23));
+		b2Lanes uy = b2SubLanes(b2MulLanes(Cdot2, k13), b2MulLanes(Cdot1x, k33));
+		b2Lanes uz = b2SubLanes(b2MulLanes(Cdot1x, k23), b2MulLanes(Cdot1y, k13));
+		b2Lanes dy = b2AddLanes(b2AddLanes(b2MulLanes(k11, ux), b2MulLanes(k12, uy)), b2MulLanes(k13, uz));
+		b2Lanes tx = b2SubLanes(b2MulLanes(k22, Cdot2), b2MulLanes(k23, Cdot1y));
+		b2Lanes ty = b2SubLanes(b2MulLanes(k23, Cdot1x), b2MulLanes(k12, Cdot2));
+		b2Lanes tz = b2SubLanes(b2MulLanes(k12, Cdot1y), b2MulLanes(k22, Cdot1x));
+		b2Lanes dz = b2AddLanes(b2AddLanes(b2MulLanes(k11, tx), b2MulLanes(k12, ty)), b2MulLanes(k13, tz));
+		b2Lanes Ix = b2MulLanes(minusOne, b2MulLanes(det33, dx));
+		b2Lanes Iy = b2MulLanes(minusOne, b2MulLanes(det33, dy));
+		b2Lanes Iz = b2MulLanes(minusOne, b2MulLanes(det33, dz));
+
+		// At a lower or upper limit the accumulated limit impulse may not
+		// change sign. Then the limit impulse is removed and the point
+		// constraint is solved alone: rhs = -Cdot1 + impulse.z * (ez.x, ez.y).
+		b2Lanes newImpulse = b2AddLanes(impulseZ, Iz);
+		b2Lanes atLower = b2AndLanes(b2LessLanes(zero, b2LoadLanes(b->lower)), b2LessLanes(newImpulse, zero));
+		b2Lanes atUpper = b2AndLanes(b2LessLanes(zero, b2LoadLanes(b->upper)), b2LessLanes(zero, newImpulse));
+		b2Lanes reduce = b2OrLanes(atLower, atUpper);
+
+		b2Lanes rhsX = b2AddLanes(b2MulLanes(minusOne, Cdot1x), b2MulLanes(impulseZ, k13));
+		b2Lanes rhsY = b2AddLanes(b2MulLanes(minusOne, Cdot1y), b2MulLanes(impulseZ, k23));
+		b2Lanes reducedX = b2MulLanes(det22, b2SubLanes(b2MulLanes(k22, rhsX), b2MulLanes(k12, rhsY)));
+		b2Lanes reducedY = b2MulLanes(det22, b2SubLanes(b2MulLanes(k11, rhsY), b2MulLanes(k12, rhsX)));
+
+		limitImpulseX = b2SelectLanes(reduce, b2AddLanes(impulseX, reducedX), b2AddLanes(impulseX, Ix));
+		limitImpulseY = b2SelectLanes(reduce, b2AddLanes(impulseY, reducedY), b2AddLanes(impulseY, Iy));
+		limitImpulseZ = b2SelectLanes(reduce, zero, newImpulse);
+		Ix = b2SelectLanes(reduce, reducedX, Ix);
+		Iy = b2SelectLanes(reduce, reducedY, Iy);
+		Iz = b2SelectLanes(reduce, b2MulLanes(minusOne, impulseZ), Iz);
+
+		b2Lanes crossA = b2SubLanes(b2MulLanes(rAx, Iy), b2MulLanes(rAy, Ix));
+		b2Lanes crossB = b2SubLanes(b2MulLanes(rBx, Iy), b2MulLanes(rBy, Ix));
+
+		limitVAX = b2SubLanes(vAX, b2MulLanes(mA, Ix));
+		limitVAY = b2SubLanes(vAY, b2MulLanes(mA, Iy));
+		limitWA = b2SubLanes(wA, b2MulLanes(iA, b2AddLanes(crossA, Iz)));
+
+		limitVBX = b2AddLanes(vBX, b2MulLanes(mB, Ix));
+		limitVBY = b2AddLanes(vBY, b2MulLanes(mB, Iy));
+		limitWB = b2AddLanes(wB, b2MulLanes(iB, b2AddLanes(crossB, Iz)));
+	}
+
+	// Solve point-to-point constraint: impulse = K.Solve22(-Cdot1)
+	{
+		b2Lanes bx = b2MulLanes(minusOne, Cdot1x);
+		b2Lanes by = b2MulLanes(minusOne, Cdot1y);
+		b2Lanes Ix = b2MulLanes(det22, b2SubLanes(b2MulLanes(k22, bx), b2MulLanes(k12, by)));
+		b2Lanes Iy = b2MulLanes(det22, b2SubLanes(b2MulLanes(k11, by), b2MulLanes(k12, bx)));
+
+		b2Lanes crossA = b2SubLanes(b2MulLanes(rAx, Iy), b2MulLanes(rAy, Ix));
+		b2Lanes crossB = b2SubLanes(b2MulLanes(rBx, Iy), b2MulLanes(rBy, Ix));
+
+		b2Lanes limit = b2LessLanes(zero, b2LoadLanes(b->limit));
+		b2StoreLanes(b->impulseX, b2SelectLanes(limit, limitImpulseX, b2AddLanes(impulseX, Ix)));
+		b2StoreLanes(b->impulseY, b2SelectLanes(limit, limitImpulseY, b2AddLanes(impulseY, Iy)));
+		b2StoreLanes(b->impulseZ, b2SelectLanes(limit, limitImpulseZ, impulseZ));
+
+		vAX = b2SelectLanes(limit, limitVAX, b2SubLanes(vAX, b2MulLanes(mA, Ix)));
+		vAY = b2SelectLanes(limit, limitVAY, b2SubLanes(vAY, b2MulLanes(mA, Iy)));
+		wA = b2SelectLanes(limit, limitWA, b2SubLanes(wA, b2MulLanes(iA, crossA)));
+
+		vBX = b2SelectLanes(limit, limitVBX, b2AddLanes(vBX, b2MulLanes(mB, Ix)));
+		vBY = b2SelectLanes(limit, limitVBY, b2AddLanes(vBY, b2MulLanes(mB, Iy)));
+		wB = b2SelectLanes(limit, limitWB, b2AddLanes(wB, b2MulLanes(iB, crossB)));
+	}
+
+	b2StoreLanes(vAx, vAX);
+	b2StoreLanes(vAy, vAY);
+	b2StoreLanes(wAs, wA);
+	b2StoreLanes(vBx, vBX);
+	b2StoreLanes(vBy, vBY);
+	b2StoreLanes(wBs, wB);
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		b2Velocity& velocityA = velocities[b->indexA[i]];
+		velocityA.v.Set(vAx[i], vAy[i]);
+		velocityA.w = wAs[i];
+	}
+
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		b2Velocity& velocityB = velocities[b->indexB[i]];
+		velocityB.v.Set(vBx[i], vBy[i]);
+		velocityB.w = wBs[i];
+	}
+}
+
+// Solve the b2_simdWidth distance joints of a batch, see b2SolveDistance.
+static void b2SolveDistanceBatch(b2DistanceBatch* b, b2Velocity* velocities)
+{
+	float32 vAx[b2_simdWidth], vAy[b2_simdWidth], wAs[b2_simdWidth];
+	float32 vBx[b2_simdWidth], vBy[b2_simdWidth], wBs[b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		const b2Velocity& velocityA = velocities[b->indexA[i]];
+		const b2Velocity& velocityB = velocities[b->indexB[i]];
+		vAx[i] = velocityA.v.x;
+		vAy[i] = velocityA.v.y;
+		wAs[i] = velocityA.w;
+		vBx[i] = velocityB.v.x;
+		vBy[i] = velocityB.v.y;
+		wBs[i] = velocityB.w;
+	}
+
+	b2Lanes vAX = b2LoadLanes(vAx), vAY = b2LoadLanes(vAy), wA = b2LoadLanes(wAs);
+	b2Lanes vBX = b2LoadLanes(vBx), vBY = b2LoadLanes(vBy), wB = b2LoadLanes(wBs);
+
+	b2Lanes rAx = b2LoadLanes(b->rAx), rAy = b2LoadLanes(b->rAy);
+	b2Lanes rBx = b2LoadLanes(b->rBx), rBy = b2LoadLanes(b->rBy);
+	b2Lanes ux = b2LoadLanes(b->ux), uy = b2LoadLanes(b->uy);
+
+	// Cdot = dot(u, v + cross(w, r))
+	b2Lanes vpAx = b2SubLanes(vAX, b2MulLanes(wA, rAy));
+	b2Lanes vpAy = b2AddLanes(vAY, b2MulLanes(wA, rAx));
+	b2Lanes vpBx = b2SubLanes(vBX, b2MulLanes(wB, rBy));
+	b2Lanes vpBy = b2AddLanes(vBY, b2MulLanes(wB, rBx));
+	b2Lanes Cdot = b2AddLanes(b2MulLanes(ux, b2SubLanes(vpBx, vpAx)), b2MulLanes(uy, b2SubLanes(vpBy, vpAy)));
+
+	b2Lanes accumulated = b2LoadLanes(b->impulse);
+	b2Lanes mass = b2MulLanes(b2SplatLanes(-1.0f), b2LoadLanes(b->mass));
+	b2Lanes impulse = b2MulLanes(mass, b2AddLanes(b2AddLanes(Cdot, b2LoadLanes(b->bias)), b2MulLanes(b2LoadLanes(b->gamma), accumulated)));
+	b2StoreLanes(b->impulse, b2AddLanes(accumulated, impulse));
+
+	b2Lanes Px = b2MulLanes(impulse, ux);
+	b2Lanes Py = b2MulLanes(impulse, uy);
+	b2Lanes crossA = b2SubLanes(b2MulLanes(rAx, Py), b2MulLanes(rAy, Px));
+	b2Lanes crossB = b2SubLanes(b2MulLanes(rBx, Py), b2MulLanes(rBy, Px));
+
+	b2Lanes mA = b2LoadLanes(b->invMassA), mB = b2LoadLanes(b->invMassB);
+	b2Lanes iA = b2LoadLanes(b->invIA), iB = b2LoadLanes(b->invIB);
+	b2StoreLanes(vAx, b2SubLanes(vAX, b2MulLanes(mA, Px)));
+	b2StoreLanes(vAy, b2SubLanes(vAY, b2MulLanes(mA, Py)));
+	b2StoreLanes(wAs, b2SubLanes(wA, b2MulLanes(iA, crossA)));
+	b2StoreLanes(vBx, b2AddLanes(vBX, b2MulLanes(mB, Px)));
+	b2StoreLanes(vBy, b2AddLanes(vBY, b2MulLanes(mB, Py)));
+	b2StoreLanes(wBs, b2AddLanes(wB, b2MulLanes(iB, crossB)));
+
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		b2Velocity& velocityA = velocities[b->indexA[i]];
+		velocityA.v.Set(vAx[i], vAy[i]);
+		velocityA.w = wAs[i];
+	}
+
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		b2Velocity& velocityB = velocities[b->indexB[i]];
+		velocityB.v.Set(vBx[i], vBy[i]);
+		velocityB.w = wBs[i];
+	}
+}
+
+void b2JointSolver::SolveRevoluteVelocity()
+{
+	float32 dt = m_step.dt;
+
+	b2RevoluteBatch* batch = m_revoluteBatches;
+	for (int32 i = 0; i < m_revoluteColorCount; ++i)
+	{
+		int32 j = m_revoluteColorStarts[i];
+		int32 end = m_revoluteColorStarts[i + 1];
+		for (; j + b2_simdWidth <= end; j += b2_simdWidth)
+		{
+			b2SolveRevoluteBatch(batch++, m_velocities);
+		}
+
+		for (; j < end; ++j)
+		{
+			b2SolveRevolute(m_revolutes + j, m_velocities, dt);
+		}
+	}
+}
+
+void b2JointSolver::SolveDistanceVelocity()
+{
+	b2DistanceBatch* batch = m_distanceBatches;
+	for (int32 i = 0; i < m_distanceColorCount; ++i)
+	{
+		int32 j = m_distanceColorStarts[i];
+		int32 end = m_distanceColorStarts[i + 1];
+		for (; j + b2_simdWidth <= end; j += b2_simdWidth)
+		{
+			b2SolveDistanceBatch(batch++, m_velocities);
+		}
+
+		for (; j < end; ++j)
+		{
+			b2SolveDistance(m_distances + j, m_velocities);
+		}
+	}
+}
+
+void b2JointSolver::SolvePrismaticVelocity()
+{
+	float32 dt = m_step.dt;
+
+	for (int32 i = 0; i < m_prismaticCount; ++i)
+	{
+		b2PrismaticConstraint* pc = m_prismatics + i;
+
+		int32 indexA = pc->indexA;
+		int32 indexB = pc->indexB;
+
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		float32 mA = pc->invMassA, mB = pc->invMassB;
+		float32 iA = pc->invIA, iB = pc->invIB;
+		b2Vec2 axis = pc->axis, perp = pc->perp;
+		float32 s1 = pc->s1, s2 = pc->s2;
+		float32 a1 = pc->a1, a2 = pc->a2;
+
+		// Solve linear motor constraint.
+		if (pc->enableMotor && pc->limitState != e_equalLimits)
+		{
+			float32 Cdot = b2Dot(axis, vB - vA) + a2 * wB - a1 * wA;
+			float32 impulse = pc->motorMass * (pc->motorSpeed - Cdot);
+			float32 oldImpulse = pc->motorImpulse;
+			float32 maxImpulse = dt * pc->maxMotorForce;
+			pc->motorImpulse = b2Clamp(pc->motorImpulse + impulse, -maxImpulse, maxImpulse);
+			impulse = pc->motorImpulse - oldImpulse;
+
+			b2Vec2 P = impulse * axis;
+			float32 LA = impulse * a1;
+			float32 LB = impulse * a2;
+
+			vA -= mA * P;
+			wA -= iA * LA;
+
+			vB += mB * P;
+			wB += iB * LB;
+		}
+
+		b2Vec2 Cdot1;
+		Cdot1.x = b2Dot(perp, vB - vA) + s2 * wB - s1 * wA;
+		Cdot1.y = wB - wA;
+
+		if (pc->enableLimit && pc->limitState != e_inactiveLimit)
+		{
+			// Solve prismatic and limit constraint in block form.
+			float32 Cdot2;
+			Cdot2 = b2Dot(axis, vB - vA) + a2 * wB - a1 * wA;
+			b2Vec3 Cdot(Cdot1.x, Cdot1.y, Cdot2);
+
+			b2Vec3 f1 = pc->impulse;
+			b2Vec3 df = pc->K.Solve33(-Cdot);
+			pc->impulse += df;
+
+			if (pc->limitState == e_atLowerLimit)
+			{
+				pc->impulse.z = b2Max(pc->impulse.z, 0.0f);
+			}
+			else if (pc->limitState == e_atUpperLimit)
+			{
+				pc->impulse.z = b2Min(pc->impulse.z, 0.0f);
+			}
+
+			// f2(1:2) = invK(1:2,1:2) * (-Cdot(1:2) - K(1:2,3) * (f2(3) - f1(3))) + f1(1:2)
+			b2Vec2 b = -Cdot1 - (pc->impulse.z - f1.z) * b2Vec2(pc->K.ez.x, pc->K.ez.y);
+			b2Vec2 f2r = pc->K.Solve22(b) + b2Vec2(f1.x, f1.y);
+			pc->impulse.x = f2r.x;
+			pc->impulse.y = f2r.y;
+
+			df = pc->impulse - f1;
+
+			b2Vec2 P = df.x * perp + df.z * axis;
+			float32 LA = df.x * s1 + df.y + df.z * a1;
+			float32 LB = df.x * s2 + df.y + df.z * a2;
+
+			vA -= mA * P;
+			wA -= iA * LA;
+
+			vB += mB * P;
+			wB += iB * LB;
+		}
+		else
+		{
+			// Limit is inactive, just solve the prismatic constraint in block form.
+			b2Vec2 df = pc->K.Solve22(-Cdot1);
+			pc->impulse.x += df.x;
+			pc->impulse.y += df.y;
+
+			b2Vec2 P = df.x * perp;
+			float32 LA = df.x * s1 + df.y;
+			float32 LB = df.x * s2 + df.y;
+
+			vA -= mA * P;
+			wA -= iA * LA;
+
+			vB += mB * P;
+			wB += iB * LB;
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+}
+
+bool b2JointSolver::SolveRevolutePosition()
+{
+	bool okay = true;
+
+	for (int32 i = 0; i < m_revoluteCount; ++i)
+	{
+		const b2RevoluteConstraint* rc = m_revolutes + i;
+
+		int32 indexA = rc->indexA;
+		int32 indexB = rc->indexB;
+
+		b2Vec2 cA = m_positions[indexA].c;
+		float32 aA = m_positions[indexA].a;
+		b2Vec2 cB = m_positions[indexB].c;
+		float32 aB = m_positions[indexB].a;
+
+		float32 mA = rc->invMassA, mB = rc->invMassB;
+		float32 iA = rc->invIA, iB = rc->invIB;
+
+		float32 angularError = 0.0f;
+		float32 positionError = 0.0f;
+
+		bool fixedRotation = (iA + iB == 0.0f);
+
+		// Solve angular limit constraint.
+		if (rc->enableLimit && rc->limitState != e_inactiveLimit && fixedRotation == false)
+		{
+			float32 angle = aB - aA - rc->referenceAngle;
+			float32 limitImpulse = 0.0f;
+
+			if (rc->limitState == e_equalLimits)
+			{
+				// Prevent large angular corrections
+				float32 C = b2Clamp(angle - rc->lowerAngle, -b2_maxAngularCorrection, b2_maxAngularCorrection);
+				limitImpulse = -rc->motorMass * C;
+				angularError = b2Abs(C);
+			}
+			else if (rc->limitState == e_atLowerLimit)
+			{
+				float32 C = angle - rc->lowerAngle;
+				angularError = -C;
+
+				// Prevent large angular corrections and allow some slop.
+				C = b2Clamp(C + b2_angularSlop, -b2_maxAngularCorrection, 0.0f);
+				limitImpulse = -rc->motorMass * C;
+			}
+			else if (rc->limitState == e_atUpperLimit)
+			{
+				float32 C = angle - rc->upperAngle;
+				angularError = C;
+
+				// Prevent large angular corrections and allow some slop.
+				C = b2Clamp(C - b2_angularSlop, 0.0f, b2_maxAngularCorrection);
+				limitImpulse = -rc->motorMass * C;
+			}
+
+			aA -= iA * limitImpulse;
+			aB += iB * limitImpulse;
+		}
+
+		// Solve point-to-point constraint.
+		{
+			b2Rot qA(aA), qB(aB);
+			b2Vec2 rA = b2Mul(qA, rc->localOffsetA);
+			b2Vec2 rB = b2Mul(qB, rc->localOffsetB);
+
+			b2Vec2 C = cB + rB - cA - rA;
+			positionError = C.Length();
+
+			b2Mat22 K;
+			K.ex.x = mA + mB + iA * rA.y * rA.y + iB * rB.y * rB.y;
+			K.ex.y = -iA * rA.x * rA.y - iB * rB.x * rB.y;
+			K.ey.x = K.ex.y;
+			K.ey.y = mA + mB + iA * rA.x * rA.x + iB * rB.x * rB.x;
+
+			b2Vec2 impulse = -K.Solve(C);
+
+			cA -= mA * impulse;
+			aA -= iA * b2Cross(rA, impulse);
+
+			cB += mB * impulse;
+			aB += iB * b2Cross(rB, impulse);
+		}
+
+		m_positions[indexA].c = cA;
+		m_positions[indexA].a = aA;
+		m_positions[indexB].c = cB;
+		m_positions[indexB].a = aB;
+
+		okay = okay && positionError <= b2_linearSlop && angularError <= b2_angularSlop;
+	}
+
+	return okay;
+}
+
+bool b2JointSolver::SolveDistancePosition()
+{
+	bool okay = true;
+
+	for (int32 i = 0; i < m_distanceCount; ++i)
+	{
+		const b2DistanceConstraint* dc = m_distances + i;
+
+		if (dc->frequencyHz > 0.0f)
+		{
+			// There is no position correction for soft distance constraints.
+			continue;
+		}
+
+		int32 indexA = dc->indexA;
+		int32 indexB = dc->indexB;
+
+		b2Vec2 cA = m_positions[indexA].c;
+		float32 aA = m_positions[indexA].a;
+		b2Vec2 cB = m_positions[indexB].c;
+		float32 aB = m_positions[indexB].a;
+
+		b2Rot qA(aA), qB(aB);
+
+		b2Vec2 rA = b2Mul(qA, dc->localOffsetA);
+		b2Vec2 rB = b2Mul(qB, dc->localOffsetB);
+		b2Vec2 u = cB + rB - cA - rA;
+
+		float32 length = u.Normalize();
+		float32 C = length - dc->length;
+		C = b2Clamp(C, -b2_maxLinearCorrection, b2_maxLinearCorrection);
+
+		float32 impulse = -dc->mass * C;
+		b2Vec2 P = impulse * u;
+
+		cA -= dc->invMassA * P;
+		aA -= dc->invIA * b2Cross(rA, P);
+		cB += dc->invMassB * P;
+		aB += dc->invIB * b2Cross(rB, P);
+
+		m_positions[indexA].c = cA;
+		m_positions[indexA].a = aA;
+		m_positions[indexB].c = cB;
+		m_positions[indexB].a = aB;
+
+		okay = okay && b2Abs(C) < b2_linearSlop;
+	}
+
+	return okay;
+}
+
+bool b2JointSolver::SolvePrismaticPosition()
+{
+	bool okay = true;
+
+	for (int32 i = 0; i < m_prismaticCount; ++i)
+	{
+		const b2PrismaticConstraint* pc = m_prismatics + i;
+
+		int32 indexA = pc->indexA;
+		int32 indexB = pc->indexB;
+
+		b2Vec2 cA = m_positions[indexA].c;
+		float32 aA = m_positions[indexA].a;
+		b2Vec2 cB = m_positions[indexB].c;
+		float32 aB = m_positions[indexB].a;
+
+		b2Rot qA(aA), qB(aB);
+
+		float32 mA = pc->invMassA, mB = pc->invMassB;
+		float32 iA = pc->invIA, iB = pc->invIB;
+
+		// Compute fresh Jacobians
+		b2Vec2 rA = b2Mul(qA, pc->localOffsetA);
+		b2Vec2 rB = b2Mul(qB, pc->localOffsetB);
+		b2Vec2 d = cB + rB - cA - rA;
+
+		b2Vec2 axis = b2Mul(qA, pc->localXAxisA);
+		float32 a1 = b2Cross(d + rA, axis);
+		float32 a2 = b2Cross(rB, axis);
+		b2Vec2 perp = b2Mul(qA, pc->localYAxisA);
+
+		float32 s1 = b2Cross(d + rA, perp);
+		float32 s2 = b2Cross(rB, perp);
+
+		b2Vec3 impulse;
+		b2Vec2 C1;
+		C1.x = b2Dot(perp, d);
+		C1.y = aB - aA - pc->referenceAngle;
+
+		float32 linearError = b2Abs(C1.x);
+		float32 angularError = b2Abs(C1.y);
+
+		bool active = false;
+		float32 C2 = 0.0f;
+		if (pc->enableLimit)
+		{
+			float32 translation = b2Dot(axis, d);
+			if (b2Abs(pc->upperTranslation - pc->lowerTranslation) < 2.0f * b2_linearSlop)
+			{
+				// Prevent large angular corrections
+				C2 = b2Clamp(translation, -b2_maxLinearCorrection, b2_maxLinearCorrection);
+				linearError = b2Max(linearError, b2Abs(translation));
+				active = true;
+			}
+			else if (translation <= pc->lowerTranslation)
+			{
+				// Prevent large linear corrections and allow some slop.
+				C2 = b2Clamp(translation - pc->lowerTranslation + b2_linearSlop, -b2_maxLinearCorrection, 0.0f);
+				linearError = b2Max(linearError, pc->lowerTranslation - translation);
+				active = true;
+			}
+			else if (translation >= pc->upperTranslation)
+			{
+				// Prevent large linear corrections and allow some slop.
+				C2 = b2Clamp(translation - pc->upperTranslation - b2_linearSlop, 0.0f, b2_maxLinearCorrection);
+				linearError = b2Max(linearError, translation - pc->upperTranslation);
+				active = true;
+			}
+		}
+
+		if (active)
+		{
+			float32 k11 = mA + mB + iA * s1 * s1 + iB * s2 * s2;
+			float32 k12 = iA * s1 + iB * s2;
+			float32 k13 = iA * s1 * a1 + iB * s2 * a2;
+			float32 k22 = iA + iB;
+			if (k22 == 0.0f)
+			{
+				// For fixed rotation
+				k22 = 1.0f;
+			}
+			float32 k23 = iA * a1 + iB * a2;
+			float32 k33 = mA + mB + iA * a1 * a1 + iB * a2 * a2;
+
+			b2Mat33 K;
+			K.ex.Set(k11, k12, k13);
+			K.ey.Set(k12, k22, k23);
+			K.ez.Set(k13, k23, k33);
+
+			b2Vec3 C;
+			C.x = C1.x;
+			C.y = C1.y;
+			C.z = C2;
+
+			impulse = K.Solve33(-C);
+		}
+		else
+		{
+			float32 k11 = mA + mB + iA * s1 * s1 + iB * s2 * s2;
+			float32 k12 = iA * s1 + iB * s2;
+			float32 k22 = iA + iB;
+			if (k22 == 0.0f)
+			{
+				k22 = 1.0f;
+			}
+
+			b2Mat22 K;
+			K.ex.Set(k11, k12);
+			K.ey.Set(k12, k22);
+
+			b2Vec2 impulse1 = K.Solve(-C1);
+			impulse.x = impulse1.x;
+			impulse.y = impulse1.y;
+			impulse.z = 0.0f;
+		}
+
+		b2Vec2 P = impulse.x * perp + impulse.z * axis;
+		float32 LA = impulse.x * s1 + impulse.y + impulse.z * a1;
+		float32 LB = impulse.x * s2 + impulse.y + impulse.z * a2;
+
+		cA -= mA * P;
+		aA -= iA * LA;
+		cB += mB * P;
+		aB += iB * LB;
+
+		m_positions[indexA].c = cA;
+		m_positions[indexA].a = aA;
+		m_positions[indexB].c = cB;
+		m_positions[indexB].a = aB;
+
+		okay = okay && linearError <= b2_linearSlop && angularError <= b2_angularSlop;
+	}
+
+	return okay;
+}
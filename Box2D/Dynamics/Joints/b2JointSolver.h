@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_JOINT_SOLVER_H
+#define B2_JOINT_SOLVER_H
+
+#include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Simd.h>
+
+class b2StackAllocator;
+
+// The solver state of a revolute joint, see b2RevoluteJoint.
+struct b2RevoluteConstraint
+{
+	b2Mat33 mass;
+	b2Vec2 rA;
+	b2Vec2 rB;
+	b2Vec2 localOffsetA;	// local anchor minus local center
+	b2Vec2 localOffsetB;
+	b2Vec3 impulse;
+	float32 motorImpulse;
+	float32 motorMass;
+	float32 motorSpeed;
+	float32 maxMotorTorque;
+	float32 referenceAngle;
+	float32 lowerAngle;
+	float32 upperAngle;
+	float32 invMassA, invMassB;
+	float32 invIA, invIB;
+	int32 indexA;
+	int32 indexB;
+	b2LimitState limitState;
+	bool enableMotor;
+	bool enableLimit;
+};
+
+// The solver state of a distance joint, see b2DistanceJoint.
+struct b2DistanceConstraint
+{
+	b2Vec2 u;
+	b2Vec2 rA;
+	b2Vec2 rB;
+	b2Vec2 localOffsetA;
+	b2Vec2 localOffsetB;
+	float32 impulse;
+	float32 mass;
+	float32 gamma;
+	float32 bias;
+	float32 length;
+	float32 frequencyHz;
+	float32 dampingRatio;
+	float32 invMassA, invMassB;
+	float32 invIA, invIB;
+	int32 indexA;
+	int32 indexB;
+};
+
+// The solver state of a prismatic joint, see b2PrismaticJoint.
+struct b2PrismaticConstraint
+{
+	b2Mat33 K;
+	b2Vec2 axis, perp;
+	b2Vec2 localOffsetA;
+	b2Vec2 localOffsetB;
+	b2Vec2 localXAxisA;
+	b2Vec2 localYAxisA;
+	b2Vec3 impulse;
+	float32 s1, s2;
+	float32 a1, a2;
+	float32 motorImpulse;
+	float32 motorMass;
+	float32 motorSpeed;
+	float32 maxMotorForce;
+	float32 referenceAngle;
+	float32 lowerTranslation;
+	float32 upperTranslation;
+	float32 invMassA, invMassB;
+	float32 invIA, invIB;
+	int32 indexA;
+	int32 indexB;
+	b2LimitState limitState;
+	bool enableMotor;
+	bool enableLimit;
+};
+
+// b2_simdWidth revolute joints of the same color, one per lane. Flags are 1 or 0.
+struct b2RevoluteBatch
+{
+	int32 indexA[b2_simdWidth];
+	int32 indexB[b2_simdWidth];
+	float32 rAx[b2_simdWidth], rAy[b2_simdWidth];
+	float32 rBx[b2_simdWidth], rBy[b2_simdWidth];
+	float32 invMassA[b2_simdWidth], invMassB[b2_simdWidth];
+	float32 invIA[b2_simdWidth], invIB[b2_simdWidth];
+
+	// The symmetric effective mass and the parts of its solves that only
+	// depend on it: cross(ey, ez) and the inverse determinants.
+	float32 k11[b2_simdWidth], k12[b2_simdWidth], k13[b2_simdWidth];
+	float32 k22[b2_simdWidth], k23[b2_simdWidth], k33[b2_simdWidth];
+	float32 cx[b2_simdWidth], cy[b2_simdWidth], cz[b2_simdWidth];
+	float32 det33[b2_simdWidth], det22[b2_simdWidth];
+
+	float32 impulseX[b2_simdWidth], impulseY[b2_simdWidth], impulseZ[b2_simdWidth];
+	float32 motorImpulse[b2_simdWidth];
+	float32 motorMass[b2_simdWidth];
+	float32 motorSpeed[b2_simdWidth];
+	float32 maxMotorImpulse[b2_simdWidth];
+	float32 motor[b2_simdWidth];
+	float32 limit[b2_simdWidth];
+	float32 lower[b2_simdWidth];
+	float32 upper[b2_simdWidth];
+};
+
+// b2_simdWidth distance joints of the same color, one per lane.
+struct b2DistanceBatch
+{
+	int32 indexA[b2_simdWidth];
+	int32 indexB[b2_simdWidth];
+	float32 rAx[b2_simdWidth], rAy[b2_simdWidth];
+	float32 rBx[b2_simdWidth], rBy[b2_simdWidth];
+	float32 ux[b2_simdWidth], uy[b2_simdWidth];
+	float32 invMassA[b2_simdWidth], invMassB[b2_simdWidth];
+	float32 invIA[b2_simdWidth], invIB[b2_simdWidth];
+	float32 mass[b2_simdWidth];
+	float32 bias[b2_simdWidth];
+	float32 gamma[b2_simdWidth];
+	float32 impulse[b2_simdWidth];
+};
+
+struct b2JointSolverDef
+{
+	b2TimeStep step;
+	b2Joint** joints;
+	int32 count;
+	int32 bodyCount;
+	b2Position* positions;
+	b2Velocity* velocities;
+	b2StackAllocator* allocator;
+};
+
+/// Solves the joints of an island grouped by type. Revolute, distance and
+/// prismatic joints are copied into packed constraint arrays, one per type,
+/// and each array is swept by a kernel specialized for its type, without
+/// virtual calls. The other joint types go through the virtual functions of
+/// b2Joint.
+/// Revolute and distance joints are also colored: a joint gets the first color
+/// after the colors of the earlier joints of its type on the same dynamic body.
+/// Joints of a color share no dynamic body, so the velocity iterations solve
+/// them b2_simdWidth at a time, see b2Simd.h. Coloring never swaps two joints
+/// that share a body and the kernels do the same math as the joint classes, so
+/// an island with a single joint type is solved exactly as by the virtual path.
+/// This is an internal class.
+class b2JointSolver
+{
+public:
+	b2JointSolver(b2JointSolverDef* def);
+	~b2JointSolver();
+
+	/// Compute the effective masses and apply the warm starting impulses.
+	void InitializeVelocityConstraints();
+
+	void SolveVelocityConstraints();
+
+	/// Copy the impulses and limit states back to the joints.
+	void StoreImpulses();
+
+	/// This returns true if the position errors are within tolerance.
+	bool SolvePositionConstraints();
+
+private:
+	int32 ColorJoints(b2Joint** joints, int32 count, int32 bodyCount, int32* colorStarts);
+
+	void InitializeRevolute();
+	void InitializeDistance();
+	void InitializePrismatic();
+
+	void SolveRevoluteVelocity();
+	void SolveDistanceVelocity();
+	void SolvePrismaticVelocity();
+
+	bool SolveRevolutePosition();
+	bool SolveDistancePosition();
+	bool SolvePrismaticPosition();
+
+	b2TimeStep m_step;
+	b2Position* m_positions;
+	b2Velocity* m_velocities;
+	b2StackAllocator* m_allocator;
+
+	// Joints of each batched type, then the others, in island order.
+	b2Joint** m_joints;
+	int32 m_revoluteCount;
+	int32 m_distanceCount;
+	int32 m_prismaticCount;
+	int32 m_otherCount;
+
+	b2RevoluteConstraint* m_revolutes;
+	b2DistanceConstraint* m_distances;
+	b2PrismaticConstraint* m_prismatics;
+
+	// Constraints [colorStarts[i], colorStarts[i + 1]) have color i. The full
+	// lanes of each color are copied to the batches.
+	int32* m_revoluteColorStarts;
+	int32 m_revoluteColorCount;
+	b2RevoluteBatch* m_revoluteBatches;
+	int32 m_revoluteBatchCount;
+
+	int32* m_distanceColorStarts;
+	int32 m_distanceColorCount;
+	b2DistanceBatch* m_distanceBatches;
+	int32 m_distanceBatchCount;
+};
+
+#endif
@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Dynamics/b2Island.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
 
@@ -37,6 +38,10 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	{
 		m_flags |= e_bulletFlag;
 	}
+	if (bd->speculative)
+	{
+		m_flags |= e_speculativeFlag;
+	}
 	if (bd->fixedRotation)
 	{
 		m_flags |= e_fixedRotationFlag;
@@ -71,6 +76,14 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_prev = NULL;
 	m_next = NULL;
 
+	m_island = NULL;
+
+	m_region = bd->region;
+	m_regionIndex = -1;
+	m_poolIndex = b2_nullSlot;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+
 	m_linearVelocity = bd->linearVelocity;
 	m_angularVelocity = bd->angularVelocity;
 
@@ -133,7 +146,12 @@ void b2Body::SetType(b2BodyType type)
 		m_angularVelocity = 0.0f;
 		m_sweep.a0 = m_sweep.a;
 		m_sweep.c0 = m_sweep.c;
-		SynchronizeFixtures();
+
+		// Parked proxies are updated when they are unparked.
+		if (IsParked() == false)
+		{
+			SynchronizeFixtures();
+		}
 	}
 
 	SetAwake(true);
@@ -151,6 +169,18 @@ void b2Body::SetType(b2BodyType type)
 	}
 	m_contactList = NULL;
 
+	// Move the body between its island and the kinematic list.
+	m_world->RemoveFromSolver(this);
+	if (IsActive())
+	{
+		m_world->AddToSolver(this);
+	}
+
+	if (IsParked())
+	{
+		return;
+	}
+
 	// Touch the proxies so that new contacts will be created (when appropriate)
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -173,9 +203,11 @@ b2Fixture* b2Body::CreateFixture(const b2FixtureDef* def)
 
 	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
 
-	void* memory = allocator->Allocate(sizeof(b2Fixture));
+	int32 poolIndex;
+	void* memory = m_world->m_fixturePool.Allocate(&poolIndex);
 	b2Fixture* fixture = new (memory) b2Fixture;
 	fixture->Create(allocator, this, def);
+	fixture->m_poolIndex = poolIndex;
 
 	if (m_flags & e_activeFlag)
 	{
@@ -260,7 +292,9 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 
 	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
 
-	if (m_flags & e_activeFlag)
+	m_world->RemoveFromQueries(fixture, true);
+
+	if (m_flags & (e_activeFlag | e_parkedFlag))
 	{
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 		fixture->DestroyProxies(broadPhase);
@@ -269,8 +303,9 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 	fixture->Destroy(allocator);
 	fixture->m_body = NULL;
 	fixture->m_next = NULL;
+	int32 poolIndex = fixture->m_poolIndex;
 	fixture->~b2Fixture();
-	allocator->Free(fixture, sizeof(b2Fixture));
+	m_world->m_fixturePool.Free(poolIndex);
 
 	--m_fixtureCount;
 
@@ -431,6 +466,12 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 	m_sweep.c0 = m_sweep.c;
 	m_sweep.a0 = angle;
 
+	// Parked proxies are updated when they are unparked.
+	if (IsParked())
+	{
+		return;
+	}
+
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
@@ -438,13 +479,42 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 	}
 }
 
+void b2Body::WakeIsland()
+{
+	if (m_island && m_island->awake == false)
+	{
+		m_world->WakeIsland(m_island);
+	}
+}
+
 void b2Body::SynchronizeFixtures()
 {
+	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+
+	if ((m_flags & e_speculativeFlag) && m_type == b2_dynamicBody)
+	{
+		// Cover the motion of the next step so that speculative contacts
+		// exist before the shapes meet.
+		b2Vec2 translation = m_world->m_dt * m_linearVelocity;
+		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+		{
+			translation *= b2_maxTranslation / translation.Length();
+		}
+
+		b2Transform xf2 = m_xf;
+		xf2.p += translation;
+
+		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+		{
+			f->Synchronize(broadPhase, m_xf, xf2);
+		}
+		return;
+	}
+
 	b2Transform xf1;
 	xf1.q.Set(m_sweep.a0);
 	xf1.p = m_sweep.c0 - b2Mul(xf1.q, m_sweep.localCenter);
 
-	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
 		f->Synchronize(broadPhase, xf1, m_xf);
@@ -455,6 +525,33 @@ void b2Body::SetActive(bool flag)
 {
 	b2Assert(m_world->IsLocked() == false);
 
+	if (IsParked())
+	{
+		if (flag == false)
+		{
+			// Stay inactive when the region is unparked.
+			b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+			for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
+			{
+				f->DestroyProxies(broadPhase);
+			}
+
+			m_flags &= ~e_parkedFlag;
+
+			// Don't leave the contacts for the parked cleanup.
+			b2ContactEdge* ce = m_contactList;
+			while (ce)
+			{
+				b2ContactEdge* ce0 = ce;
+				ce = ce->next;
+				m_world->m_contactManager.Destroy(ce0->contact);
+			}
+			m_contactList = NULL;
+		}
+
+		return;
+	}
+
 	if (flag == IsActive())
 	{
 		return;
@@ -462,6 +559,13 @@ void b2Body::SetActive(bool flag)
 
 	if (flag)
 	{
+		if (m_world->IsRegionParked(m_region))
+		{
+			// The body becomes active when the region is unparked.
+			m_flags |= e_parkedFlag;
+			return;
+		}
+
 		m_flags |= e_activeFlag;
 
 		// Create all proxies.
@@ -471,6 +575,8 @@ void b2Body::SetActive(bool flag)
 			f->CreateProxies(broadPhase, m_xf);
 		}
 
+		m_world->AddToSolver(this);
+
 		// Contacts are created the next time step.
 	}
 	else
@@ -481,6 +587,7 @@ void b2Body::SetActive(bool flag)
 		b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 		for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 		{
+			m_world->RemoveFromQueries(f, false);
 			f->DestroyProxies(broadPhase);
 		}
 
@@ -493,6 +600,51 @@ void b2Body::SetActive(bool flag)
 			m_world->m_contactManager.Destroy(ce0->contact);
 		}
 		m_contactList = NULL;
+
+		m_world->RemoveFromSolver(this);
+	}
+}
+
+b2Vec2d b2Body::GetAbsolutePosition() const
+{
+	return m_world->GetRegionOrigin(m_region) + m_xf.p;
+}
+
+void b2Body::SetRegion(int32 region)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked() == true)
+	{
+		return;
+	}
+
+	if (region == m_region)
+	{
+		return;
+	}
+
+	b2Vec2d oldOrigin = m_world->GetRegionOrigin(m_region);
+
+	m_world->RemoveFromRegion(this);
+	m_region = region;
+	m_world->AddToRegion(this);
+
+	// Parked regions can have different origins.
+	b2Vec2 shift = b2Offset(m_world->GetRegionOrigin(region), oldOrigin);
+	if (shift.x != 0.0f || shift.y != 0.0f)
+	{
+		m_world->ShiftBody(this, shift);
+	}
+
+	bool park = m_world->IsRegionParked(region);
+	if (IsParked() && park == false)
+	{
+		b2Body* body = this;
+		m_world->UnparkBodies(&body, 1);
+	}
+	else if (IsActive() && park)
+	{
+		m_world->ParkBody(this);
 	}
 }
 
@@ -518,6 +670,14 @@ void b2Body::SetFixedRotation(bool flag)
 	ResetMassData();
 }
 
+b2BodyHandle b2Body::GetHandle() const
+{
+	b2BodyHandle handle;
+	handle.index = m_poolIndex;
+	handle.revision = m_world->m_bodyPool.GetRevision(m_poolIndex);
+	return handle;
+}
+
 void b2Body::Dump()
 {
 	int32 bodyIndex = m_islandIndex;
@@ -535,8 +695,10 @@ void b2Body::Dump()
 	b2Log("  bd.awake = bool(%d);\n", m_flags & e_awakeFlag);
 	b2Log("  bd.fixedRotation = bool(%d);\n", m_flags & e_fixedRotationFlag);
 	b2Log("  bd.bullet = bool(%d);\n", m_flags & e_bulletFlag);
+	b2Log("  bd.speculative = bool(%d);\n", m_flags & e_speculativeFlag);
 	b2Log("  bd.active = bool(%d);\n", m_flags & e_activeFlag);
 	b2Log("  bd.gravityScale = %.15lef;\n", m_gravityScale);
+	b2Log("  bd.region = %d;\n", m_region);
 	b2Log("  bodies[%d] = m_world->CreateBody(&bd);\n", m_islandIndex);
 	b2Log("\n");
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
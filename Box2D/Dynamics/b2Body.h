@@ -28,6 +28,7 @@ class b2Joint;
 class b2Contact;
 class b2Controller;
 class b2World;
+struct b2PersistentIsland;
 struct b2FixtureDef;
 struct b2JointEdge;
 struct b2ContactEdge;
@@ -46,6 +47,17 @@ enum b2BodyType
 	//b2_bulletBody,
 };
 
+/// The region of bodies that are never parked. See b2World::ParkRegion.
+const int32 b2_noRegion = -1;
+
+/// A checked reference to a body. Unlike a pointer it can still be resolved
+/// after the body is destroyed, b2World::GetBody then returns NULL.
+struct b2BodyHandle
+{
+	int32 index;
+	uint32 revision;
+};
+
 /// A body definition holds all the data needed to construct a rigid body.
 /// You can safely re-use body definitions. Shapes are added to a body after construction.
 struct b2BodyDef
@@ -64,9 +76,11 @@ struct b2BodyDef
 		awake = true;
 		fixedRotation = false;
 		bullet = false;
+		speculative = false;
 		type = b2_staticBody;
 		active = true;
 		gravityScale = 1.0f;
+		region = b2_noRegion;
 	}
 
 	/// The body type: static, kinematic, or dynamic.
@@ -112,6 +126,14 @@ struct b2BodyDef
 	/// @warning You should use this flag sparingly since it increases processing time.
 	bool bullet;
 
+	/// Use speculative contacts instead of time of impact sub-stepping to keep
+	/// this body from tunneling. Contacts are created ahead of the body's linear
+	/// motion and the solver only lets it close the gap, so this is cheaper than
+	/// a bullet for many fast bodies. Rotation is not predicted, and contact
+	/// callbacks may begin slightly before the shapes actually touch.
+	/// This setting is only considered on dynamic bodies.
+	bool speculative;
+
 	/// Does this body start out active?
 	bool active;
 
@@ -120,6 +142,10 @@ struct b2BodyDef
 
 	/// Scale the gravity applied to this body.
 	float32 gravityScale;
+
+	/// The streaming region of the body, e.g. the index of the level chunk
+	/// it belongs to. Region ids should be small and dense. See b2World::ParkRegion.
+	int32 region;
 };
 
 /// A rigid body. These are created via b2World::CreateBody.
@@ -168,6 +194,10 @@ public:
 	/// @return the world position of the body's origin.
 	const b2Vec2& GetPosition() const;
 
+	/// Get the position of the body's origin in double precision, including
+	/// all origin shifts of the world. Use this to track bodies in large worlds.
+	b2Vec2d GetAbsolutePosition() const;
+
 	/// Get the angle in radians.
 	/// @return the current world rotation angle in radians.
 	float32 GetAngle() const;
@@ -311,6 +341,12 @@ public:
 	/// Is this body treated like a bullet for continuous collision detection?
 	bool IsBullet() const;
 
+	/// Should this body use speculative contacts for continuous collision detection?
+	void SetSpeculative(bool flag);
+
+	/// Does this body use speculative contacts for continuous collision detection?
+	bool IsSpeculative() const;
+
 	/// You can disable sleeping on this body. If you disable sleeping, the
 	/// body will be woken.
 	void SetSleepingAllowed(bool flag);
@@ -345,6 +381,21 @@ public:
 	/// Get the active state of the body.
 	bool IsActive() const;
 
+	/// Is this body parked with its region? A parked body is inactive but
+	/// keeps its broad-phase proxies so it can be unparked quickly. Calling
+	/// SetActive(true) on a parked body has no effect, SetActive(false) keeps
+	/// it inactive when the region is unparked.
+	bool IsParked() const;
+
+	/// Get the streaming region of this body.
+	int32 GetRegion() const;
+
+	/// Move this body to another region. The body is parked or unparked
+	/// to match the new region. Its position is converted if the regions
+	/// have different origins, see b2World::GetRegionOrigin.
+	/// @warning This function is locked during callbacks.
+	void SetRegion(int32 region);
+
 	/// Set this body to have fixed rotation. This causes the mass
 	/// to be reset.
 	void SetFixedRotation(bool flag);
@@ -380,6 +431,9 @@ public:
 	b2World* GetWorld();
 	const b2World* GetWorld() const;
 
+	/// Get a handle to this body, see b2World::GetBody.
+	b2BodyHandle GetHandle() const;
+
 	/// Dump this body to a log file
 	void Dump();
 
@@ -389,6 +443,7 @@ private:
 	friend class b2Island;
 	friend class b2ContactManager;
 	friend class b2ContactSolver;
+	friend class b2JointSolver;
 	friend class b2Contact;
 	
 	friend class b2DistanceJoint;
@@ -412,7 +467,9 @@ private:
 		e_bulletFlag		= 0x0008,
 		e_fixedRotationFlag	= 0x0010,
 		e_activeFlag		= 0x0020,
-		e_toiFlag			= 0x0040
+		e_toiFlag			= 0x0040,
+		e_parkedFlag		= 0x0080,
+		e_speculativeFlag	= 0x0100
 	};
 
 	b2Body(const b2BodyDef* bd, b2World* world);
@@ -427,12 +484,29 @@ private:
 
 	void Advance(float32 t);
 
+	// Wake the persistent island this body belongs to.
+	void WakeIsland();
+
 	b2BodyType m_type;
 
 	uint16 m_flags;
 
 	int32 m_islandIndex;
 
+	// The region and the index in the region's body array.
+	int32 m_region;
+	int32 m_regionIndex;
+
+	// The slot in the world's body pool.
+	int32 m_poolIndex;
+
+	// The persistent island owning this body. NULL for static, kinematic and
+	// inactive bodies. Active kinematic bodies use the links for the world's
+	// kinematic list.
+	b2PersistentIsland* m_island;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
+
 	b2Transform m_xf;		// the body origin transform
 	b2Sweep m_sweep;		// the swept motion for CCD
 
@@ -630,6 +704,23 @@ inline bool b2Body::IsBullet() const
 	return (m_flags & e_bulletFlag) == e_bulletFlag;
 }
 
+inline void b2Body::SetSpeculative(bool flag)
+{
+	if (flag)
+	{
+		m_flags |= e_speculativeFlag;
+	}
+	else
+	{
+		m_flags &= ~e_speculativeFlag;
+	}
+}
+
+inline bool b2Body::IsSpeculative() const
+{
+	return (m_flags & e_speculativeFlag) == e_speculativeFlag;
+}
+
 inline void b2Body::SetAwake(bool flag)
 {
 	if (flag)
@@ -638,6 +729,7 @@ inline void b2Body::SetAwake(bool flag)
 		{
 			m_flags |= e_awakeFlag;
 			m_sleepTime = 0.0f;
+			WakeIsland();
 		}
 	}
 	else
@@ -661,6 +753,16 @@ inline bool b2Body::IsActive() const
 	return (m_flags & e_activeFlag) == e_activeFlag;
 }
 
+inline bool b2Body::IsParked() const
+{
+	return (m_flags & e_parkedFlag) == e_parkedFlag;
+}
+
+inline int32 b2Body::GetRegion() const
+{
+	return m_region;
+}
+
 inline bool b2Body::IsFixedRotation() const
 {
 	return (m_flags & e_fixedRotationFlag) == e_fixedRotationFlag;
@@ -19,13 +19,16 @@
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Common/b2Trace.h>
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
-b2ContactManager::b2ContactManager()
+b2ContactManager::b2ContactManager(b2Allocator* allocator)
+	: m_broadPhase(allocator)
 {
 	m_contactList = NULL;
 	m_contactCount = 0;
@@ -46,6 +49,12 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	// The island may now be split.
+	if (c->IsTouching())
+	{
+		bodyA->GetWorld()->UnlinkIslands(bodyA, bodyB);
+	}
+
 	// Remove from the world.
 	if (c->m_prev)
 	{
@@ -104,6 +113,8 @@ void b2ContactManager::Destroy(b2Contact* c)
 // contact list.
 void b2ContactManager::Collide()
 {
+	b2TraceScope("b2ContactManager::Collide");
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
@@ -114,7 +125,17 @@ void b2ContactManager::Collide()
 		int32 indexB = c->GetChildIndexB();
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
-		 
+
+		// Contacts of parked bodies are cleaned up here instead of when the
+		// region is parked.
+		if (bodyA->IsParked() || bodyB->IsParked())
+		{
+			b2Contact* cNuke = c;
+			c = cNuke->GetNext();
+			Destroy(cNuke);
+			continue;
+		}
+
 		// Is this contact flagged for filtering?
 		if (c->m_flags & b2Contact::e_filterFlag)
 		{
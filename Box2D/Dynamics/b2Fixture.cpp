@@ -34,6 +34,7 @@ b2Fixture::b2Fixture()
 	m_next = NULL;
 	m_proxies = NULL;
 	m_proxyCount = 0;
+	m_poolIndex = b2_nullSlot;
 	m_shape = NULL;
 	m_density = 0.0f;
 }
@@ -138,11 +139,20 @@ void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 
 void b2Fixture::DestroyProxies(b2BroadPhase* broadPhase)
 {
+	bool parked = m_body->IsParked();
+
 	// Destroy proxies in the broad-phase.
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
-		broadPhase->DestroyProxy(proxy->proxyId);
+		if (parked)
+		{
+			broadPhase->DestroyParkedProxy(proxy->proxyId);
+		}
+		else
+		{
+			broadPhase->DestroyProxy(proxy->proxyId);
+		}
 		proxy->proxyId = b2BroadPhase::e_nullProxy;
 	}
 
@@ -204,7 +214,7 @@ void b2Fixture::Refilter()
 
 	b2World* world = m_body->GetWorld();
 
-	if (world == NULL)
+	if (world == NULL || m_body->IsParked())
 	{
 		return;
 	}
@@ -223,9 +233,42 @@ void b2Fixture::SetSensor(bool sensor)
 	{
 		m_body->SetAwake(true);
 		m_isSensor = sensor;
+
+		// Touching contacts of this fixture join or leave the island graph.
+		b2World* world = m_body->GetWorld();
+		for (b2ContactEdge* ce = m_body->GetContactList(); ce; ce = ce->next)
+		{
+			b2Contact* c = ce->contact;
+			if (c->IsTouching() == false)
+			{
+				continue;
+			}
+
+			if (c->GetFixtureA() != this && c->GetFixtureB() != this)
+			{
+				continue;
+			}
+
+			if (sensor)
+			{
+				world->UnlinkIslands(m_body, ce->other);
+			}
+			else if (c->GetFixtureA()->IsSensor() == false && c->GetFixtureB()->IsSensor() == false)
+			{
+				world->LinkIslands(m_body, ce->other);
+			}
+		}
 	}
 }
 
+b2FixtureHandle b2Fixture::GetHandle() const
+{
+	b2FixtureHandle handle;
+	handle.index = m_poolIndex;
+	handle.revision = m_body->GetWorld()->m_fixturePool.GetRevision(m_poolIndex);
+	return handle;
+}
+
 void b2Fixture::Dump(int32 bodyIndex)
 {
 	b2Log("    b2FixtureDef fd;\n");
@@ -28,6 +28,13 @@ class b2Body;
 class b2BroadPhase;
 class b2Fixture;
 
+/// A checked reference to a fixture, see b2World::GetFixture.
+struct b2FixtureHandle
+{
+	int32 index;
+	uint32 revision;
+};
+
 /// This holds contact filtering data.
 struct b2Filter
 {
@@ -152,6 +159,9 @@ public:
 	/// Set the user data. Use this to store your application specific data.
 	void SetUserData(void* data);
 
+	/// Get a handle to this fixture, see b2World::GetFixture.
+	b2FixtureHandle GetHandle() const;
+
 	/// Test a point for containment in this fixture.
 	/// @param p a point in world coordinates.
 	bool TestPoint(const b2Vec2& p) const;
@@ -201,6 +211,7 @@ protected:
 	friend class b2World;
 	friend class b2Contact;
 	friend class b2ContactManager;
+	friend class b2PersistentQuery;
 
 	b2Fixture();
 
@@ -215,24 +226,28 @@ protected:
 
 	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2);
 
-	float32 m_density;
-
+	// Pointers first and small members last to keep the pool slots small.
 	b2Fixture* m_next;
 	b2Body* m_body;
 
 	b2Shape* m_shape;
 
+	b2FixtureProxy* m_proxies;
+
+	void* m_userData;
+
+	float32 m_density;
 	float32 m_friction;
 	float32 m_restitution;
 
-	b2FixtureProxy* m_proxies;
 	int32 m_proxyCount;
 
+	// The slot in the world's fixture pool.
+	int32 m_poolIndex;
+
 	b2Filter m_filter;
 
 	bool m_isSensor;
-
-	void* m_userData;
 };
 
 inline b2Shape::Type b2Fixture::GetType() const
@@ -24,8 +24,11 @@
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Dynamics/Joints/b2JointSolver.h>
 #include <Box2D/Common/b2StackAllocator.h>
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Trace.h>
+#include <new>
 
 /*
 Position Correction Notes
@@ -182,6 +185,7 @@ b2Island::~b2Island()
 
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
 {
+	b2TraceScope("b2Island::Solve");
 	b2Timer timer;
 
 	float32 h = step.dt;
@@ -196,12 +200,20 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		b2Vec2 v = b->m_linearVelocity;
 		float32 w = b->m_angularVelocity;
 
-		// Store positions for continuous collision.
-		b->m_sweep.c0 = b->m_sweep.c;
-		b->m_sweep.a0 = b->m_sweep.a;
-
-		if (b->m_type == b2_dynamicBody)
+		// Static and kinematic bodies are shared with other islands. Awake
+		// kinematic bodies were already moved by b2World::SolveKinematic, so
+		// the velocity constraints start from where they were.
+		if (b->m_type == b2_kinematicBody && b->IsAwake())
+		{
+			c = b->m_sweep.c0;
+			a = b->m_sweep.a0;
+		}
+		else if (b->m_type == b2_dynamicBody)
 		{
+			// Store positions for continuous collision.
+			b->m_sweep.c0 = b->m_sweep.c;
+			b->m_sweep.a0 = b->m_sweep.a;
+
 			// Integrate velocities.
 			v += h * (b->m_gravityScale * gravity + b->m_invMass * b->m_force);
 			w += h * b->m_invI * b->m_torque;
@@ -224,6 +236,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	}
 
 	timer.Reset();
+	b2TraceBegin("Initialize constraints");
 
 	// Solver data
 	b2SolverData solverData;
@@ -248,32 +261,84 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		contactSolver.WarmStart();
 	}
 	
-	for (int32 i = 0; i < m_jointCount; ++i)
+	// Batched joints are solved by type, see b2JointSolver. The solver only
+	// exists when it has joints to solve, so the default path allocates nothing.
+	b2JointSolver* jointSolver = NULL;
+	if (step.jointBatching && m_jointCount > 0)
 	{
-		m_joints[i]->InitVelocityConstraints(solverData);
+		b2JointSolverDef jointSolverDef;
+		jointSolverDef.step = step;
+		jointSolverDef.joints = m_joints;
+		jointSolverDef.count = m_jointCount;
+		jointSolverDef.bodyCount = m_bodyCount;
+		jointSolverDef.positions = m_positions;
+		jointSolverDef.velocities = m_velocities;
+		jointSolverDef.allocator = m_allocator;
+
+		void* mem = m_allocator->Allocate(sizeof(b2JointSolver));
+		jointSolver = new (mem) b2JointSolver(&jointSolverDef);
 	}
 
+	b2TraceBegin("Joint InitVelocityConstraints");
+	if (jointSolver)
+	{
+		jointSolver->InitializeVelocityConstraints();
+	}
+	else
+	{
+		for (int32 i = 0; i < m_jointCount; ++i)
+		{
+			m_joints[i]->InitVelocityConstraints(solverData);
+		}
+	}
+	b2TraceEnd();
+
 	profile->solveInit = timer.GetMilliseconds();
+	b2TraceEnd();
 
 	// Solve velocity constraints
 	timer.Reset();
+	b2TraceBegin("Velocity iterations");
 	for (int32 i = 0; i < step.velocityIterations; ++i)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
+		b2TraceBegin("Joint SolveVelocityConstraints");
+		if (jointSolver)
 		{
-			m_joints[j]->SolveVelocityConstraints(solverData);
+			jointSolver->SolveVelocityConstraints();
 		}
+		else
+		{
+			for (int32 j = 0; j < m_jointCount; ++j)
+			{
+				m_joints[j]->SolveVelocityConstraints(solverData);
+			}
+		}
+		b2TraceEnd();
 
 		contactSolver.SolveVelocityConstraints();
 	}
 
 	// Store impulses for warm starting
 	contactSolver.StoreImpulses();
+	if (jointSolver)
+	{
+		jointSolver->StoreImpulses();
+	}
 	profile->solveVelocity = timer.GetMilliseconds();
+	b2TraceEnd();
 
 	// Integrate positions
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
+		b2Body* b = m_bodies[i];
+		if (b->m_type != b2_dynamicBody)
+		{
+			// Kinematic bodies move to where b2World::SolveKinematic put them.
+			m_positions[i].c = b->m_sweep.c;
+			m_positions[i].a = b->m_sweep.a;
+			continue;
+		}
+
 		b2Vec2 c = m_positions[i].c;
 		float32 a = m_positions[i].a;
 		b2Vec2 v = m_velocities[i].v;
@@ -306,17 +371,27 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 	// Solve position constraints
 	timer.Reset();
+	b2TraceBegin("Position iterations");
 	bool positionSolved = false;
 	for (int32 i = 0; i < step.positionIterations; ++i)
 	{
 		bool contactsOkay = contactSolver.SolvePositionConstraints();
 
+		b2TraceBegin("Joint SolvePositionConstraints");
 		bool jointsOkay = true;
-		for (int32 i = 0; i < m_jointCount; ++i)
+		if (jointSolver)
+		{
+			jointsOkay = jointSolver->SolvePositionConstraints();
+		}
+		else
 		{
-			bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
-			jointsOkay = jointsOkay && jointOkay;
+			for (int32 i = 0; i < m_jointCount; ++i)
+			{
+				bool jointOkay = m_joints[i]->SolvePositionConstraints(solverData);
+				jointsOkay = jointsOkay && jointOkay;
+			}
 		}
+		b2TraceEnd();
 
 		if (contactsOkay && jointsOkay)
 		{
@@ -326,10 +401,21 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		}
 	}
 
+	if (jointSolver)
+	{
+		jointSolver->~b2JointSolver();
+		m_allocator->Free(jointSolver);
+	}
+
 	// Copy state buffers back to the bodies
 	for (int32 i = 0; i < m_bodyCount; ++i)
 	{
 		b2Body* body = m_bodies[i];
+		if (body->m_type != b2_dynamicBody)
+		{
+			continue;
+		}
+
 		body->m_sweep.c = m_positions[i].c;
 		body->m_sweep.a = m_positions[i].a;
 		body->m_linearVelocity = m_velocities[i].v;
@@ -338,6 +424,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	}
 
 	profile->solvePosition = timer.GetMilliseconds();
+	b2TraceEnd();
 
 	Report(contactSolver.m_velocityConstraints);
 
@@ -356,6 +443,17 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 				continue;
 			}
 
+			if (b->GetType() == b2_kinematicBody)
+			{
+				// A moving kinematic body keeps the bodies it carries awake.
+				// Its sleep time is kept by b2World::SolveKinematic.
+				if (b->IsAwake())
+				{
+					minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+				}
+				continue;
+			}
+
 			if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
 				b->m_angularVelocity * b->m_angularVelocity > angTolSqr ||
 				b2Dot(b->m_linearVelocity, b->m_linearVelocity) > linTolSqr)
@@ -375,7 +473,10 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 			for (int32 i = 0; i < m_bodyCount; ++i)
 			{
 				b2Body* b = m_bodies[i];
-				b->SetAwake(false);
+				if (b->GetType() != b2_kinematicBody)
+				{
+					b->SetAwake(false);
+				}
 			}
 		}
 	}
@@ -383,6 +484,8 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 void b2Island::SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB)
 {
+	b2TraceScope("b2Island::SolveTOI");
+
 	b2Assert(toiIndexA < m_bodyCount);
 	b2Assert(toiIndexB < m_bodyCount);
 
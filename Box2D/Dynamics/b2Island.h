@@ -30,6 +30,30 @@ class b2ContactListener;
 struct b2ContactVelocityConstraint;
 struct b2Profile;
 
+/// A persistent island is a set of dynamic bodies connected by touching
+/// contacts and joints. Static and kinematic bodies bound the islands.
+/// Islands are merged as soon as two of their bodies become connected. They
+/// are only split lazily, because a removed contact or joint does not
+/// necessarily break the island apart.
+/// This is an internal structure.
+struct b2PersistentIsland
+{
+	// World awake island list.
+	b2PersistentIsland* prev;
+	b2PersistentIsland* next;
+
+	// Bodies are linked through b2Body::m_islandPrev/m_islandNext.
+	b2Body* bodyList;
+	b2Body* bodyTail;
+	int32 bodyCount;
+
+	// Number of contacts, joints and bodies removed since the island was
+	// last built. When positive the island may be split.
+	int32 constraintRemoveCount;
+
+	bool awake;
+};
+
 /// This is an internal class.
 class b2Island
 {
@@ -0,0 +1,380 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2PersistentQuery.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Collision/b2BroadPhase.h>
+#include <algorithm>
+#include <string.h>
+
+inline bool b2QueryHitLessThan(const b2QueryHit& hit1, const b2QueryHit& hit2)
+{
+	return hit1.proxyId < hit2.proxyId;
+}
+
+// Gathers the proxies of the whole box for b2PersistentQuery::Refresh.
+struct b2PersistentQueryRefresh
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		if (query->ShouldFind(proxy->fixture))
+		{
+			b2QueryHit hit = { proxy->fixture, proxy->childIndex, proxyId };
+			query->AddHit(&hits, &count, &capacity, hit);
+		}
+		return true;
+	}
+
+	b2PersistentQuery* query;
+	const b2BroadPhase* broadPhase;
+	b2QueryHit* hits;
+	int32 count;
+	int32 capacity;
+};
+
+b2PersistentQuery::b2PersistentQuery(const b2PersistentQueryDef* def, b2World* world)
+{
+	b2Assert(def->aabb.IsValid());
+
+	m_world = world;
+	m_prev = NULL;
+	m_next = NULL;
+
+	m_aabb = def->aabb;
+	m_filter = def->filter;
+	m_userData = def->userData;
+
+	m_treeProxyId = world->m_queryTree.CreateProxy(m_aabb, this);
+	m_dirty = true;
+	m_mergeStart = 0;
+
+	m_results = NULL;
+	m_resultCount = 0;
+	m_resultCapacity = 0;
+
+	m_added = NULL;
+	m_addedCount = 0;
+	m_addedCapacity = 0;
+
+	m_removed = NULL;
+	m_removedCount = 0;
+	m_removedCapacity = 0;
+	m_pendingCount = 0;
+}
+
+b2PersistentQuery::~b2PersistentQuery()
+{
+	m_world->m_queryTree.DestroyProxy(m_treeProxyId);
+
+	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
+	allocator->Free(m_results, m_resultCapacity * sizeof(b2QueryHit));
+	allocator->Free(m_added, m_addedCapacity * sizeof(b2QueryHit));
+	allocator->Free(m_removed, m_removedCapacity * sizeof(b2QueryHit));
+}
+
+void b2PersistentQuery::SetAABB(const b2AABB& aabb)
+{
+	b2Assert(aabb.IsValid());
+	b2Assert(m_world->IsLocked() == false);
+
+	m_aabb = aabb;
+	m_world->m_queryTree.MoveProxy(m_treeProxyId, aabb, b2Vec2_zero);
+	m_dirty = true;
+}
+
+void b2PersistentQuery::SetFilter(const b2Filter& filter)
+{
+	b2Assert(m_world->IsLocked() == false);
+
+	m_filter = filter;
+	m_dirty = true;
+}
+
+int32 b2PersistentQuery::GetMemorySize() const
+{
+	return b2BlockAllocator::GetBlockSize(m_resultCapacity * sizeof(b2QueryHit)) +
+		b2BlockAllocator::GetBlockSize(m_addedCapacity * sizeof(b2QueryHit)) +
+		b2BlockAllocator::GetBlockSize(m_removedCapacity * sizeof(b2QueryHit));
+}
+
+bool b2PersistentQuery::ShouldFind(const b2Fixture* fixture) const
+{
+	const b2Filter& filter = fixture->GetFilterData();
+	return (filter.maskBits & m_filter.categoryBits) != 0 &&
+		(filter.categoryBits & m_filter.maskBits) != 0;
+}
+
+bool b2PersistentQuery::ShouldKeep(const b2BroadPhase* broadPhase, const b2QueryHit& hit) const
+{
+	return b2TestOverlap(broadPhase->GetFatAABB(hit.proxyId), m_aabb) && ShouldFind(hit.fixture);
+}
+
+int32 b2PersistentQuery::FindResult(int32 proxyId) const
+{
+	int32 low = 0;
+	int32 high = m_resultCount - 1;
+	while (low <= high)
+	{
+		int32 mid = (low + high) >> 1;
+		int32 id = m_results[mid].proxyId;
+		if (id == proxyId)
+		{
+			return mid;
+		}
+
+		if (id < proxyId)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	return -1;
+}
+
+void b2PersistentQuery::Reserve(b2QueryHit** hits, int32 count, int32* capacity, int32 size)
+{
+	if (size <= *capacity)
+	{
+		return;
+	}
+
+	int32 newCapacity = b2Max(2 * *capacity, 16);
+	while (newCapacity < size)
+	{
+		newCapacity *= 2;
+	}
+
+	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
+	b2QueryHit* newHits = (b2QueryHit*)allocator->Allocate(newCapacity * sizeof(b2QueryHit));
+	if (count > 0)
+	{
+		memcpy(newHits, *hits, count * sizeof(b2QueryHit));
+	}
+	allocator->Free(*hits, *capacity * sizeof(b2QueryHit));
+
+	*hits = newHits;
+	*capacity = newCapacity;
+}
+
+void b2PersistentQuery::AddHit(b2QueryHit** hits, int32* count, int32* capacity, const b2QueryHit& hit)
+{
+	Reserve(hits, *count, capacity, *count + 1);
+	(*hits)[*count] = hit;
+	++(*count);
+}
+
+void b2PersistentQuery::Refresh(const b2BroadPhase* broadPhase, bool report)
+{
+	b2PersistentQueryRefresh refresh;
+	refresh.query = this;
+	refresh.broadPhase = broadPhase;
+	refresh.hits = NULL;
+	refresh.count = 0;
+	refresh.capacity = 0;
+	broadPhase->Query(&refresh, m_aabb);
+
+	std::sort(refresh.hits, refresh.hits + refresh.count, b2QueryHitLessThan);
+
+	if (report)
+	{
+		// Both sets are sorted by proxy id. A live proxy id belongs to a single
+		// fixture child, so equal ids are the same hit.
+		int32 i = 0, j = 0;
+		while (i < m_resultCount || j < refresh.count)
+		{
+			if (j == refresh.count || (i < m_resultCount && m_results[i].proxyId < refresh.hits[j].proxyId))
+			{
+				AddHit(&m_removed, &m_removedCount, &m_removedCapacity, m_results[i]);
+				++i;
+			}
+			else if (i == m_resultCount || refresh.hits[j].proxyId < m_results[i].proxyId)
+			{
+				AddHit(&m_added, &m_addedCount, &m_addedCapacity, refresh.hits[j]);
+				++j;
+			}
+			else
+			{
+				++i;
+				++j;
+			}
+		}
+	}
+
+	m_world->m_blockAllocator.Free(m_results, m_resultCapacity * sizeof(b2QueryHit));
+	m_results = refresh.hits;
+	m_resultCount = refresh.count;
+	m_resultCapacity = refresh.capacity;
+	m_dirty = false;
+}
+
+void b2PersistentQuery::RemoveMoved(const b2BroadPhase* broadPhase, const int32* moved, int32 movedCount)
+{
+	// Only moved proxies can leave: their fat AABB changed or Refilter touched
+	// them. Both lists are sorted, so look up the shorter one in the other.
+	// A TOI sub-step only moves a couple of proxies.
+	bool removed = false;
+	if (movedCount < m_resultCount)
+	{
+		for (int32 i = 0; i < movedCount; ++i)
+		{
+			int32 index = FindResult(moved[i]);
+			if (index >= 0 && ShouldKeep(broadPhase, m_results[index]) == false)
+			{
+				AddHit(&m_removed, &m_removedCount, &m_removedCapacity, m_results[index]);
+				m_results[index].fixture = NULL;
+				removed = true;
+			}
+		}
+	}
+	else
+	{
+		for (int32 i = 0; i < m_resultCount; ++i)
+		{
+			b2QueryHit* hit = m_results + i;
+			if (std::binary_search(moved, moved + movedCount, hit->proxyId) && ShouldKeep(broadPhase, *hit) == false)
+			{
+				AddHit(&m_removed, &m_removedCount, &m_removedCapacity, *hit);
+				hit->fixture = NULL;
+				removed = true;
+			}
+		}
+	}
+
+	if (removed == false)
+	{
+		return;
+	}
+
+	int32 count = 0;
+	for (int32 i = 0; i < m_resultCount; ++i)
+	{
+		if (m_results[i].fixture)
+		{
+			m_results[count++] = m_results[i];
+		}
+	}
+	m_resultCount = count;
+}
+
+void b2PersistentQuery::MergeAdded()
+{
+	int32 addCount = m_addedCount - m_mergeStart;
+	if (addCount == 0)
+	{
+		return;
+	}
+
+	Reserve(&m_results, m_resultCount, &m_resultCapacity, m_resultCount + addCount);
+
+	// The additions are sorted because the moved proxies are, merge from the back.
+	const b2QueryHit* added = m_added + m_mergeStart;
+	int32 i = m_resultCount - 1;
+	int32 j = addCount - 1;
+	int32 k = m_resultCount + addCount - 1;
+	while (j >= 0)
+	{
+		if (i >= 0 && m_results[i].proxyId > added[j].proxyId)
+		{
+			m_results[k--] = m_results[i--];
+		}
+		else
+		{
+			m_results[k--] = added[j--];
+		}
+	}
+
+	m_resultCount += addCount;
+}
+
+void b2PersistentQuery::RemoveFixture(const b2Fixture* fixture, bool destroyed)
+{
+	for (int32 i = 0; i < fixture->m_proxyCount; ++i)
+	{
+		int32 index = FindResult(fixture->m_proxies[i].proxyId);
+		if (index < 0)
+		{
+			continue;
+		}
+
+		if (destroyed == false)
+		{
+			// Kept by the next time step.
+			AddHit(&m_removed, &m_removedCount, &m_removedCapacity, m_results[index]);
+			++m_pendingCount;
+		}
+
+		memmove(m_results + index, m_results + index + 1, (m_resultCount - index - 1) * sizeof(b2QueryHit));
+		--m_resultCount;
+	}
+
+	if (destroyed == false)
+	{
+		return;
+	}
+
+	int32 count = 0;
+	for (int32 i = 0; i < m_addedCount; ++i)
+	{
+		if (m_added[i].fixture != fixture)
+		{
+			m_added[count++] = m_added[i];
+		}
+	}
+	m_addedCount = count;
+
+	count = 0;
+	int32 pendingStart = m_removedCount - m_pendingCount;
+	for (int32 i = 0; i < m_removedCount; ++i)
+	{
+		if (m_removed[i].fixture != fixture)
+		{
+			m_removed[count++] = m_removed[i];
+		}
+		else if (i >= pendingStart)
+		{
+			--m_pendingCount;
+		}
+	}
+	m_removedCount = count;
+}
+
+void b2PersistentQuery::ClearEvents()
+{
+	m_addedCount = 0;
+
+	if (m_pendingCount == 0)
+	{
+		m_removedCount = 0;
+		return;
+	}
+
+	memmove(m_removed, m_removed + m_removedCount - m_pendingCount, m_pendingCount * sizeof(b2QueryHit));
+	m_removedCount = m_pendingCount;
+	m_pendingCount = 0;
+}
+
+void b2PersistentQuery::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	m_aabb.lowerBound -= newOrigin;
+	m_aabb.upperBound -= newOrigin;
+}
@@ -0,0 +1,257 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_PERSISTENT_QUERY_H
+#define B2_PERSISTENT_QUERY_H
+
+#include <Box2D/Dynamics/b2Fixture.h>
+
+class b2World;
+class b2BroadPhase;
+
+/// A fixture child found by a b2PersistentQuery.
+struct b2QueryHit
+{
+	b2Fixture* fixture;
+	int32 childIndex;
+	int32 proxyId;
+};
+
+/// A persistent query definition holds the data needed to create a query.
+struct b2PersistentQueryDef
+{
+	/// This constructor sets the query definition default values.
+	b2PersistentQueryDef()
+	{
+		aabb.lowerBound.SetZero();
+		aabb.upperBound.SetZero();
+		userData = NULL;
+	}
+
+	/// The query box in world coordinates.
+	b2AABB aabb;
+
+	/// Only fixtures whose filter accepts this filter are found. The group
+	/// index is not used.
+	b2Filter filter;
+
+	/// Use this to store application specific query data.
+	void* userData;
+};
+
+/// A box whose overlapping fixtures are tracked from step to step, created by
+/// b2World. Like b2World::QueryAABB it finds the fixture children whose
+/// broad-phase AABB overlaps the box, but the results are only updated for the
+/// proxies that moved during the time step instead of walking the tree every
+/// frame, so a query over static or sleeping fixtures costs next to nothing.
+/// Use this for triggers and neighbor scans that ask for the same region
+/// every frame.
+class b2PersistentQuery
+{
+public:
+
+	/// Move the query box. The results are updated during the next time step.
+	void SetAABB(const b2AABB& aabb);
+
+	/// Get the query box.
+	const b2AABB& GetAABB() const;
+
+	/// Change the filter. The results are updated during the next time step.
+	void SetFilter(const b2Filter& filter);
+
+	/// Get the filter.
+	const b2Filter& GetFilter() const;
+
+	/// Get the fixture children that overlap the query box, sorted by proxy id.
+	const b2QueryHit* GetResults() const;
+	int32 GetResultCount() const;
+
+	/// Get the fixture children that entered the query during the last time step.
+	const b2QueryHit* GetAdded() const;
+	int32 GetAddedCount() const;
+
+	/// Get the fixture children that left the query during the last time step,
+	/// or before it because their body was deactivated or parked. Destroyed
+	/// fixtures leave the results without being reported here, as they leave
+	/// their contacts.
+	const b2QueryHit* GetRemoved() const;
+	int32 GetRemovedCount() const;
+
+	/// Get the user data pointer that was provided in the query definition.
+	void* GetUserData() const;
+
+	/// Set the user data.
+	void SetUserData(void* data);
+
+	/// Get the next query in the world's list.
+	b2PersistentQuery* GetNext();
+	const b2PersistentQuery* GetNext() const;
+
+	/// Get the parent world of this query.
+	b2World* GetWorld();
+	const b2World* GetWorld() const;
+
+	/// Get the bytes allocated for the result and event arrays.
+	int32 GetMemorySize() const;
+
+protected:
+
+	friend class b2World;
+	friend struct b2PersistentQueryRefresh;
+	friend struct b2PersistentQueryUpdate;
+
+	b2PersistentQuery(const b2PersistentQueryDef* def, b2World* world);
+	~b2PersistentQuery();
+
+	bool ShouldFind(const b2Fixture* fixture) const;
+
+	// Is a moved result still found?
+	bool ShouldKeep(const b2BroadPhase* broadPhase, const b2QueryHit& hit) const;
+
+	// The index of a proxy in the results, or -1.
+	int32 FindResult(int32 proxyId) const;
+
+	// Grow one of the hit arrays to hold size hits, keeping the first count.
+	void Reserve(b2QueryHit** hits, int32 count, int32* capacity, int32 size);
+
+	// Append to one of the hit arrays, growing it.
+	void AddHit(b2QueryHit** hits, int32* count, int32* capacity, const b2QueryHit& hit);
+
+	// Query the broad-phase for the whole box and report the difference to the
+	// current results.
+	void Refresh(const b2BroadPhase* broadPhase, bool report);
+
+	// Drop the moved results that no longer overlap or pass the filter.
+	void RemoveMoved(const b2BroadPhase* broadPhase, const int32* moved, int32 movedCount);
+
+	// Merge the hits added since m_mergeStart into the results.
+	void MergeAdded();
+
+	// Take the proxies of a fixture out of the results. A fixture that is
+	// destroyed is also forgotten by the event arrays.
+	void RemoveFixture(const b2Fixture* fixture, bool destroyed);
+
+	// Start the events of a new time step.
+	void ClearEvents();
+
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+	b2World* m_world;
+	b2PersistentQuery* m_prev;
+	b2PersistentQuery* m_next;
+
+	b2AABB m_aabb;
+	b2Filter m_filter;
+	void* m_userData;
+
+	// The proxy of the box in the world's query tree.
+	int32 m_treeProxyId;
+
+	// The box or filter changed since the last update.
+	bool m_dirty;
+
+	// The first of the hits added by the current update.
+	int32 m_mergeStart;
+
+	b2QueryHit* m_results;
+	int32 m_resultCount;
+	int32 m_resultCapacity;
+
+	b2QueryHit* m_added;
+	int32 m_addedCount;
+	int32 m_addedCapacity;
+
+	// The last m_pendingCount removals happened between time steps and are
+	// kept by the next one.
+	b2QueryHit* m_removed;
+	int32 m_removedCount;
+	int32 m_removedCapacity;
+	int32 m_pendingCount;
+};
+
+inline const b2AABB& b2PersistentQuery::GetAABB() const
+{
+	return m_aabb;
+}
+
+inline const b2Filter& b2PersistentQuery::GetFilter() const
+{
+	return m_filter;
+}
+
+inline const b2QueryHit* b2PersistentQuery::GetResults() const
+{
+	return m_results;
+}
+
+inline int32 b2PersistentQuery::GetResultCount() const
+{
+	return m_resultCount;
+}
+
+inline const b2QueryHit* b2PersistentQuery::GetAdded() const
+{
+	return m_added;
+}
+
+inline int32 b2PersistentQuery::GetAddedCount() const
+{
+	return m_addedCount;
+}
+
+inline const b2QueryHit* b2PersistentQuery::GetRemoved() const
+{
+	return m_removed;
+}
+
+inline int32 b2PersistentQuery::GetRemovedCount() const
+{
+	return m_removedCount;
+}
+
+inline void* b2PersistentQuery::GetUserData() const
+{
+	return m_userData;
+}
+
+inline void b2PersistentQuery::SetUserData(void* data)
+{
+	m_userData = data;
+}
+
+inline b2PersistentQuery* b2PersistentQuery::GetNext()
+{
+	return m_next;
+}
+
+inline const b2PersistentQuery* b2PersistentQuery::GetNext() const
+{
+	return m_next;
+}
+
+inline b2World* b2PersistentQuery::GetWorld()
+{
+	return m_world;
+}
+
+inline const b2World* b2PersistentQuery::GetWorld() const
+{
+	return m_world;
+}
+
+#endif
@@ -32,6 +32,11 @@ struct b2Profile
 	float32 solvePosition;
 	float32 broadphase;
 	float32 solveTOI;
+	float32 buildIslands;
+	float32 solveParticles;
+	int32 toiEvents;		///< TOI events solved during the step
+	int32 toiDeferred;		///< TOI events left unsolved because the budget ran out
+	int32 manifoldsReused;	///< contact updates that kept the manifold, see b2World::SetManifoldReuse
 };
 
 /// This is an internal structure.
@@ -43,6 +48,7 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool jointBatching;
 };
 
 /// This is an internal structure.
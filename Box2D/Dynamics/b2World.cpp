@@ -31,16 +31,75 @@
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Collision/b2TimeOfImpact.h>
 #include <Box2D/Common/b2Draw.h>
+#include <Box2D/Common/b2DrawBuffer.h>
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Trace.h>
+#include <Box2D/Common/b2Snapshot.h>
+#include <Box2D/Particle/b2ParticleSystem.h>
+#include <Box2D/Dynamics/b2PersistentQuery.h>
 #include <new>
 
+// A contact with a pending time of impact.
+struct b2TOIEvent
+{
+	b2Contact* contact;
+	float32 alpha;
+};
+
 b2World::b2World(const b2Vec2& gravity)
+	: m_arena(0),
+	m_statsAllocator(&m_arena),
+	m_blockAllocator(&m_statsAllocator),
+	m_stackAllocator(&m_statsAllocator, b2_stackSize),
+	m_bodyPool(&m_statsAllocator, sizeof(b2Body)),
+	m_fixturePool(&m_statsAllocator, sizeof(b2Fixture)),
+	m_contactManager(&m_statsAllocator),
+	m_queryTree(&m_statsAllocator)
+{
+	Initialize(gravity);
+}
+
+b2World::b2World(const b2WorldDef* def)
+	: m_arena(def->allocator ? 0 : def->arenaSize),
+	m_statsAllocator(def->allocator ? def->allocator : &m_arena),
+	m_blockAllocator(&m_statsAllocator),
+	m_stackAllocator(&m_statsAllocator, def->stackSize),
+	m_bodyPool(&m_statsAllocator, sizeof(b2Body)),
+	m_fixturePool(&m_statsAllocator, sizeof(b2Fixture)),
+	m_contactManager(&m_statsAllocator),
+	m_queryTree(&m_statsAllocator)
+{
+	Initialize(def->gravity);
+	m_toiBudget = def->toiBudget;
+	m_manifoldReuse = def->manifoldReuse;
+	m_jointBatching = def->jointBatching;
+	m_taskExecutor = def->taskExecutor;
+}
+
+void b2World::Initialize(const b2Vec2& gravity)
 {
 	m_destructionListener = NULL;
+	m_taskExecutor = NULL;
 	g_debugDraw = NULL;
 
 	m_bodyList = NULL;
 	m_jointList = NULL;
+	m_particleSystemList = NULL;
+	m_queryList = NULL;
+
+	m_islandList = NULL;
+	m_splitIsland = NULL;
+	m_kinematicList = NULL;
+
+	m_regions = NULL;
+	m_regionCount = 0;
+	m_globalRegion = b2Region();
+	m_origin.SetZero();
+
+	m_toiEvents = NULL;
+	m_toiEventCount = 0;
+	m_toiEventCapacity = 0;
+	m_toiBudget = 0;
 
 	m_bodyCount = 0;
 	m_jointCount = 0;
@@ -48,6 +107,8 @@ b2World::b2World(const b2Vec2& gravity)
 	m_warmStarting = true;
 	m_continuousPhysics = true;
 	m_subStepping = false;
+	m_manifoldReuse = false;
+	m_jointBatching = false;
 
 	m_stepComplete = true;
 
@@ -57,6 +118,7 @@ b2World::b2World(const b2Vec2& gravity)
 	m_flags = e_clearForces;
 
 	m_inv_dt0 = 0.0f;
+	m_dt = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
 
@@ -65,23 +127,36 @@ b2World::b2World(const b2Vec2& gravity)
 
 b2World::~b2World()
 {
-	// Some shapes allocate using b2Alloc.
-	b2Body* b = m_bodyList;
-	while (b)
+	while (m_particleSystemList)
 	{
-		b2Body* bNext = b->m_next;
+		DestroyParticleSystem(m_particleSystemList);
+	}
+
+	while (m_queryList)
+	{
+		DestroyPersistentQuery(m_queryList);
+	}
 
-		b2Fixture* f = b->m_fixtureList;
-		while (f)
+	// Some shapes allocate using b2Alloc. The pools free the fixtures and
+	// bodies themselves.
+	for (int32 i = 0; i < m_fixturePool.GetCapacity(); ++i)
+	{
+		b2Fixture* f = (b2Fixture*)m_fixturePool.Find(i);
+		if (f)
 		{
-			b2Fixture* fNext = f->m_next;
 			f->m_proxyCount = 0;
 			f->Destroy(&m_blockAllocator);
-			f = fNext;
 		}
+	}
 
-		b = bNext;
+	// Large arrays bypass the block allocator chunks.
+	for (int32 i = 0; i < m_regionCount; ++i)
+	{
+		m_blockAllocator.Free(m_regions[i].bodies, m_regions[i].bodyCapacity * sizeof(b2Body*));
 	}
+	m_blockAllocator.Free(m_regions, m_regionCount * sizeof(b2Region));
+	m_blockAllocator.Free(m_globalRegion.bodies, m_globalRegion.bodyCapacity * sizeof(b2Body*));
+	m_blockAllocator.Free(m_toiEvents, m_toiEventCapacity * sizeof(b2TOIEvent));
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -112,8 +187,10 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 		return NULL;
 	}
 
-	void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
+	int32 poolIndex;
+	void* mem = m_bodyPool.Allocate(&poolIndex);
 	b2Body* b = new (mem) b2Body(def, this);
+	b->m_poolIndex = poolIndex;
 
 	// Add to world doubly linked list.
 	b->m_prev = NULL;
@@ -125,6 +202,19 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	AddToRegion(b);
+	if (b->IsActive() && IsRegionParked(b->m_region))
+	{
+		// The body has no fixtures yet, so there is nothing to park.
+		b->m_flags &= ~b2Body::e_activeFlag;
+		b->m_flags |= b2Body::e_parkedFlag;
+	}
+
+	if (b->IsActive())
+	{
+		AddToSolver(b);
+	}
+
 	return b;
 }
 
@@ -177,10 +267,12 @@ void b2World::DestroyBody(b2Body* b)
 			m_destructionListener->SayGoodbye(f0);
 		}
 
+		RemoveFromQueries(f0, true);
 		f0->DestroyProxies(&m_contactManager.m_broadPhase);
 		f0->Destroy(&m_blockAllocator);
+		int32 fixtureIndex = f0->m_poolIndex;
 		f0->~b2Fixture();
-		m_blockAllocator.Free(f0, sizeof(b2Fixture));
+		m_fixturePool.Free(fixtureIndex);
 
 		b->m_fixtureList = f;
 		b->m_fixtureCount -= 1;
@@ -188,6 +280,9 @@ void b2World::DestroyBody(b2Body* b)
 	b->m_fixtureList = NULL;
 	b->m_fixtureCount = 0;
 
+	RemoveFromSolver(b);
+	RemoveFromRegion(b);
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -205,8 +300,133 @@ void b2World::DestroyBody(b2Body* b)
 	}
 
 	--m_bodyCount;
+	int32 poolIndex = b->m_poolIndex;
 	b->~b2Body();
-	m_blockAllocator.Free(b, sizeof(b2Body));
+	m_bodyPool.Free(poolIndex);
+}
+
+void b2World::CreateBodies(const b2BodyDef* defs, int32 count, b2Body** bodies)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Body* b = CreateBody(defs + i);
+		if (bodies)
+		{
+			bodies[i] = b;
+		}
+	}
+}
+
+void b2World::CreateFixtures(b2Body* const* bodies, const b2FixtureDef* defs, int32 count, b2Fixture** fixtures)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	// Fixtures of inactive and parked bodies get their proxies later.
+	int32 proxyCapacity = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (bodies[i]->m_flags & b2Body::e_activeFlag)
+		{
+			proxyCapacity += defs[i].shape->GetChildCount();
+		}
+	}
+
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(proxyCapacity * sizeof(b2AABB));
+	void** userData = (void**)m_stackAllocator.Allocate(proxyCapacity * sizeof(void*));
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(proxyCapacity * sizeof(int32));
+	int32 proxyCount = 0;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Body* b = bodies[i];
+
+		int32 poolIndex;
+		void* mem = m_fixturePool.Allocate(&poolIndex);
+		b2Fixture* f = new (mem) b2Fixture;
+		f->Create(&m_blockAllocator, b, defs + i);
+		f->m_poolIndex = poolIndex;
+
+		if (b->m_flags & b2Body::e_activeFlag)
+		{
+			f->m_proxyCount = f->m_shape->GetChildCount();
+			for (int32 j = 0; j < f->m_proxyCount; ++j)
+			{
+				b2FixtureProxy* proxy = f->m_proxies + j;
+				f->m_shape->ComputeAABB(&proxy->aabb, b->m_xf, j);
+				proxy->fixture = f;
+				proxy->childIndex = j;
+				aabbs[proxyCount] = proxy->aabb;
+				userData[proxyCount] = proxy;
+				++proxyCount;
+			}
+		}
+
+		f->m_next = b->m_fixtureList;
+		b->m_fixtureList = f;
+		++b->m_fixtureCount;
+
+		if (fixtures)
+		{
+			fixtures[i] = f;
+		}
+	}
+
+	m_contactManager.m_broadPhase.CreateProxies(aabbs, userData, proxyCount, proxyIds);
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		((b2FixtureProxy*)userData[i])->proxyId = proxyIds[i];
+	}
+
+	m_stackAllocator.Free(proxyIds);
+	m_stackAllocator.Free(userData);
+	m_stackAllocator.Free(aabbs);
+
+	// Reset the mass once per run of fixtures on the same body.
+	bool resetMass = false;
+	for (int32 i = 0; i < count; ++i)
+	{
+		resetMass = resetMass || defs[i].density > 0.0f;
+		if (i + 1 == count || bodies[i + 1] != bodies[i])
+		{
+			if (resetMass)
+			{
+				bodies[i]->ResetMassData();
+			}
+			resetMass = false;
+		}
+	}
+
+	m_flags |= e_newFixture;
+}
+
+b2Body* b2World::GetBody(const b2BodyHandle& handle)
+{
+	return (b2Body*)m_bodyPool.Find(handle.index, handle.revision);
+}
+
+const b2Body* b2World::GetBody(const b2BodyHandle& handle) const
+{
+	return (const b2Body*)m_bodyPool.Find(handle.index, handle.revision);
+}
+
+b2Fixture* b2World::GetFixture(const b2FixtureHandle& handle)
+{
+	return (b2Fixture*)m_fixturePool.Find(handle.index, handle.revision);
+}
+
+const b2Fixture* b2World::GetFixture(const b2FixtureHandle& handle) const
+{
+	return (const b2Fixture*)m_fixturePool.Find(handle.index, handle.revision);
 }
 
 b2Joint* b2World::CreateJoint(const b2JointDef* def)
@@ -264,6 +484,9 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 		}
 	}
 
+	// Joined bodies always share an island.
+	LinkIslands(bodyA, bodyB);
+
 	// Note: creating a joint doesn't wake the bodies.
 
 	return j;
@@ -303,6 +526,9 @@ void b2World::DestroyJoint(b2Joint* j)
 	bodyA->SetAwake(true);
 	bodyB->SetAwake(true);
 
+	// The island may now be split.
+	UnlinkIslands(bodyA, bodyB);
+
 	// Remove from body 1.
 	if (j->m_edgeA.prev)
 	{
@@ -364,6 +590,118 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 }
 
+b2ParticleSystem* b2World::CreateParticleSystem(const b2ParticleSystemDef* def)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return NULL;
+	}
+
+	void* mem = m_blockAllocator.Allocate(sizeof(b2ParticleSystem));
+	b2ParticleSystem* system = new (mem) b2ParticleSystem(def, this);
+
+	// Add to world doubly linked list.
+	system->m_prev = NULL;
+	system->m_next = m_particleSystemList;
+	if (m_particleSystemList)
+	{
+		m_particleSystemList->m_prev = system;
+	}
+	m_particleSystemList = system;
+
+	return system;
+}
+
+void b2World::DestroyParticleSystem(b2ParticleSystem* system)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	if (system->m_prev)
+	{
+		system->m_prev->m_next = system->m_next;
+	}
+
+	if (system->m_next)
+	{
+		system->m_next->m_prev = system->m_prev;
+	}
+
+	if (system == m_particleSystemList)
+	{
+		m_particleSystemList = system->m_next;
+	}
+
+	system->~b2ParticleSystem();
+	m_blockAllocator.Free(system, sizeof(b2ParticleSystem));
+}
+
+b2PersistentQuery* b2World::CreatePersistentQuery(const b2PersistentQueryDef* def)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return NULL;
+	}
+
+	void* mem = m_blockAllocator.Allocate(sizeof(b2PersistentQuery));
+	b2PersistentQuery* query = new (mem) b2PersistentQuery(def, this);
+
+	// Add to world doubly linked list.
+	query->m_prev = NULL;
+	query->m_next = m_queryList;
+	if (m_queryList)
+	{
+		m_queryList->m_prev = query;
+	}
+	m_queryList = query;
+
+	return query;
+}
+
+void b2World::DestroyPersistentQuery(b2PersistentQuery* query)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	if (query->m_prev)
+	{
+		query->m_prev->m_next = query->m_next;
+	}
+
+	if (query->m_next)
+	{
+		query->m_next->m_prev = query->m_prev;
+	}
+
+	if (query == m_queryList)
+	{
+		m_queryList = query->m_next;
+	}
+
+	query->~b2PersistentQuery();
+	m_blockAllocator.Free(query, sizeof(b2PersistentQuery));
+}
+
+void b2World::RunParallel(b2ParallelTask* task, int32 count, int32 minRange)
+{
+	if (m_taskExecutor && count > minRange)
+	{
+		m_taskExecutor->ParallelFor(task, count, minRange);
+	}
+	else if (count > 0)
+	{
+		task->Execute(0, count);
+	}
+}
+
 //
 void b2World::SetAllowSleeping(bool flag)
 {
@@ -382,958 +720,2727 @@ void b2World::SetAllowSleeping(bool flag)
 	}
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
-void b2World::Solve(const b2TimeStep& step)
+void b2World::AddToSolver(b2Body* body)
 {
-	m_profile.solveInit = 0.0f;
-	m_profile.solveVelocity = 0.0f;
-	m_profile.solvePosition = 0.0f;
+	b2Assert(body->IsActive());
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
-
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	// Static bodies don't participate in islands. Kinematic bodies are
+	// integrated on their own and are shared by the islands they touch.
+	if (body->m_type == b2_dynamicBody)
 	{
-		b->m_flags &= ~b2Body::e_islandFlag;
+		AddToIsland(body);
 	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	else if (body->m_type == b2_kinematicBody)
 	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
+		b2Assert(body->m_islandPrev == NULL && body->m_islandNext == NULL);
+		body->m_islandNext = m_kinematicList;
+		if (m_kinematicList)
+		{
+			m_kinematicList->m_islandPrev = body;
+		}
+		m_kinematicList = body;
 	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+}
+
+void b2World::RemoveFromSolver(b2Body* body)
+{
+	if (body->m_island)
 	{
-		j->m_islandFlag = false;
+		RemoveFromIsland(body);
+		return;
 	}
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	if (body != m_kinematicList && body->m_islandPrev == NULL)
 	{
-		if (seed->m_flags & b2Body::e_islandFlag)
-		{
-			continue;
-		}
+		// Not in the kinematic list.
+		b2Assert(body->m_islandNext == NULL);
+		return;
+	}
 
-		if (seed->IsAwake() == false || seed->IsActive() == false)
-		{
-			continue;
-		}
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
 
-		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
-		{
-			continue;
-		}
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
 
-		// Reset island and stack.
-		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
+	if (body == m_kinematicList)
+	{
+		m_kinematicList = body->m_islandNext;
+	}
 
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
-		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
-			b2Assert(b->IsActive() == true);
-			island.Add(b);
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
+}
 
-			// Make sure the body is awake.
-			b->SetAwake(true);
+void b2World::AddToIsland(b2Body* body)
+{
+	b2Assert(body->m_island == NULL);
+	b2Assert(body->m_type == b2_dynamicBody && body->IsActive());
+
+	void* mem = m_blockAllocator.Allocate(sizeof(b2PersistentIsland));
+	b2PersistentIsland* island = (b2PersistentIsland*)mem;
+	island->prev = NULL;
+	island->next = NULL;
+	island->bodyList = body;
+	island->bodyTail = body;
+	island->bodyCount = 1;
+	island->constraintRemoveCount = 0;
+	island->awake = false;
+
+	body->m_island = island;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
+
+	if (body->IsAwake())
+	{
+		WakeIsland(island);
+	}
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
+	// Joints to active bodies may already exist.
+	for (b2JointEdge* je = body->m_jointList; je; je = je->next)
+	{
+		LinkIslands(body, je->other);
+	}
+}
 
-			// Search all contacts connected to this body.
-			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
-			{
-				b2Contact* contact = ce->contact;
+void b2World::RemoveFromIsland(b2Body* body)
+{
+	b2PersistentIsland* island = body->m_island;
+	b2Assert(island != NULL);
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
-				{
-					continue;
-				}
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
 
-				// Is this contact solid and touching?
-				if (contact->IsEnabled() == false ||
-					contact->IsTouching() == false)
-				{
-					continue;
-				}
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
 
-				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
-				if (sensorA || sensorB)
-				{
-					continue;
-				}
+	if (body == island->bodyList)
+	{
+		island->bodyList = body->m_islandNext;
+	}
 
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
+	if (body == island->bodyTail)
+	{
+		island->bodyTail = body->m_islandPrev;
+	}
 
-				b2Body* other = ce->other;
+	body->m_island = NULL;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
 
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
-				{
-					continue;
-				}
+	--island->bodyCount;
+	if (island->bodyCount > 0)
+	{
+		// The remaining bodies may no longer be connected.
+		++island->constraintRemoveCount;
+		return;
+	}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
-			}
+	if (island->awake)
+	{
+		SleepIsland(island);
+	}
 
-			// Search all joints connect to this body.
-			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+	if (island == m_splitIsland)
+	{
+		m_splitIsland = NULL;
+	}
+
+	m_blockAllocator.Free(island, sizeof(b2PersistentIsland));
+}
+
+void b2World::LinkIslands(b2Body* bodyA, b2Body* bodyB)
+{
+	b2PersistentIsland* islandA = bodyA->m_island;
+	b2PersistentIsland* islandB = bodyB->m_island;
+
+	// Islands don't propagate across static or inactive bodies.
+	if (islandA == NULL || islandB == NULL || islandA == islandB)
+	{
+		return;
+	}
+
+	// Keep the larger island to minimize relinking.
+	if (islandA->bodyCount >= islandB->bodyCount)
+	{
+		MergeIslands(islandA, islandB);
+	}
+	else
+	{
+		MergeIslands(islandB, islandA);
+	}
+}
+
+void b2World::UnlinkIslands(b2Body* bodyA, b2Body* bodyB)
+{
+	b2PersistentIsland* islandA = bodyA->m_island;
+	b2PersistentIsland* islandB = bodyB->m_island;
+
+	if (islandA)
+	{
+		++islandA->constraintRemoveCount;
+	}
+
+	if (islandB && islandB != islandA)
+	{
+		++islandB->constraintRemoveCount;
+	}
+}
+
+void b2World::MergeIslands(b2PersistentIsland* keep, b2PersistentIsland* absorb)
+{
+	b2Assert(keep != absorb);
+
+	if (absorb->awake)
+	{
+		SleepIsland(absorb);
+		WakeIsland(keep);
+	}
+
+	for (b2Body* b = absorb->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_island = keep;
+	}
+
+	// Append the absorbed bodies so an island walk in progress visits them.
+	keep->bodyTail->m_islandNext = absorb->bodyList;
+	absorb->bodyList->m_islandPrev = keep->bodyTail;
+	keep->bodyTail = absorb->bodyTail;
+	keep->bodyCount += absorb->bodyCount;
+	keep->constraintRemoveCount += absorb->constraintRemoveCount;
+
+	if (absorb == m_splitIsland)
+	{
+		m_splitIsland = keep;
+	}
+
+	m_blockAllocator.Free(absorb, sizeof(b2PersistentIsland));
+}
+
+// Rebuild the islands of the given island's bodies using a depth first search.
+void b2World::SplitIsland(b2PersistentIsland* island)
+{
+	b2TraceScope("b2World::SplitIsland");
+
+	int32 bodyCount = island->bodyCount;
+	bool awake = island->awake;
+
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(bodyCount * sizeof(b2Body*));
+
+	int32 count = 0;
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		bodies[count++] = b;
+	}
+	b2Assert(count == bodyCount);
+
+	if (awake)
+	{
+		SleepIsland(island);
+	}
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* seed = bodies[i];
+		if (seed->m_flags & b2Body::e_islandFlag)
+		{
+			continue;
+		}
+
+		void* mem = m_blockAllocator.Allocate(sizeof(b2PersistentIsland));
+		b2PersistentIsland* newIsland = (b2PersistentIsland*)mem;
+		newIsland->prev = NULL;
+		newIsland->next = NULL;
+		newIsland->bodyList = NULL;
+		newIsland->bodyTail = NULL;
+		newIsland->bodyCount = 0;
+		newIsland->constraintRemoveCount = 0;
+		newIsland->awake = false;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+
+			// Search the neighbors before relinking the body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 			{
-				if (je->joint->m_islandFlag == true)
+				b2Contact* contact = ce->contact;
+				if (contact->IsTouching() == false)
 				{
 					continue;
 				}
 
-				b2Body* other = je->other;
+				if (contact->m_fixtureA->m_isSensor || contact->m_fixtureB->m_isSensor)
+				{
+					continue;
+				}
 
-				// Don't simulate joints connected to inactive bodies.
-				if (other->IsActive() == false)
+				b2Body* other = ce->other;
+				if ((other->m_flags & b2Body::e_islandFlag) || other->m_island != island)
 				{
 					continue;
 				}
 
-				island.Add(je->joint);
-				je->joint->m_islandFlag = true;
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
 
-				if (other->m_flags & b2Body::e_islandFlag)
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				b2Body* other = je->other;
+				if ((other->m_flags & b2Body::e_islandFlag) || other->m_island != island)
 				{
 					continue;
 				}
 
-				b2Assert(stackCount < stackSize);
+				b2Assert(stackCount < bodyCount);
 				stack[stackCount++] = other;
 				other->m_flags |= b2Body::e_islandFlag;
 			}
-		}
-
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
 
-		// Post solve cleanup.
-		for (int32 i = 0; i < island.m_bodyCount; ++i)
-		{
-			// Allow static bodies to participate in other islands.
-			b2Body* b = island.m_bodies[i];
-			if (b->GetType() == b2_staticBody)
+			b->m_island = newIsland;
+			b->m_islandPrev = newIsland->bodyTail;
+			b->m_islandNext = NULL;
+			if (newIsland->bodyTail)
 			{
-				b->m_flags &= ~b2Body::e_islandFlag;
+				newIsland->bodyTail->m_islandNext = b;
+			}
+			else
+			{
+				newIsland->bodyList = b;
 			}
+			newIsland->bodyTail = b;
+			++newIsland->bodyCount;
+		}
+
+		if (awake)
+		{
+			WakeIsland(newIsland);
 		}
 	}
 
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
+
 	m_stackAllocator.Free(stack);
+	m_stackAllocator.Free(bodies);
 
+	if (island == m_splitIsland)
 	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
-		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
-			{
-				continue;
-			}
+		m_splitIsland = NULL;
+	}
 
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
+	m_blockAllocator.Free(island, sizeof(b2PersistentIsland));
+}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
-		}
+void b2World::WakeIsland(b2PersistentIsland* island)
+{
+	if (island->awake)
+	{
+		return;
+	}
 
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+	island->awake = true;
+	island->prev = NULL;
+	island->next = m_islandList;
+	if (m_islandList)
+	{
+		m_islandList->prev = island;
 	}
+	m_islandList = island;
 }
 
-// Find TOI contacts and solve them.
-void b2World::SolveTOI(const b2TimeStep& step)
+void b2World::SleepIsland(b2PersistentIsland* island)
 {
-	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+	if (island->awake == false)
+	{
+		return;
+	}
 
-	if (m_stepComplete)
+	if (island->prev)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->m_next)
-		{
-			b->m_flags &= ~b2Body::e_islandFlag;
-			b->m_sweep.alpha0 = 0.0f;
-		}
+		island->prev->next = island->next;
+	}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
-		{
-			// Invalidate TOI
-			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			c->m_toiCount = 0;
-			c->m_toi = 1.0f;
-		}
+	if (island->next)
+	{
+		island->next->prev = island->prev;
 	}
 
-	// Find TOI events and solve them.
-	for (;;)
+	if (island == m_islandList)
 	{
-		// Find the first TOI.
-		b2Contact* minContact = NULL;
-		float32 minAlpha = 1.0f;
+		m_islandList = island->next;
+	}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	island->awake = false;
+	island->prev = NULL;
+	island->next = NULL;
+}
+
+b2Region* b2World::GetRegion(int32 region)
+{
+	b2Assert(region >= 0);
+
+	if (region >= m_regionCount)
+	{
+		int32 oldCount = m_regionCount;
+		b2Region* oldRegions = m_regions;
+		m_regionCount = b2Max(region + 1, 2 * oldCount);
+		m_regions = (b2Region*)m_blockAllocator.Allocate(m_regionCount * sizeof(b2Region));
+		for (int32 i = 0; i < oldCount; ++i)
 		{
-			// Is this contact disabled?
-			if (c->IsEnabled() == false)
-			{
-				continue;
-			}
+			new (m_regions + i) b2Region(oldRegions[i]);
+		}
 
-			// Prevent excessive sub-stepping.
-			if (c->m_toiCount > b2_maxSubSteps)
-			{
-				continue;
-			}
+		// Value-initialized, so the new regions are empty and unparked.
+		for (int32 i = oldCount; i < m_regionCount; ++i)
+		{
+			new (m_regions + i) b2Region();
+		}
 
-			float32 alpha = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
-			{
-				// This contact has a valid cached TOI.
-				alpha = c->m_toi;
-			}
-			else
-			{
-				b2Fixture* fA = c->GetFixtureA();
-				b2Fixture* fB = c->GetFixtureB();
+		if (oldRegions)
+		{
+			m_blockAllocator.Free(oldRegions, oldCount * sizeof(b2Region));
+		}
+	}
 
-				// Is there a sensor?
-				if (fA->IsSensor() || fB->IsSensor())
-				{
-					continue;
-				}
+	return m_regions + region;
+}
 
-				b2Body* bA = fA->GetBody();
-				b2Body* bB = fB->GetBody();
+void b2World::AddToRegion(b2Body* body)
+{
+	b2Region* region = body->m_region == b2_noRegion ? &m_globalRegion : GetRegion(body->m_region);
+	if (region->bodyCount == region->bodyCapacity)
+	{
+		b2Body** oldBodies = region->bodies;
+		int32 oldCapacity = region->bodyCapacity;
+		region->bodyCapacity = oldCapacity > 0 ? 2 * oldCapacity : 16;
+		region->bodies = (b2Body**)m_blockAllocator.Allocate(region->bodyCapacity * sizeof(b2Body*));
+		if (oldBodies)
+		{
+			memcpy(region->bodies, oldBodies, region->bodyCount * sizeof(b2Body*));
+			m_blockAllocator.Free(oldBodies, oldCapacity * sizeof(b2Body*));
+		}
+	}
 
-				b2BodyType typeA = bA->m_type;
-				b2BodyType typeB = bB->m_type;
-				b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+	body->m_regionIndex = region->bodyCount;
+	region->bodies[region->bodyCount++] = body;
+}
 
-				bool activeA = bA->IsAwake() && typeA != b2_staticBody;
-				bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+void b2World::RemoveFromRegion(b2Body* body)
+{
+	b2Region* region = body->m_region == b2_noRegion ? &m_globalRegion : m_regions + body->m_region;
+	b2Assert(region->bodies[body->m_regionIndex] == body);
 
-				// Is at least one body active (awake and dynamic or kinematic)?
-				if (activeA == false && activeB == false)
-				{
-					continue;
-				}
+	b2Body* last = region->bodies[--region->bodyCount];
+	region->bodies[body->m_regionIndex] = last;
+	last->m_regionIndex = body->m_regionIndex;
+	body->m_regionIndex = -1;
+}
 
-				bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
-				bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+void b2World::ParkBody(b2Body* body)
+{
+	b2Assert(body->IsActive());
 
-				// Are these two non-bullet dynamic bodies?
-				if (collideA == false && collideB == false)
-				{
-					continue;
-				}
+	body->m_flags &= ~b2Body::e_activeFlag;
+	body->m_flags |= b2Body::e_parkedFlag;
 
-				// Compute the TOI for this contact.
-				// Put the sweeps onto the same time interval.
-				float32 alpha0 = bA->m_sweep.alpha0;
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	for (b2Fixture* f = body->m_fixtureList; f; f = f->m_next)
+	{
+		RemoveFromQueries(f, false);
+		for (int32 i = 0; i < f->m_proxyCount; ++i)
+		{
+			broadPhase->ParkProxy(f->m_proxies[i].proxyId);
+		}
+	}
 
-				if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
-				{
-					alpha0 = bB->m_sweep.alpha0;
-					bA->m_sweep.Advance(alpha0);
-				}
-				else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
-				{
-					alpha0 = bA->m_sweep.alpha0;
-					bB->m_sweep.Advance(alpha0);
-				}
+	RemoveFromSolver(body);
 
-				b2Assert(alpha0 < 1.0f);
+	// The contacts are destroyed by the next b2ContactManager::Collide.
+}
 
-				int32 indexA = c->GetChildIndexA();
-				int32 indexB = c->GetChildIndexB();
+void b2World::UnparkBodies(b2Body** bodies, int32 count)
+{
+	int32 proxyCapacity = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (bodies[i]->IsParked())
+		{
+			for (b2Fixture* f = bodies[i]->m_fixtureList; f; f = f->m_next)
+			{
+				proxyCapacity += f->m_proxyCount;
+			}
+		}
+	}
 
-				// Compute the time of impact in interval [0, minTOI]
-				b2TOIInput input;
-				input.proxyA.Set(fA->GetShape(), indexA);
-				input.proxyB.Set(fB->GetShape(), indexB);
-				input.sweepA = bA->m_sweep;
-				input.sweepB = bB->m_sweep;
-				input.tMax = 1.0f;
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(proxyCapacity * sizeof(int32));
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(proxyCapacity * sizeof(b2AABB));
+	int32 proxyCount = 0;
 
-				b2TOIOutput output;
-				b2TimeOfImpact(&output, &input);
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Body* b = bodies[i];
+		if (b->IsParked() == false)
+		{
+			continue;
+		}
 
-				// Beta is the fraction of the remaining portion of the .
-				float32 beta = output.t;
-				if (output.state == b2TOIOutput::e_touching)
-				{
-					alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
-				}
-				else
-				{
-					alpha = 1.0f;
-				}
+		b->m_flags &= ~b2Body::e_parkedFlag;
+		b->m_flags |= b2Body::e_activeFlag;
 
-				c->m_toi = alpha;
-				c->m_flags |= b2Contact::e_toiFlag;
+		// The body may have moved while parked.
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			if (f->m_proxyCount == 0)
+			{
+				// Created while parked.
+				f->CreateProxies(broadPhase, b->m_xf);
+				continue;
 			}
 
-			if (alpha < minAlpha)
+			for (int32 j = 0; j < f->m_proxyCount; ++j)
 			{
-				// This is the minimum TOI found so far.
-				minContact = c;
-				minAlpha = alpha;
+				b2FixtureProxy* proxy = f->m_proxies + j;
+				f->m_shape->ComputeAABB(&proxy->aabb, b->m_xf, proxy->childIndex);
+				proxyIds[proxyCount] = proxy->proxyId;
+				aabbs[proxyCount] = proxy->aabb;
+				++proxyCount;
 			}
 		}
 
-		if (minContact == NULL || 1.0f - 10.0f * b2_epsilon < minAlpha)
-		{
-			// No more TOI events. Done!
-			m_stepComplete = true;
-			break;
-		}
+		AddToSolver(b);
+	}
 
-		// Advance the bodies to the TOI.
-		b2Fixture* fA = minContact->GetFixtureA();
-		b2Fixture* fB = minContact->GetFixtureB();
-		b2Body* bA = fA->GetBody();
-		b2Body* bB = fB->GetBody();
+	broadPhase->UnparkProxies(proxyIds, aabbs, proxyCount);
 
-		b2Sweep backup1 = bA->m_sweep;
-		b2Sweep backup2 = bB->m_sweep;
+	m_stackAllocator.Free(aabbs);
+	m_stackAllocator.Free(proxyIds);
 
-		bA->Advance(minAlpha);
-		bB->Advance(minAlpha);
+	// Contacts are created the next time step.
+}
 
-		// The TOI contact likely has some new contact points.
-		minContact->Update(m_contactManager.m_contactListener);
-		minContact->m_flags &= ~b2Contact::e_toiFlag;
-		++minContact->m_toiCount;
+void b2World::ParkRegion(int32 region)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
 
-		// Is the contact solid?
-		if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
+	b2Region* r = GetRegion(region);
+	if (r->parked)
+	{
+		return;
+	}
+
+	r->parked = true;
+	r->origin = m_origin;
+	for (int32 i = 0; i < r->bodyCount; ++i)
+	{
+		b2Body* b = r->bodies[i];
+		if (b->IsActive())
 		{
-			// Restore the sweeps.
-			minContact->SetEnabled(false);
-			bA->m_sweep = backup1;
-			bB->m_sweep = backup2;
-			bA->SynchronizeTransform();
-			bB->SynchronizeTransform();
-			continue;
+			ParkBody(b);
 		}
+	}
+}
 
-		bA->SetAwake(true);
-		bB->SetAwake(true);
+void b2World::UnparkRegion(int32 region)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
 
-		// Build the island
-		island.Clear();
-		island.Add(bA);
-		island.Add(bB);
-		island.Add(minContact);
+	if (IsRegionParked(region) == false)
+	{
+		return;
+	}
 
-		bA->m_flags |= b2Body::e_islandFlag;
-		bB->m_flags |= b2Body::e_islandFlag;
-		minContact->m_flags |= b2Contact::e_islandFlag;
+	b2Region* r = m_regions + region;
+	r->parked = false;
 
-		// Get contacts on bodyA and bodyB.
-		b2Body* bodies[2] = {bA, bB};
-		for (int32 i = 0; i < 2; ++i)
+	// Catch up with the origin shifts made while the region was parked.
+	b2Vec2 shift = b2Offset(m_origin, r->origin);
+	if (shift.x != 0.0f || shift.y != 0.0f)
+	{
+		ShiftRegion(r, shift);
+	}
+
+	UnparkBodies(r->bodies, r->bodyCount);
+}
+
+b2Vec2d b2World::GetRegionOrigin(int32 region) const
+{
+	if (IsRegionParked(region))
+	{
+		return m_regions[region].origin;
+	}
+
+	return m_origin;
+}
+
+bool b2World::IsRegionParked(int32 region) const
+{
+	if (region < 0 || region >= m_regionCount)
+	{
+		return false;
+	}
+
+	return m_regions[region].parked;
+}
+
+int32 b2World::GetRegionBodyCount(int32 region) const
+{
+	if (region < 0 || region >= m_regionCount)
+	{
+		return 0;
+	}
+
+	return m_regions[region].bodyCount;
+}
+
+// Integrate and solve constraints of all awake islands, solve position constraints.
+void b2World::Solve(const b2TimeStep& step)
+{
+	b2TraceScope("b2World::Solve");
+
+	m_profile.solveInit = 0.0f;
+	m_profile.solveVelocity = 0.0f;
+	m_profile.solvePosition = 0.0f;
+	m_profile.buildIslands = 0.0f;
+
+	// Size the island for the worst case.
+	b2Island island(m_bodyCount,
+					m_contactManager.m_contactCount,
+					m_jointCount,
+					&m_stackAllocator,
+					m_contactManager.m_contactListener);
+
+	// Kinematic bodies move first, so the islands see their new positions.
+	SolveKinematic(step);
+
+	// Islands are kept up to date as contacts begin and end, so only
+	// the awake islands are visited. Island flags are cleared after
+	// each island is solved.
+	float32 synchronizeTime = 0.0f;
+	float32 splitSleepTime = -1.0f;
+	m_splitIsland = NULL;
+
+	b2PersistentIsland* persistent = m_islandList;
+	while (persistent)
+	{
+		// Bodies may have been put to sleep by the user.
+		bool awake = false;
+		for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
 		{
-			b2Body* body = bodies[i];
-			if (body->m_type == b2_dynamicBody)
+			if (b->IsAwake())
 			{
-				for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
-				{
-					if (island.m_bodyCount == island.m_bodyCapacity)
-					{
-						break;
-					}
+				awake = true;
+				break;
+			}
+		}
 
-					if (island.m_contactCount == island.m_contactCapacity)
-					{
-						break;
-					}
+		if (awake == false)
+		{
+			b2PersistentIsland* next = persistent->next;
+			SleepIsland(persistent);
+			persistent = next;
+			continue;
+		}
 
-					b2Contact* contact = ce->contact;
+		b2TraceBegin("Build island");
+		b2Timer buildTimer;
+		island.Clear();
 
-					// Has this contact already been added to the island?
-					if (contact->m_flags & b2Contact::e_islandFlag)
-					{
-						continue;
-					}
+		// Bodies merged into this island during the walk are appended to the list.
+		for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
+		{
+			b2Assert(b->IsActive() == true);
+			island.Add(b);
+			b->m_flags |= b2Body::e_islandFlag;
 
-					// Only add static, kinematic, or bullet bodies.
-					b2Body* other = ce->other;
-					if (other->m_type == b2_dynamicBody &&
-						body->IsBullet() == false && other->IsBullet() == false)
-					{
-						continue;
-					}
+			// Make sure the body is awake.
+			b->SetAwake(true);
 
-					// Skip sensors.
-					bool sensorA = contact->m_fixtureA->m_isSensor;
-					bool sensorB = contact->m_fixtureB->m_isSensor;
-					if (sensorA || sensorB)
-					{
-						continue;
-					}
+			// Search all contacts connected to this body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* contact = ce->contact;
 
-					// Tentatively advance the body to the TOI.
-					b2Sweep backup = other->m_sweep;
-					if ((other->m_flags & b2Body::e_islandFlag) == 0)
-					{
-						other->Advance(minAlpha);
-					}
+				// Has this contact already been added to the island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
 
-					// Update the contact points
-					contact->Update(m_contactManager.m_contactListener);
+				// Is this contact solid and touching?
+				if (contact->IsEnabled() == false ||
+					contact->IsTouching() == false)
+				{
+					continue;
+				}
 
-					// Was the contact disabled by the user?
-					if (contact->IsEnabled() == false)
-					{
-						other->m_sweep = backup;
-						other->SynchronizeTransform();
-						continue;
-					}
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
 
-					// Are there contact points?
-					if (contact->IsTouching() == false)
-					{
-						other->m_sweep = backup;
-						other->SynchronizeTransform();
-						continue;
-					}
+				island.Add(contact);
+				contact->m_flags |= b2Contact::e_islandFlag;
 
-					// Add the contact to the island
-					contact->m_flags |= b2Contact::e_islandFlag;
-					island.Add(contact);
+				b2Body* other = ce->other;
 
-					// Has the other body already been added to the island?
-					if (other->m_flags & b2Body::e_islandFlag)
-					{
-						continue;
-					}
-					
-					// Add the other body to the island.
+				// A fixture may have stopped being a sensor while touching.
+				if (other->m_island && other->m_island != persistent)
+				{
+					MergeIslands(persistent, other->m_island);
+				}
+
+				// Static and kinematic bodies are shared between islands.
+				if (other->GetType() != b2_dynamicBody &&
+					(other->m_flags & b2Body::e_islandFlag) == 0)
+				{
+					island.Add(other);
 					other->m_flags |= b2Body::e_islandFlag;
+				}
+			}
 
-					if (other->m_type != b2_staticBody)
-					{
-						other->SetAwake(true);
-					}
+			// Search all joints connect to this body.
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->joint->m_islandFlag == true)
+				{
+					continue;
+				}
+
+				b2Body* other = je->other;
+
+				// Don't simulate joints connected to inactive bodies.
+				if (other->IsActive() == false)
+				{
+					continue;
+				}
+
+				island.Add(je->joint);
+				je->joint->m_islandFlag = true;
+
+				if (other->m_island && other->m_island != persistent)
+				{
+					MergeIslands(persistent, other->m_island);
+				}
 
+				if (other->GetType() != b2_dynamicBody &&
+					(other->m_flags & b2Body::e_islandFlag) == 0)
+				{
 					island.Add(other);
+					other->m_flags |= b2Body::e_islandFlag;
 				}
 			}
 		}
 
-		b2TimeStep subStep;
-		subStep.dt = (1.0f - minAlpha) * step.dt;
-		subStep.inv_dt = 1.0f / subStep.dt;
-		subStep.dtRatio = 1.0f;
-		subStep.positionIterations = 20;
-		subStep.velocityIterations = step.velocityIterations;
-		subStep.warmStarting = false;
-		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
+		m_profile.buildIslands += buildTimer.GetMilliseconds();
+		b2TraceEnd();
+
+		b2Profile profile;
+		island.Solve(&profile, step, m_gravity, m_allowSleep);
+		m_profile.solveInit += profile.solveInit;
+		m_profile.solveVelocity += profile.solveVelocity;
+		m_profile.solvePosition += profile.solvePosition;
+
+		// Post solve cleanup.
+		for (int32 i = 0; i < island.m_contactCount; ++i)
+		{
+			island.m_contacts[i]->m_flags &= ~b2Contact::e_islandFlag;
+		}
+
+		for (int32 i = 0; i < island.m_jointCount; ++i)
+		{
+			island.m_joints[i]->m_islandFlag = false;
+		}
 
-		// Reset island flags and synchronize broad-phase proxies.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
 		{
-			b2Body* body = island.m_bodies[i];
-			body->m_flags &= ~b2Body::e_islandFlag;
+			// Allow static and kinematic bodies to participate in other islands.
+			b2Body* b = island.m_bodies[i];
+			if (b->GetType() != b2_dynamicBody)
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
+			}
+		}
+
+		// Synchronize fixtures (for broad-phase).
+		b2TraceBegin("Synchronize fixtures");
+		b2Timer synchronizeTimer;
+		float32 minSleepTime = b2_maxFloat;
+		for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
+		{
+			b->SynchronizeFixtures();
+			b->m_flags &= ~b2Body::e_islandFlag;
+			minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+		}
+		synchronizeTime += synchronizeTimer.GetMilliseconds();
+		b2TraceEnd();
+
+		b2PersistentIsland* next = persistent->next;
+
+		if (persistent->bodyList->IsAwake() == false)
+		{
+			// The island fell asleep. Make sure it sleeps at its minimum size.
+			b2Timer splitTimer;
+			if (persistent->constraintRemoveCount > 0)
+			{
+				SplitIsland(persistent);
+			}
+			else
+			{
+				SleepIsland(persistent);
+			}
+			m_profile.buildIslands += splitTimer.GetMilliseconds();
+		}
+		else if (persistent->constraintRemoveCount > 0 && minSleepTime > splitSleepTime)
+		{
+			// Prefer splitting the island closest to falling asleep.
+			m_splitIsland = persistent;
+			splitSleepTime = minSleepTime;
+		}
+
+		persistent = next;
+	}
+
+	// Split at most one awake island per step to bound the cost.
+	if (m_splitIsland)
+	{
+		b2Timer splitTimer;
+		SplitIsland(m_splitIsland);
+		m_splitIsland = NULL;
+		m_profile.buildIslands += splitTimer.GetMilliseconds();
+	}
+
+	{
+		b2Timer timer;
+
+		// Look for new contacts.
+		FindNewContacts();
+		m_profile.broadphase = synchronizeTime + timer.GetMilliseconds();
+	}
+}
+
+// Integrate the awake kinematic bodies in one flat pass. Their velocities are
+// not affected by anything, so they don't need islands. A moving kinematic body
+// wakes the bodies it touches, which would otherwise share its island.
+void b2World::SolveKinematic(const b2TimeStep& step)
+{
+	b2TraceScope("b2World::SolveKinematic");
+
+	float32 h = step.dt;
+
+	const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
+	const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
+
+	for (b2Body* b = m_kinematicList; b; b = b->m_islandNext)
+	{
+		if (b->IsAwake() == false)
+		{
+			continue;
+		}
+
+		// Store positions for continuous collision.
+		b->m_sweep.c0 = b->m_sweep.c;
+		b->m_sweep.a0 = b->m_sweep.a;
+
+		b2Vec2 v = b->m_linearVelocity;
+		float32 w = b->m_angularVelocity;
+
+		// Check for large velocities
+		b2Vec2 translation = h * v;
+		if (b2Dot(translation, translation) > b2_maxTranslationSquared)
+		{
+			float32 ratio = b2_maxTranslation / translation.Length();
+			v *= ratio;
+		}
+
+		float32 rotation = h * w;
+		if (rotation * rotation > b2_maxRotationSquared)
+		{
+			float32 ratio = b2_maxRotation / b2Abs(rotation);
+			w *= ratio;
+		}
+
+		b->m_sweep.c += h * v;
+		b->m_sweep.a += h * w;
+		b->m_linearVelocity = v;
+		b->m_angularVelocity = w;
+		b->SynchronizeTransform();
+		b->SynchronizeFixtures();
+
+		if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
+			w * w > angTolSqr ||
+			b2Dot(v, v) > linTolSqr)
+		{
+			b->m_sleepTime = 0.0f;
+
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* contact = ce->contact;
+				if (contact->IsEnabled() == false ||
+					contact->IsTouching() == false ||
+					contact->m_fixtureA->m_isSensor ||
+					contact->m_fixtureB->m_isSensor)
+				{
+					continue;
+				}
+
+				if (ce->other->GetType() == b2_dynamicBody)
+				{
+					ce->other->SetAwake(true);
+				}
+			}
+
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->other->GetType() == b2_dynamicBody && je->other->IsActive())
+				{
+					je->other->SetAwake(true);
+				}
+			}
+		}
+		else if (m_allowSleep)
+		{
+			b->m_sleepTime += h;
+			if (b->m_sleepTime >= b2_timeToSleep)
+			{
+				b->SetAwake(false);
+			}
+		}
+	}
+}
+
+// Get the time of impact of a contact in the current step, or 1 if the
+// contact doesn't need continuous collision. The result is cached until
+// the contact's TOI flag is cleared.
+float32 b2World::ComputeTOI(b2Contact* c)
+{
+	// Is this contact disabled?
+	if (c->IsEnabled() == false)
+	{
+		return 1.0f;
+	}
+
+	// Prevent excessive sub-stepping.
+	if (c->m_toiCount > b2_maxSubSteps)
+	{
+		return 1.0f;
+	}
+
+	if (c->m_flags & b2Contact::e_toiFlag)
+	{
+		// This contact has a valid cached TOI.
+		return c->m_toi;
+	}
+
+	b2Fixture* fA = c->GetFixtureA();
+	b2Fixture* fB = c->GetFixtureB();
+
+	// Is there a sensor?
+	if (fA->IsSensor() || fB->IsSensor())
+	{
+		return 1.0f;
+	}
+
+	b2Body* bA = fA->GetBody();
+	b2Body* bB = fB->GetBody();
+
+	b2BodyType typeA = bA->m_type;
+	b2BodyType typeB = bB->m_type;
+	b2Assert(typeA == b2_dynamicBody || typeB == b2_dynamicBody);
+
+	bool activeA = bA->IsAwake() && typeA != b2_staticBody;
+	bool activeB = bB->IsAwake() && typeB != b2_staticBody;
+
+	// Is at least one body active (awake and dynamic or kinematic)?
+	if (activeA == false && activeB == false)
+	{
+		return 1.0f;
+	}
+
+	bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
+	bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
+
+	// Are these two non-bullet dynamic bodies?
+	if (collideA == false && collideB == false)
+	{
+		return 1.0f;
+	}
+
+	// Speculative bodies are kept from tunneling by speculative contacts.
+	if (bA->IsSpeculative() || bB->IsSpeculative())
+	{
+		return 1.0f;
+	}
+
+	// Compute the TOI for this contact.
+	// Put the sweeps onto the same time interval.
+	float32 alpha0 = bA->m_sweep.alpha0;
+
+	if (bA->m_sweep.alpha0 < bB->m_sweep.alpha0)
+	{
+		alpha0 = bB->m_sweep.alpha0;
+		bA->m_sweep.Advance(alpha0);
+	}
+	else if (bB->m_sweep.alpha0 < bA->m_sweep.alpha0)
+	{
+		alpha0 = bA->m_sweep.alpha0;
+		bB->m_sweep.Advance(alpha0);
+	}
+
+	b2Assert(alpha0 < 1.0f);
+
+	int32 indexA = c->GetChildIndexA();
+	int32 indexB = c->GetChildIndexB();
+
+	// Compute the time of impact in interval [0, minTOI]
+	b2TOIInput input;
+	input.proxyA.Set(fA->GetShape(), indexA);
+	input.proxyB.Set(fB->GetShape(), indexB);
+	input.sweepA = bA->m_sweep;
+	input.sweepB = bB->m_sweep;
+	input.tMax = 1.0f;
+
+	b2TOIOutput output;
+	b2TimeOfImpact(&output, &input);
+
+	// Beta is the fraction of the remaining portion of the .
+	float32 beta = output.t;
+	float32 alpha;
+	if (output.state == b2TOIOutput::e_touching)
+	{
+		alpha = b2Min(alpha0 + (1.0f - alpha0) * beta, 1.0f);
+	}
+	else
+	{
+		alpha = 1.0f;
+	}
+
+	c->m_toi = alpha;
+	c->m_flags |= b2Contact::e_toiFlag;
+	return alpha;
+}
+
+void b2World::PushTOIEvent(b2Contact* contact, float32 alpha)
+{
+	if (m_toiEventCount == m_toiEventCapacity)
+	{
+		b2TOIEvent* oldEvents = m_toiEvents;
+		int32 oldCapacity = m_toiEventCapacity;
+		m_toiEventCapacity = oldCapacity > 0 ? 2 * oldCapacity : 64;
+		m_toiEvents = (b2TOIEvent*)m_blockAllocator.Allocate(m_toiEventCapacity * sizeof(b2TOIEvent));
+		if (oldEvents)
+		{
+			memcpy(m_toiEvents, oldEvents, m_toiEventCount * sizeof(b2TOIEvent));
+			m_blockAllocator.Free(oldEvents, oldCapacity * sizeof(b2TOIEvent));
+		}
+	}
+
+	// Sift up.
+	int32 index = m_toiEventCount++;
+	while (index > 0)
+	{
+		int32 parent = (index - 1) >> 1;
+		if (m_toiEvents[parent].alpha <= alpha)
+		{
+			break;
+		}
+
+		m_toiEvents[index] = m_toiEvents[parent];
+		index = parent;
+	}
+
+	m_toiEvents[index].contact = contact;
+	m_toiEvents[index].alpha = alpha;
+}
+
+// Pop the earliest event that is still valid. Events go stale when the
+// contact is solved or its TOI is recomputed, they are skipped here.
+b2Contact* b2World::PopTOIEvent(float32* alpha)
+{
+	while (m_toiEventCount > 0)
+	{
+		b2TOIEvent top = m_toiEvents[0];
+
+		// Sift down the last event from the root.
+		b2TOIEvent last = m_toiEvents[--m_toiEventCount];
+		int32 index = 0;
+		for (;;)
+		{
+			int32 child = 2 * index + 1;
+			if (child >= m_toiEventCount)
+			{
+				break;
+			}
+
+			if (child + 1 < m_toiEventCount && m_toiEvents[child + 1].alpha < m_toiEvents[child].alpha)
+			{
+				++child;
+			}
+
+			if (last.alpha <= m_toiEvents[child].alpha)
+			{
+				break;
+			}
+
+			m_toiEvents[index] = m_toiEvents[child];
+			index = child;
+		}
+		m_toiEvents[index] = last;
+
+		b2Contact* c = top.contact;
+		if ((c->m_flags & b2Contact::e_toiFlag) && c->m_toi == top.alpha &&
+			c->IsEnabled() && c->m_toiCount <= b2_maxSubSteps)
+		{
+			*alpha = top.alpha;
+			return c;
+		}
+	}
+
+	return NULL;
+}
+
+// Find TOI contacts and solve them. Pending events are kept in a heap, so
+// each event only recomputes the TOI of the contacts it disturbed.
+void b2World::SolveTOI(const b2TimeStep& step)
+{
+	b2TraceScope("b2World::SolveTOI");
+
+	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+
+	if (m_stepComplete)
+	{
+		for (int32 i = 0; i < m_bodyPool.GetCapacity(); ++i)
+		{
+			b2Body* b = (b2Body*)m_bodyPool.Find(i);
+			if (b)
+			{
+				b->m_flags &= ~b2Body::e_islandFlag;
+				b->m_sweep.alpha0 = 0.0f;
+			}
+		}
+
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		{
+			// Invalidate TOI
+			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+			c->m_toiCount = 0;
+			c->m_toi = 1.0f;
+		}
+	}
+
+	// Find the TOI events.
+	m_toiEventCount = 0;
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		float32 alpha = ComputeTOI(c);
+		if (alpha < 1.0f)
+		{
+			PushTOIEvent(c, alpha);
+		}
+	}
+
+	// Solve them in time order.
+	for (;;)
+	{
+		float32 minAlpha = 1.0f;
+		b2Contact* minContact = PopTOIEvent(&minAlpha);
+
+		if (minContact == NULL || 1.0f - 10.0f * b2_epsilon < minAlpha)
+		{
+			// No more TOI events. Done!
+			m_stepComplete = true;
+			break;
+		}
+
+		if (m_toiBudget > 0 && m_profile.toiEvents >= m_toiBudget)
+		{
+			// Out of budget. The remaining bodies finish the step without
+			// continuous collision.
+			m_profile.toiDeferred = 1;
+			while (PopTOIEvent(&minAlpha))
+			{
+				++m_profile.toiDeferred;
+			}
+
+			m_stepComplete = true;
+			break;
+		}
+
+		// Advance the bodies to the TOI.
+		b2Fixture* fA = minContact->GetFixtureA();
+		b2Fixture* fB = minContact->GetFixtureB();
+		b2Body* bA = fA->GetBody();
+		b2Body* bB = fB->GetBody();
+
+		b2Sweep backup1 = bA->m_sweep;
+		b2Sweep backup2 = bB->m_sweep;
+
+		bA->Advance(minAlpha);
+		bB->Advance(minAlpha);
+
+		// The TOI contact likely has some new contact points.
+		minContact->Update(m_contactManager.m_contactListener);
+		minContact->m_flags &= ~b2Contact::e_toiFlag;
+		++minContact->m_toiCount;
+
+		// Is the contact solid?
+		if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
+		{
+			// Restore the sweeps.
+			minContact->SetEnabled(false);
+			bA->m_sweep = backup1;
+			bB->m_sweep = backup2;
+			bA->SynchronizeTransform();
+			bB->SynchronizeTransform();
+			continue;
+		}
+
+		bA->SetAwake(true);
+		bB->SetAwake(true);
+
+		// Build the island
+		island.Clear();
+		island.Add(bA);
+		island.Add(bB);
+		island.Add(minContact);
+
+		bA->m_flags |= b2Body::e_islandFlag;
+		bB->m_flags |= b2Body::e_islandFlag;
+		minContact->m_flags |= b2Contact::e_islandFlag;
+
+		// Get contacts on bodyA and bodyB.
+		b2Body* bodies[2] = {bA, bB};
+		for (int32 i = 0; i < 2; ++i)
+		{
+			b2Body* body = bodies[i];
+			if (body->m_type == b2_dynamicBody)
+			{
+				for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+				{
+					if (island.m_bodyCount == island.m_bodyCapacity)
+					{
+						break;
+					}
+
+					if (island.m_contactCount == island.m_contactCapacity)
+					{
+						break;
+					}
+
+					b2Contact* contact = ce->contact;
+
+					// Has this contact already been added to the island?
+					if (contact->m_flags & b2Contact::e_islandFlag)
+					{
+						continue;
+					}
+
+					// Only add static, kinematic, or bullet bodies.
+					b2Body* other = ce->other;
+					if (other->m_type == b2_dynamicBody &&
+						body->IsBullet() == false && other->IsBullet() == false)
+					{
+						continue;
+					}
+
+					// Skip sensors.
+					bool sensorA = contact->m_fixtureA->m_isSensor;
+					bool sensorB = contact->m_fixtureB->m_isSensor;
+					if (sensorA || sensorB)
+					{
+						continue;
+					}
+
+					// Tentatively advance the body to the TOI.
+					b2Sweep backup = other->m_sweep;
+					if ((other->m_flags & b2Body::e_islandFlag) == 0)
+					{
+						other->Advance(minAlpha);
+					}
+
+					// Update the contact points
+					contact->Update(m_contactManager.m_contactListener);
+
+					// Was the contact disabled by the user?
+					if (contact->IsEnabled() == false)
+					{
+						other->m_sweep = backup;
+						other->SynchronizeTransform();
+						continue;
+					}
+
+					// Are there contact points?
+					if (contact->IsTouching() == false)
+					{
+						other->m_sweep = backup;
+						other->SynchronizeTransform();
+						continue;
+					}
+
+					// Add the contact to the island
+					contact->m_flags |= b2Contact::e_islandFlag;
+					island.Add(contact);
+
+					// Has the other body already been added to the island?
+					if (other->m_flags & b2Body::e_islandFlag)
+					{
+						continue;
+					}
+					
+					// Add the other body to the island.
+					other->m_flags |= b2Body::e_islandFlag;
+
+					if (other->m_type != b2_staticBody)
+					{
+						other->SetAwake(true);
+					}
+
+					island.Add(other);
+				}
+			}
+		}
+
+		b2TimeStep subStep;
+		subStep.dt = (1.0f - minAlpha) * step.dt;
+		subStep.inv_dt = 1.0f / subStep.dt;
+		subStep.dtRatio = 1.0f;
+		subStep.positionIterations = 20;
+		subStep.velocityIterations = step.velocityIterations;
+		subStep.warmStarting = false;
+		subStep.jointBatching = false;
+		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
+		++m_profile.toiEvents;
+
+		// Reset island flags and synchronize broad-phase proxies.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* body = island.m_bodies[i];
+			body->m_flags &= ~b2Body::e_islandFlag;
+
+			if (body->m_type != b2_dynamicBody)
+			{
+				continue;
+			}
+
+			body->SynchronizeFixtures();
+
+			// Invalidate all contact TOIs on this displaced body.
+			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			{
+				ce->contact->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+			}
+		}
+
+		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
+		b2Contact* oldContactList = m_contactManager.m_contactList;
+		FindNewContacts();
+
+		// New contacts are added to the front of the list.
+		for (b2Contact* c = m_contactManager.m_contactList; c != oldContactList; c = c->m_next)
+		{
+			float32 alpha = ComputeTOI(c);
+			if (alpha < 1.0f)
+			{
+				PushTOIEvent(c, alpha);
+			}
+		}
+
+		// Recompute the TOIs that were invalidated by moving the bodies.
+		for (int32 i = 0; i < island.m_bodyCount; ++i)
+		{
+			b2Body* body = island.m_bodies[i];
+			if (body->m_type != b2_dynamicBody)
+			{
+				continue;
+			}
+
+			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* c = ce->contact;
+				if (c->m_flags & b2Contact::e_toiFlag)
+				{
+					continue;
+				}
+
+				float32 alpha = ComputeTOI(c);
+				if (alpha < 1.0f)
+				{
+					PushTOIEvent(c, alpha);
+				}
+			}
+		}
+
+		if (m_subStepping)
+		{
+			m_stepComplete = false;
+			break;
+		}
+	}
+}
+
+void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
+{
+	b2TraceScope("b2World::Step");
+	b2Timer stepTimer;
+
+	for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
+	{
+		q->ClearEvents();
+	}
+
+	// If new fixtures were added, we need to find the new contacts.
+	if (m_flags & e_newFixture)
+	{
+		FindNewContacts();
+		m_flags &= ~e_newFixture;
+	}
+
+	m_flags |= e_locked;
+
+	b2TimeStep step;
+	step.dt = dt;
+	step.velocityIterations	= velocityIterations;
+	step.positionIterations = positionIterations;
+	if (dt > 0.0f)
+	{
+		step.inv_dt = 1.0f / dt;
+	}
+	else
+	{
+		step.inv_dt = 0.0f;
+	}
+
+	step.dtRatio = m_inv_dt0 * dt;
+
+	if (dt > 0.0f)
+	{
+		m_dt = dt;
+	}
+
+	step.warmStarting = m_warmStarting;
+	step.jointBatching = m_jointBatching;
+	
+	// Update contacts. This is where some contacts are destroyed.
+	m_profile.manifoldsReused = 0;
+	{
+		b2Timer timer;
+		m_contactManager.Collide();
+		m_profile.collide = timer.GetMilliseconds();
+	}
+
+	// Particles push the bodies before they are solved.
+	m_profile.solveParticles = 0.0f;
+	if (m_particleSystemList && step.dt > 0.0f)
+	{
+		b2Timer timer;
+		for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+		{
+			p->Solve(step);
+		}
+		m_profile.solveParticles = timer.GetMilliseconds();
+	}
+
+	// Integrate velocities, solve velocity constraints, and integrate positions.
+	if (m_stepComplete && step.dt > 0.0f)
+	{
+		b2Timer timer;
+		Solve(step);
+		m_profile.solve = timer.GetMilliseconds();
+	}
+
+	// Handle TOI events.
+	m_profile.toiEvents = 0;
+	m_profile.toiDeferred = 0;
+	if (m_continuousPhysics && step.dt > 0.0f)
+	{
+		b2Timer timer;
+		SolveTOI(step);
+		m_profile.solveTOI = timer.GetMilliseconds();
+	}
+
+	if (step.dt > 0.0f)
+	{
+		m_inv_dt0 = step.inv_dt;
+	}
+
+	if (m_flags & e_clearForces)
+	{
+		ClearForces();
+	}
+
+	// Queries that changed are refreshed even if nothing was solved.
+	if (m_queryList)
+	{
+		UpdateQueries();
+	}
+
+	m_flags &= ~e_locked;
+
+	m_profile.step = stepTimer.GetMilliseconds();
+}
+
+void b2World::FindNewContacts()
+{
+	// The queries read the moved proxies before UpdatePairs forgets them.
+	if (m_queryList)
+	{
+		UpdateQueries();
+	}
+
+	m_contactManager.FindNewContacts();
+}
+
+// Finds the queries a moved proxy enters for b2World::UpdateQueries.
+struct b2PersistentQueryUpdate
+{
+	bool QueryCallback(int32 treeProxyId)
+	{
+		b2PersistentQuery* query = (b2PersistentQuery*)queryTree->GetUserData(treeProxyId);
+		if (query->m_dirty || b2TestOverlap(query->m_aabb, *fatAABB) == false)
+		{
+			return true;
+		}
+
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		if (query->ShouldFind(proxy->fixture) == false || query->FindResult(proxyId) >= 0)
+		{
+			return true;
+		}
+
+		b2QueryHit hit = { proxy->fixture, proxy->childIndex, proxyId };
+		query->AddHit(&query->m_added, &query->m_addedCount, &query->m_addedCapacity, hit);
+		return true;
+	}
+
+	const b2DynamicTree* queryTree;
+	const b2BroadPhase* broadPhase;
+	const b2AABB* fatAABB;
+	int32 proxyId;
+};
+
+void b2World::UpdateQueries()
+{
+	b2TraceScope("b2World::UpdateQueries");
+
+	const b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	const int32* moveBuffer = broadPhase->GetMoveBuffer();
+	int32 moveCount = broadPhase->GetMoveCount();
+
+	if (moveCount > 0)
+	{
+		// Sort the moved proxies so the queries can look them up and add them
+		// in proxy order.
+		int32* moved = (int32*)m_stackAllocator.Allocate(moveCount * sizeof(int32));
+		int32 movedCount = 0;
+		for (int32 i = 0; i < moveCount; ++i)
+		{
+			if (moveBuffer[i] != b2BroadPhase::e_nullProxy)
+			{
+				moved[movedCount++] = moveBuffer[i];
+			}
+		}
+		std::sort(moved, moved + movedCount);
+		movedCount = int32(std::unique(moved, moved + movedCount) - moved);
+
+		for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
+		{
+			if (q->m_dirty == false)
+			{
+				q->RemoveMoved(broadPhase, moved, movedCount);
+				q->m_mergeStart = q->m_addedCount;
+			}
+		}
+
+		// Only the queries a moved proxy overlaps are visited.
+		b2PersistentQueryUpdate update;
+		update.queryTree = &m_queryTree;
+		update.broadPhase = broadPhase;
+		for (int32 i = 0; i < movedCount; ++i)
+		{
+			update.proxyId = moved[i];
+			update.fatAABB = &broadPhase->GetFatAABB(moved[i]);
+			m_queryTree.Query(&update, *update.fatAABB);
+		}
+
+		for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
+		{
+			if (q->m_dirty == false)
+			{
+				q->MergeAdded();
+			}
+		}
+
+		m_stackAllocator.Free(moved);
+	}
+
+	for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
+	{
+		if (q->m_dirty)
+		{
+			q->Refresh(broadPhase, true);
+		}
+	}
+}
+
+void b2World::RemoveFromQueries(b2Fixture* fixture, bool destroyed)
+{
+	for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
+	{
+		q->RemoveFixture(fixture, destroyed);
+	}
+}
+
+void b2World::ClearForces()
+{
+	for (int32 i = 0; i < m_bodyPool.GetCapacity(); ++i)
+	{
+		b2Body* body = (b2Body*)m_bodyPool.Find(i);
+		if (body)
+		{
+			body->m_force.SetZero();
+			body->m_torque = 0.0f;
+		}
+	}
+}
+
+struct b2WorldQueryWrapper
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		return callback->ReportFixture(proxy->fixture);
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2QueryCallback* callback;
+};
+
+void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
+{
+	b2WorldQueryWrapper wrapper;
+	wrapper.broadPhase = &m_contactManager.m_broadPhase;
+	wrapper.callback = callback;
+	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
+}
+
+struct b2WorldRayCastWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		void* userData = broadPhase->GetUserData(proxyId);
+		b2FixtureProxy* proxy = (b2FixtureProxy*)userData;
+		b2Fixture* fixture = proxy->fixture;
+		int32 index = proxy->childIndex;
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, index);
+
+		if (hit)
+		{
+			float32 fraction = output.fraction;
+			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+			return callback->ReportFixture(fixture, point, output.normal, fraction);
+		}
+
+		return input.maxFraction;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2RayCastCallback* callback;
+};
+
+void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const
+{
+	b2WorldRayCastWrapper wrapper;
+	wrapper.broadPhase = &m_contactManager.m_broadPhase;
+	wrapper.callback = callback;
+	b2RayCastInput input;
+	input.maxFraction = 1.0f;
+	input.p1 = point1;
+	input.p2 = point2;
+	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
+}
+
+template <typename T>
+static void b2DrawShape(T* draw, b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
+{
+	switch (fixture->GetType())
+	{
+	case b2Shape::e_circle:
+		{
+			b2CircleShape* circle = (b2CircleShape*)fixture->GetShape();
+
+			b2Vec2 center = b2Mul(xf, circle->m_p);
+			float32 radius = circle->m_radius;
+			b2Vec2 axis = b2Mul(xf.q, b2Vec2(1.0f, 0.0f));
+
+			draw->DrawSolidCircle(center, radius, axis, color);
+		}
+		break;
+
+	case b2Shape::e_edge:
+		{
+			b2EdgeShape* edge = (b2EdgeShape*)fixture->GetShape();
+			b2Vec2 v1 = b2Mul(xf, edge->m_vertex1);
+			b2Vec2 v2 = b2Mul(xf, edge->m_vertex2);
+			draw->DrawSegment(v1, v2, color);
+		}
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2ChainShape* chain = (b2ChainShape*)fixture->GetShape();
+			int32 count = chain->m_count;
+			const b2Vec2* vertices = chain->m_vertices;
+
+			b2Vec2 v1 = b2Mul(xf, vertices[0]);
+			for (int32 i = 1; i < count; ++i)
+			{
+				b2Vec2 v2 = b2Mul(xf, vertices[i]);
+				draw->DrawSegment(v1, v2, color);
+				draw->DrawCircle(v1, 0.05f, color);
+				v1 = v2;
+			}
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			b2PolygonShape* poly = (b2PolygonShape*)fixture->GetShape();
+			int32 vertexCount = poly->m_count;
+			b2Assert(vertexCount <= b2_maxPolygonVertices);
+			b2Vec2 vertices[b2_maxPolygonVertices];
+
+			for (int32 i = 0; i < vertexCount; ++i)
+			{
+				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
+			}
+
+			draw->DrawSolidPolygon(vertices, vertexCount, color);
+		}
+		break;
+            
+    default:
+        break;
+	}
+}
+
+template <typename T>
+static void b2DrawJoint(T* draw, b2Joint* joint)
+{
+	b2Body* bodyA = joint->GetBodyA();
+	b2Body* bodyB = joint->GetBodyB();
+	const b2Transform& xf1 = bodyA->GetTransform();
+	const b2Transform& xf2 = bodyB->GetTransform();
+	b2Vec2 x1 = xf1.p;
+	b2Vec2 x2 = xf2.p;
+	b2Vec2 p1 = joint->GetAnchorA();
+	b2Vec2 p2 = joint->GetAnchorB();
+
+	b2Color color(0.5f, 0.8f, 0.8f);
+
+	switch (joint->GetType())
+	{
+	case e_distanceJoint:
+		draw->DrawSegment(p1, p2, color);
+		break;
+
+	case e_pulleyJoint:
+		{
+			b2PulleyJoint* pulley = (b2PulleyJoint*)joint;
+			b2Vec2 s1 = pulley->GetGroundAnchorA();
+			b2Vec2 s2 = pulley->GetGroundAnchorB();
+			draw->DrawSegment(s1, p1, color);
+			draw->DrawSegment(s2, p2, color);
+			draw->DrawSegment(s1, s2, color);
+		}
+		break;
+
+	case e_mouseJoint:
+		// don't draw this
+		break;
+
+	default:
+		draw->DrawSegment(x1, p1, color);
+		draw->DrawSegment(p1, p2, color);
+		draw->DrawSegment(x2, p2, color);
+	}
+}
+
+template <typename T>
+void b2World::DrawWorld(T* draw)
+{
+	uint32 flags = draw->GetFlags();
+
+	if (flags & b2Draw::e_shapeBit)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			const b2Transform& xf = b->GetTransform();
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			{
+				if (b->IsActive() == false)
+				{
+					b2DrawShape(draw, f, xf, b2Color(0.5f, 0.5f, 0.3f));
+				}
+				else if (b->GetType() == b2_staticBody)
+				{
+					b2DrawShape(draw, f, xf, b2Color(0.5f, 0.9f, 0.5f));
+				}
+				else if (b->GetType() == b2_kinematicBody)
+				{
+					b2DrawShape(draw, f, xf, b2Color(0.5f, 0.5f, 0.9f));
+				}
+				else if (b->IsAwake() == false)
+				{
+					b2DrawShape(draw, f, xf, b2Color(0.6f, 0.6f, 0.6f));
+				}
+				else
+				{
+					b2DrawShape(draw, f, xf, b2Color(0.9f, 0.7f, 0.7f));
+				}
+			}
+		}
+	}
+
+	if (flags & b2Draw::e_jointBit)
+	{
+		for (b2Joint* j = m_jointList; j; j = j->GetNext())
+		{
+			b2DrawJoint(draw, j);
+		}
+	}
+
+	if (flags & b2Draw::e_pairBit)
+	{
+		b2Color color(0.3f, 0.9f, 0.9f);
+		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->GetNext())
+		{
+			//b2Fixture* fixtureA = c->GetFixtureA();
+			//b2Fixture* fixtureB = c->GetFixtureB();
+
+			//b2Vec2 cA = fixtureA->GetAABB().GetCenter();
+			//b2Vec2 cB = fixtureB->GetAABB().GetCenter();
+
+			//draw->DrawSegment(cA, cB, color);
+		}
+	}
+
+	if (flags & b2Draw::e_aabbBit)
+	{
+		b2Color color(0.9f, 0.3f, 0.9f);
+		b2BroadPhase* bp = &m_contactManager.m_broadPhase;
+
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			if (b->IsActive() == false)
+			{
+				continue;
+			}
+
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			{
+				for (int32 i = 0; i < f->m_proxyCount; ++i)
+				{
+					b2FixtureProxy* proxy = f->m_proxies + i;
+					b2AABB aabb = bp->GetFatAABB(proxy->proxyId);
+					b2Vec2 vs[4];
+					vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
+					vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
+					vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
+					vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
+
+					draw->DrawPolygon(vs, 4, color);
+				}
+			}
+		}
+	}
+
+	if (flags & b2Draw::e_centerOfMassBit)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			b2Transform xf = b->GetTransform();
+			xf.p = b->GetWorldCenter();
+			draw->DrawTransform(xf);
+		}
+	}
+
+	if (flags & b2Draw::e_particleBit)
+	{
+		for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+		{
+			p->Draw(draw);
+		}
+	}
+}
+
+void b2World::DrawDebugData()
+{
+	if (g_debugDraw == NULL)
+	{
+		return;
+	}
+
+	DrawWorld(g_debugDraw);
+}
+
+void b2World::DrawDebugData(b2DrawBuffer* buffer)
+{
+	DrawWorld(buffer);
+}
+
+int32 b2World::GetProxyCount() const
+{
+	return m_contactManager.m_broadPhase.GetProxyCount();
+}
+
+int32 b2World::GetTreeHeight() const
+{
+	return m_contactManager.m_broadPhase.GetTreeHeight();
+}
 
-			if (body->m_type != b2_dynamicBody)
-			{
-				continue;
-			}
+int32 b2World::GetTreeBalance() const
+{
+	return m_contactManager.m_broadPhase.GetTreeBalance();
+}
 
-			body->SynchronizeFixtures();
+float32 b2World::GetTreeQuality() const
+{
+	return m_contactManager.m_broadPhase.GetTreeQuality();
+}
 
-			// Invalidate all contact TOIs on this displaced body.
-			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
-			{
-				ce->contact->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			}
-		}
+void b2World::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	b2Assert((m_flags & e_locked) == 0);
+	if ((m_flags & e_locked) == e_locked)
+	{
+		return;
+	}
 
-		// Commit fixture proxy movements to the broad-phase so that new contacts are created.
-		// Also, some contacts can be destroyed.
-		m_contactManager.FindNewContacts();
+	m_origin += newOrigin;
 
-		if (m_subStepping)
+	// Parked regions keep their origin until they are unparked, so only the
+	// bodies of the other regions are touched.
+	ShiftRegion(&m_globalRegion, newOrigin);
+	for (int32 i = 0; i < m_regionCount; ++i)
+	{
+		if (m_regions[i].parked == false)
 		{
-			m_stepComplete = false;
-			break;
+			ShiftRegion(m_regions + i, newOrigin);
 		}
 	}
-}
-
-void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
-{
-	b2Timer stepTimer;
 
-	// If new fixtures were added, we need to find the new contacts.
-	if (m_flags & e_newFixture)
+	// Joint anchors in world coordinates always follow the world origin.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
 	{
-		m_contactManager.FindNewContacts();
-		m_flags &= ~e_newFixture;
+		j->ShiftOrigin(newOrigin);
 	}
 
-	m_flags |= e_locked;
-
-	b2TimeStep step;
-	step.dt = dt;
-	step.velocityIterations	= velocityIterations;
-	step.positionIterations = positionIterations;
-	if (dt > 0.0f)
+	for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
 	{
-		step.inv_dt = 1.0f / dt;
+		p->ShiftOrigin(newOrigin);
 	}
-	else
+
+	for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
 	{
-		step.inv_dt = 0.0f;
+		q->ShiftOrigin(newOrigin);
 	}
+	m_queryTree.ShiftOrigin(newOrigin);
 
-	step.dtRatio = m_inv_dt0 * dt;
+	// Parked proxies are out of the tree and get new AABBs when unparked.
+	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
+}
 
-	step.warmStarting = m_warmStarting;
-	
-	// Update contacts. This is where some contacts are destroyed.
+void b2World::ShiftRegion(b2Region* region, const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < region->bodyCount; ++i)
 	{
-		b2Timer timer;
-		m_contactManager.Collide();
-		m_profile.collide = timer.GetMilliseconds();
+		ShiftBody(region->bodies[i], newOrigin);
 	}
+}
 
-	// Integrate velocities, solve velocity constraints, and integrate positions.
-	if (m_stepComplete && step.dt > 0.0f)
+void b2World::ShiftBody(b2Body* body, const b2Vec2& newOrigin)
+{
+	body->m_xf.p -= newOrigin;
+	body->m_sweep.c0 -= newOrigin;
+	body->m_sweep.c -= newOrigin;
+}
+
+void b2World::Dump()
+{
+	if ((m_flags & e_locked) == e_locked)
 	{
-		b2Timer timer;
-		Solve(step);
-		m_profile.solve = timer.GetMilliseconds();
+		return;
 	}
 
-	// Handle TOI events.
-	if (m_continuousPhysics && step.dt > 0.0f)
+	b2Log("b2Vec2 g(%.15lef, %.15lef);\n", m_gravity.x, m_gravity.y);
+	b2Log("m_world->SetGravity(g);\n");
+
+	b2Log("b2Body** bodies = (b2Body**)b2Alloc(%d * sizeof(b2Body*));\n", m_bodyCount);
+	b2Log("b2Joint** joints = (b2Joint**)b2Alloc(%d * sizeof(b2Joint*));\n", m_jointCount);
+	int32 i = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-		b2Timer timer;
-		SolveTOI(step);
-		m_profile.solveTOI = timer.GetMilliseconds();
+		b->m_islandIndex = i;
+		b->Dump();
+		++i;
 	}
 
-	if (step.dt > 0.0f)
+	i = 0;
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
 	{
-		m_inv_dt0 = step.inv_dt;
+		j->m_index = i;
+		++i;
 	}
 
-	if (m_flags & e_clearForces)
+	// First pass on joints, skip gear joints.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
 	{
-		ClearForces();
+		if (j->m_type == e_gearJoint)
+		{
+			continue;
+		}
+
+		b2Log("{\n");
+		j->Dump();
+		b2Log("}\n");
 	}
 
-	m_flags &= ~e_locked;
+	// Second pass on joints, only gear joints.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		if (j->m_type != e_gearJoint)
+		{
+			continue;
+		}
 
-	m_profile.step = stepTimer.GetMilliseconds();
+		b2Log("{\n");
+		j->Dump();
+		b2Log("}\n");
+	}
+
+	b2Log("b2Free(joints);\n");
+	b2Log("b2Free(bodies);\n");
+	b2Log("joints = NULL;\n");
+	b2Log("bodies = NULL;\n");
 }
 
-void b2World::ClearForces()
+static void b2AddObject(b2ObjectMemory* memory, int32 size)
 {
-	for (b2Body* body = m_bodyList; body; body = body->GetNext())
-	{
-		body->m_force.SetZero();
-		body->m_torque = 0.0f;
-	}
+	memory->count += 1;
+	memory->bytes += b2BlockAllocator::GetBlockSize(size);
 }
 
-struct b2WorldQueryWrapper
+static int32 b2GetShapeSize(const b2Shape* shape)
 {
-	bool QueryCallback(int32 proxyId)
+	switch (shape->GetType())
 	{
-		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
-		return callback->ReportFixture(proxy->fixture);
-	}
+	case b2Shape::e_circle:
+		return sizeof(b2CircleShape);
 
-	const b2BroadPhase* broadPhase;
-	b2QueryCallback* callback;
-};
+	case b2Shape::e_edge:
+		return sizeof(b2EdgeShape);
 
-void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
-{
-	b2WorldQueryWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
-	wrapper.callback = callback;
-	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
+	case b2Shape::e_polygon:
+		return sizeof(b2PolygonShape);
+
+	case b2Shape::e_chain:
+		return sizeof(b2ChainShape);
+
+	default:
+		b2Assert(false);
+		return 0;
+	}
 }
 
-struct b2WorldRayCastWrapper
+void b2World::GetMemoryStats(b2MemoryStats* stats) const
 {
-	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	memset(stats, 0, sizeof(b2MemoryStats));
+
+	// Bodies and fixtures are counted with their whole pools.
+	stats->bodies.count = m_bodyPool.GetCount();
+	stats->bodies.bytes = m_bodyPool.GetMemorySize();
+	stats->fixtures.count = m_fixturePool.GetCount();
+	stats->fixtures.bytes = m_fixturePool.GetMemorySize();
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-		void* userData = broadPhase->GetUserData(proxyId);
-		b2FixtureProxy* proxy = (b2FixtureProxy*)userData;
-		b2Fixture* fixture = proxy->fixture;
-		int32 index = proxy->childIndex;
-		b2RayCastOutput output;
-		bool hit = fixture->RayCast(&output, input, index);
+		// An island is counted with its first body.
+		if (b->m_island && b->m_island->bodyList == b)
+		{
+			b2AddObject(&stats->islands, sizeof(b2PersistentIsland));
+		}
 
-		if (hit)
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
 		{
-			float32 fraction = output.fraction;
-			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
-			return callback->ReportFixture(fixture, point, output.normal, fraction);
+			stats->fixtures.bytes += b2BlockAllocator::GetBlockSize(f->m_shape->GetChildCount() * sizeof(b2FixtureProxy));
+
+			b2AddObject(&stats->shapes, b2GetShapeSize(f->m_shape));
+			if (f->m_shape->GetType() == b2Shape::e_chain)
+			{
+				// Chain vertices come from b2Alloc.
+				stats->shapes.bytes += ((b2ChainShape*)f->m_shape)->m_count * sizeof(b2Vec2);
+			}
 		}
+	}
 
-		return input.maxFraction;
+	// The contact types add no members to b2Contact.
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		b2AddObject(&stats->contacts, sizeof(b2Contact));
+		if (c->m_manifold)
+		{
+			b2AddObject(&stats->manifolds, sizeof(b2Manifold));
+		}
 	}
 
-	const b2BroadPhase* broadPhase;
-	b2RayCastCallback* callback;
-};
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		b2AddObject(&stats->joints, b2Joint::GetSize(j->m_type));
+	}
 
-void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const
-{
-	b2WorldRayCastWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
-	wrapper.callback = callback;
-	b2RayCastInput input;
-	input.maxFraction = 1.0f;
-	input.p1 = point1;
-	input.p2 = point2;
-	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
+	stats->regions.count = m_regionCount;
+	stats->regions.bytes = b2BlockAllocator::GetBlockSize(m_regionCount * sizeof(b2Region));
+	for (int32 i = 0; i < m_regionCount; ++i)
+	{
+		stats->regions.bytes += b2BlockAllocator::GetBlockSize(m_regions[i].bodyCapacity * sizeof(b2Body*));
+	}
+	stats->regions.bytes += b2BlockAllocator::GetBlockSize(m_globalRegion.bodyCapacity * sizeof(b2Body*));
+
+	const b2BroadPhase& broadPhase = m_contactManager.m_broadPhase;
+	stats->proxies.count = broadPhase.GetProxyCount();
+	stats->proxies.bytes = broadPhase.GetMemorySize();
+
+	for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+	{
+		stats->particles.count += p->GetParticleCount();
+		stats->particles.bytes += b2BlockAllocator::GetBlockSize(sizeof(b2ParticleSystem)) + p->GetMemorySize();
+	}
+
+	for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
+	{
+		stats->queries.count += 1;
+		stats->queries.bytes += b2BlockAllocator::GetBlockSize(sizeof(b2PersistentQuery)) + q->GetMemorySize();
+	}
+	stats->queries.bytes += m_queryTree.GetMemorySize();
+
+	stats->stackBytes = m_stackAllocator.GetCapacity();
+	m_blockAllocator.GetStats(stats->blockClasses);
+	stats->allocator = m_statsAllocator.GetStats();
 }
 
-void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
+// Snapshot layout, all values in native byte order:
+// header, object identities, world, bodies, fixtures, broad-phase, contacts, joints, islands,
+// kinematic bodies.
+static const uint32 b2_snapshotMagic = 0x53533242;
+static const int32 b2_snapshotVersion = 6;
+
+int32 b2World::SaveSnapshot(void* buffer, int32 capacity) const
 {
-	switch (fixture->GetType())
-	{
-	case b2Shape::e_circle:
-		{
-			b2CircleShape* circle = (b2CircleShape*)fixture->GetShape();
+	b2SnapshotWriter writer(buffer, capacity);
 
-			b2Vec2 center = b2Mul(xf, circle->m_p);
-			float32 radius = circle->m_radius;
-			b2Vec2 axis = b2Mul(xf.q, b2Vec2(1.0f, 0.0f));
+	int32 fixtureCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		fixtureCount += b->m_fixtureCount;
+	}
 
-			g_debugDraw->DrawSolidCircle(center, radius, axis, color);
+	int32 islandCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->m_island && b->m_island->bodyList == b)
+		{
+			++islandCount;
 		}
-		break;
+	}
 
-	case b2Shape::e_edge:
+	// Header
+	writer.Write(b2_snapshotMagic);
+	writer.Write(b2_snapshotVersion);
+	int32 sizeOffset = writer.GetSize();
+	writer.Write(int32(0));
+	writer.Write(m_bodyCount);
+	writer.Write(fixtureCount);
+	writer.Write(m_jointCount);
+
+	// Identities. Restoring requires the same bodies, fixtures, joints and regions.
+	writer.Write(m_regionCount);
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		writer.Write(b);
+		writer.Write(b->m_region);
+		writer.Write(b->m_regionIndex);
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
 		{
-			b2EdgeShape* edge = (b2EdgeShape*)fixture->GetShape();
-			b2Vec2 v1 = b2Mul(xf, edge->m_vertex1);
-			b2Vec2 v2 = b2Mul(xf, edge->m_vertex2);
-			g_debugDraw->DrawSegment(v1, v2, color);
+			writer.Write(f);
+			writer.Write(f->m_proxyCount);
 		}
-		break;
+	}
 
-	case b2Shape::e_chain:
-		{
-			b2ChainShape* chain = (b2ChainShape*)fixture->GetShape();
-			int32 count = chain->m_count;
-			const b2Vec2* vertices = chain->m_vertices;
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		writer.Write(j);
+		writer.Write(j->m_type);
+	}
 
-			b2Vec2 v1 = b2Mul(xf, vertices[0]);
-			for (int32 i = 1; i < count; ++i)
-			{
-				b2Vec2 v2 = b2Mul(xf, vertices[i]);
-				g_debugDraw->DrawSegment(v1, v2, color);
-				g_debugDraw->DrawCircle(v1, 0.05f, color);
-				v1 = v2;
-			}
-		}
-		break;
+	// World
+	writer.Write(m_flags & ~e_locked);
+	writer.Write(m_gravity);
+	writer.Write(m_allowSleep);
+	writer.Write(m_warmStarting);
+	writer.Write(m_continuousPhysics);
+	writer.Write(m_subStepping);
+	writer.Write(m_stepComplete);
+	writer.Write(m_inv_dt0);
+	writer.Write(m_origin);
+
+	for (int32 i = 0; i < m_regionCount; ++i)
+	{
+		writer.Write(m_regions[i].parked);
+		writer.Write(m_regions[i].origin);
+	}
 
-	case b2Shape::e_polygon:
+	// Bodies and fixtures
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		writer.Write(b->m_type);
+		writer.Write(b->m_flags);
+		writer.Write(b->m_xf);
+		writer.Write(b->m_sweep);
+		writer.Write(b->m_linearVelocity);
+		writer.Write(b->m_angularVelocity);
+		writer.Write(b->m_force);
+		writer.Write(b->m_torque);
+		writer.Write(b->m_mass);
+		writer.Write(b->m_invMass);
+		writer.Write(b->m_I);
+		writer.Write(b->m_invI);
+		writer.Write(b->m_linearDamping);
+		writer.Write(b->m_angularDamping);
+		writer.Write(b->m_gravityScale);
+		writer.Write(b->m_sleepTime);
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
 		{
-			b2PolygonShape* poly = (b2PolygonShape*)fixture->GetShape();
-			int32 vertexCount = poly->m_count;
-			b2Assert(vertexCount <= b2_maxPolygonVertices);
-			b2Vec2 vertices[b2_maxPolygonVertices];
+			writer.Write(f->m_density);
+			writer.Write(f->m_friction);
+			writer.Write(f->m_restitution);
+			writer.Write(f->m_filter);
+			writer.Write(f->m_isSensor);
 
-			for (int32 i = 0; i < vertexCount; ++i)
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
 			{
-				vertices[i] = b2Mul(xf, poly->m_vertices[i]);
+				writer.Write(f->m_proxies[i].aabb);
+				writer.Write(f->m_proxies[i].proxyId);
 			}
+		}
+	}
+
+	m_contactManager.m_broadPhase.WriteSnapshot(&writer);
 
-			g_debugDraw->DrawSolidPolygon(vertices, vertexCount, color);
+	// Contacts in world list order. Body contact lists share this order
+	// because contacts are always prepended to both.
+	writer.Write(m_contactManager.m_contactCount);
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		writer.Write(c->m_fixtureA);
+		writer.Write(c->m_indexA);
+		writer.Write(c->m_fixtureB);
+		writer.Write(c->m_indexB);
+		writer.Write(c->m_flags);
+		writer.Write(c->m_manifold != NULL);
+		if (c->m_manifold)
+		{
+			writer.Write(*c->m_manifold);
 		}
-		break;
-            
-    default:
-        break;
+		writer.Write(c->m_toiCount);
+		writer.Write(c->m_toi);
+		writer.Write(c->m_friction);
+		writer.Write(c->m_restitution);
+		writer.Write(c->m_tangentSpeed);
+		writer.Write(c->m_cachePosition);
+		writer.Write(c->m_cacheAngle);
 	}
-}
 
-void b2World::DrawJoint(b2Joint* joint)
-{
-	b2Body* bodyA = joint->GetBodyA();
-	b2Body* bodyB = joint->GetBodyB();
-	const b2Transform& xf1 = bodyA->GetTransform();
-	const b2Transform& xf2 = bodyB->GetTransform();
-	b2Vec2 x1 = xf1.p;
-	b2Vec2 x2 = xf2.p;
-	b2Vec2 p1 = joint->GetAnchorA();
-	b2Vec2 p2 = joint->GetAnchorB();
+	// Joints are stored whole, including warm starting and limit state.
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		writer.Write(j, b2Joint::GetSize(j->m_type));
+	}
 
-	b2Color color(0.5f, 0.8f, 0.8f);
+	// Islands: awake islands in list order, then sleeping islands.
+	writer.Write(islandCount);
+	for (b2PersistentIsland* island = m_islandList; island; island = island->next)
+	{
+		writer.Write(island->awake);
+		writer.Write(island->constraintRemoveCount);
+		writer.Write(island->bodyCount);
+		for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+		{
+			writer.Write(b);
+		}
+	}
 
-	switch (joint->GetType())
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-	case e_distanceJoint:
-		g_debugDraw->DrawSegment(p1, p2, color);
-		break;
+		b2PersistentIsland* island = b->m_island;
+		if (island == NULL || island->bodyList != b || island->awake)
+		{
+			continue;
+		}
 
-	case e_pulleyJoint:
+		writer.Write(island->awake);
+		writer.Write(island->constraintRemoveCount);
+		writer.Write(island->bodyCount);
+		for (b2Body* ib = island->bodyList; ib; ib = ib->m_islandNext)
 		{
-			b2PulleyJoint* pulley = (b2PulleyJoint*)joint;
-			b2Vec2 s1 = pulley->GetGroundAnchorA();
-			b2Vec2 s2 = pulley->GetGroundAnchorB();
-			g_debugDraw->DrawSegment(s1, p1, color);
-			g_debugDraw->DrawSegment(s2, p2, color);
-			g_debugDraw->DrawSegment(s1, s2, color);
+			writer.Write(ib);
 		}
-		break;
+	}
 
-	case e_mouseJoint:
-		// don't draw this
-		break;
+	// Kinematic bodies in list order.
+	int32 kinematicCount = 0;
+	for (b2Body* b = m_kinematicList; b; b = b->m_islandNext)
+	{
+		++kinematicCount;
+	}
 
-	default:
-		g_debugDraw->DrawSegment(x1, p1, color);
-		g_debugDraw->DrawSegment(p1, p2, color);
-		g_debugDraw->DrawSegment(x2, p2, color);
+	writer.Write(kinematicCount);
+	for (b2Body* b = m_kinematicList; b; b = b->m_islandNext)
+	{
+		writer.Write(b);
 	}
+
+	writer.WriteAt(sizeOffset, writer.GetSize());
+	return writer.GetSize();
 }
 
-void b2World::DrawDebugData()
+bool b2World::RestoreSnapshot(const void* buffer, int32 size)
 {
-	if (g_debugDraw == NULL)
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
 	{
-		return;
+		return false;
 	}
 
-	uint32 flags = g_debugDraw->GetFlags();
+	b2SnapshotReader reader(buffer, size);
 
-	if (flags & b2Draw::e_shapeBit)
+	// Validate before touching anything.
+	if (reader.Read<uint32>() != b2_snapshotMagic ||
+		reader.Read<int32>() != b2_snapshotVersion ||
+		reader.Read<int32>() != size)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		return false;
+	}
+
+	int32 bodyCount = reader.Read<int32>();
+	int32 fixtureCount = reader.Read<int32>();
+	int32 jointCount = reader.Read<int32>();
+	if (bodyCount != m_bodyCount || jointCount != m_jointCount)
+	{
+		return false;
+	}
+
+	if (reader.Read<int32>() != m_regionCount)
+	{
+		return false;
+	}
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (reader.Read<b2Body*>() != b ||
+			reader.Read<int32>() != b->m_region ||
+			reader.Read<int32>() != b->m_regionIndex)
 		{
-			const b2Transform& xf = b->GetTransform();
-			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			return false;
+		}
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			--fixtureCount;
+			if (reader.Read<b2Fixture*>() != f || reader.Read<int32>() != f->m_proxyCount)
 			{
-				if (b->IsActive() == false)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.3f));
-				}
-				else if (b->GetType() == b2_staticBody)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.9f, 0.5f));
-				}
-				else if (b->GetType() == b2_kinematicBody)
-				{
-					DrawShape(f, xf, b2Color(0.5f, 0.5f, 0.9f));
-				}
-				else if (b->IsAwake() == false)
-				{
-					DrawShape(f, xf, b2Color(0.6f, 0.6f, 0.6f));
-				}
-				else
-				{
-					DrawShape(f, xf, b2Color(0.9f, 0.7f, 0.7f));
-				}
+				return false;
 			}
 		}
 	}
 
-	if (flags & b2Draw::e_jointBit)
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
 	{
-		for (b2Joint* j = m_jointList; j; j = j->GetNext())
+		if (reader.Read<b2Joint*>() != j || reader.Read<b2JointType>() != j->m_type)
 		{
-			DrawJoint(j);
+			return false;
 		}
 	}
 
-	if (flags & b2Draw::e_pairBit)
+	if (fixtureCount != 0 || reader.IsValid() == false)
 	{
-		b2Color color(0.3f, 0.9f, 0.9f);
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->GetNext())
-		{
-			//b2Fixture* fixtureA = c->GetFixtureA();
-			//b2Fixture* fixtureB = c->GetFixtureB();
+		return false;
+	}
 
-			//b2Vec2 cA = fixtureA->GetAABB().GetCenter();
-			//b2Vec2 cB = fixtureB->GetAABB().GetCenter();
+	// World
+	m_flags = reader.Read<int32>();
+	m_gravity = reader.Read<b2Vec2>();
+	m_allowSleep = reader.Read<bool>();
+	m_warmStarting = reader.Read<bool>();
+	m_continuousPhysics = reader.Read<bool>();
+	m_subStepping = reader.Read<bool>();
+	m_stepComplete = reader.Read<bool>();
+	m_inv_dt0 = reader.Read<float32>();
+	m_origin = reader.Read<b2Vec2d>();
+
+	for (int32 i = 0; i < m_regionCount; ++i)
+	{
+		m_regions[i].parked = reader.Read<bool>();
+		m_regions[i].origin = reader.Read<b2Vec2d>();
+	}
+
+	// Bodies and fixtures
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_type = reader.Read<b2BodyType>();
+		b->m_flags = reader.Read<uint16>();
+		b->m_xf = reader.Read<b2Transform>();
+		b->m_sweep = reader.Read<b2Sweep>();
+		b->m_linearVelocity = reader.Read<b2Vec2>();
+		b->m_angularVelocity = reader.Read<float32>();
+		b->m_force = reader.Read<b2Vec2>();
+		b->m_torque = reader.Read<float32>();
+		b->m_mass = reader.Read<float32>();
+		b->m_invMass = reader.Read<float32>();
+		b->m_I = reader.Read<float32>();
+		b->m_invI = reader.Read<float32>();
+		b->m_linearDamping = reader.Read<float32>();
+		b->m_angularDamping = reader.Read<float32>();
+		b->m_gravityScale = reader.Read<float32>();
+		b->m_sleepTime = reader.Read<float32>();
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			f->m_density = reader.Read<float32>();
+			f->m_friction = reader.Read<float32>();
+			f->m_restitution = reader.Read<float32>();
+			f->m_filter = reader.Read<b2Filter>();
+			f->m_isSensor = reader.Read<bool>();
 
-			//g_debugDraw->DrawSegment(cA, cB, color);
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				f->m_proxies[i].aabb = reader.Read<b2AABB>();
+				f->m_proxies[i].proxyId = reader.Read<int32>();
+			}
 		}
 	}
 
-	if (flags & b2Draw::e_aabbBit)
+	m_contactManager.m_broadPhase.ReadSnapshot(&reader);
+
+	// The proxy ids changed, find the query results again. As for contacts,
+	// no events are reported for a rollback.
+	for (b2PersistentQuery* q = m_queryList; q; q = q->m_next)
 	{
-		b2Color color(0.9f, 0.3f, 0.9f);
-		b2BroadPhase* bp = &m_contactManager.m_broadPhase;
+		q->m_addedCount = 0;
+		q->m_removedCount = 0;
+		q->m_pendingCount = 0;
+		q->Refresh(&m_contactManager.m_broadPhase, false);
+	}
 
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+	// Contacts. Existing contacts that match a snapshot contact are reused,
+	// the others are freed silently: no events are reported for a rollback.
+	// The island flag marks claimed contacts.
+	int32 contactCount = reader.Read<int32>();
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_flags &= ~b2Contact::e_islandFlag;
+	}
+
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(contactCount * sizeof(b2Contact*));
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		b2Fixture* fixtureA = reader.Read<b2Fixture*>();
+		int32 indexA = reader.Read<int32>();
+		b2Fixture* fixtureB = reader.Read<b2Fixture*>();
+		int32 indexB = reader.Read<int32>();
+
+		b2Contact* contact = NULL;
+		for (b2ContactEdge* ce = fixtureA->m_body->m_contactList; ce; ce = ce->next)
 		{
-			if (b->IsActive() == false)
+			b2Contact* c = ce->contact;
+			if (c->m_fixtureA == fixtureA && c->m_fixtureB == fixtureB &&
+				c->m_indexA == indexA && c->m_indexB == indexB &&
+				(c->m_flags & b2Contact::e_islandFlag) == 0)
 			{
-				continue;
+				contact = c;
+				break;
 			}
+		}
 
-			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
-			{
-				for (int32 i = 0; i < f->m_proxyCount; ++i)
-				{
-					b2FixtureProxy* proxy = f->m_proxies + i;
-					b2AABB aabb = bp->GetFatAABB(proxy->proxyId);
-					b2Vec2 vs[4];
-					vs[0].Set(aabb.lowerBound.x, aabb.lowerBound.y);
-					vs[1].Set(aabb.upperBound.x, aabb.lowerBound.y);
-					vs[2].Set(aabb.upperBound.x, aabb.upperBound.y);
-					vs[3].Set(aabb.lowerBound.x, aabb.upperBound.y);
+		if (contact == NULL)
+		{
+			contact = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, &m_blockAllocator);
+			b2Assert(contact->m_fixtureA == fixtureA && contact->m_fixtureB == fixtureB);
+		}
 
-					g_debugDraw->DrawPolygon(vs, 4, color);
-				}
+		contact->m_flags = reader.Read<uint32>() | b2Contact::e_islandFlag;
+		if (reader.Read<bool>())
+		{
+			if (contact->m_manifold == NULL)
+			{
+				contact->m_manifold = (b2Manifold*)m_blockAllocator.Allocate(sizeof(b2Manifold));
 			}
+			*contact->m_manifold = reader.Read<b2Manifold>();
+		}
+		else if (contact->m_manifold)
+		{
+			m_blockAllocator.Free(contact->m_manifold, sizeof(b2Manifold));
+			contact->m_manifold = NULL;
 		}
+		contact->m_toiCount = reader.Read<int32>();
+		contact->m_toi = reader.Read<float32>();
+		contact->m_friction = reader.Read<float32>();
+		contact->m_restitution = reader.Read<float32>();
+		contact->m_tangentSpeed = reader.Read<float32>();
+		contact->m_cachePosition = reader.Read<b2Vec2>();
+		contact->m_cacheAngle = reader.Read<float32>();
+		contacts[i] = contact;
 	}
 
-	if (flags & b2Draw::e_centerOfMassBit)
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
 	{
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		b2Contact* cNext = c->m_next;
+		if ((c->m_flags & b2Contact::e_islandFlag) == 0)
 		{
-			b2Transform xf = b->GetTransform();
-			xf.p = b->GetWorldCenter();
-			g_debugDraw->DrawTransform(xf);
+			// Don't wake the bodies.
+			if (c->m_manifold)
+			{
+				c->m_manifold->pointCount = 0;
+			}
+			b2Contact::Destroy(c, &m_blockAllocator);
 		}
+		c = cNext;
 	}
-}
 
-int32 b2World::GetProxyCount() const
-{
-	return m_contactManager.m_broadPhase.GetProxyCount();
-}
+	// Relink the world and body contact lists in snapshot order.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_contactList = NULL;
+	}
 
-int32 b2World::GetTreeHeight() const
-{
-	return m_contactManager.m_broadPhase.GetTreeHeight();
-}
+	m_contactManager.m_contactList = NULL;
+	for (int32 i = contactCount - 1; i >= 0; --i)
+	{
+		b2Contact* contact = contacts[i];
+		contact->m_flags &= ~b2Contact::e_islandFlag;
 
-int32 b2World::GetTreeBalance() const
-{
-	return m_contactManager.m_broadPhase.GetTreeBalance();
-}
+		contact->m_prev = NULL;
+		contact->m_next = m_contactManager.m_contactList;
+		if (m_contactManager.m_contactList != NULL)
+		{
+			m_contactManager.m_contactList->m_prev = contact;
+		}
+		m_contactManager.m_contactList = contact;
 
-float32 b2World::GetTreeQuality() const
-{
-	return m_contactManager.m_broadPhase.GetTreeQuality();
-}
+		b2Body* bodyA = contact->m_fixtureA->m_body;
+		b2Body* bodyB = contact->m_fixtureB->m_body;
 
-void b2World::ShiftOrigin(const b2Vec2& newOrigin)
-{
-	b2Assert((m_flags & e_locked) == 0);
-	if ((m_flags & e_locked) == e_locked)
-	{
-		return;
-	}
+		contact->m_nodeA.contact = contact;
+		contact->m_nodeA.other = bodyB;
+		contact->m_nodeA.prev = NULL;
+		contact->m_nodeA.next = bodyA->m_contactList;
+		if (bodyA->m_contactList != NULL)
+		{
+			bodyA->m_contactList->prev = &contact->m_nodeA;
+		}
+		bodyA->m_contactList = &contact->m_nodeA;
 
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
-	{
-		b->m_xf.p -= newOrigin;
-		b->m_sweep.c0 -= newOrigin;
-		b->m_sweep.c -= newOrigin;
+		contact->m_nodeB.contact = contact;
+		contact->m_nodeB.other = bodyA;
+		contact->m_nodeB.prev = NULL;
+		contact->m_nodeB.next = bodyB->m_contactList;
+		if (bodyB->m_contactList != NULL)
+		{
+			bodyB->m_contactList->prev = &contact->m_nodeB;
+		}
+		bodyB->m_contactList = &contact->m_nodeB;
 	}
+	m_contactManager.m_contactCount = contactCount;
+
+	m_stackAllocator.Free(contacts);
 
+	// Joints. Keep the graph links and user data of the live joint.
 	for (b2Joint* j = m_jointList; j; j = j->m_next)
 	{
-		j->ShiftOrigin(newOrigin);
+		b2Joint* prev = j->m_prev;
+		b2Joint* next = j->m_next;
+		b2JointEdge edgeA = j->m_edgeA;
+		b2JointEdge edgeB = j->m_edgeB;
+		void* userData = j->m_userData;
+
+		reader.Read(j, b2Joint::GetSize(j->m_type));
+
+		j->m_prev = prev;
+		j->m_next = next;
+		j->m_edgeA = edgeA;
+		j->m_edgeB = edgeB;
+		j->m_userData = userData;
 	}
 
-	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
-}
-
-void b2World::Dump()
-{
-	if ((m_flags & e_locked) == e_locked)
+	// Islands are rebuilt from scratch. Collect the old islands through their
+	// head bodies before freeing any of them.
+	b2PersistentIsland** islands = (b2PersistentIsland**)m_stackAllocator.Allocate(m_bodyCount * sizeof(b2PersistentIsland*));
+	int32 oldIslandCount = 0;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-		return;
+		if (b->m_island && b->m_island->bodyList == b)
+		{
+			islands[oldIslandCount++] = b->m_island;
+		}
 	}
 
-	b2Log("b2Vec2 g(%.15lef, %.15lef);\n", m_gravity.x, m_gravity.y);
-	b2Log("m_world->SetGravity(g);\n");
-
-	b2Log("b2Body** bodies = (b2Body**)b2Alloc(%d * sizeof(b2Body*));\n", m_bodyCount);
-	b2Log("b2Joint** joints = (b2Joint**)b2Alloc(%d * sizeof(b2Joint*));\n", m_jointCount);
-	int32 i = 0;
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	for (int32 i = 0; i < oldIslandCount; ++i)
 	{
-		b->m_islandIndex = i;
-		b->Dump();
-		++i;
+		m_blockAllocator.Free(islands[i], sizeof(b2PersistentIsland));
 	}
+	m_stackAllocator.Free(islands);
 
-	i = 0;
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
-		j->m_index = i;
-		++i;
+		b->m_island = NULL;
+		b->m_islandPrev = NULL;
+		b->m_islandNext = NULL;
 	}
 
-	// First pass on joints, skip gear joints.
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	m_islandList = NULL;
+	m_splitIsland = NULL;
+	m_kinematicList = NULL;
+	b2PersistentIsland* islandTail = NULL;
+
+	int32 islandCount = reader.Read<int32>();
+	for (int32 i = 0; i < islandCount; ++i)
 	{
-		if (j->m_type == e_gearJoint)
+		void* mem = m_blockAllocator.Allocate(sizeof(b2PersistentIsland));
+		b2PersistentIsland* island = (b2PersistentIsland*)mem;
+		island->awake = reader.Read<bool>();
+		island->constraintRemoveCount = reader.Read<int32>();
+		island->bodyCount = reader.Read<int32>();
+		island->bodyList = NULL;
+		island->bodyTail = NULL;
+		island->prev = NULL;
+		island->next = NULL;
+
+		for (int32 j = 0; j < island->bodyCount; ++j)
 		{
-			continue;
+			b2Body* b = reader.Read<b2Body*>();
+			b->m_island = island;
+			b->m_islandPrev = island->bodyTail;
+			if (island->bodyTail)
+			{
+				island->bodyTail->m_islandNext = b;
+			}
+			else
+			{
+				island->bodyList = b;
+			}
+			island->bodyTail = b;
 		}
 
-		b2Log("{\n");
-		j->Dump();
-		b2Log("}\n");
+		// Keep the awake list order.
+		if (island->awake)
+		{
+			island->prev = islandTail;
+			if (islandTail)
+			{
+				islandTail->next = island;
+			}
+			else
+			{
+				m_islandList = island;
+			}
+			islandTail = island;
+		}
 	}
 
-	// Second pass on joints, only gear joints.
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	b2Body* kinematicTail = NULL;
+	int32 kinematicCount = reader.Read<int32>();
+	for (int32 i = 0; i < kinematicCount; ++i)
 	{
-		if (j->m_type != e_gearJoint)
+		b2Body* b = reader.Read<b2Body*>();
+		b->m_islandPrev = kinematicTail;
+		if (kinematicTail)
 		{
-			continue;
+			kinematicTail->m_islandNext = b;
+		}
+		else
+		{
+			m_kinematicList = b;
 		}
+		kinematicTail = b;
+	}
 
-		b2Log("{\n");
-		j->Dump();
-		b2Log("}\n");
+	b2Assert(reader.IsValid() && reader.GetOffset() == size);
+	return true;
+}
+
+// FNV-1a
+static inline uint32 b2HashBytes(uint32 hash, const void* data, int32 size)
+{
+	const uint8* bytes = (const uint8*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
 	}
+	return hash;
+}
 
-	b2Log("b2Free(joints);\n");
-	b2Log("b2Free(bodies);\n");
-	b2Log("joints = NULL;\n");
-	b2Log("bodies = NULL;\n");
+uint32 b2World::GetStateHash() const
+{
+	uint32 hash = 2166136261u;
+	hash = b2HashBytes(hash, &m_bodyCount, sizeof(m_bodyCount));
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		hash = b2HashBytes(hash, &b->m_sweep.c, sizeof(b->m_sweep.c));
+		hash = b2HashBytes(hash, &b->m_sweep.a, sizeof(b->m_sweep.a));
+		hash = b2HashBytes(hash, &b->m_linearVelocity, sizeof(b->m_linearVelocity));
+		hash = b2HashBytes(hash, &b->m_angularVelocity, sizeof(b->m_angularVelocity));
+		uint8 awake = b->IsAwake() ? 1 : 0;
+		hash = b2HashBytes(hash, &awake, sizeof(awake));
+	}
+
+	for (const b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+	{
+		int32 count = p->GetParticleCount();
+		hash = b2HashBytes(hash, &count, sizeof(count));
+		hash = b2HashBytes(hash, p->GetPositionBuffer(), count * sizeof(b2Vec2));
+		hash = b2HashBytes(hash, p->GetVelocityBuffer(), count * sizeof(b2Vec2));
+	}
+	return hash;
 }
@@ -20,7 +20,9 @@
 #define B2_WORLD_H
 
 #include <Box2D/Common/b2Math.h>
+#include <Box2D/Common/b2Allocator.h>
 #include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Common/b2Pool.h>
 #include <Box2D/Common/b2StackAllocator.h>
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
@@ -28,12 +30,107 @@
 
 struct b2AABB;
 struct b2BodyDef;
+struct b2BodyHandle;
 struct b2Color;
+struct b2FixtureDef;
+struct b2FixtureHandle;
 struct b2JointDef;
 class b2Body;
 class b2Draw;
+class b2DrawBuffer;
 class b2Fixture;
 class b2Joint;
+class b2ParticleSystem;
+struct b2ParticleSystemDef;
+class b2PersistentQuery;
+struct b2PersistentQueryDef;
+struct b2PersistentIsland;
+struct b2TOIEvent;
+
+/// The memory used by one kind of world object.
+struct b2ObjectMemory
+{
+	int32 count;
+	int32 bytes;	///< including the rounding up to the block size
+};
+
+/// A breakdown of the memory used by a world. See b2World::GetMemoryStats.
+struct b2MemoryStats
+{
+	b2ObjectMemory bodies;		///< the body pool
+	b2ObjectMemory fixtures;	///< the fixture pool and the proxy arrays
+	b2ObjectMemory shapes;		///< the shape clones owned by fixtures, including chain vertices
+	b2ObjectMemory contacts;	///< all contacts, touching or not
+	b2ObjectMemory manifolds;	///< one per touching contact, and the empty ones given by b2Contact::GetManifold
+	b2ObjectMemory joints;
+	b2ObjectMemory islands;
+	b2ObjectMemory regions;		///< the region table and the region body arrays
+	b2ObjectMemory proxies;		///< broad-phase proxies, the tree node pool and the move and pair buffers
+	b2ObjectMemory particles;	///< particles and the buffers of their systems
+	b2ObjectMemory queries;		///< persistent queries and their result arrays
+	int32 stackBytes;			///< the stack allocator buffer
+	b2BlockClassStats blockClasses[b2_blockSizes];
+	b2AllocStats allocator;		///< what the world obtained from its allocator
+};
+
+/// A world definition holds the settings needed to construct a world.
+/// You can safely re-use world definitions.
+struct b2WorldDef
+{
+	/// This constructor sets the world definition default values.
+	b2WorldDef()
+	{
+		gravity.Set(0.0f, -10.0f);
+		allocator = NULL;
+		arenaSize = b2_arenaSize;
+		stackSize = b2_stackSize;
+		toiBudget = 0;
+		manifoldReuse = false;
+		jointBatching = false;
+		taskExecutor = NULL;
+	}
+
+	/// The world gravity vector.
+	b2Vec2 gravity;
+
+	/// Where the world gets its memory. This is owned by you and must outlive
+	/// the world. If NULL the world uses its own arena of arenaSize bytes.
+	b2Allocator* allocator;
+
+	/// The size of the arena the world reserves from b2Alloc when no allocator
+	/// is given. Memory beyond the arena comes from b2Alloc. Zero disables the
+	/// arena.
+	int32 arenaSize;
+
+	/// The initial size of the per step stack allocator. A step that needs
+	/// more chains blocks to the stack, which are merged once the step is done.
+	int32 stackSize;
+
+	/// The maximum number of TOI events solved per step, zero for no limit.
+	/// See b2World::SetTOIBudget.
+	int32 toiBudget;
+
+	/// Reuse the manifolds of resting contacts, see b2World::SetManifoldReuse.
+	bool manifoldReuse;
+
+	/// Solve joints grouped by type, see b2World::SetJointBatching.
+	bool jointBatching;
+
+	/// Runs the parallel passes, see b2World::SetTaskExecutor.
+	b2TaskExecutor* taskExecutor;
+};
+
+// The bodies tagged with one region id.
+struct b2Region
+{
+	b2Body** bodies;
+	int32 bodyCount;
+	int32 bodyCapacity;
+	bool parked;
+
+	// The world origin when the region was parked.
+	b2Vec2d origin;
+};
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -41,10 +138,14 @@ class b2Joint;
 class b2World
 {
 public:
-	/// Construct a world object.
+	/// Construct a world object. The world reserves no arena and gets its
+	/// memory from b2Alloc, use b2WorldDef for an arena.
 	/// @param gravity the world gravity vector.
 	b2World(const b2Vec2& gravity);
 
+	/// Construct a world object from a definition.
+	b2World(const b2WorldDef* def);
+
 	/// Destruct the world. All physics entities are destroyed and all heap memory is released.
 	~b2World();
 
@@ -77,6 +178,32 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyBody(b2Body* body);
 
+	/// Create a rigid body for each definition, as CreateBody does.
+	/// @param defs an array of count body definitions.
+	/// @param bodies receives the bodies in the order of the definitions, may be NULL.
+	/// @warning This function is locked during callbacks.
+	void CreateBodies(const b2BodyDef* defs, int32 count, b2Body** bodies);
+
+	/// Create a fixture for each definition and attach it to the body with
+	/// the same index, as b2Body::CreateFixture does. The broad-phase proxies of
+	/// all fixtures are built into the tree in one batch, which is much faster
+	/// than inserting them one at a time. Use this to spawn a level.
+	/// @param bodies an array of count bodies, a body may appear more than once.
+	/// @param defs an array of count fixture definitions.
+	/// @param fixtures receives the fixtures in the order of the definitions, may be NULL.
+	/// @warning This function is locked during callbacks.
+	void CreateFixtures(b2Body* const* bodies, const b2FixtureDef* defs, int32 count, b2Fixture** fixtures);
+
+	/// Get the body a handle refers to.
+	/// @return NULL if the body was destroyed.
+	b2Body* GetBody(const b2BodyHandle& handle);
+	const b2Body* GetBody(const b2BodyHandle& handle) const;
+
+	/// Get the fixture a handle refers to.
+	/// @return NULL if the fixture was destroyed.
+	b2Fixture* GetFixture(const b2FixtureHandle& handle);
+	const b2Fixture* GetFixture(const b2FixtureHandle& handle) const;
+
 	/// Create a joint to constrain bodies together. No reference to the definition
 	/// is retained. This may cause the connected bodies to cease colliding.
 	/// @warning This function is locked during callbacks.
@@ -86,6 +213,42 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyJoint(b2Joint* joint);
 
+	/// Create a particle system given a definition. No reference to the
+	/// definition is retained. Particle systems are stepped with the world
+	/// before the bodies are solved.
+	/// @warning This function is locked during callbacks.
+	b2ParticleSystem* CreateParticleSystem(const b2ParticleSystemDef* def);
+
+	/// Destroy a particle system and all its particles.
+	/// @warning This function is locked during callbacks.
+	void DestroyParticleSystem(b2ParticleSystem* system);
+
+	/// Get the world particle system list. With the returned system, use
+	/// b2ParticleSystem::GetNext to get the next system in the world list.
+	b2ParticleSystem* GetParticleSystemList();
+	const b2ParticleSystem* GetParticleSystemList() const;
+
+	/// Create a persistent query given a definition. No reference to the
+	/// definition is retained. Its results are found during the next time step
+	/// and then kept up to date from the proxies that move.
+	/// @warning This function is locked during callbacks.
+	b2PersistentQuery* CreatePersistentQuery(const b2PersistentQueryDef* def);
+
+	/// Destroy a persistent query.
+	/// @warning This function is locked during callbacks.
+	void DestroyPersistentQuery(b2PersistentQuery* query);
+
+	/// Get the world persistent query list. With the returned query, use
+	/// b2PersistentQuery::GetNext to get the next query in the world list.
+	b2PersistentQuery* GetPersistentQueryList();
+	const b2PersistentQuery* GetPersistentQueryList() const;
+
+	/// Register an executor that runs the parallel passes of the step on
+	/// worker threads. The executor is owned by you and must remain in scope.
+	/// NULL runs them on the calling thread.
+	void SetTaskExecutor(b2TaskExecutor* executor) { m_taskExecutor = executor; }
+	b2TaskExecutor* GetTaskExecutor() const { return m_taskExecutor; }
+
 	/// Take a time step. This performs collision detection, integration,
 	/// and constraint solution.
 	/// @param timeStep the amount of time to simulate, this should not vary.
@@ -107,6 +270,11 @@ public:
 	/// Call this to draw shapes and other debug draw data. This is intentionally non-const.
 	void DrawDebugData();
 
+	/// Write the debug draw data into vertex arrays instead of calling the
+	/// registered b2Draw. The buffer's flags select what is drawn. This appends
+	/// to the buffer, so clear it at the start of each frame.
+	void DrawDebugData(b2DrawBuffer* buffer);
+
 	/// Query the world for all fixtures that potentially overlap the
 	/// provided AABB.
 	/// @param callback a user implemented callback class.
@@ -157,6 +325,30 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Limit the number of TOI events solved per step, zero for no limit.
+	/// When the budget runs out the remaining fast bodies finish the step
+	/// without continuous collision, so they may tunnel. This bounds the
+	/// cost of a step with many bullets. b2Profile::toiDeferred counts the
+	/// events that were dropped.
+	void SetTOIBudget(int32 budget) { m_toiBudget = budget; }
+	int32 GetTOIBudget() const { return m_toiBudget; }
+
+	/// Enable/disable manifold reuse. A touching contact then keeps its
+	/// manifold while its bodies move less than b2_manifoldReuseLinearTolerance
+	/// and b2_manifoldReuseAngularTolerance relative to each other since the
+	/// manifold was computed. The manifold is in body local coordinates, so the
+	/// solver still sees the current separations. This saves the narrow-phase
+	/// of resting stacks. b2Profile::manifoldsReused counts the reused manifolds.
+	void SetManifoldReuse(bool flag) { m_manifoldReuse = flag; }
+	bool GetManifoldReuse() const { return m_manifoldReuse; }
+
+	/// Enable/disable joint batching, off by default. The revolute, distance and
+	/// prismatic joints of an island are then solved grouped by type by kernels
+	/// without virtual calls, ahead of the other joints. This changes the order
+	/// in which the joints of an island with mixed joint types are solved.
+	void SetJointBatching(bool flag) { m_jointBatching = flag; }
+	bool GetJointBatching() const { return m_jointBatching; }
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -196,19 +388,87 @@ public:
 
 	/// Shift the world origin. Useful for large worlds.
 	/// The body shift formula is: position -= newOrigin
+	/// Bodies and proxies of parked regions are not touched, they are shifted
+	/// once when their region is unparked. Joints, particle systems and
+	/// persistent queries are always shifted.
 	/// @param newOrigin the new origin with respect to the old origin
 	void ShiftOrigin(const b2Vec2& newOrigin);
 
+	/// Get the sum of all origin shifts, in double precision. Body positions
+	/// are relative to this point, see b2Body::GetAbsolutePosition.
+	b2Vec2d GetOrigin() const;
+
+	/// Park all bodies of a region, e.g. a level chunk that scrolled out of
+	/// view. Parked bodies are inactive but their broad-phase proxies are only
+	/// taken out of the tree, not destroyed. Contacts with parked bodies are
+	/// destroyed during the next time step. Bodies created in or moved to a
+	/// parked region are parked as well.
+	/// While the region is parked its bodies keep the world origin of the time
+	/// it was parked, see GetRegionOrigin.
+	/// @warning This function is locked during callbacks.
+	void ParkRegion(int32 region);
+
+	/// Unpark all bodies of a region. Their proxies are rebuilt into the
+	/// broad-phase tree in one batch and contacts are created during the next
+	/// time step. Bodies that were inactive when the region was parked stay inactive.
+	/// Origin shifts made while the region was parked are applied to its bodies.
+	/// @warning This function is locked during callbacks.
+	void UnparkRegion(int32 region);
+
+	/// Get the origin the positions of the bodies in a region are relative
+	/// to. This is the world origin, or the world origin at the time the
+	/// region was parked. Positions passed to CreateBody and SetTransform for
+	/// bodies of a parked region are relative to this origin as well.
+	b2Vec2d GetRegionOrigin(int32 region) const;
+
+	/// Is this region parked?
+	bool IsRegionParked(int32 region) const;
+
+	/// Get the number of bodies in a region.
+	int32 GetRegionBodyCount(int32 region) const;
+
 	/// Get the contact manager for testing.
 	const b2ContactManager& GetContactManager() const;
 
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Get statistics of the memory this world obtained from its allocator.
+	const b2AllocStats& GetAllocStats() const;
+
+	/// Get the memory used by each kind of object and block size class. This
+	/// walks all objects, so don't call it every step.
+	void GetMemoryStats(b2MemoryStats* stats) const;
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+	/// Write the simulation state into a buffer for rollback or replay. This
+	/// includes bodies, fixtures, broad-phase proxies, contacts with their
+	/// warm starting impulses, joints and islands. Particle systems are not
+	/// included. Call this between steps.
+	/// @param buffer the destination, or NULL to query the required size.
+	/// @param capacity the size of buffer in bytes.
+	/// @return the snapshot size in bytes. The snapshot is only complete if
+	/// this is not larger than capacity.
+	/// @warning a snapshot refers to the objects of this world in memory. It is
+	/// not a file format: use Dump for that.
+	int32 SaveSnapshot(void* buffer, int32 capacity) const;
+
+	/// Restore a snapshot taken by SaveSnapshot in place. Bodies, fixtures and
+	/// joints are overwritten and contacts are reused when possible, so stepping
+	/// afterwards gives the same results as stepping after the snapshot was taken.
+	/// No contact events are reported during the restore.
+	/// @return false and leave the world untouched if the bodies, fixtures or
+	/// joints were created or destroyed since the snapshot was taken.
+	bool RestoreSnapshot(const void* buffer, int32 size);
+
+	/// Get a hash of the body positions, velocities and sleep states, and of
+	/// the particle positions and velocities. Compare
+	/// it across peers every step to detect a desync as soon as it happens.
+	uint32 GetStateHash() const;
+
 private:
 
 	// m_flags
@@ -223,22 +483,110 @@ private:
 	friend class b2Fixture;
 	friend class b2ContactManager;
 	friend class b2Controller;
+	friend class b2Contact;
+	friend class b2ParticleSystem;
+	friend class b2PersistentQuery;
+
+	void Initialize(const b2Vec2& gravity);
 
 	void Solve(const b2TimeStep& step);
-	void SolveTOI(const b2TimeStep& step);
 
-	void DrawJoint(b2Joint* joint);
-	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
+	// Update the persistent queries, then pair the moved proxies.
+	void FindNewContacts();
 
+	// Update the persistent queries from the moved proxies and refresh the
+	// queries that changed. This doesn't clear the move buffer.
+	void UpdateQueries();
+
+	// Take a fixture whose proxies are about to be destroyed or parked out of
+	// the persistent queries.
+	void RemoveFromQueries(b2Fixture* fixture, bool destroyed);
+
+	void SolveKinematic(const b2TimeStep& step);
+	void SolveTOI(const b2TimeStep& step);
+	float32 ComputeTOI(b2Contact* contact);
+	void PushTOIEvent(b2Contact* contact, float32 alpha);
+	b2Contact* PopTOIEvent(float32* alpha);
+
+	// Add an active body to its island or to the kinematic list, and back.
+	void AddToSolver(b2Body* body);
+	void RemoveFromSolver(b2Body* body);
+
+	// Persistent island management.
+	void AddToIsland(b2Body* body);
+	void RemoveFromIsland(b2Body* body);
+	void LinkIslands(b2Body* bodyA, b2Body* bodyB);
+	void UnlinkIslands(b2Body* bodyA, b2Body* bodyB);
+	void MergeIslands(b2PersistentIsland* keep, b2PersistentIsland* absorb);
+	void SplitIsland(b2PersistentIsland* island);
+	void WakeIsland(b2PersistentIsland* island);
+	void SleepIsland(b2PersistentIsland* island);
+
+	// Region management.
+	b2Region* GetRegion(int32 region);
+	void AddToRegion(b2Body* body);
+	void RemoveFromRegion(b2Body* body);
+	void ParkBody(b2Body* body);
+	void UnparkBodies(b2Body** bodies, int32 count);
+	void ShiftBody(b2Body* body, const b2Vec2& newOrigin);
+	void ShiftRegion(b2Region* region, const b2Vec2& newOrigin);
+
+	// Run a task on the executor, or here without one.
+	void RunParallel(b2ParallelTask* task, int32 count, int32 minRange);
+
+	// Walk the world for DrawDebugData, with draw a b2Draw or a b2DrawBuffer.
+	template <typename T>
+	void DrawWorld(T* draw);
+
+	// Allocators are declared first so they outlive everything that uses them.
+	b2ArenaAllocator m_arena;
+	b2StatsAllocator m_statsAllocator;
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
+	// Bodies and fixtures are packed in pools. Loops that don't depend on
+	// the order walk the pools instead of the lists.
+	b2Pool m_bodyPool;
+	b2Pool m_fixturePool;
+
 	int32 m_flags;
 
 	b2ContactManager m_contactManager;
 
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
+	b2ParticleSystem* m_particleSystemList;
+
+	// The boxes of the persistent queries, to find those a moved proxy enters.
+	b2PersistentQuery* m_queryList;
+	b2DynamicTree m_queryTree;
+
+	// Awake persistent islands. Sleeping islands are not linked.
+	b2PersistentIsland* m_islandList;
+
+	// The awake island that will be split at the end of the current step.
+	b2PersistentIsland* m_splitIsland;
+
+	// Active kinematic bodies, linked through their island links because
+	// they don't join islands.
+	b2Body* m_kinematicList;
+
+	// Indexed by region id.
+	b2Region* m_regions;
+	int32 m_regionCount;
+
+	// The bodies without a region. This region is never parked, so origin
+	// shifts don't need to walk the body pool.
+	b2Region m_globalRegion;
+
+	// The sum of all origin shifts.
+	b2Vec2d m_origin;
+
+	// Pending TOI events of the current step, a binary heap ordered by time.
+	b2TOIEvent* m_toiEvents;
+	int32 m_toiEventCount;
+	int32 m_toiEventCapacity;
+	int32 m_toiBudget;
 
 	int32 m_bodyCount;
 	int32 m_jointCount;
@@ -247,16 +595,23 @@ private:
 	bool m_allowSleep;
 
 	b2DestructionListener* m_destructionListener;
+	b2TaskExecutor* m_taskExecutor;
 	b2Draw* g_debugDraw;
 
 	// This is used to compute the time step ratio to
 	// support a variable time step.
 	float32 m_inv_dt0;
 
+	// The last non-zero time step. Speculative bodies and contacts use
+	// this to predict the motion over the next step.
+	float32 m_dt;
+
 	// These are for debugging the solver.
 	bool m_warmStarting;
 	bool m_continuousPhysics;
 	bool m_subStepping;
+	bool m_manifoldReuse;
+	bool m_jointBatching;
 
 	bool m_stepComplete;
 
@@ -283,6 +638,26 @@ inline const b2Joint* b2World::GetJointList() const
 	return m_jointList;
 }
 
+inline b2ParticleSystem* b2World::GetParticleSystemList()
+{
+	return m_particleSystemList;
+}
+
+inline const b2ParticleSystem* b2World::GetParticleSystemList() const
+{
+	return m_particleSystemList;
+}
+
+inline b2PersistentQuery* b2World::GetPersistentQueryList()
+{
+	return m_queryList;
+}
+
+inline const b2PersistentQuery* b2World::GetPersistentQueryList() const
+{
+	return m_queryList;
+}
+
 inline b2Contact* b2World::GetContactList()
 {
 	return m_contactManager.m_contactList;
@@ -351,4 +726,14 @@ inline const b2Profile& b2World::GetProfile() const
 	return m_profile;
 }
 
+inline const b2AllocStats& b2World::GetAllocStats() const
+{
+	return m_statsAllocator.GetStats();
+}
+
+inline b2Vec2d b2World::GetOrigin() const
+{
+	return m_origin;
+}
+
 #endif
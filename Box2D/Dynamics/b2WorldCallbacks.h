@@ -152,4 +152,29 @@ public:
 									const b2Vec2& normal, float32 fraction) = 0;
 };
 
+/// A loop over items that can be split across threads. See b2TaskExecutor.
+class b2ParallelTask
+{
+public:
+	virtual ~b2ParallelTask() {}
+
+	/// Process the items [begin, end). Different ranges of the same task may
+	/// run at the same time on different threads.
+	virtual void Execute(int32 begin, int32 end) = 0;
+};
+
+/// Implement this to run the parallel passes of the world, like the particle
+/// solver, on your own worker threads. Without an executor these passes run
+/// on the calling thread. The results don't depend on how the work is split.
+class b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// Call task->Execute on ranges that cover [0, count) exactly once and
+	/// return when all of them are done. Ranges should hold at least
+	/// minRange items, smaller ones aren't worth a thread.
+	virtual void ParallelFor(b2ParallelTask* task, int32 count, int32 minRange) = 0;
+};
+
 #endif
@@ -0,0 +1,790 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include <Box2D/Particle/b2ParticleSystem.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2EdgeShape.h>
+#include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Common/b2Draw.h>
+#include <Box2D/Common/b2DrawBuffer.h>
+#include <Box2D/Common/b2Trace.h>
+#include <string.h>
+
+// The smallest number of particles handed to a thread.
+#define b2_particleTaskRange	256
+
+// The bucket of a hash cell. Neighboring cells of a row go to consecutive
+// buckets, so their particles are next to each other in the sorted proxies.
+inline int32 b2ParticleBucket(int32 x, int32 y, int32 mask)
+{
+	return int32(((uint32)x + (uint32)y * 2654435761u) & (uint32)mask);
+}
+
+// The closest point of a segment to a point.
+static b2Vec2 b2ClosestPointOnSegment(const b2Vec2& p, const b2Vec2& v1, const b2Vec2& v2)
+{
+	b2Vec2 e = v2 - v1;
+	float32 ee = b2Dot(e, e);
+	if (ee == 0.0f)
+	{
+		return v1;
+	}
+
+	float32 t = b2Clamp(b2Dot(p - v1, e) / ee, 0.0f, 1.0f);
+	return v1 + t * e;
+}
+
+// The signed distance from a point to the surface of a fixture child,
+// negative inside, and the normal pointing from the surface to the point.
+// This doesn't use b2Distance because that updates global counters and the
+// particle passes run on several threads.
+static float32 b2ComputeParticleDistance(const b2Shape* shape, int32 childIndex, const b2Transform& xf,
+										 const b2Vec2& point, b2Vec2* normal)
+{
+	b2Vec2 p = b2MulT(xf, point);
+	b2Vec2 n(0.0f, 1.0f);
+	float32 distance = 0.0f;
+
+	switch (shape->GetType())
+	{
+	case b2Shape::e_circle:
+		{
+			const b2CircleShape* circle = (const b2CircleShape*)shape;
+			b2Vec2 d = p - circle->m_p;
+			float32 length = d.Normalize();
+			if (length > 0.0f)
+			{
+				n = d;
+			}
+			distance = length - circle->m_radius;
+		}
+		break;
+
+	case b2Shape::e_edge:
+	case b2Shape::e_chain:
+		{
+			b2EdgeShape edge;
+			if (shape->GetType() == b2Shape::e_chain)
+			{
+				((const b2ChainShape*)shape)->GetChildEdge(&edge, childIndex);
+			}
+			else
+			{
+				edge = *(const b2EdgeShape*)shape;
+			}
+
+			b2Vec2 d = p - b2ClosestPointOnSegment(p, edge.m_vertex1, edge.m_vertex2);
+			float32 length = d.Normalize();
+			if (length > 0.0f)
+			{
+				n = d;
+			}
+			else
+			{
+				n = b2Cross(edge.m_vertex2 - edge.m_vertex1, 1.0f);
+				n.Normalize();
+			}
+			distance = length - edge.m_radius;
+		}
+		break;
+
+	case b2Shape::e_polygon:
+		{
+			const b2PolygonShape* polygon = (const b2PolygonShape*)shape;
+			int32 count = polygon->m_count;
+
+			int32 bestIndex = 0;
+			float32 maxSeparation = -b2_maxFloat;
+			for (int32 i = 0; i < count; ++i)
+			{
+				float32 s = b2Dot(polygon->m_normals[i], p - polygon->m_vertices[i]);
+				if (s > maxSeparation)
+				{
+					maxSeparation = s;
+					bestIndex = i;
+				}
+			}
+
+			if (maxSeparation <= 0.0f)
+			{
+				// Inside, push out through the closest face.
+				n = polygon->m_normals[bestIndex];
+				distance = maxSeparation - polygon->m_radius;
+				break;
+			}
+
+			float32 minDistanceSqr = b2_maxFloat;
+			b2Vec2 closest = p;
+			for (int32 i = 0; i < count; ++i)
+			{
+				int32 i2 = i + 1 < count ? i + 1 : 0;
+				b2Vec2 c = b2ClosestPointOnSegment(p, polygon->m_vertices[i], polygon->m_vertices[i2]);
+				float32 distanceSqr = b2DistanceSquared(p, c);
+				if (distanceSqr < minDistanceSqr)
+				{
+					minDistanceSqr = distanceSqr;
+					closest = c;
+				}
+			}
+
+			b2Vec2 d = p - closest;
+			float32 length = d.Normalize();
+			n = length > 0.0f ? d : polygon->m_normals[bestIndex];
+			distance = length - polygon->m_radius;
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+
+	*normal = b2Mul(xf.q, n);
+	return distance;
+}
+
+class b2ParticleWeightTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 begin, int32 end)
+	{
+		system->ComputeWeights(begin, end);
+	}
+
+	b2ParticleSystem* system;
+};
+
+class b2ParticleVelocityTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 begin, int32 end)
+	{
+		system->ComputeVelocities(begin, end);
+	}
+
+	b2ParticleSystem* system;
+};
+
+class b2ParticleCollisionTask : public b2ParallelTask
+{
+public:
+	void Execute(int32 begin, int32 end)
+	{
+		system->SolveCollisions(begin, end);
+	}
+
+	b2ParticleSystem* system;
+};
+
+// Collects the fixtures within a diameter of a particle.
+struct b2ParticleFixtureQuery
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		if (system->ShouldCollide(fixture) == false)
+		{
+			return true;
+		}
+
+		b2Vec2 normal;
+		float32 distance = b2ComputeParticleDistance(fixture->GetShape(), proxy->childIndex,
+			fixture->GetBody()->GetTransform(), position, &normal);
+		if (distance >= diameter)
+		{
+			return true;
+		}
+
+		b2ParticleBodyContact* contact = contacts + count;
+		contact->fixture = fixture;
+		contact->childIndex = proxy->childIndex;
+		contact->weight = 1.0f - b2Max(distance, 0.0f) / diameter;
+		contact->normal = normal;
+		contact->impulse.SetZero();
+		++count;
+
+		return count < b2_maxParticleBodyContacts;
+	}
+
+	const b2BroadPhase* broadPhase;
+	const b2ParticleSystem* system;
+	b2Vec2 position;
+	float32 diameter;
+	b2ParticleBodyContact* contacts;
+	int32 count;
+};
+
+b2ParticleSystem::b2ParticleSystem(const b2ParticleSystemDef* def, b2World* world)
+{
+	b2Assert(def->radius > 0.0f);
+	b2Assert(def->density > 0.0f);
+
+	m_world = world;
+	m_prev = NULL;
+	m_next = NULL;
+
+	m_def = *def;
+	m_diameter = 2.0f * def->radius;
+	m_inverseDiameter = 1.0f / m_diameter;
+
+	m_dt = 0.0f;
+	m_inv_dt = 0.0f;
+	m_gravity.SetZero();
+
+	m_count = 0;
+	m_capacity = 0;
+
+	m_positionBuffer = NULL;
+	m_velocityBuffer = NULL;
+	m_flagsBuffer = NULL;
+	m_newVelocityBuffer = NULL;
+	m_weightBuffer = NULL;
+	m_neighborCountBuffer = NULL;
+	m_neighborBuffer = NULL;
+	m_bodyContactCountBuffer = NULL;
+	m_bodyContactBuffer = NULL;
+	m_cellXBuffer = NULL;
+	m_cellYBuffer = NULL;
+	m_bucketBuffer = NULL;
+	m_hashProxies = NULL;
+	m_hashStarts = NULL;
+	m_hashSize = 0;
+}
+
+b2ParticleSystem::~b2ParticleSystem()
+{
+	Reallocate(0);
+}
+
+// Resize a particle buffer, keeping the first count elements.
+static void* b2ReallocateParticleBuffer(b2BlockAllocator* allocator, void* buffer, int32 elementSize,
+										int32 count, int32 oldCapacity, int32 newCapacity)
+{
+	void* newBuffer = NULL;
+	if (newCapacity > 0)
+	{
+		newBuffer = allocator->Allocate(newCapacity * elementSize);
+		if (count > 0)
+		{
+			memcpy(newBuffer, buffer, b2Min(count, newCapacity) * elementSize);
+		}
+	}
+
+	if (oldCapacity > 0)
+	{
+		allocator->Free(buffer, oldCapacity * elementSize);
+	}
+
+	return newBuffer;
+}
+
+void b2ParticleSystem::Reallocate(int32 capacity)
+{
+	b2BlockAllocator* allocator = &m_world->m_blockAllocator;
+	int32 count = m_count;
+	int32 oldCapacity = m_capacity;
+
+	// Particle state is kept, the per step buffers are rebuilt every step.
+	m_positionBuffer = (b2Vec2*)b2ReallocateParticleBuffer(allocator, m_positionBuffer, sizeof(b2Vec2), count, oldCapacity, capacity);
+	m_velocityBuffer = (b2Vec2*)b2ReallocateParticleBuffer(allocator, m_velocityBuffer, sizeof(b2Vec2), count, oldCapacity, capacity);
+	m_flagsBuffer = (uint32*)b2ReallocateParticleBuffer(allocator, m_flagsBuffer, sizeof(uint32), count, oldCapacity, capacity);
+	m_newVelocityBuffer = (b2Vec2*)b2ReallocateParticleBuffer(allocator, m_newVelocityBuffer, sizeof(b2Vec2), 0, oldCapacity, capacity);
+	m_weightBuffer = (float32*)b2ReallocateParticleBuffer(allocator, m_weightBuffer, sizeof(float32), 0, oldCapacity, capacity);
+	m_neighborCountBuffer = (int32*)b2ReallocateParticleBuffer(allocator, m_neighborCountBuffer, sizeof(int32), 0, oldCapacity, capacity);
+	m_neighborBuffer = (b2ParticleNeighbor*)b2ReallocateParticleBuffer(allocator, m_neighborBuffer,
+		b2_maxParticleNeighbors * sizeof(b2ParticleNeighbor), 0, oldCapacity, capacity);
+	m_bodyContactCountBuffer = (int32*)b2ReallocateParticleBuffer(allocator, m_bodyContactCountBuffer, sizeof(int32), 0, oldCapacity, capacity);
+	m_bodyContactBuffer = (b2ParticleBodyContact*)b2ReallocateParticleBuffer(allocator, m_bodyContactBuffer,
+		b2_maxParticleBodyContacts * sizeof(b2ParticleBodyContact), 0, oldCapacity, capacity);
+	m_cellXBuffer = (int32*)b2ReallocateParticleBuffer(allocator, m_cellXBuffer, sizeof(int32), 0, oldCapacity, capacity);
+	m_cellYBuffer = (int32*)b2ReallocateParticleBuffer(allocator, m_cellYBuffer, sizeof(int32), 0, oldCapacity, capacity);
+	m_bucketBuffer = (int32*)b2ReallocateParticleBuffer(allocator, m_bucketBuffer, sizeof(int32), 0, oldCapacity, capacity);
+	m_hashProxies = (b2ParticleProxy*)b2ReallocateParticleBuffer(allocator, m_hashProxies, sizeof(b2ParticleProxy), 0, oldCapacity, capacity);
+
+	// Twice as many buckets as particles keeps the chains short.
+	int32 hashSize = 0;
+	if (capacity > 0)
+	{
+		hashSize = 1;
+		while (hashSize < 2 * capacity)
+		{
+			hashSize <<= 1;
+		}
+	}
+	m_hashStarts = (int32*)b2ReallocateParticleBuffer(allocator, m_hashStarts, sizeof(int32), 0,
+		m_hashSize > 0 ? m_hashSize + 1 : 0, hashSize > 0 ? hashSize + 1 : 0);
+	m_hashSize = hashSize;
+
+	m_capacity = capacity;
+}
+
+int32 b2ParticleSystem::GetMemorySize() const
+{
+	int32 particleSize = 3 * sizeof(b2Vec2) + sizeof(uint32) + sizeof(float32) + 5 * sizeof(int32) + sizeof(b2ParticleProxy) +
+		b2_maxParticleNeighbors * sizeof(b2ParticleNeighbor) +
+		b2_maxParticleBodyContacts * sizeof(b2ParticleBodyContact);
+	int32 size = m_capacity * particleSize;
+	if (m_hashSize > 0)
+	{
+		size += (m_hashSize + 1) * sizeof(int32);
+	}
+	return size;
+}
+
+int32 b2ParticleSystem::CreateParticle(const b2ParticleDef& def)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return b2_invalidParticleIndex;
+	}
+
+	if (m_count == m_capacity)
+	{
+		Reallocate(m_capacity > 0 ? 2 * m_capacity : 256);
+	}
+
+	int32 index = m_count++;
+	m_positionBuffer[index] = def.position;
+	m_velocityBuffer[index] = def.velocity;
+	m_flagsBuffer[index] = def.flags;
+	return index;
+}
+
+void b2ParticleSystem::DestroyParticle(int32 index)
+{
+	b2Assert(m_world->IsLocked() == false);
+	b2Assert(0 <= index && index < m_count);
+	if (m_world->IsLocked())
+	{
+		return;
+	}
+
+	int32 last = --m_count;
+	m_positionBuffer[index] = m_positionBuffer[last];
+	m_velocityBuffer[index] = m_velocityBuffer[last];
+	m_flagsBuffer[index] = m_flagsBuffer[last];
+}
+
+void b2ParticleSystem::SetParticleFlags(int32 index, uint32 flags)
+{
+	b2Assert(0 <= index && index < m_count);
+	m_flagsBuffer[index] = flags;
+}
+
+float32 b2ParticleSystem::GetParticleMass() const
+{
+	float32 stride = b2_particleStride * m_diameter;
+	return m_def.density * stride * stride;
+}
+
+bool b2ParticleSystem::ShouldCollide(const b2Fixture* fixture) const
+{
+	if (fixture->IsSensor())
+	{
+		return false;
+	}
+
+	const b2Filter& filter = fixture->GetFilterData();
+	return (filter.maskBits & m_def.filter.categoryBits) != 0 &&
+		(filter.categoryBits & m_def.filter.maskBits) != 0;
+}
+
+void b2ParticleSystem::Solve(const b2TimeStep& step)
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	b2TraceScope("b2ParticleSystem::Solve");
+
+	m_dt = step.dt;
+	m_inv_dt = step.inv_dt;
+	m_gravity = m_def.gravityScale * m_world->m_gravity;
+
+	BuildHash();
+
+	// Each pass only writes the data of its own particles and reads that of
+	// the others from the previous pass, so the particles can be split freely.
+	{
+		b2TraceScope("b2ParticleSystem::ComputeWeights");
+		b2ParticleWeightTask task;
+		task.system = this;
+		m_world->RunParallel(&task, m_count, b2_particleTaskRange);
+	}
+
+	{
+		b2TraceScope("b2ParticleSystem::ComputeVelocities");
+		b2ParticleVelocityTask task;
+		task.system = this;
+		m_world->RunParallel(&task, m_count, b2_particleTaskRange);
+		b2Swap(m_velocityBuffer, m_newVelocityBuffer);
+	}
+
+	{
+		b2TraceScope("b2ParticleSystem::SolveCollisions");
+		b2ParticleCollisionTask task;
+		task.system = this;
+		m_world->RunParallel(&task, m_count, b2_particleTaskRange);
+	}
+
+	if (m_def.twoWayCoupling)
+	{
+		ApplyBodyImpulses();
+	}
+}
+
+void b2ParticleSystem::BuildHash()
+{
+	b2TraceScope("b2ParticleSystem::BuildHash");
+
+	int32 mask = m_hashSize - 1;
+	memset(m_hashStarts, 0, (m_hashSize + 1) * sizeof(int32));
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		int32 x = int32(floorf(m_positionBuffer[i].x * m_inverseDiameter));
+		int32 y = int32(floorf(m_positionBuffer[i].y * m_inverseDiameter));
+		int32 bucket = b2ParticleBucket(x, y, mask);
+		m_cellXBuffer[i] = x;
+		m_cellYBuffer[i] = y;
+		m_bucketBuffer[i] = bucket;
+		++m_hashStarts[bucket + 1];
+	}
+
+	for (int32 i = 0; i < m_hashSize; ++i)
+	{
+		m_hashStarts[i + 1] += m_hashStarts[i];
+	}
+
+	// A stable counting sort, so the neighbor order only depends on the
+	// particle order.
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ParticleProxy* proxy = m_hashProxies + m_hashStarts[m_bucketBuffer[i]]++;
+		proxy->position = m_positionBuffer[i];
+		proxy->cellX = m_cellXBuffer[i];
+		proxy->cellY = m_cellYBuffer[i];
+		proxy->index = i;
+	}
+
+	// The scatter advanced each start to the end of its bucket.
+	for (int32 i = m_hashSize; i > 0; --i)
+	{
+		m_hashStarts[i] = m_hashStarts[i - 1];
+	}
+	m_hashStarts[0] = 0;
+}
+
+void b2ParticleSystem::ComputeWeights(int32 begin, int32 end)
+{
+	int32 mask = m_hashSize - 1;
+	float32 diameterSqr = m_diameter * m_diameter;
+	b2Vec2 dv = m_dt * m_gravity;
+
+	b2ParticleFixtureQuery query;
+	query.broadPhase = &m_world->m_contactManager.m_broadPhase;
+	query.system = this;
+	query.diameter = m_diameter;
+
+	// Going through the particles in hash order keeps the buckets they scan
+	// in the cache.
+	for (int32 n = begin; n < end; ++n)
+	{
+		const b2ParticleProxy* self = m_hashProxies + n;
+		int32 i = self->index;
+		m_velocityBuffer[i] += dv;
+
+		b2Vec2 p = self->position;
+		int32 cellX = self->cellX;
+		int32 cellY = self->cellY;
+
+		b2ParticleNeighbor* neighbors = m_neighborBuffer + i * b2_maxParticleNeighbors;
+		int32 neighborCount = 0;
+		float32 weight = 0.0f;
+
+		for (int32 y = cellY - 1; y <= cellY + 1; ++y)
+		{
+			// The three cells of the row are one range of proxies, or two if
+			// the row wraps around the end of the table.
+			int32 first = b2ParticleBucket(cellX - 1, y, mask);
+			int32 last = b2ParticleBucket(cellX + 1, y, mask);
+			int32 ranges[4];
+			ranges[0] = m_hashStarts[first];
+			if (first <= last)
+			{
+				ranges[1] = m_hashStarts[last + 1];
+				ranges[2] = 0;
+				ranges[3] = 0;
+			}
+			else
+			{
+				ranges[1] = m_hashStarts[m_hashSize];
+				ranges[2] = 0;
+				ranges[3] = m_hashStarts[last + 1];
+			}
+
+			for (int32 r = 0; r < 4; r += 2)
+			{
+				for (int32 k = ranges[r]; k < ranges[r + 1]; ++k)
+				{
+					const b2ParticleProxy* proxy = m_hashProxies + k;
+					int32 j = proxy->index;
+
+					// Other cells can share the buckets.
+					if (j == i || proxy->cellY != y || b2Abs(proxy->cellX - cellX) > 1)
+					{
+						continue;
+					}
+
+					float32 distanceSqr = b2DistanceSquared(p, proxy->position);
+					if (distanceSqr >= diameterSqr || neighborCount == b2_maxParticleNeighbors)
+					{
+						continue;
+					}
+
+					float32 w = 1.0f - b2Sqrt(distanceSqr) * m_inverseDiameter;
+					neighbors[neighborCount].index = j;
+					neighbors[neighborCount].weight = w;
+					++neighborCount;
+					weight += w;
+				}
+			}
+		}
+
+		query.position = p;
+		query.contacts = m_bodyContactBuffer + i * b2_maxParticleBodyContacts;
+		query.count = 0;
+
+		b2AABB aabb;
+		aabb.lowerBound.Set(p.x - m_diameter, p.y - m_diameter);
+		aabb.upperBound.Set(p.x + m_diameter, p.y + m_diameter);
+		query.broadPhase->Query(&query, aabb);
+
+		for (int32 j = 0; j < query.count; ++j)
+		{
+			weight += query.contacts[j].weight;
+		}
+
+		m_neighborCountBuffer[i] = neighborCount;
+		m_bodyContactCountBuffer[i] = query.count;
+		m_weightBuffer[i] = weight;
+	}
+}
+
+void b2ParticleSystem::ComputeVelocities(int32 begin, int32 end)
+{
+	// These scale with the diameter and the time step so the fluid behaves
+	// the same at any size.
+	float32 criticalVelocity = m_diameter * m_inv_dt;
+	float32 pressurePerWeight = m_def.pressureStrength * m_def.density * criticalVelocity * criticalVelocity;
+	float32 velocityPerPressure = m_dt / (m_def.density * m_diameter);
+	float32 powderVelocity = m_def.powderStrength * criticalVelocity;
+	float32 minPowderWeight = 1.0f - b2_particleStride;
+	float32 mass = GetParticleMass();
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2Vec2 p = m_positionBuffer[i];
+		b2Vec2 v = m_velocityBuffer[i];
+		uint32 flags = m_flagsBuffer[i];
+
+		float32 wi = b2Clamp(m_weightBuffer[i], b2_minParticleWeight, b2_maxParticleWeight);
+		float32 hi = pressurePerWeight * (wi - b2_minParticleWeight);
+
+		b2Vec2 dv(0.0f, 0.0f);
+
+		const b2ParticleNeighbor* neighbors = m_neighborBuffer + i * b2_maxParticleNeighbors;
+		int32 neighborCount = m_neighborCountBuffer[i];
+		for (int32 k = 0; k < neighborCount; ++k)
+		{
+			int32 j = neighbors[k].index;
+			float32 w = neighbors[k].weight;
+
+			// The distance follows from the weight.
+			float32 distance = (1.0f - w) * m_diameter;
+			if (distance < b2_epsilon)
+			{
+				continue;
+			}
+			b2Vec2 n = (1.0f / distance) * (m_positionBuffer[j] - p);
+
+			float32 wj = b2Clamp(m_weightBuffer[j], b2_minParticleWeight, b2_maxParticleWeight);
+			float32 hj = pressurePerWeight * (wj - b2_minParticleWeight);
+			dv -= (velocityPerPressure * w * (hi + hj)) * n;
+
+			b2Vec2 vr = m_velocityBuffer[j] - v;
+			float32 vn = b2Dot(vr, n);
+			if (vn < 0.0f)
+			{
+				// Each particle of the pair removes half of the approach.
+				dv += (0.5f * m_def.dampingStrength * w * vn) * n;
+			}
+
+			uint32 pairFlags = flags | m_flagsBuffer[j];
+			if (pairFlags & b2_viscousParticle)
+			{
+				dv += (m_def.viscousStrength * w) * vr;
+			}
+
+			if ((pairFlags & b2_powderParticle) && w > minPowderWeight)
+			{
+				dv -= (powderVelocity * (w - minPowderWeight)) * n;
+			}
+		}
+
+		b2ParticleBodyContact* contacts = m_bodyContactBuffer + i * b2_maxParticleBodyContacts;
+		int32 contactCount = m_bodyContactCountBuffer[i];
+		for (int32 k = 0; k < contactCount; ++k)
+		{
+			b2ParticleBodyContact* contact = contacts + k;
+			b2Body* body = contact->fixture->GetBody();
+			float32 w = contact->weight;
+			b2Vec2 n = contact->normal;
+
+			// The surface pushes back like a particle with the same pressure.
+			b2Vec2 dvc = (velocityPerPressure * w * hi) * n;
+
+			float32 vn = b2Dot(v - body->GetLinearVelocityFromWorldPoint(p), n);
+			if (vn < 0.0f)
+			{
+				dvc -= (m_def.dampingStrength * w * vn) * n;
+			}
+
+			dv += dvc;
+			if (body->GetType() == b2_dynamicBody)
+			{
+				contact->impulse = -mass * dvc;
+			}
+		}
+
+		m_newVelocityBuffer[i] = v + dv;
+	}
+}
+
+void b2ParticleSystem::SolveCollisions(int32 begin, int32 end)
+{
+	// Limiting the motion to a diameter per step keeps the particles from
+	// tunneling and the fixtures they can reach among their body contacts.
+	float32 maxSpeed = m_diameter * m_inv_dt;
+	float32 maxSpeedSqr = maxSpeed * maxSpeed;
+	float32 mass = GetParticleMass();
+
+	for (int32 i = begin; i < end; ++i)
+	{
+		b2Vec2 v = m_velocityBuffer[i];
+		float32 speedSqr = v.LengthSquared();
+		if (speedSqr > maxSpeedSqr)
+		{
+			v *= maxSpeed / b2Sqrt(speedSqr);
+		}
+
+		b2Vec2 p = m_positionBuffer[i];
+		b2ParticleBodyContact* contacts = m_bodyContactBuffer + i * b2_maxParticleBodyContacts;
+		int32 contactCount = m_bodyContactCountBuffer[i];
+		if (contactCount > 0 && speedSqr > 0.0f)
+		{
+			b2RayCastInput input;
+			input.p1 = p;
+			input.p2 = p + m_dt * v;
+			input.maxFraction = 1.0f;
+
+			b2ParticleBodyContact* hit = NULL;
+			b2Vec2 normal = b2Vec2_zero;
+			for (int32 k = 0; k < contactCount; ++k)
+			{
+				b2RayCastOutput output;
+				if (contacts[k].fixture->RayCast(&output, input, contacts[k].childIndex))
+				{
+					input.maxFraction = output.fraction;
+					normal = output.normal;
+					hit = contacts + k;
+				}
+			}
+
+			if (hit)
+			{
+				// Stop at the surface.
+				float32 fraction = input.maxFraction;
+				b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2 + b2_linearSlop * normal;
+				b2Vec2 newVelocity = m_inv_dt * (point - p);
+				if (hit->fixture->GetBody()->GetType() == b2_dynamicBody)
+				{
+					hit->impulse += mass * (v - newVelocity);
+				}
+				v = newVelocity;
+			}
+		}
+
+		m_velocityBuffer[i] = v;
+		m_positionBuffer[i] = p + m_dt * v;
+	}
+}
+
+void b2ParticleSystem::ApplyBodyImpulses()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ParticleBodyContact* contacts = m_bodyContactBuffer + i * b2_maxParticleBodyContacts;
+		int32 contactCount = m_bodyContactCountBuffer[i];
+		for (int32 k = 0; k < contactCount; ++k)
+		{
+			const b2ParticleBodyContact* contact = contacts + k;
+			if (contact->impulse.x != 0.0f || contact->impulse.y != 0.0f)
+			{
+				contact->fixture->GetBody()->ApplyLinearImpulse(contact->impulse, m_positionBuffer[i], true);
+			}
+		}
+	}
+}
+
+void b2ParticleSystem::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		m_positionBuffer[i] -= newOrigin;
+	}
+}
+
+template <typename T>
+static void b2DrawParticles(T* draw, const b2Vec2* positions, const uint32* flags, int32 count, float32 radius)
+{
+	b2Color water(0.3f, 0.5f, 0.9f);
+	b2Color powder(0.8f, 0.7f, 0.4f);
+	for (int32 i = 0; i < count; ++i)
+	{
+		const b2Color& color = (flags[i] & b2_powderParticle) ? powder : water;
+		draw->DrawCircle(positions[i], radius, color);
+	}
+}
+
+void b2ParticleSystem::Draw(b2Draw* draw) const
+{
+	b2DrawParticles(draw, m_positionBuffer, m_flagsBuffer, m_count, m_def.radius);
+}
+
+void b2ParticleSystem::Draw(b2DrawBuffer* buffer) const
+{
+	buffer->Reserve(2 * buffer->GetCircleSegmentCount() * m_count, 0);
+	b2DrawParticles(buffer, m_positionBuffer, m_flagsBuffer, m_count, m_def.radius);
+}
@@ -0,0 +1,316 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef B2_PARTICLE_SYSTEM_H
+#define B2_PARTICLE_SYSTEM_H
+
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+class b2World;
+class b2Draw;
+class b2DrawBuffer;
+struct b2TimeStep;
+
+#define b2_invalidParticleIndex		(-1)
+
+/// The particle types. Flags can be combined.
+enum b2ParticleFlag
+{
+	/// Pressure only.
+	b2_waterParticle = 0,
+
+	/// Adds viscosity, the particle takes on the velocity of its neighbors.
+	b2_viscousParticle = 1 << 0,
+
+	/// Adds a strong short range repulsion, for sand and gravel.
+	b2_powderParticle = 1 << 1
+};
+
+/// A particle definition holds the data needed to create a particle.
+struct b2ParticleDef
+{
+	b2ParticleDef()
+	{
+		flags = b2_waterParticle;
+		position.SetZero();
+		velocity.SetZero();
+	}
+
+	/// A combination of b2ParticleFlag.
+	uint32 flags;
+
+	/// The world position of the particle.
+	b2Vec2 position;
+
+	/// The linear velocity of the particle in world coordinates.
+	b2Vec2 velocity;
+};
+
+/// A particle system definition holds the settings shared by its particles.
+struct b2ParticleSystemDef
+{
+	/// This constructor sets the particle system definition default values.
+	b2ParticleSystemDef()
+	{
+		radius = 0.05f;
+		density = 1.0f;
+		gravityScale = 1.0f;
+		pressureStrength = 0.05f;
+		dampingStrength = 1.0f;
+		viscousStrength = 0.25f;
+		powderStrength = 0.5f;
+		twoWayCoupling = true;
+	}
+
+	/// The particle radius. Particles interact with everything within a
+	/// diameter.
+	float32 radius;
+
+	/// The density of the particles, usually in kg/m^2. This sets how hard
+	/// the particles push on bodies.
+	float32 density;
+
+	/// Scale the world gravity for the particles.
+	float32 gravityScale;
+
+	/// How strongly compressed particles push each other apart. Large values
+	/// make the fluid less compressible but can blow up, keep it below 0.2.
+	float32 pressureStrength;
+
+	/// Removes the approaching velocity of touching particles and bodies.
+	float32 dampingStrength;
+
+	/// The viscosity of b2_viscousParticle particles.
+	float32 viscousStrength;
+
+	/// The repulsion of b2_powderParticle particles.
+	float32 powderStrength;
+
+	/// If true the particles push the dynamic bodies they touch. Otherwise
+	/// the bodies move the particles and are not affected by them.
+	bool twoWayCoupling;
+
+	/// Only fixtures whose filter accepts this filter collide with the particles.
+	/// The group index is not used.
+	b2Filter filter;
+};
+
+/// A fixture touched by a particle.
+struct b2ParticleBodyContact
+{
+	b2Fixture* fixture;
+	int32 childIndex;
+	float32 weight;
+	b2Vec2 normal;		///< from the fixture to the particle
+	b2Vec2 impulse;		///< applied to the body at the end of the pass
+};
+
+/// A neighbor of a particle.
+struct b2ParticleNeighbor
+{
+	int32 index;
+	float32 weight;
+};
+
+/// A particle in the spatial hash. The position and cell are copied so
+/// scanning a bucket reads contiguous memory.
+struct b2ParticleProxy
+{
+	b2Vec2 position;
+	int32 cellX;
+	int32 cellY;
+	int32 index;
+};
+
+/// Fluid and granular matter made of small particles, created by b2World.
+/// Particles are much cheaper than circle bodies: they have no fixtures,
+/// broad-phase proxies or contacts. Their state is kept in arrays and they
+/// find each other with a spatial hash that is rebuilt every step.
+/// Particles push each other apart with an SPH-style pressure and collide
+/// with the fixtures of the world, but not with the particles of other
+/// systems. The particle passes are split across threads by the world's
+/// b2TaskExecutor.
+class b2ParticleSystem
+{
+public:
+
+	/// Create a particle.
+	/// @return the particle index, or b2_invalidParticleIndex when the world is locked.
+	/// @warning This function is locked during callbacks.
+	int32 CreateParticle(const b2ParticleDef& def);
+
+	/// Destroy a particle. The last particle is moved to its index.
+	/// @warning This function is locked during callbacks.
+	void DestroyParticle(int32 index);
+
+	/// Get the number of particles.
+	int32 GetParticleCount() const;
+
+	/// Get the particle positions, indexed by particle. You may change them
+	/// between steps.
+	b2Vec2* GetPositionBuffer();
+	const b2Vec2* GetPositionBuffer() const;
+
+	/// Get the particle velocities, indexed by particle. You may change them
+	/// between steps.
+	b2Vec2* GetVelocityBuffer();
+	const b2Vec2* GetVelocityBuffer() const;
+
+	/// Get the particle flags, indexed by particle.
+	const uint32* GetFlagsBuffer() const;
+
+	/// Change the flags of a particle.
+	void SetParticleFlags(int32 index, uint32 flags);
+
+	/// Get the particle radius.
+	float32 GetRadius() const;
+
+	/// Get the mass of one particle.
+	float32 GetParticleMass() const;
+
+	/// Get the next particle system in the world's list.
+	b2ParticleSystem* GetNext();
+	const b2ParticleSystem* GetNext() const;
+
+	/// Get the parent world of this particle system.
+	b2World* GetWorld();
+	const b2World* GetWorld() const;
+
+	/// Get the bytes allocated for the particle buffers.
+	int32 GetMemorySize() const;
+
+protected:
+
+	friend class b2World;
+	friend class b2ParticleWeightTask;
+	friend class b2ParticleVelocityTask;
+	friend class b2ParticleCollisionTask;
+	friend struct b2ParticleFixtureQuery;
+
+	b2ParticleSystem(const b2ParticleSystemDef* def, b2World* world);
+	~b2ParticleSystem();
+
+	void Reallocate(int32 capacity);
+	void Solve(const b2TimeStep& step);
+	void BuildHash();
+	void ComputeWeights(int32 begin, int32 end);
+	void ComputeVelocities(int32 begin, int32 end);
+	void SolveCollisions(int32 begin, int32 end);
+	void ApplyBodyImpulses();
+	bool ShouldCollide(const b2Fixture* fixture) const;
+	void ShiftOrigin(const b2Vec2& newOrigin);
+	void Draw(b2Draw* draw) const;
+	void Draw(b2DrawBuffer* buffer) const;
+
+	b2World* m_world;
+	b2ParticleSystem* m_prev;
+	b2ParticleSystem* m_next;
+
+	b2ParticleSystemDef m_def;
+	float32 m_diameter;
+	float32 m_inverseDiameter;
+
+	// Updated at the start of Solve.
+	float32 m_dt;
+	float32 m_inv_dt;
+	b2Vec2 m_gravity;
+
+	int32 m_count;
+	int32 m_capacity;
+
+	// Particle state.
+	b2Vec2* m_positionBuffer;
+	b2Vec2* m_velocityBuffer;
+	uint32* m_flagsBuffer;
+
+	// Per step buffers. m_newVelocityBuffer receives the velocities while the
+	// old ones are read, so the result doesn't depend on the particle order.
+	b2Vec2* m_newVelocityBuffer;
+	float32* m_weightBuffer;
+	int32* m_neighborCountBuffer;
+	b2ParticleNeighbor* m_neighborBuffer;
+	int32* m_bodyContactCountBuffer;
+	b2ParticleBodyContact* m_bodyContactBuffer;
+
+	// The spatial hash. Cells are a diameter wide. The particles are sorted
+	// by bucket, those of bucket i are m_hashProxies[m_hashStarts[i]] up
+	// to m_hashStarts[i + 1].
+	int32* m_cellXBuffer;
+	int32* m_cellYBuffer;
+	int32* m_bucketBuffer;
+	b2ParticleProxy* m_hashProxies;
+	int32* m_hashStarts;
+	int32 m_hashSize;
+};
+
+inline int32 b2ParticleSystem::GetParticleCount() const
+{
+	return m_count;
+}
+
+inline b2Vec2* b2ParticleSystem::GetPositionBuffer()
+{
+	return m_positionBuffer;
+}
+
+inline const b2Vec2* b2ParticleSystem::GetPositionBuffer() const
+{
+	return m_positionBuffer;
+}
+
+inline b2Vec2* b2ParticleSystem::GetVelocityBuffer()
+{
+	return m_velocityBuffer;
+}
+
+inline const b2Vec2* b2ParticleSystem::GetVelocityBuffer() const
+{
+	return m_velocityBuffer;
+}
+
+inline const uint32* b2ParticleSystem::GetFlagsBuffer() const
+{
+	return m_flagsBuffer;
+}
+
+inline float32 b2ParticleSystem::GetRadius() const
+{
+	return m_def.radius;
+}
+
+inline b2ParticleSystem* b2ParticleSystem::GetNext()
+{
+	return m_next;
+}
+
+inline const b2ParticleSystem* b2ParticleSystem::GetNext() const
+{
+	return m_next;
+}
+
+inline b2World* b2ParticleSystem::GetWorld()
+{
+	return m_world;
+}
+
+inline const b2World* b2ParticleSystem::GetWorld() const
+{
+	return m_world;
+}
+
+#endif
@@ -0,0 +1,524 @@
+/*
+* Copyright (c) 2011 Erin Catto http://box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include <Box2D/Rope/b2RopeSystem.h>
+#include <Box2D/Common/b2Draw.h>
+#include <string.h>
+
+// Copy a buffer into a larger one.
+static void* b2GrowBuffer(void* buffer, int32 size, int32 newSize)
+{
+	void* newBuffer = b2Alloc(newSize);
+	if (size > 0)
+	{
+		memcpy(newBuffer, buffer, size);
+	}
+	b2Free(buffer);
+	return newBuffer;
+}
+
+b2RopeSystem::b2RopeSystem()
+{
+	m_px = NULL;
+	m_py = NULL;
+	m_p0x = NULL;
+	m_p0y = NULL;
+	m_vx = NULL;
+	m_vy = NULL;
+	m_ims = NULL;
+	m_Ls = NULL;
+	m_as = NULL;
+	m_rowCount = 0;
+	m_rowCapacity = 0;
+
+	m_batches = NULL;
+	m_batchCount = 0;
+	m_batchCapacity = 0;
+
+	m_ropes = NULL;
+	m_ropeCount = 0;
+	m_ropeCapacity = 0;
+
+	m_vertices = NULL;
+	m_vertexCount = 0;
+	m_vertexCapacity = 0;
+}
+
+b2RopeSystem::~b2RopeSystem()
+{
+	b2Free(m_px);
+	b2Free(m_py);
+	b2Free(m_p0x);
+	b2Free(m_p0y);
+	b2Free(m_vx);
+	b2Free(m_vy);
+	b2Free(m_ims);
+	b2Free(m_Ls);
+	b2Free(m_as);
+	b2Free(m_batches);
+	b2Free(m_ropes);
+	b2Free(m_vertices);
+}
+
+int32 b2RopeSystem::AllocateBatch(int32 count)
+{
+	if (m_rowCount + count > m_rowCapacity)
+	{
+		int32 capacity = b2Max(2 * m_rowCapacity, m_rowCount + count);
+		int32 size = m_rowCount * b2_simdWidth * sizeof(float32);
+		int32 newSize = capacity * b2_simdWidth * sizeof(float32);
+		m_px = (float32*)b2GrowBuffer(m_px, size, newSize);
+		m_py = (float32*)b2GrowBuffer(m_py, size, newSize);
+		m_p0x = (float32*)b2GrowBuffer(m_p0x, size, newSize);
+		m_p0y = (float32*)b2GrowBuffer(m_p0y, size, newSize);
+		m_vx = (float32*)b2GrowBuffer(m_vx, size, newSize);
+		m_vy = (float32*)b2GrowBuffer(m_vy, size, newSize);
+		m_ims = (float32*)b2GrowBuffer(m_ims, size, newSize);
+		m_Ls = (float32*)b2GrowBuffer(m_Ls, size, newSize);
+		m_as = (float32*)b2GrowBuffer(m_as, size, newSize);
+		m_rowCapacity = capacity;
+	}
+
+	if (m_batchCount == m_batchCapacity)
+	{
+		int32 capacity = b2Max(2 * m_batchCapacity, 8);
+		m_batches = (b2RopeBatch*)b2GrowBuffer(m_batches, m_batchCount * sizeof(b2RopeBatch), capacity * sizeof(b2RopeBatch));
+		m_batchCapacity = capacity;
+	}
+
+	// Empty lanes are massless and never move.
+	int32 offset = m_rowCount * b2_simdWidth;
+	int32 size = count * b2_simdWidth * sizeof(float32);
+	memset(m_px + offset, 0, size);
+	memset(m_py + offset, 0, size);
+	memset(m_p0x + offset, 0, size);
+	memset(m_p0y + offset, 0, size);
+	memset(m_vx + offset, 0, size);
+	memset(m_vy + offset, 0, size);
+	memset(m_ims + offset, 0, size);
+	memset(m_Ls + offset, 0, size);
+	memset(m_as + offset, 0, size);
+	m_rowCount += count;
+
+	b2RopeBatch* batch = m_batches + m_batchCount;
+	memset(batch, 0, sizeof(b2RopeBatch));
+	batch->count = count;
+	batch->ropeCount = 0;
+	batch->offset = offset;
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		batch->ropes[i] = -1;
+	}
+
+	return m_batchCount++;
+}
+
+int32 b2RopeSystem::CreateRope(const b2RopeDef* def)
+{
+	b2Assert(def->count >= 3);
+	int32 count = def->count;
+
+	// Fill the batches in order so the newest batch is the only partial one per count.
+	int32 batchIndex = -1;
+	for (int32 i = m_batchCount - 1; i >= 0; --i)
+	{
+		if (m_batches[i].count == count && m_batches[i].ropeCount < b2_simdWidth)
+		{
+			batchIndex = i;
+			break;
+		}
+	}
+
+	if (batchIndex == -1)
+	{
+		batchIndex = AllocateBatch(count);
+	}
+
+	if (m_ropeCount == m_ropeCapacity)
+	{
+		int32 capacity = b2Max(2 * m_ropeCapacity, 16);
+		m_ropes = (b2RopeProxy*)b2GrowBuffer(m_ropes, m_ropeCount * sizeof(b2RopeProxy), capacity * sizeof(b2RopeProxy));
+		m_ropeCapacity = capacity;
+	}
+
+	if (m_vertexCount + count > m_vertexCapacity)
+	{
+		int32 capacity = b2Max(2 * m_vertexCapacity, m_vertexCount + count);
+		m_vertices = (b2Vec2*)b2GrowBuffer(m_vertices, m_vertexCount * sizeof(b2Vec2), capacity * sizeof(b2Vec2));
+		m_vertexCapacity = capacity;
+	}
+
+	b2RopeBatch* batch = m_batches + batchIndex;
+	int32 lane = batch->ropeCount++;
+	int32 index = m_ropeCount++;
+	batch->ropes[lane] = index;
+	batch->gravityX[lane] = def->gravity.x;
+	batch->gravityY[lane] = def->gravity.y;
+	batch->damping[lane] = def->damping;
+	batch->k2[lane] = def->k2;
+	batch->k3[lane] = def->k3;
+
+	b2RopeProxy* rope = m_ropes + index;
+	rope->batch = batchIndex;
+	rope->lane = lane;
+	rope->vertexStart = m_vertexCount;
+	rope->count = count;
+	m_vertexCount += count;
+
+	// Same setup as b2Rope::Initialize.
+	int32 offset = batch->offset + lane;
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 k = offset + i * b2_simdWidth;
+		m_px[k] = def->vertices[i].x;
+		m_py[k] = def->vertices[i].y;
+		m_p0x[k] = def->vertices[i].x;
+		m_p0y[k] = def->vertices[i].y;
+		m_vx[k] = 0.0f;
+		m_vy[k] = 0.0f;
+
+		float32 m = def->masses[i];
+		if (m > 0.0f)
+		{
+			m_ims[k] = 1.0f / m;
+		}
+		else
+		{
+			m_ims[k] = 0.0f;
+		}
+
+		m_vertices[rope->vertexStart + i] = def->vertices[i];
+	}
+
+	for (int32 i = 0; i < count - 1; ++i)
+	{
+		b2Vec2 p1 = def->vertices[i];
+		b2Vec2 p2 = def->vertices[i + 1];
+		m_Ls[offset + i * b2_simdWidth] = b2Distance(p1, p2);
+	}
+
+	for (int32 i = 0; i < count - 2; ++i)
+	{
+		b2Vec2 p1 = def->vertices[i];
+		b2Vec2 p2 = def->vertices[i + 1];
+		b2Vec2 p3 = def->vertices[i + 2];
+
+		b2Vec2 d1 = p2 - p1;
+		b2Vec2 d2 = p3 - p2;
+
+		float32 a = b2Cross(d1, d2);
+		float32 b = b2Dot(d1, d2);
+
+		m_as[offset + i * b2_simdWidth] = b2Atan2(a, b);
+	}
+
+	return index;
+}
+
+void b2RopeSystem::SetAngle(int32 index, float32 angle)
+{
+	b2Assert(0 <= index && index < m_ropeCount);
+	const b2RopeProxy* rope = m_ropes + index;
+	int32 offset = m_batches[rope->batch].offset + rope->lane;
+	for (int32 i = 0; i < rope->count - 2; ++i)
+	{
+		m_as[offset + i * b2_simdWidth] = angle;
+	}
+}
+
+void b2RopeSystem::Step(float32 h, int32 iterations)
+{
+	StepBatches(h, iterations, 0, m_batchCount);
+}
+
+void b2RopeSystem::StepBatches(float32 h, int32 iterations, int32 firstBatch, int32 batchCount)
+{
+	b2Assert(0 <= firstBatch && firstBatch + batchCount <= m_batchCount);
+
+	if (h == 0.0)
+	{
+		return;
+	}
+
+	for (int32 i = firstBatch; i < firstBatch + batchCount; ++i)
+	{
+		StepBatch(m_batches + i, h, iterations);
+	}
+}
+
+void b2RopeSystem::StepBatch(const b2RopeBatch* batch, float32 h, int32 iterations)
+{
+	int32 count = batch->count;
+	float32* px = m_px + batch->offset;
+	float32* py = m_py + batch->offset;
+	float32* p0x = m_p0x + batch->offset;
+	float32* p0y = m_p0y + batch->offset;
+	float32* vx = m_vx + batch->offset;
+	float32* vy = m_vy + batch->offset;
+	const float32* ims = m_ims + batch->offset;
+
+	float32 damping[b2_simdWidth];
+	for (int32 i = 0; i < b2_simdWidth; ++i)
+	{
+		damping[i] = b2Exp(- h * batch->damping[i]);
+	}
+
+	b2Lanes zero = b2SplatLanes(0.0f);
+	b2Lanes hs = b2SplatLanes(h);
+	b2Lanes d = b2LoadLanes(damping);
+	b2Lanes gx = b2MulLanes(hs, b2LoadLanes(batch->gravityX));
+	b2Lanes gy = b2MulLanes(hs, b2LoadLanes(batch->gravityY));
+
+	for (int32 i = 0; i < count * b2_simdWidth; i += b2_simdWidth)
+	{
+		b2Lanes x = b2LoadLanes(px + i);
+		b2Lanes y = b2LoadLanes(py + i);
+		b2StoreLanes(p0x + i, x);
+		b2StoreLanes(p0y + i, y);
+
+		b2Lanes dynamic = b2LessLanes(zero, b2LoadLanes(ims + i));
+		b2Lanes u = b2LoadLanes(vx + i);
+		b2Lanes v = b2LoadLanes(vy + i);
+		u = b2SelectLanes(dynamic, b2AddLanes(u, gx), u);
+		v = b2SelectLanes(dynamic, b2AddLanes(v, gy), v);
+		u = b2MulLanes(u, d);
+		v = b2MulLanes(v, d);
+		b2StoreLanes(vx + i, u);
+		b2StoreLanes(vy + i, v);
+		b2StoreLanes(px + i, b2AddLanes(x, b2MulLanes(hs, u)));
+		b2StoreLanes(py + i, b2AddLanes(y, b2MulLanes(hs, v)));
+	}
+
+	for (int32 i = 0; i < iterations; ++i)
+	{
+		SolveC2(batch);
+		SolveC3(batch);
+		SolveC2(batch);
+	}
+
+	b2Lanes inv_h = b2SplatLanes(1.0f / h);
+	for (int32 i = 0; i < count * b2_simdWidth; i += b2_simdWidth)
+	{
+		b2StoreLanes(vx + i, b2MulLanes(inv_h, b2SubLanes(b2LoadLanes(px + i), b2LoadLanes(p0x + i))));
+		b2StoreLanes(vy + i, b2MulLanes(inv_h, b2SubLanes(b2LoadLanes(py + i), b2LoadLanes(p0y + i))));
+	}
+
+	for (int32 lane = 0; lane < batch->ropeCount; ++lane)
+	{
+		b2Vec2* vertices = m_vertices + m_ropes[batch->ropes[lane]].vertexStart;
+		for (int32 i = 0; i < count; ++i)
+		{
+			vertices[i].Set(px[i * b2_simdWidth + lane], py[i * b2_simdWidth + lane]);
+		}
+	}
+}
+
+// The lane version of b2Rope::SolveC2. The skipped constraints are masked out.
+void b2RopeSystem::SolveC2(const b2RopeBatch* batch)
+{
+	float32* px = m_px + batch->offset;
+	float32* py = m_py + batch->offset;
+	const float32* ims = m_ims + batch->offset;
+	const float32* Ls = m_Ls + batch->offset;
+
+	b2Lanes zero = b2SplatLanes(0.0f);
+	b2Lanes one = b2SplatLanes(1.0f);
+	b2Lanes epsilon = b2SplatLanes(b2_epsilon);
+	b2Lanes k2 = b2LoadLanes(batch->k2);
+
+	// The second vertex of one constraint is the first of the next, keep it in registers.
+	b2Lanes x1 = b2LoadLanes(px);
+	b2Lanes y1 = b2LoadLanes(py);
+	b2Lanes im1 = b2LoadLanes(ims);
+
+	int32 count2 = batch->count - 1;
+	for (int32 i = 0; i < count2; ++i)
+	{
+		int32 k = i * b2_simdWidth;
+
+		b2Lanes x2 = b2LoadLanes(px + k + b2_simdWidth);
+		b2Lanes y2 = b2LoadLanes(py + k + b2_simdWidth);
+		b2Lanes im2 = b2LoadLanes(ims + k + b2_simdWidth);
+
+		// b2Vec2::Normalize
+		b2Lanes dx = b2SubLanes(x2, x1);
+		b2Lanes dy = b2SubLanes(y2, y1);
+		b2Lanes length = b2SqrtLanes(b2AddLanes(b2MulLanes(dx, dx), b2MulLanes(dy, dy)));
+		b2Lanes small = b2LessLanes(length, epsilon);
+		b2Lanes invLength = b2DivLanes(one, length);
+		dx = b2SelectLanes(small, dx, b2MulLanes(dx, invLength));
+		dy = b2SelectLanes(small, dy, b2MulLanes(dy, invLength));
+		b2Lanes L = b2SelectLanes(small, zero, length);
+
+		b2Lanes im = b2AddLanes(im1, im2);
+		b2Lanes skip = b2EqualLanes(im, zero);
+
+		b2Lanes s1 = b2DivLanes(im1, im);
+		b2Lanes s2 = b2DivLanes(im2, im);
+
+		b2Lanes C = b2SubLanes(b2LoadLanes(Ls + k), L);
+		b2Lanes c1 = b2MulLanes(b2MulLanes(k2, s1), C);
+		b2Lanes c2 = b2MulLanes(b2MulLanes(k2, s2), C);
+
+		x1 = b2SelectLanes(skip, x1, b2SubLanes(x1, b2MulLanes(c1, dx)));
+		y1 = b2SelectLanes(skip, y1, b2SubLanes(y1, b2MulLanes(c1, dy)));
+		x2 = b2SelectLanes(skip, x2, b2AddLanes(x2, b2MulLanes(c2, dx)));
+		y2 = b2SelectLanes(skip, y2, b2AddLanes(y2, b2MulLanes(c2, dy)));
+
+		b2StoreLanes(px + k, x1);
+		b2StoreLanes(py + k, y1);
+
+		x1 = x2;
+		y1 = y2;
+		im1 = im2;
+	}
+
+	b2StoreLanes(px + count2 * b2_simdWidth, x1);
+	b2StoreLanes(py + count2 * b2_simdWidth, y1);
+}
+
+// The lane version of b2Rope::SolveC3. Only the angle and its wrapping are
+// done one lane at a time.
+void b2RopeSystem::SolveC3(const b2RopeBatch* batch)
+{
+	float32* px = m_px + batch->offset;
+	float32* py = m_py + batch->offset;
+	const float32* ims = m_ims + batch->offset;
+	const float32* as = m_as + batch->offset;
+
+	b2Lanes zero = b2SplatLanes(0.0f);
+	b2Lanes one = b2SplatLanes(1.0f);
+	b2Lanes minusOne = b2SplatLanes(-1.0f);
+	b2Lanes k3 = b2MulLanes(minusOne, b2LoadLanes(batch->k3));
+
+	b2Lanes x1 = b2LoadLanes(px);
+	b2Lanes y1 = b2LoadLanes(py);
+	b2Lanes m1 = b2LoadLanes(ims);
+	b2Lanes x2 = b2LoadLanes(px + b2_simdWidth);
+	b2Lanes y2 = b2LoadLanes(py + b2_simdWidth);
+	b2Lanes m2 = b2LoadLanes(ims + b2_simdWidth);
+
+	int32 count3 = batch->count - 2;
+	for (int32 i = 0; i < count3; ++i)
+	{
+		int32 k = i * b2_simdWidth;
+
+		b2Lanes x3 = b2LoadLanes(px + k + 2 * b2_simdWidth);
+		b2Lanes y3 = b2LoadLanes(py + k + 2 * b2_simdWidth);
+		b2Lanes m3 = b2LoadLanes(ims + k + 2 * b2_simdWidth);
+
+		b2Lanes d1x = b2SubLanes(x2, x1);
+		b2Lanes d1y = b2SubLanes(y2, y1);
+		b2Lanes d2x = b2SubLanes(x3, x2);
+		b2Lanes d2y = b2SubLanes(y3, y2);
+
+		b2Lanes L1sqr = b2AddLanes(b2MulLanes(d1x, d1x), b2MulLanes(d1y, d1y));
+		b2Lanes L2sqr = b2AddLanes(b2MulLanes(d2x, d2x), b2MulLanes(d2y, d2y));
+
+		b2Lanes a = b2SubLanes(b2MulLanes(d1x, d2y), b2MulLanes(d1y, d2x));
+		b2Lanes b = b2AddLanes(b2MulLanes(d1x, d2x), b2MulLanes(d1y, d2y));
+
+		float32 sa[b2_simdWidth], sb[b2_simdWidth], sC[b2_simdWidth];
+		b2StoreLanes(sa, a);
+		b2StoreLanes(sb, b);
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			float32 angle = b2Atan2(sa[lane], sb[lane]);
+			float32 rest = as[k + lane];
+			float32 C = angle - rest;
+
+			while (C > b2_pi)
+			{
+				angle -= 2 * b2_pi;
+				C = angle - rest;
+			}
+
+			while (C < -b2_pi)
+			{
+				angle += 2.0f * b2_pi;
+				C = angle - rest;
+			}
+
+			sC[lane] = C;
+		}
+		b2Lanes C = b2LoadLanes(sC);
+
+		// Jd = s * Skew(d)
+		b2Lanes s1 = b2DivLanes(minusOne, L1sqr);
+		b2Lanes s2 = b2DivLanes(one, L2sqr);
+		b2Lanes Jd1x = b2MulLanes(s1, b2MulLanes(minusOne, d1y));
+		b2Lanes Jd1y = b2MulLanes(s1, d1x);
+		b2Lanes Jd2x = b2MulLanes(s2, b2MulLanes(minusOne, d2y));
+		b2Lanes Jd2y = b2MulLanes(s2, d2x);
+
+		b2Lanes J1x = b2MulLanes(minusOne, Jd1x);
+		b2Lanes J1y = b2MulLanes(minusOne, Jd1y);
+		b2Lanes J2x = b2SubLanes(Jd1x, Jd2x);
+		b2Lanes J2y = b2SubLanes(Jd1y, Jd2y);
+		b2Lanes J3x = Jd2x;
+		b2Lanes J3y = Jd2y;
+
+		b2Lanes mass = b2MulLanes(m1, b2AddLanes(b2MulLanes(J1x, J1x), b2MulLanes(J1y, J1y)));
+		mass = b2AddLanes(mass, b2MulLanes(m2, b2AddLanes(b2MulLanes(J2x, J2x), b2MulLanes(J2y, J2y))));
+		mass = b2AddLanes(mass, b2MulLanes(m3, b2AddLanes(b2MulLanes(J3x, J3x), b2MulLanes(J3y, J3y))));
+
+		b2Lanes skip = b2OrLanes(b2EqualLanes(b2MulLanes(L1sqr, L2sqr), zero), b2EqualLanes(mass, zero));
+
+		mass = b2DivLanes(one, mass);
+		b2Lanes impulse = b2MulLanes(b2MulLanes(k3, mass), C);
+
+		b2Lanes c1 = b2MulLanes(m1, impulse);
+		b2Lanes c2 = b2MulLanes(m2, impulse);
+		b2Lanes c3 = b2MulLanes(m3, impulse);
+
+		x1 = b2SelectLanes(skip, x1, b2AddLanes(x1, b2MulLanes(c1, J1x)));
+		y1 = b2SelectLanes(skip, y1, b2AddLanes(y1, b2MulLanes(c1, J1y)));
+		x2 = b2SelectLanes(skip, x2, b2AddLanes(x2, b2MulLanes(c2, J2x)));
+		y2 = b2SelectLanes(skip, y2, b2AddLanes(y2, b2MulLanes(c2, J2y)));
+		x3 = b2SelectLanes(skip, x3, b2AddLanes(x3, b2MulLanes(c3, J3x)));
+		y3 = b2SelectLanes(skip, y3, b2AddLanes(y3, b2MulLanes(c3, J3y)));
+
+		b2StoreLanes(px + k, x1);
+		b2StoreLanes(py + k, y1);
+
+		x1 = x2;
+		y1 = y2;
+		m1 = m2;
+		x2 = x3;
+		y2 = y3;
+		m2 = m3;
+	}
+
+	b2StoreLanes(px + count3 * b2_simdWidth, x1);
+	b2StoreLanes(py + count3 * b2_simdWidth, y1);
+	b2StoreLanes(px + (count3 + 1) * b2_simdWidth, x2);
+	b2StoreLanes(py + (count3 + 1) * b2_simdWidth, y2);
+}
+
+void b2RopeSystem::Draw(b2Draw* draw) const
+{
+	b2Color c(0.4f, 0.5f, 0.7f);
+
+	for (int32 i = 0; i < m_ropeCount; ++i)
+	{
+		const b2Vec2* vertices = m_vertices + m_ropes[i].vertexStart;
+		for (int32 j = 0; j < m_ropes[i].count - 1; ++j)
+		{
+			draw->DrawSegment(vertices[j], vertices[j + 1], c);
+		}
+	}
+}
@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef B2_ROPE_SYSTEM_H
+#define B2_ROPE_SYSTEM_H
+
+#include <Box2D/Rope/b2Rope.h>
+#include <Box2D/Common/b2Simd.h>
+
+/// Up to b2_simdWidth ropes with the same vertex count, one rope per lane.
+/// Vertex i of every lane is stored next to each other in the system buffers.
+struct b2RopeBatch
+{
+	int32 count;
+	int32 ropeCount;
+	int32 offset;
+	int32 ropes[b2_simdWidth];
+
+	float32 gravityX[b2_simdWidth];
+	float32 gravityY[b2_simdWidth];
+	float32 damping[b2_simdWidth];
+	float32 k2[b2_simdWidth];
+	float32 k3[b2_simdWidth];
+};
+
+/// Where a rope lives in the batches and in the vertex stream.
+struct b2RopeProxy
+{
+	int32 batch;
+	int32 lane;
+	int32 vertexStart;
+	int32 count;
+};
+
+/// Steps many ropes together, for scenes with hundreds of cosmetic ropes.
+/// All ropes share one set of SoA buffers. Ropes with the same vertex count
+/// are packed into batches and each batch is solved across the SIMD lanes.
+/// Every lane runs the same sweep as b2Rope::Step, so a rope moves exactly like
+/// a b2Rope made from the same definition.
+class b2RopeSystem
+{
+public:
+	b2RopeSystem();
+	~b2RopeSystem();
+
+	/// Add a rope. Ropes cannot be removed.
+	/// @return the rope index.
+	int32 CreateRope(const b2RopeDef* def);
+
+	/// Step every rope.
+	void Step(float32 timeStep, int32 iterations);
+
+	/// Step the ropes in batches [firstBatch, firstBatch + batchCount). Batches
+	/// share no data, so disjoint ranges can be stepped on different threads.
+	void StepBatches(float32 timeStep, int32 iterations, int32 firstBatch, int32 batchCount);
+
+	///
+	int32 GetRopeCount() const
+	{
+		return m_ropeCount;
+	}
+
+	///
+	int32 GetBatchCount() const
+	{
+		return m_batchCount;
+	}
+
+	/// The positions of all ropes, rope after rope in creation order.
+	/// Rendering can draw straight from this.
+	const b2Vec2* GetVertices() const
+	{
+		return m_vertices;
+	}
+
+	///
+	int32 GetVertexCount() const
+	{
+		return m_vertexCount;
+	}
+
+	/// The first vertex of a rope in the vertex stream.
+	int32 GetRopeVertexStart(int32 index) const
+	{
+		b2Assert(0 <= index && index < m_ropeCount);
+		return m_ropes[index].vertexStart;
+	}
+
+	///
+	int32 GetRopeVertexCount(int32 index) const
+	{
+		b2Assert(0 <= index && index < m_ropeCount);
+		return m_ropes[index].count;
+	}
+
+	///
+	void SetAngle(int32 index, float32 angle);
+
+	///
+	void Draw(b2Draw* draw) const;
+
+private:
+
+	int32 AllocateBatch(int32 count);
+
+	void StepBatch(const b2RopeBatch* batch, float32 h, int32 iterations);
+	void SolveC2(const b2RopeBatch* batch);
+	void SolveC3(const b2RopeBatch* batch);
+
+	// Lane buffers, b2_simdWidth floats per row and count rows per batch.
+	// The stretch rest lengths and bend angles use the first count - 1 and
+	// count - 2 rows of their batch.
+	float32* m_px;
+	float32* m_py;
+	float32* m_p0x;
+	float32* m_p0y;
+	float32* m_vx;
+	float32* m_vy;
+	float32* m_ims;
+	float32* m_Ls;
+	float32* m_as;
+	int32 m_rowCount;
+	int32 m_rowCapacity;
+
+	b2RopeBatch* m_batches;
+	int32 m_batchCount;
+	int32 m_batchCapacity;
+
+	b2RopeProxy* m_ropes;
+	int32 m_ropeCount;
+	int32 m_ropeCapacity;
+
+	b2Vec2* m_vertices;
+	int32 m_vertexCount;
+	int32 m_vertexCapacity;
+};
+
+#endif
@@ -64,14 +64,76 @@ namespace seed
         m_fixture = m_body->CreateFixture(&circle, in_static ? 0.0f : 1.0f);
     }
 
+    void PhysicsBody::InitAsChainLoops(const Vector2& in_position, const vector<vector<Vector2>>& in_loops, b2World* in_world)
+    {
+        b2BodyDef bodyDef;
+        bodyDef.type = b2_staticBody;
+        bodyDef.position.Set(in_position.x, in_position.y);
+
+        m_body = in_world->CreateBody(&bodyDef);
+
+        // one fixture per loop, chains don't collide on the seams between tiles
+        vector<b2Vec2> vertices;
+        for (const vector<Vector2>& loop : in_loops)
+        {
+            vertices.clear();
+            for (const Vector2& point : loop)
+            {
+                vertices.push_back(b2Vec2(point.x, point.y));
+            }
+
+            b2ChainShape chain;
+            chain.CreateLoop(vertices.data(), (int32)vertices.size());
+            m_fixture = m_body->CreateFixture(&chain, 0.0f);
+        }
+    }
+
+    void PhysicsBody::InitAsPolygons(const Vector2& in_position, const vector<vector<Vector2>>& in_polygons, b2World* in_world, bool in_static)
+    {
+        b2BodyDef bodyDef;
+        bodyDef.type = in_static ? b2_staticBody : b2_dynamicBody;
+        bodyDef.position.Set(in_position.x, in_position.y);
+        bodyDef.gravityScale = 200.f;
+
+        m_body = in_world->CreateBody(&bodyDef);
+
+        // one fixture per convex piece, same material as InitAsBox
+        b2FixtureDef fixtureDef;
+        fixtureDef.density = in_static ? 0.0f : 100.0f;
+        fixtureDef.friction = in_static ? 0.2f : 0.3f;
+
+        b2Vec2 vertices[b2_maxPolygonVertices];
+        for (const vector<Vector2>& polygon : in_polygons)
+        {
+            int32 count = (int32)std::min(polygon.size(), (size_t)b2_maxPolygonVertices);
+            for (int32 i = 0; i < count; ++i)
+            {
+                vertices[i].Set(polygon[i].x, polygon[i].y);
+            }
+
+            b2PolygonShape shape;
+            shape.Set(vertices, count);
+            fixtureDef.shape = &shape;
+            m_fixture = m_body->CreateFixture(&fixtureDef);
+        }
+    }
+
     void PhysicsBody::SetPixelToMetersRatio(float in_ratio)
     {
         m_pixelToMeterRatio = in_ratio;
     }
 
+    void PhysicsBody::SetNode(Node* in_node)
+    {
+        m_body->SetUserData(in_node);
+    }
+
     void PhysicsBody::SetRestitution(float in_restitution)
     {
-        m_fixture->SetRestitution(in_restitution);
+        for (b2Fixture* fixture = m_body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+        {
+            fixture->SetRestitution(in_restitution);
+        }
     }
 
     Vector2 PhysicsBody::GetPosition()
@@ -116,7 +178,15 @@ namespace seed
 
     void PhysicsBody::SetFriction(float in_friction)
     {
-        m_fixture->SetFriction(in_friction);
+        for (b2Fixture* fixture = m_body->GetFixtureList(); fixture; fixture = fixture->GetNext())
+        {
+            fixture->SetFriction(in_friction);
+        }
+    }
+
+    void PhysicsBody::SetRegion(int in_region)
+    {
+        m_body->SetRegion(in_region);
     }
 
 }
@@ -14,10 +14,19 @@ namespace seed
 
         void    InitAsBox(const Vector2& in_position, const Vector2& in_dimensions, b2World* in_world, bool in_static);
         void    InitAsCircle(const Vector2& in_position, float in_radius, b2World* in_world, bool in_static);
+        void    InitAsChainLoops(const Vector2& in_position, const vector<vector<Vector2>>& in_loops, b2World* in_world);
+        void    InitAsPolygons(const Vector2& in_position, const vector<vector<Vector2>>& in_polygons, b2World* in_world, bool in_static);
         void    SetRestitution(float in_restitution);
         void    SetFriction(float in_friction);
         void    SetPixelToMetersRatio(float in_ratio);
 
+        // the node driven by this body, stored as the b2Body user data so
+        // PhysicsQuery can map fixtures back to nodes
+        void    SetNode(Node* in_node);
+
+        // streaming region, see PhysicsMgr::ParkRegion
+        void    SetRegion(int in_region);
+
         // move things around
         void    SetTransform(const Vector2& in_transform, float in_angle);
         void    SetLinearVel(const Vector2& in_vel);
@@ -2,7 +2,13 @@
 //#include "Node.h"
 #include "PhysicsMgr.h"
 #include "PhysicsBody.h"
+#include "PhysicsQuery.h"
 #include "Node.h"
+#include "TiledMapNode.h"
+#include "TiledMapCollision.h"
+#include "Sprite.h"
+#include "SpriteCollision.h"
+#include <algorithm>
 
 namespace seed
 {
@@ -17,8 +23,10 @@ namespace seed
 
     void PhysicsMgr::Init(const Vector2& in_gravity, float in_pixelToMetersRatio )
     {
-        b2Vec2 gravity(in_gravity.x, in_gravity.y);
-        m_world = new b2World(gravity);
+        // Each world gets its own arena so several views don't contend on the heap
+        b2WorldDef worldDef;
+        worldDef.gravity.Set(in_gravity.x, in_gravity.y);
+        m_world = new b2World(&worldDef);
         m_pixelToMetersRatio = in_pixelToMetersRatio;
     }
 
@@ -38,6 +46,11 @@ namespace seed
             node->SetPosition(it->second->GetPosition() * m_pixelToMetersRatio);
             node->SetAngle(it->second->GetAngle() * m_pixelToMetersRatio);
         }
+
+        for (PhysicsQuery* query : m_queries)
+        {
+            query->Update();
+        }
     }
 
     PhysicsBody* PhysicsMgr::CreateBoxPhysicsForNode(Node* in_node, bool in_static)
@@ -51,6 +64,7 @@ namespace seed
         PhysicsBody* newBody = new PhysicsBody();
         newBody->SetPixelToMetersRatio(m_pixelToMetersRatio);
         newBody->InitAsBox(in_node->GetPosition() / m_pixelToMetersRatio, Vector2(in_node->GetWidth() / in_node->GetScale().x, in_node->GetHeight() / in_node->GetScale().y) / m_pixelToMetersRatio, m_world, in_static);
+        newBody->SetNode(in_node);
         m_bodies[in_node] = newBody;
         return newBody;
     }
@@ -66,6 +80,123 @@ namespace seed
         PhysicsBody* newBody = new PhysicsBody();
         newBody->SetPixelToMetersRatio(m_pixelToMetersRatio);
         newBody->InitAsCircle(in_node->GetPosition() / m_pixelToMetersRatio, in_radius, m_world, in_static);
+        newBody->SetNode(in_node);
+        m_bodies[in_node] = newBody;
+        return newBody;
+    }
+
+    PhysicsBody* PhysicsMgr::CreateTiledMapPhysicsForNode(TiledMapNode* in_node, const string& in_layer)
+    {
+        if (!m_world)
+        {
+            OLogE("PhysicsMgr::CreateTiledMapPhysicsForNode called before PhysicsMgr::Init");
+            return nullptr;
+        }
+
+        std::string mapFile = OContentManager->find(in_node->GetFile());
+        if (mapFile.empty()) mapFile = in_node->GetFile();
+
+        TiledMapCollision collision;
+        collision.Init(mapFile, in_node->GetTiledMap(), in_layer);
+        collision.Cook(mapFile + ".collision");
+
+        // tile corners to meters, relative to the node
+        Vector2 tileSize = Vector2((float)collision.GetTileWidth(), (float)collision.GetTileHeight()) * in_node->GetScale() / m_pixelToMetersRatio;
+        vector<vector<Vector2>> loops;
+        for (const TiledMapCollision::Loop& loop : collision.GetLoops())
+        {
+            loops.push_back(vector<Vector2>());
+            for (const TiledMapCollision::Point& point : loop)
+            {
+                loops.back().push_back(Vector2((float)point.x, (float)point.y) * tileSize);
+            }
+        }
+
+        PhysicsBody* newBody = new PhysicsBody();
+        newBody->SetPixelToMetersRatio(m_pixelToMetersRatio);
+        newBody->InitAsChainLoops(in_node->GetPosition() / m_pixelToMetersRatio, loops, m_world);
+        newBody->SetNode(in_node);
+        m_bodies[in_node] = newBody;
+        return newBody;
+    }
+
+    PhysicsBody* PhysicsMgr::CreateSpritePhysicsForNode(Sprite* in_node, bool in_static, float in_tolerance)
+    {
+        if (!m_world)
+        {
+            OLogE("PhysicsMgr::CreateSpritePhysicsForNode called before PhysicsMgr::Init");
+            return nullptr;
+        }
+
+        // the whole texture, or the frame of the sprite anim
+        OTexture* texture = in_node->GetTexture();
+        Vector2 align = in_node->GetAlign();
+        SpriteCollision::Rect rect = { 0, 0, 0, 0 };
+        if (!texture)
+        {
+            texture = in_node->GetSpriteAnim().getTexture();
+            if (texture)
+            {
+                Vector4 uvs = in_node->GetSpriteAnim().getUVs();
+                Vector2 size = texture->getSizef();
+                rect.x = (int)(uvs.x * size.x + .5f);
+                rect.y = (int)(uvs.y * size.y + .5f);
+                rect.width = (int)(uvs.z * size.x + .5f) - rect.x;
+                rect.height = (int)(uvs.w * size.y + .5f) - rect.y;
+                align = in_node->GetSpriteAnim().getOrigin();
+            }
+        }
+        if (!texture)
+        {
+            OLogE("PhysicsMgr::CreateSpritePhysicsForNode called on a sprite without texture");
+            return nullptr;
+        }
+
+        std::string textureFile = OContentManager->find(texture->getName());
+        if (textureFile.empty()) textureFile = texture->getName();
+        std::string cacheFile = textureFile;
+        if (rect.width > 0)
+        {
+            cacheFile += "." + to_string(rect.x) + "_" + to_string(rect.y) + "_" + to_string(rect.width) + "_" + to_string(rect.height);
+        }
+        cacheFile += ".collision";
+
+        auto it = m_spritePieces.find(cacheFile);
+        if (it == m_spritePieces.end())
+        {
+            SpriteCollision collision;
+            if (!collision.Init(textureFile, rect))
+            {
+                return CreateBoxPhysicsForNode(in_node, in_static);
+            }
+            collision.Cook(cacheFile, in_tolerance);
+            it = m_spritePieces.insert(make_pair(cacheFile, collision.GetPieces())).first;
+        }
+
+        // texture pixels to meters, relative to the node
+        Vector2 size = rect.width > 0 ? Vector2((float)rect.width, (float)rect.height) : texture->getSizef();
+        Vector2 scale = in_node->GetScale() / m_pixelToMetersRatio;
+        vector<vector<Vector2>> polygons;
+        for (const SpriteCollision::Piece& piece : it->second)
+        {
+            polygons.push_back(vector<Vector2>());
+            for (const SpriteCollision::Point& point : piece)
+            {
+                Vector2 pixel(point.x, point.y);
+                if (in_node->GetFlippedH()) pixel.x = size.x - pixel.x;
+                if (in_node->GetFlippedV()) pixel.y = size.y - pixel.y;
+                polygons.back().push_back((pixel - align * size) * scale);
+            }
+        }
+        if (polygons.empty())
+        {
+            return CreateBoxPhysicsForNode(in_node, in_static);
+        }
+
+        PhysicsBody* newBody = new PhysicsBody();
+        newBody->SetPixelToMetersRatio(m_pixelToMetersRatio);
+        newBody->InitAsPolygons(in_node->GetPosition() / m_pixelToMetersRatio, polygons, m_world, in_static);
+        newBody->SetNode(in_node);
         m_bodies[in_node] = newBody;
         return newBody;
     }
@@ -81,6 +212,47 @@ namespace seed
         return it->second;
     }
 
+    void PhysicsMgr::ParkRegion(int in_region)
+    {
+        if (!m_world)
+            return;
+
+        m_world->ParkRegion(in_region);
+    }
+
+    void PhysicsMgr::UnparkRegion(int in_region)
+    {
+        if (!m_world)
+            return;
+
+        m_world->UnparkRegion(in_region);
+    }
+
+    PhysicsQuery* PhysicsMgr::CreateQuery(const Vector2& in_position, const Vector2& in_size)
+    {
+        if (!m_world)
+        {
+            OLogE("PhysicsMgr::CreateQuery called before PhysicsMgr::Init");
+            return nullptr;
+        }
+
+        PhysicsQuery* newQuery = new PhysicsQuery(m_world, in_position, in_size, m_pixelToMetersRatio);
+        m_queries.push_back(newQuery);
+        return newQuery;
+    }
+
+    void PhysicsMgr::DestroyQuery(PhysicsQuery* in_query)
+    {
+        auto it = std::find(m_queries.begin(), m_queries.end(), in_query);
+        if (it == m_queries.end())
+        {
+            OLogE("Query specified to PhysicsMgr::DestroyQuery was not created by it");
+            return;
+        }
+        m_queries.erase(it);
+        delete in_query;
+    }
+
 
 }
 
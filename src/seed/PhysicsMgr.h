@@ -2,9 +2,13 @@
 #ifdef WITH_BOX_2D
     #include <Box2D/Box2D.h>
 #endif
+#include "SpriteCollision.h"
 
 namespace seed
 {
+    class TiledMapNode;
+    class Sprite;
+    class PhysicsQuery;
     class PhysicsMgr
     {
     public:
@@ -17,14 +21,38 @@ namespace seed
 
         PhysicsBody*    CreateBoxPhysicsForNode(Node* in_node, bool in_static);
         PhysicsBody*    CreateCirclePhysicsForNode(Node* in_node, float in_radius, bool in_static);
+
+        // Static chain loops around the solid cells of the map, see TiledMapCollision.
+        // The outlines are cooked once and cached next to the .tmx file.
+        PhysicsBody*    CreateTiledMapPhysicsForNode(TiledMapNode* in_node, const string& in_layer = "collision");
+
+        // Convex pieces around the opaque pixels of the sprite's texture, or of
+        // its current frame when it plays a sprite anim, see SpriteCollision.
+        // The pieces are cooked once per texture and cached next to it.
+        PhysicsBody*    CreateSpritePhysicsForNode(Sprite* in_node, bool in_static, float in_tolerance = 1.f);
+
         PhysicsBody*    GetBodyForNode(Node* in_node);
 
+        // Streaming: park the bodies of a level chunk that scrolled out of view
+        void            ParkRegion(int in_region);
+        void            UnparkRegion(int in_region);
+
+        // Nodes overlapping a rectangle in pixels, kept up to date by Update,
+        // see PhysicsQuery. Use these for triggers instead of scanning every frame.
+        PhysicsQuery*   CreateQuery(const Vector2& in_position, const Vector2& in_size);
+        void            DestroyQuery(PhysicsQuery* in_query);
+
         
     private:
 
         b2World*    m_world;
         BodyMap     m_bodies;
 
+        vector<PhysicsQuery*>   m_queries;
+
+        // cooked sprite pieces by cache file
+        unordered_map<string, SpriteCollision::PieceVect> m_spritePieces;
+
         float       m_pixelToMetersRatio;
     };
 }
@@ -0,0 +1,100 @@
+#include "App.h"
+#include "PhysicsQuery.h"
+#include "Node.h"
+#include <algorithm>
+
+namespace seed
+{
+    static b2AABB RectToAABB(const Vector2& in_position, const Vector2& in_size, float in_pixelToMetersRatio)
+    {
+        Vector2 topLeft = in_position / in_pixelToMetersRatio;
+        Vector2 bottomRight = (in_position + in_size) / in_pixelToMetersRatio;
+
+        b2AABB aabb;
+        aabb.lowerBound.Set(std::min(topLeft.x, bottomRight.x), std::min(topLeft.y, bottomRight.y));
+        aabb.upperBound.Set(std::max(topLeft.x, bottomRight.x), std::max(topLeft.y, bottomRight.y));
+        return aabb;
+    }
+
+    PhysicsQuery::PhysicsQuery(b2World* in_world, const Vector2& in_position, const Vector2& in_size, float in_pixelToMetersRatio)
+        : m_world(in_world)
+        , m_query(nullptr)
+        , m_pixelToMetersRatio(in_pixelToMetersRatio)
+    {
+        b2PersistentQueryDef queryDef;
+        queryDef.aabb = RectToAABB(in_position, in_size, m_pixelToMetersRatio);
+        queryDef.userData = this;
+        m_query = m_world->CreatePersistentQuery(&queryDef);
+    }
+
+    PhysicsQuery::~PhysicsQuery()
+    {
+        m_world->DestroyPersistentQuery(m_query);
+    }
+
+    void PhysicsQuery::SetRect(const Vector2& in_position, const Vector2& in_size)
+    {
+        m_query->SetAABB(RectToAABB(in_position, in_size, m_pixelToMetersRatio));
+    }
+
+    bool PhysicsQuery::Contains(Node* in_node) const
+    {
+        return m_counts.find(in_node) != m_counts.end();
+    }
+
+    void PhysicsQuery::Update()
+    {
+        m_entered.clear();
+        m_left.clear();
+
+        // only the fixtures that came in or went out during the step are looked at
+        if (m_query->GetAddedCount() == 0 && m_query->GetRemovedCount() == 0)
+            return;
+
+        m_previousCounts.clear();
+        Apply(m_query->GetAdded(), m_query->GetAddedCount(), 1);
+        Apply(m_query->GetRemoved(), m_query->GetRemovedCount(), -1);
+
+        // a node that went in and out during the same step is not reported
+        for (auto& previous : m_previousCounts)
+        {
+            auto it = m_counts.find(previous.first);
+            int count = it != m_counts.end() ? it->second : 0;
+            if (previous.second == 0 && count > 0)
+            {
+                m_entered.push_back(previous.first);
+            }
+            else if (previous.second > 0 && count <= 0)
+            {
+                m_left.push_back(previous.first);
+            }
+            if (it != m_counts.end() && count <= 0)
+            {
+                m_counts.erase(it);
+            }
+        }
+
+        if (m_entered.empty() && m_left.empty())
+            return;
+
+        m_nodes.clear();
+        for (auto& count : m_counts)
+        {
+            m_nodes.push_back(count.first);
+        }
+    }
+
+    void PhysicsQuery::Apply(const b2QueryHit* in_hits, int in_count, int in_delta)
+    {
+        for (int i = 0; i < in_count; ++i)
+        {
+            Node* node = (Node*)in_hits[i].fixture->GetBody()->GetUserData();
+            if (!node)
+                continue;
+
+            int& count = m_counts[node];
+            m_previousCounts.insert(make_pair(node, count));
+            count += in_delta;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifdef WITH_BOX_2D
+    #include <Box2D/Box2D.h>
+#endif
+#include "SeedGlobals.h"
+
+namespace seed
+{
+    // The nodes whose physics overlap a rectangle. The rectangle is a
+    // b2PersistentQuery, updated by the world step from the bodies that moved,
+    // so a trigger over resting or static nodes costs next to nothing per frame.
+    // Create it with PhysicsMgr::CreateQuery.
+    class PhysicsQuery
+    {
+    public:
+
+        PhysicsQuery(b2World* in_world, const Vector2& in_position, const Vector2& in_size, float in_pixelToMetersRatio);
+        ~PhysicsQuery();
+
+        // top left and size, in pixels. The nodes follow during the next update.
+        void            SetRect(const Vector2& in_position, const Vector2& in_size);
+
+        // refresh the node lists from the query, after the world step
+        void            Update();
+
+        // nodes in the rectangle, in no particular order
+        const NodeVect& GetNodes() const { return m_nodes; }
+
+        // nodes that came in or went out during the last update
+        const NodeVect& GetEnteredNodes() const { return m_entered; }
+        const NodeVect& GetLeftNodes() const { return m_left; }
+
+        bool            Contains(Node* in_node) const;
+
+    private:
+
+        void            Apply(const b2QueryHit* in_hits, int in_count, int in_delta);
+
+        b2World*            m_world;
+        b2PersistentQuery*  m_query;
+        float               m_pixelToMetersRatio;
+
+        // fixture children of each node in the query, a node leaves when it has none
+        unordered_map<Node*, int>   m_counts;
+
+        // counts before the update of the nodes it touched
+        unordered_map<Node*, int>   m_previousCounts;
+
+        NodeVect    m_nodes;
+        NodeVect    m_entered;
+        NodeVect    m_left;
+    };
+}
@@ -0,0 +1,545 @@
+#include "App.h"
+#include "SpriteCollision.h"
+#include "onut/src/lodepng/LodePNG.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+// "SPRC" cache header, bump the version when the file layout changes
+#define SPRITECOLLISION_MAGIC           0x43525053
+#define SPRITECOLLISION_VERSION         1
+
+// b2_maxPolygonVertices
+#define SPRITECOLLISION_MAX_VERTICES    8
+
+namespace seed
+{
+    // outline directions, in clockwise order on screen (y points down)
+    static const int s_dirX[4] = { 1, 0, -1, 0 };
+    static const int s_dirY[4] = { 0, 1, 0, -1 };
+
+    // Positive where the outline turns clockwise on screen. Outlines are
+    // clockwise around the solid pixels, so convex corners are positive.
+    static float Cross(const SpriteCollision::Point& in_a, const SpriteCollision::Point& in_b, const SpriteCollision::Point& in_c)
+    {
+        return (in_b.x - in_a.x) * (in_c.y - in_b.y) - (in_b.y - in_a.y) * (in_c.x - in_b.x);
+    }
+
+    // twice the signed area, positive for clockwise outlines on screen
+    static float Area(const vector<SpriteCollision::Point>& in_points)
+    {
+        float area = 0.f;
+        for (size_t i = 0; i < in_points.size(); ++i)
+        {
+            const SpriteCollision::Point& a = in_points[i];
+            const SpriteCollision::Point& b = in_points[(i + 1) % in_points.size()];
+            area += a.x * b.y - b.x * a.y;
+        }
+        return area;
+    }
+
+    static float DistanceToSegmentSq(const SpriteCollision::Point& in_p, const SpriteCollision::Point& in_a, const SpriteCollision::Point& in_b)
+    {
+        float dx = in_b.x - in_a.x;
+        float dy = in_b.y - in_a.y;
+        float lengthSq = dx * dx + dy * dy;
+        float t = lengthSq > 0.f ? ((in_p.x - in_a.x) * dx + (in_p.y - in_a.y) * dy) / lengthSq : 0.f;
+        t = std::max(0.f, std::min(1.f, t));
+        float ex = in_a.x + t * dx - in_p.x;
+        float ey = in_a.y + t * dy - in_p.y;
+        return ex * ex + ey * ey;
+    }
+
+    SpriteCollision::SpriteCollision()
+    {
+    }
+
+    SpriteCollision::~SpriteCollision()
+    {
+    }
+
+    bool SpriteCollision::Init(const string& in_textureFile, const Rect& in_rect, uint8_t in_alphaThreshold)
+    {
+        m_width = 0;
+        m_height = 0;
+        m_solid.clear();
+        m_pieces.clear();
+
+        vector<unsigned char> image;
+        unsigned width = 0;
+        unsigned height = 0;
+        if (lodepng::decode(image, width, height, in_textureFile) != 0)
+        {
+            OLogE("SpriteCollision::Init could not read " + in_textureFile);
+            return false;
+        }
+
+        Rect rect = in_rect;
+        if (rect.width <= 0 || rect.height <= 0)
+        {
+            rect.x = 0;
+            rect.y = 0;
+            rect.width = (int)width;
+            rect.height = (int)height;
+        }
+        if (rect.x < 0 || rect.y < 0 || rect.x + rect.width > (int)width || rect.y + rect.height > (int)height)
+        {
+            OLogE("SpriteCollision::Init rectangle is outside of " + in_textureFile);
+            return false;
+        }
+
+        Init(image.data() + (rect.y * width + rect.x) * 4, rect.width, rect.height, (int)width * 4, in_alphaThreshold);
+        return true;
+    }
+
+    void SpriteCollision::Init(const uint8_t* in_rgba, int in_width, int in_height, int in_pitch, uint8_t in_alphaThreshold)
+    {
+        m_width = in_width;
+        m_height = in_height;
+        m_solid.assign(m_width * m_height, false);
+        m_pieces.clear();
+
+        for (int y = 0; y < m_height; ++y)
+        {
+            const uint8_t* pRow = in_rgba + y * in_pitch;
+            for (int x = 0; x < m_width; ++x)
+            {
+                m_solid[y * m_width + x] = pRow[x * 4 + 3] >= in_alphaThreshold;
+            }
+        }
+    }
+
+    void SpriteCollision::Cook(const string& in_cacheFile, float in_tolerance)
+    {
+        uint32_t key = ComputeKey(in_tolerance);
+        if (LoadCache(in_cacheFile, key))
+        {
+            return;
+        }
+
+        m_pieces.clear();
+        vector<Loop> loops;
+        TraceLoops(loops);
+        for (Loop& loop : loops)
+        {
+            // holes wind the other way, they are filled
+            if (Area(loop) <= 0.f) continue;
+
+            Simplify(loop, in_tolerance);
+            if (loop.size() < 3 || Area(loop) <= 0.f) continue;
+
+            Decompose(loop);
+        }
+        SaveCache(in_cacheFile, key);
+    }
+
+    int SpriteCollision::GetWidth() const
+    {
+        return m_width;
+    }
+
+    int SpriteCollision::GetHeight() const
+    {
+        return m_height;
+    }
+
+    bool SpriteCollision::IsSolid(int in_x, int in_y) const
+    {
+        if (in_x < 0 || in_y < 0 || in_x >= m_width || in_y >= m_height)
+        {
+            return false;
+        }
+        return m_solid[in_y * m_width + in_x];
+    }
+
+    const SpriteCollision::PieceVect& SpriteCollision::GetPieces() const
+    {
+        return m_pieces;
+    }
+
+    uint32_t SpriteCollision::ComputeKey(float in_tolerance) const
+    {
+        // FNV-1a over the settings and the solid pixels
+        uint32_t key = 2166136261u;
+        auto hash = [&key](uint32_t in_value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                key ^= (in_value >> (i * 8)) & 0xff;
+                key *= 16777619u;
+            }
+        };
+
+        uint32_t tolerance;
+        memcpy(&tolerance, &in_tolerance, sizeof(tolerance));
+
+        hash(SPRITECOLLISION_VERSION);
+        hash(SPRITECOLLISION_MAX_VERTICES);
+        hash(tolerance);
+        hash(m_width);
+        hash(m_height);
+        for (bool solid : m_solid)
+        {
+            hash(solid ? 1 : 0);
+        }
+        return key;
+    }
+
+    bool SpriteCollision::LoadCache(const string& in_cacheFile, uint32_t in_key)
+    {
+        FILE* pFile = fopen(in_cacheFile.c_str(), "rb");
+        if (!pFile) return false;
+
+        uint32_t header[3] = { 0 };
+        int pieceCount = 0;
+        bool valid = fread(header, sizeof(header), 1, pFile) == 1 &&
+            header[0] == SPRITECOLLISION_MAGIC &&
+            header[1] == SPRITECOLLISION_VERSION &&
+            header[2] == in_key &&
+            fread(&pieceCount, sizeof(pieceCount), 1, pFile) == 1 &&
+            pieceCount >= 0;
+
+        m_pieces.clear();
+        for (int i = 0; valid && i < pieceCount; ++i)
+        {
+            int pointCount = 0;
+            valid = fread(&pointCount, sizeof(pointCount), 1, pFile) == 1 &&
+                pointCount >= 3 && pointCount <= SPRITECOLLISION_MAX_VERTICES;
+            if (!valid) break;
+
+            Piece piece(pointCount);
+            valid = fread(piece.data(), sizeof(Point), pointCount, pFile) == (size_t)pointCount;
+            m_pieces.push_back(piece);
+        }
+        fclose(pFile);
+
+        if (!valid)
+        {
+            m_pieces.clear();
+        }
+        return valid;
+    }
+
+    void SpriteCollision::SaveCache(const string& in_cacheFile, uint32_t in_key) const
+    {
+        FILE* pFile = fopen(in_cacheFile.c_str(), "wb");
+        if (!pFile)
+        {
+            OLogE("SpriteCollision could not write " + in_cacheFile);
+            return;
+        }
+
+        uint32_t header[3] = { SPRITECOLLISION_MAGIC, SPRITECOLLISION_VERSION, in_key };
+        int pieceCount = (int)m_pieces.size();
+        fwrite(header, sizeof(header), 1, pFile);
+        fwrite(&pieceCount, sizeof(pieceCount), 1, pFile);
+        for (const Piece& piece : m_pieces)
+        {
+            int pointCount = (int)piece.size();
+            fwrite(&pointCount, sizeof(pointCount), 1, pFile);
+            fwrite(piece.data(), sizeof(Point), pointCount, pFile);
+        }
+        fclose(pFile);
+    }
+
+    void SpriteCollision::TraceLoops(vector<Loop>& out_loops) const
+    {
+        out_loops.clear();
+
+        // Outgoing boundary edges of each pixel corner, one bit per direction.
+        // Edges run clockwise around solid pixels on screen, see TiledMapCollision.
+        const int stride = m_width + 1;
+        vector<uint8_t> edges(stride * (m_height + 1), 0);
+        for (int y = 0; y < m_height; ++y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                if (!IsSolid(x, y)) continue;
+                if (!IsSolid(x, y - 1)) edges[y * stride + x] |= 1 << 0;
+                if (!IsSolid(x + 1, y)) edges[y * stride + x + 1] |= 1 << 1;
+                if (!IsSolid(x, y + 1)) edges[(y + 1) * stride + x + 1] |= 1 << 2;
+                if (!IsSolid(x - 1, y)) edges[(y + 1) * stride + x] |= 1 << 3;
+            }
+        }
+
+        vector<int> corners;
+        vector<int> dirs;
+        for (int start = 0; start < (int)edges.size(); ++start)
+        {
+            if (!edges[start]) continue;
+
+            corners.clear();
+            dirs.clear();
+            int corner = start;
+            int dir = 0;
+            while (dir < 4 && !(edges[corner] & (1 << dir))) ++dir;
+            do
+            {
+                // keep pixels touching diagonally in separate loops
+                if (!dirs.empty())
+                {
+                    int inDir = dirs.back();
+                    int turns[3] = { (inDir + 1) & 3, inDir, (inDir + 3) & 3 };
+                    for (int turn : turns)
+                    {
+                        if (edges[corner] & (1 << turn))
+                        {
+                            dir = turn;
+                            break;
+                        }
+                    }
+                }
+
+                edges[corner] &= ~(1 << dir);
+                corners.push_back(corner);
+                dirs.push_back(dir);
+                corner += s_dirY[dir] * stride + s_dirX[dir];
+            } while (corner != start);
+
+            // keep only the corners where the outline turns
+            Loop loop;
+            for (size_t i = 0; i < corners.size(); ++i)
+            {
+                int prevDir = dirs[(i + dirs.size() - 1) % dirs.size()];
+                if (dirs[i] != prevDir)
+                {
+                    loop.push_back({ (float)(corners[i] % stride), (float)(corners[i] / stride) });
+                }
+            }
+            out_loops.push_back(loop);
+
+            // a corner can start a second loop
+            --start;
+        }
+    }
+
+    void SpriteCollision::Simplify(Loop& inout_loop, float in_tolerance) const
+    {
+        // Douglas-Peucker, with the loop split at the corner farthest from the
+        // first one. Kept corners are traced ones, so they stay on the pixel grid.
+        size_t count = inout_loop.size();
+        if (count <= 4) return;
+
+        size_t farthest = 0;
+        float farthestSq = -1.f;
+        for (size_t i = 1; i < count; ++i)
+        {
+            float dx = inout_loop[i].x - inout_loop[0].x;
+            float dy = inout_loop[i].y - inout_loop[0].y;
+            if (dx * dx + dy * dy > farthestSq)
+            {
+                farthestSq = dx * dx + dy * dy;
+                farthest = i;
+            }
+        }
+
+        vector<bool> keep(count, false);
+        keep[0] = true;
+        keep[farthest] = true;
+
+        // ranges of corners, the second half wraps back to the first corner
+        vector<pair<size_t, size_t>> ranges;
+        ranges.push_back(make_pair((size_t)0, farthest));
+        ranges.push_back(make_pair(farthest, count));
+        float toleranceSq = in_tolerance * in_tolerance;
+        while (!ranges.empty())
+        {
+            size_t first = ranges.back().first;
+            size_t last = ranges.back().second;
+            ranges.pop_back();
+
+            size_t worst = first;
+            float worstSq = toleranceSq;
+            for (size_t i = first + 1; i < last; ++i)
+            {
+                float distanceSq = DistanceToSegmentSq(inout_loop[i], inout_loop[first], inout_loop[last % count]);
+                if (distanceSq > worstSq)
+                {
+                    worstSq = distanceSq;
+                    worst = i;
+                }
+            }
+
+            if (worst != first)
+            {
+                keep[worst] = true;
+                ranges.push_back(make_pair(first, worst));
+                ranges.push_back(make_pair(worst, last));
+            }
+        }
+
+        Loop simplified;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (keep[i]) simplified.push_back(inout_loop[i]);
+        }
+        inout_loop.swap(simplified);
+    }
+
+    void SpriteCollision::Decompose(const Loop& in_loop)
+    {
+        // Ear clipping into triangles, then Hertel-Mehlhorn: remove the
+        // diagonals from the longest down while the two pieces they split
+        // merge into a convex piece within the vertex limit.
+        typedef vector<int> IndexPiece;
+        vector<IndexPiece> pieces;
+        auto point = [&in_loop](int in_index) -> const Point& { return in_loop[in_index]; };
+
+        vector<int> remaining;
+        for (int i = 0; i < (int)in_loop.size(); ++i)
+        {
+            remaining.push_back(i);
+        }
+
+        while (remaining.size() >= 3)
+        {
+            int count = (int)remaining.size();
+            int ear = -1;
+            int fallback = -1;
+            for (int i = 0; i < count && ear < 0; ++i)
+            {
+                int a = remaining[(i + count - 1) % count];
+                int b = remaining[i];
+                int c = remaining[(i + 1) % count];
+                float cross = Cross(point(a), point(b), point(c));
+                if (cross == 0.f)
+                {
+                    // straight or folded back, drop it without a triangle
+                    ear = i;
+                    break;
+                }
+                if (cross < 0.f) continue;
+                if (fallback < 0) fallback = i;
+
+                bool empty = true;
+                for (int j = 0; j < count && empty; ++j)
+                {
+                    int p = remaining[j];
+                    if (p == a || p == b || p == c) continue;
+                    const Point& q = point(p);
+                    if ((q.x == point(a).x && q.y == point(a).y) ||
+                        (q.x == point(c).x && q.y == point(c).y)) continue;
+                    empty = Cross(point(a), point(b), q) < 0.f ||
+                        Cross(point(b), point(c), q) < 0.f ||
+                        Cross(point(c), point(a), q) < 0.f;
+                }
+                if (empty) ear = i;
+            }
+
+            // a simplified outline can touch itself, clip a convex corner anyway
+            if (ear < 0) ear = fallback;
+            if (ear < 0) break;
+
+            int a = remaining[(ear + count - 1) % count];
+            int b = remaining[ear];
+            int c = remaining[(ear + 1) % count];
+            if (Cross(point(a), point(b), point(c)) > 0.f)
+            {
+                pieces.push_back({ a, b, c });
+            }
+            remaining.erase(remaining.begin() + ear);
+        }
+
+        // owner piece of each directed edge
+        auto edgeKey = [](int in_from, int in_to) { return ((uint64_t)(uint32_t)in_from << 32) | (uint32_t)in_to; };
+        unordered_map<uint64_t, int> owners;
+        for (int i = 0; i < (int)pieces.size(); ++i)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                owners[edgeKey(pieces[i][k], pieces[i][(k + 1) % 3])] = i;
+            }
+        }
+
+        vector<pair<int, int>> diagonals;
+        for (const auto& owner : owners)
+        {
+            int from = (int)(owner.first >> 32);
+            int to = (int)(owner.first & 0xffffffff);
+            if (from < to && owners.count(edgeKey(to, from)))
+            {
+                diagonals.push_back(make_pair(from, to));
+            }
+        }
+        auto lengthSq = [&point](const pair<int, int>& in_diagonal)
+        {
+            float dx = point(in_diagonal.second).x - point(in_diagonal.first).x;
+            float dy = point(in_diagonal.second).y - point(in_diagonal.first).y;
+            return dx * dx + dy * dy;
+        };
+        sort(diagonals.begin(), diagonals.end(), [&lengthSq](const pair<int, int>& in_a, const pair<int, int>& in_b)
+        {
+            float a = lengthSq(in_a);
+            float b = lengthSq(in_b);
+            return a != b ? a > b : in_a < in_b;
+        });
+
+        vector<bool> alive(pieces.size(), true);
+        IndexPiece merged;
+        for (const pair<int, int>& diagonal : diagonals)
+        {
+            int a = diagonal.first;
+            int b = diagonal.second;
+            int i = owners[edgeKey(a, b)];
+            int j = owners[edgeKey(b, a)];
+            const IndexPiece& pieceI = pieces[i];
+            const IndexPiece& pieceJ = pieces[j];
+
+            // piece i from b around to a, then piece j strictly between a and b
+            merged.clear();
+            int start = (int)(find(pieceI.begin(), pieceI.end(), b) - pieceI.begin());
+            for (size_t k = 0; k < pieceI.size(); ++k)
+            {
+                merged.push_back(pieceI[(start + k) % pieceI.size()]);
+            }
+            start = (int)(find(pieceJ.begin(), pieceJ.end(), a) - pieceJ.begin());
+            for (size_t k = 1; k + 1 < pieceJ.size(); ++k)
+            {
+                merged.push_back(pieceJ[(start + k) % pieceJ.size()]);
+            }
+
+            // straight corners are dropped from the final pieces
+            bool convex = true;
+            int corners = 0;
+            int mergedCount = (int)merged.size();
+            for (int k = 0; k < mergedCount && convex; ++k)
+            {
+                float cross = Cross(point(merged[(k + mergedCount - 1) % mergedCount]), point(merged[k]), point(merged[(k + 1) % mergedCount]));
+                convex = cross >= 0.f;
+                if (cross > 0.f) ++corners;
+            }
+            if (!convex || corners > SPRITECOLLISION_MAX_VERTICES) continue;
+
+            owners.erase(edgeKey(a, b));
+            owners.erase(edgeKey(b, a));
+            for (size_t k = 0; k < pieceJ.size(); ++k)
+            {
+                uint64_t key = edgeKey(pieceJ[k], pieceJ[(k + 1) % pieceJ.size()]);
+                if (owners.count(key)) owners[key] = i;
+            }
+            pieces[i] = merged;
+            pieces[j].clear();
+            alive[j] = false;
+        }
+
+        for (size_t i = 0; i < pieces.size(); ++i)
+        {
+            if (!alive[i]) continue;
+
+            Piece piece;
+            int count = (int)pieces[i].size();
+            for (int k = 0; k < count; ++k)
+            {
+                const Point& p = point(pieces[i][k]);
+                if (Cross(point(pieces[i][(k + count - 1) % count]), p, point(pieces[i][(k + 1) % count])) > 0.f)
+                {
+                    piece.push_back(p);
+                }
+            }
+            if (piece.size() >= 3)
+            {
+                m_pieces.push_back(piece);
+            }
+        }
+    }
+}
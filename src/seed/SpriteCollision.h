@@ -0,0 +1,69 @@
+#pragma once
+#include "SeedGlobals.h"
+
+namespace seed
+{
+    // Collision shapes cooked from the alpha of a texture. The outline of the
+    // opaque pixels is traced, simplified and cut into convex pieces of at most
+    // b2_maxPolygonVertices vertices, meant to be emitted as one b2PolygonShape
+    // fixture each on a single body. Holes in the sprite are filled.
+    class SpriteCollision
+    {
+    public:
+
+        // in pixels, relative to the top left of the traced rectangle
+        struct Point
+        {
+            float x;
+            float y;
+        };
+        typedef vector<Point>   Piece;
+        typedef vector<Piece>   PieceVect;
+
+        // sub-image of a texture, in pixels. An empty rectangle is the whole texture.
+        struct Rect
+        {
+            int x;
+            int y;
+            int width;
+            int height;
+        };
+
+        SpriteCollision();
+        ~SpriteCollision();
+
+        // Find the solid pixels of a png: those of in_rect with an alpha of at
+        // least in_alphaThreshold.
+        bool            Init(const string& in_textureFile, const Rect& in_rect = Rect(), uint8_t in_alphaThreshold = 128);
+
+        // Same from pixels already in memory, rgba rows of in_pitch bytes.
+        void            Init(const uint8_t* in_rgba, int in_width, int in_height, int in_pitch, uint8_t in_alphaThreshold = 128);
+
+        // Load the pieces from in_cacheFile if they were cooked from the same
+        // pixels and tolerance, otherwise build them and write the cache.
+        // in_tolerance is how far in pixels the simplified outline may stray
+        // from the traced one.
+        void            Cook(const string& in_cacheFile, float in_tolerance = 1.f);
+
+        int             GetWidth() const;
+        int             GetHeight() const;
+        bool            IsSolid(int in_x, int in_y) const;
+        const PieceVect& GetPieces() const;
+
+    private:
+
+        typedef vector<Point>   Loop;
+
+        uint32_t        ComputeKey(float in_tolerance) const;
+        bool            LoadCache(const string& in_cacheFile, uint32_t in_key);
+        void            SaveCache(const string& in_cacheFile, uint32_t in_key) const;
+        void            TraceLoops(vector<Loop>& out_loops) const;
+        void            Simplify(Loop& inout_loop, float in_tolerance) const;
+        void            Decompose(const Loop& in_loop);
+
+        int             m_width = 0;
+        int             m_height = 0;
+        vector<bool>    m_solid;
+        PieceVect       m_pieces;
+    };
+}
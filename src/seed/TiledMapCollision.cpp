@@ -0,0 +1,300 @@
+#include "App.h"
+#include "TiledMapCollision.h"
+#include "TiledMap.h"
+#include "tinyxml2.h"
+#include <unordered_set>
+
+// "SCOL" cache header, bump the version when the file layout changes
+#define TILEDMAPCOLLISION_MAGIC     0x4c4f4353
+#define TILEDMAPCOLLISION_VERSION   1
+
+// tmx gids carry the flip flags in their high bits
+#define TILEDMAPCOLLISION_GID_MASK  0x1fffffff
+
+namespace seed
+{
+    // outline directions, in clockwise order on screen (y points down)
+    static const int s_dirX[4] = { 1, 0, -1, 0 };
+    static const int s_dirY[4] = { 0, 1, 0, -1 };
+
+    TiledMapCollision::TiledMapCollision()
+    {
+    }
+
+    TiledMapCollision::~TiledMapCollision()
+    {
+    }
+
+    void TiledMapCollision::Init(const string& in_mapFile, onut::TiledMap* in_tiledMap, const string& in_layer)
+    {
+        m_width = 0;
+        m_height = 0;
+        m_solid.clear();
+        m_loops.clear();
+
+        tinyxml2::XMLDocument doc;
+        doc.LoadFile(in_mapFile.c_str());
+        tinyxml2::XMLElement* pXmlMap = doc.FirstChildElement("map");
+        if (!pXmlMap || !in_tiledMap)
+        {
+            OLogE("TiledMapCollision::Init could not read " + in_mapFile);
+            return;
+        }
+
+        pXmlMap->QueryAttribute("width", &m_width);
+        pXmlMap->QueryAttribute("height", &m_height);
+        pXmlMap->QueryAttribute("tilewidth", &m_tileWidth);
+        pXmlMap->QueryAttribute("tileheight", &m_tileHeight);
+        m_solid.resize(m_width * m_height, false);
+
+        // a dedicated collision layer wins over the tile flags
+        auto pCollisionLayer = dynamic_cast<onut::TiledMap::sTileLayer*>(in_tiledMap->getLayer(in_layer));
+        if (pCollisionLayer)
+        {
+            for (int i = 0; i < m_width * m_height; ++i)
+            {
+                m_solid[i] = (pCollisionLayer->tileIds[i] & TILEDMAPCOLLISION_GID_MASK) != 0;
+            }
+            return;
+        }
+
+        // gids of the tiles flagged solid. Only embedded tilesets are read.
+        unordered_set<uint32_t> solidIds;
+        for (auto pXmlTileset = pXmlMap->FirstChildElement("tileset"); pXmlTileset; pXmlTileset = pXmlTileset->NextSiblingElement("tileset"))
+        {
+            uint32_t firstId = 1;
+            pXmlTileset->QueryAttribute("firstgid", &firstId);
+            for (auto pXmlTile = pXmlTileset->FirstChildElement("tile"); pXmlTile; pXmlTile = pXmlTile->NextSiblingElement("tile"))
+            {
+                auto pXmlProperties = pXmlTile->FirstChildElement("properties");
+                if (!pXmlProperties) continue;
+                for (auto pXmlProperty = pXmlProperties->FirstChildElement("property"); pXmlProperty; pXmlProperty = pXmlProperty->NextSiblingElement("property"))
+                {
+                    const char* szName = pXmlProperty->Attribute("name");
+                    bool solid = false;
+                    pXmlProperty->QueryAttribute("value", &solid);
+                    if (szName && string(szName) == "solid" && solid)
+                    {
+                        uint32_t id = 0;
+                        pXmlTile->QueryAttribute("id", &id);
+                        solidIds.insert(firstId + id);
+                    }
+                }
+            }
+        }
+
+        if (solidIds.empty()) return;
+
+        for (int layer = 0; layer < in_tiledMap->getLayerCount(); ++layer)
+        {
+            auto pTileLayer = dynamic_cast<onut::TiledMap::sTileLayer*>(in_tiledMap->getLayer(layer));
+            if (!pTileLayer) continue;
+            for (int i = 0; i < m_width * m_height; ++i)
+            {
+                if (solidIds.count(pTileLayer->tileIds[i] & TILEDMAPCOLLISION_GID_MASK))
+                {
+                    m_solid[i] = true;
+                }
+            }
+        }
+    }
+
+    void TiledMapCollision::Cook(const string& in_cacheFile)
+    {
+        uint32_t key = ComputeKey();
+        if (LoadCache(in_cacheFile, key))
+        {
+            return;
+        }
+
+        TraceLoops();
+        SaveCache(in_cacheFile, key);
+    }
+
+    int TiledMapCollision::GetWidth() const
+    {
+        return m_width;
+    }
+
+    int TiledMapCollision::GetHeight() const
+    {
+        return m_height;
+    }
+
+    int TiledMapCollision::GetTileWidth() const
+    {
+        return m_tileWidth;
+    }
+
+    int TiledMapCollision::GetTileHeight() const
+    {
+        return m_tileHeight;
+    }
+
+    bool TiledMapCollision::IsSolid(int in_x, int in_y) const
+    {
+        if (in_x < 0 || in_y < 0 || in_x >= m_width || in_y >= m_height)
+        {
+            return false;
+        }
+        return m_solid[in_y * m_width + in_x];
+    }
+
+    const TiledMapCollision::LoopVect& TiledMapCollision::GetLoops() const
+    {
+        return m_loops;
+    }
+
+    uint32_t TiledMapCollision::ComputeKey() const
+    {
+        // FNV-1a over the map size and the solid cells
+        uint32_t key = 2166136261u;
+        auto hash = [&key](uint32_t in_value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                key ^= (in_value >> (i * 8)) & 0xff;
+                key *= 16777619u;
+            }
+        };
+
+        hash(TILEDMAPCOLLISION_VERSION);
+        hash(m_width);
+        hash(m_height);
+        for (bool solid : m_solid)
+        {
+            hash(solid ? 1 : 0);
+        }
+        return key;
+    }
+
+    bool TiledMapCollision::LoadCache(const string& in_cacheFile, uint32_t in_key)
+    {
+        FILE* pFile = fopen(in_cacheFile.c_str(), "rb");
+        if (!pFile) return false;
+
+        uint32_t header[3] = { 0 };
+        int loopCount = 0;
+        bool valid = fread(header, sizeof(header), 1, pFile) == 1 &&
+            header[0] == TILEDMAPCOLLISION_MAGIC &&
+            header[1] == TILEDMAPCOLLISION_VERSION &&
+            header[2] == in_key &&
+            fread(&loopCount, sizeof(loopCount), 1, pFile) == 1 &&
+            loopCount >= 0;
+
+        m_loops.clear();
+        for (int i = 0; valid && i < loopCount; ++i)
+        {
+            int pointCount = 0;
+            valid = fread(&pointCount, sizeof(pointCount), 1, pFile) == 1 && pointCount >= 3;
+            if (!valid) break;
+
+            Loop loop(pointCount);
+            valid = fread(loop.data(), sizeof(Point), pointCount, pFile) == (size_t)pointCount;
+            m_loops.push_back(loop);
+        }
+        fclose(pFile);
+
+        if (!valid)
+        {
+            m_loops.clear();
+        }
+        return valid;
+    }
+
+    void TiledMapCollision::SaveCache(const string& in_cacheFile, uint32_t in_key) const
+    {
+        FILE* pFile = fopen(in_cacheFile.c_str(), "wb");
+        if (!pFile)
+        {
+            OLogE("TiledMapCollision could not write " + in_cacheFile);
+            return;
+        }
+
+        uint32_t header[3] = { TILEDMAPCOLLISION_MAGIC, TILEDMAPCOLLISION_VERSION, in_key };
+        int loopCount = (int)m_loops.size();
+        fwrite(header, sizeof(header), 1, pFile);
+        fwrite(&loopCount, sizeof(loopCount), 1, pFile);
+        for (const Loop& loop : m_loops)
+        {
+            int pointCount = (int)loop.size();
+            fwrite(&pointCount, sizeof(pointCount), 1, pFile);
+            fwrite(loop.data(), sizeof(Point), pointCount, pFile);
+        }
+        fclose(pFile);
+    }
+
+    void TiledMapCollision::TraceLoops()
+    {
+        m_loops.clear();
+
+        // Outgoing boundary edges of each cell corner, one bit per direction.
+        // Edges run clockwise around solid cells on screen, so the chain normals
+        // face the empty cells.
+        const int stride = m_width + 1;
+        vector<uint8_t> edges(stride * (m_height + 1), 0);
+        for (int y = 0; y < m_height; ++y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                if (!IsSolid(x, y)) continue;
+                if (!IsSolid(x, y - 1)) edges[y * stride + x] |= 1 << 0;
+                if (!IsSolid(x + 1, y)) edges[y * stride + x + 1] |= 1 << 1;
+                if (!IsSolid(x, y + 1)) edges[(y + 1) * stride + x + 1] |= 1 << 2;
+                if (!IsSolid(x - 1, y)) edges[(y + 1) * stride + x] |= 1 << 3;
+            }
+        }
+
+        vector<Point> corners;
+        vector<int> dirs;
+        for (int start = 0; start < (int)edges.size(); ++start)
+        {
+            if (!edges[start]) continue;
+
+            // walk the outline, clearing its edges
+            corners.clear();
+            dirs.clear();
+            int corner = start;
+            int dir = 0;
+            while (dir < 4 && !(edges[corner] & (1 << dir))) ++dir;
+            do
+            {
+                // Two edges leave a corner where solid cells touch diagonally.
+                // Turning with the outline keeps those cells in separate loops.
+                if (!dirs.empty())
+                {
+                    int inDir = dirs.back();
+                    int turns[3] = { (inDir + 1) & 3, inDir, (inDir + 3) & 3 };
+                    for (int turn : turns)
+                    {
+                        if (edges[corner] & (1 << turn))
+                        {
+                            dir = turn;
+                            break;
+                        }
+                    }
+                }
+
+                edges[corner] &= ~(1 << dir);
+                corners.push_back({ corner % stride, corner / stride });
+                dirs.push_back(dir);
+                corner += s_dirY[dir] * stride + s_dirX[dir];
+            } while (corner != start);
+
+            // keep only the corners where the outline turns
+            Loop loop;
+            for (size_t i = 0; i < corners.size(); ++i)
+            {
+                int prevDir = dirs[(i + dirs.size() - 1) % dirs.size()];
+                if (dirs[i] != prevDir)
+                {
+                    loop.push_back(corners[i]);
+                }
+            }
+            m_loops.push_back(loop);
+
+            // a corner can start a second loop
+            --start;
+        }
+    }
+}
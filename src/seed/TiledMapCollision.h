@@ -0,0 +1,60 @@
+#pragma once
+#include "SeedGlobals.h"
+
+namespace onut
+{
+    class TiledMap;
+};
+
+namespace seed
+{
+    // Static collision cooked from a tile map. Solid cells are merged into
+    // outline loops, meant to be emitted as b2ChainShape loops on a single
+    // static body instead of one box per tile.
+    class TiledMapCollision
+    {
+    public:
+
+        // corner of a cell, in tiles
+        struct Point
+        {
+            int x;
+            int y;
+        };
+        typedef vector<Point>   Loop;
+        typedef vector<Loop>    LoopVect;
+
+        TiledMapCollision();
+        ~TiledMapCollision();
+
+        // Find the solid cells of the map. Every tile of the layer named in_layer
+        // is solid. Without such a layer, tiles with a "solid" property set in
+        // the map's tilesets are solid on all tile layers.
+        void            Init(const string& in_mapFile, onut::TiledMap* in_tiledMap, const string& in_layer = "collision");
+
+        // Load the loops from in_cacheFile if it was cooked from the same cells,
+        // otherwise trace them and write the cache.
+        void            Cook(const string& in_cacheFile);
+
+        int             GetWidth() const;
+        int             GetHeight() const;
+        int             GetTileWidth() const;
+        int             GetTileHeight() const;
+        bool            IsSolid(int in_x, int in_y) const;
+        const LoopVect& GetLoops() const;
+
+    private:
+
+        uint32_t        ComputeKey() const;
+        bool            LoadCache(const string& in_cacheFile, uint32_t in_key);
+        void            SaveCache(const string& in_cacheFile, uint32_t in_key) const;
+        void            TraceLoops();
+
+        int             m_width = 0;
+        int             m_height = 0;
+        int             m_tileWidth = 0;
+        int             m_tileHeight = 0;
+        vector<bool>    m_solid;
+        LoopVect        m_loops;
+    };
+}
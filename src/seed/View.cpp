@@ -686,6 +686,16 @@ namespace seed
         return m_physics.CreateCirclePhysicsForNode(in_node, in_radius, in_static);
     }
 
+    PhysicsBody* View::CreateTiledMapPhysicsForNode(TiledMapNode* in_node, const string& in_layer)
+    {
+        return m_physics.CreateTiledMapPhysicsForNode(in_node, in_layer);
+    }
+
+    PhysicsBody* View::CreateSpritePhysicsForNode(Sprite* in_node, bool in_static, float in_tolerance)
+    {
+        return m_physics.CreateSpritePhysicsForNode(in_node, in_static, in_tolerance);
+    }
+
     PhysicsBody* View::GetPhysicsForNode(Node* in_node)
     {
         return m_physics.GetBodyForNode(in_node);
@@ -82,6 +82,8 @@ namespace seed
         PhysicsMgr&     GetPhysics();
         PhysicsBody*    CreateBoxPhysicsForNode(Node* in_node, bool in_static);
         PhysicsBody*    CreateCirclePhysicsForNode(Node* in_node, float in_radius, bool in_static);
+        PhysicsBody*    CreateTiledMapPhysicsForNode(TiledMapNode* in_node, const string& in_layer = "collision");
+        PhysicsBody*    CreateSpritePhysicsForNode(Sprite* in_node, bool in_static, float in_tolerance = 1.f);
         PhysicsBody*    GetPhysicsForNode(Node* in_node);
         
     private: